@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "BytecodeCache.h"
+#include "BytecodeReader.h"
+#include "BytecodeWriter.h"
+
+namespace enact {
+    uint64_t BytecodeCache::hashSource(const std::string &source) {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : source) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    std::string BytecodeCache::pathFor(const std::string &sourcePath) {
+        return sourcePath + "c";
+    }
+
+    std::string BytecodeCache::serialise(FunctionObject *script, const std::string &source) {
+        return BytecodeWriter::write(script, hashSource(source));
+    }
+
+    FunctionObject *BytecodeCache::deserialise(const std::string &data, const std::string &source, GC &gc) {
+        if (!BytecodeReader::matches(reinterpret_cast<const uint8_t *>(data.data()), data.size(), hashSource(source))) {
+            return nullptr;
+        }
+
+        return BytecodeReader::read(data, gc);
+    }
+
+    FunctionObject *BytecodeCache::load(const std::string &sourcePath, const std::string &source, GC &gc) {
+        auto mapped = std::make_shared<const MappedFile>(pathFor(sourcePath));
+        if (mapped->isValid()) {
+            if (!BytecodeReader::matches(mapped->getData(), mapped->getSize(), hashSource(source))) {
+                return nullptr;
+            }
+
+            try {
+                return BytecodeReader::map(std::move(mapped), gc);
+            } catch (BytecodeReader::Invalid &) {
+                return nullptr;
+            }
+        }
+
+        // Without mmap, the whole file is read and copied instead.
+        std::ifstream file{pathFor(sourcePath), std::ios::binary};
+        if (!file) return nullptr;
+
+        std::stringstream data{};
+        data << file.rdbuf();
+
+        try {
+            return deserialise(data.str(), source, gc);
+        } catch (BytecodeReader::Invalid &) {
+            return nullptr;
+        }
+    }
+
+    bool BytecodeCache::store(const std::string &sourcePath, const std::string &source, FunctionObject *script) {
+        std::string data;
+        try {
+            data = serialise(script, source);
+        } catch (BytecodeWriter::Unsupported &) {
+            return false;
+        }
+
+        // Written to a temporary file and renamed over the cache, so that another run starting
+        // at the same time never reads half of one.
+        std::string path = pathFor(sourcePath);
+        std::string tempPath = path + ".tmp";
+
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (!file.write(data.data(), data.size())) {
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef ENACT_BYTECODECACHE_H
+#define ENACT_BYTECODECACHE_H
+
+#include <string>
+
+#include "../value/Object.h"
+
+namespace enact {
+    class GC;
+
+    // Keeps the compiled bytecode of a source file next to it, so that later runs of the same
+    // source can skip the front end. A cache is keyed by a hash of the source it was compiled
+    // from, and one written from different source, or by a different BYTECODE_VERSION, is
+    // ignored and overwritten the next time the source is compiled.
+    class BytecodeCache {
+    public:
+        // 64-bit FNV-1a.
+        static uint64_t hashSource(const std::string &source);
+
+        // Where the cache for a source file lives, which is the same path with a "c" on the end.
+        static std::string pathFor(const std::string &sourcePath);
+
+        static std::string serialise(FunctionObject *script, const std::string &source);
+
+        // Returns nullptr if data wasn't written from this source by this version.
+        static FunctionObject *deserialise(const std::string &data, const std::string &source, GC &gc);
+
+        // Returns nullptr if there is no usable cache, in which case the source has to be
+        // compiled as usual. Never throws, since a broken cache is just a slower start.
+        //
+        // Where it can, the cache is mapped rather than read, so the script's code is shared with
+        // every other process running it, and each function's constants are only read once the
+        // VM first calls it.
+        static FunctionObject *load(const std::string &sourcePath, const std::string &source, GC &gc);
+
+        // Writes the cache for a script that has just been compiled, before the VM has run it.
+        // Returns false if it couldn't be written, which the caller is free to ignore.
+        static bool store(const std::string &sourcePath, const std::string &source, FunctionObject *script);
+    };
+}
+
+#endif //ENACT_BYTECODECACHE_H
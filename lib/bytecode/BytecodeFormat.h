@@ -0,0 +1,45 @@
+#ifndef ENACT_BYTECODEFORMAT_H
+#define ENACT_BYTECODEFORMAT_H
+
+#include <cstdint>
+
+// The layout of a bytecode cache file, which BytecodeWriter writes and BytecodeReader reads.
+// Every integer is little-endian, and every string is a uint32_t length followed by its bytes.
+//
+//   header     magic, BYTECODE_VERSION (uint32_t), hash of the source (uint64_t)
+//   types      count (uint32_t), then each type, after any type that it refers to
+//   functions  count (uint32_t), then each function, after any function in its constants
+//
+// The script is the last function. Types and functions refer to each other by their index in
+// their table. A function's constants come last, after the indices of the functions among them and
+// their size in bytes, so that a reader can skip past them and read them later.
+namespace enact {
+    constexpr char BYTECODE_MAGIC[4] = {'E', 'N', 'B', 'C'};
+
+    // Bumped whenever the layout changes, or an opcode is added, removed or changes meaning.
+    constexpr uint32_t BYTECODE_VERSION = 2;
+
+    // Stands in for the index of a type that is null, as the type of the script is.
+    constexpr uint32_t BYTECODE_NO_TYPE = UINT32_MAX;
+
+    // What a constant in a function's constant pool is.
+    enum class ConstantTag : uint8_t {
+        NIL,
+        BOOL,
+        INT,
+        DOUBLE,
+        STRING,
+        FUNCTION,
+        TYPE,
+        NATIVE,
+    };
+
+    // Natives are stored as their index in this order, since their addresses change between runs.
+    enum class NativeTag : uint8_t {
+        PRINT,
+        PUT,
+        DIS,
+    };
+}
+
+#endif //ENACT_BYTECODEFORMAT_H
@@ -0,0 +1,25 @@
+#ifndef ENACT_BYTECODEIMAGE_H
+#define ENACT_BYTECODEIMAGE_H
+
+#include <memory>
+#include <vector>
+
+#include "../type/Type.h"
+#include "MappedFile.h"
+
+namespace enact {
+    class FunctionObject;
+
+    // What BytecodeReader::map() read from a bytecode cache file, which the chunks that it left
+    // pending share until their constants have been read.
+    //
+    // Nothing keeps the functions alive but the chunks that refer to them, so only the ones in a
+    // pending chunk's getPendingFunctions() are sure to still be there.
+    struct BytecodeImage {
+        std::shared_ptr<const MappedFile> file;
+        std::vector<Type> types;
+        std::vector<FunctionObject *> functions;
+    };
+}
+
+#endif //ENACT_BYTECODEIMAGE_H
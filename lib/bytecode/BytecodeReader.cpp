@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "../memory/GC.h"
+#include "../Natives.h"
+#include "BytecodeReader.h"
+
+namespace enact {
+    bool BytecodeReader::matches(const uint8_t *data, size_t size, uint64_t sourceHash) {
+        constexpr size_t headerSize = sizeof(BYTECODE_MAGIC) + sizeof(uint32_t) + sizeof(uint64_t);
+        if (size < headerSize || std::memcmp(data, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC)) != 0) {
+            return false;
+        }
+
+        auto readLittleEndian = [data](size_t offset, size_t size) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i) {
+                value |= static_cast<uint64_t>(data[offset + i]) << (i * 8);
+            }
+            return value;
+        };
+
+        return readLittleEndian(sizeof(BYTECODE_MAGIC), sizeof(uint32_t)) == BYTECODE_VERSION &&
+               readLittleEndian(sizeof(BYTECODE_MAGIC) + sizeof(uint32_t), sizeof(uint64_t)) == sourceHash;
+    }
+
+    FunctionObject *BytecodeReader::read(const std::string &data, GC &gc) {
+        BytecodeReader reader{std::make_shared<BytecodeImage>(), reinterpret_cast<const uint8_t *>(data.data()),
+                              data.size(), gc};
+
+        try {
+            FunctionObject *script = reader.readScript();
+            gc.popRoots(reader.m_rootCount);
+            return script;
+        } catch (...) {
+            gc.popRoots(reader.m_rootCount);
+            throw;
+        }
+    }
+
+    FunctionObject *BytecodeReader::map(std::shared_ptr<const MappedFile> file, GC &gc) {
+        const uint8_t *data = file->getData();
+        size_t size = file->getSize();
+
+        auto image = std::make_shared<BytecodeImage>();
+        image->file = std::move(file);
+        BytecodeReader reader{std::move(image), data, size, gc};
+
+        try {
+            FunctionObject *script = reader.readScript();
+            gc.popRoots(reader.m_rootCount);
+            return script;
+        } catch (...) {
+            gc.popRoots(reader.m_rootCount);
+            throw;
+        }
+    }
+
+    void BytecodeReader::loadConstants(FunctionObject *function, GC &gc) {
+        Chunk &chunk = function->getChunk();
+        if (!chunk.hasPendingConstants()) return;
+
+        // Copied, since the image goes away once the last of its chunks stops pointing to it.
+        std::shared_ptr<BytecodeImage> image = chunk.m_pendingImage;
+        BytecodeReader reader{image, image->file->getData(), image->file->getSize(), gc};
+        reader.m_offset = chunk.m_pendingOffset;
+        reader.m_pendingFunctions = &chunk.m_pendingFunctions;
+
+        try {
+            chunk.m_constants = reader.readConstants();
+        } catch (...) {
+            gc.popRoots(reader.m_rootCount);
+            throw;
+        }
+
+        chunk.m_pendingImage.reset();
+        chunk.m_pendingFunctions = {};
+        gc.resized(function);
+        for (Value constant : chunk.m_constants) {
+            gc.writeBarrier(function, constant);
+        }
+
+        gc.popRoots(reader.m_rootCount);
+    }
+
+    void BytecodeReader::loadAllConstants(FunctionObject *function, GC &gc) {
+        // Every function found is reachable from the constants of one that has been loaded.
+        std::vector<FunctionObject *> functions{function};
+        std::unordered_set<FunctionObject *> found{function};
+
+        while (!functions.empty()) {
+            FunctionObject *next = functions.back();
+            functions.pop_back();
+
+            loadConstants(next, gc);
+            for (Value constant : next->getChunk().getConstants()) {
+                if (!constant.isObject() || !constant.asObject()->is<FunctionObject>()) continue;
+
+                auto nested = constant.asObject()->as<FunctionObject>();
+                if (found.insert(nested).second) {
+                    functions.push_back(nested);
+                }
+            }
+        }
+    }
+
+    BytecodeReader::BytecodeReader(std::shared_ptr<BytecodeImage> image, const uint8_t *data, size_t size,
+                                   GC &gc) :
+            m_image{std::move(image)},
+            m_data{data},
+            m_size{size},
+            m_gc{gc} {
+    }
+
+    FunctionObject *BytecodeReader::readScript() {
+        expect(sizeof(BYTECODE_MAGIC));
+        if (std::memcmp(m_data, BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC)) != 0) {
+            throw Invalid{"Bytecode doesn't start with the right magic."};
+        }
+        m_offset += sizeof(BYTECODE_MAGIC);
+
+        if (readU32() != BYTECODE_VERSION) {
+            throw Invalid{"Bytecode was written by a different version."};
+        }
+        readU64();
+
+        uint32_t typeCount = readU32();
+        for (uint32_t i = 0; i < typeCount; ++i) {
+            m_image->types.push_back(readType());
+        }
+
+        uint32_t functionCount = readU32();
+        if (functionCount == 0) {
+            throw Invalid{"Bytecode has no script."};
+        }
+
+        for (uint32_t i = 0; i < functionCount; ++i) {
+            m_image->functions.push_back(readFunction());
+        }
+
+        if (m_offset != m_size) {
+            throw Invalid{"Bytecode has trailing data after the script."};
+        }
+
+        return m_image->functions.back();
+    }
+
+    Type BytecodeReader::readType() {
+        switch (static_cast<TypeKind>(readU8())) {
+            case TypeKind::PRIMITIVE: {
+                switch (static_cast<PrimitiveKind>(readU8())) {
+                    case PrimitiveKind::INT: return INT_TYPE;
+                    case PrimitiveKind::FLOAT: return FLOAT_TYPE;
+                    case PrimitiveKind::BOOL: return BOOL_TYPE;
+                    case PrimitiveKind::STRING: return STRING_TYPE;
+                    case PrimitiveKind::DYNAMIC: return DYNAMIC_TYPE;
+                    case PrimitiveKind::NOTHING: return NOTHING_TYPE;
+                }
+
+                throw Invalid{"Bytecode has an unknown primitive type."};
+            }
+
+            case TypeKind::ARRAY: {
+                return std::make_shared<ArrayType>(readTypeIndex());
+            }
+
+            case TypeKind::FUNCTION: {
+                Type returnType = readTypeIndex();
+
+                uint32_t argumentCount = readU32();
+                std::vector<Type> argumentTypes{};
+                for (uint32_t i = 0; i < argumentCount; ++i) {
+                    argumentTypes.push_back(readTypeIndex());
+                }
+
+                bool isMethod = readU8() != 0;
+                bool isNative = readU8() != 0;
+
+                return std::make_shared<FunctionType>(returnType, std::move(argumentTypes), isMethod, isNative);
+            }
+
+            case TypeKind::TRAIT: {
+                std::string name = readString();
+                return std::make_shared<TraitType>(std::move(name), readTypeMap());
+            }
+
+            case TypeKind::STRUCT: {
+                std::string name = readString();
+
+                uint32_t traitCount = readU32();
+                std::vector<std::shared_ptr<const TraitType>> traits{};
+                for (uint32_t i = 0; i < traitCount; ++i) {
+                    Type trait = readTypeIndex();
+                    if (!trait || !trait->isTrait()) {
+                        throw Invalid{"Bytecode has a struct type with a trait that isn't one."};
+                    }
+                    traits.push_back(std::static_pointer_cast<const TraitType>(trait));
+                }
+
+                InsertionOrderMap<std::string, Type> fields = readTypeMap();
+                InsertionOrderMap<std::string, Type> methods = readTypeMap();
+
+                return std::make_shared<StructType>(std::move(name), std::move(traits), std::move(fields),
+                                                    std::move(methods));
+            }
+
+            case TypeKind::CONSTRUCTOR: {
+                Type structType = readTypeIndex();
+                if (!structType || !structType->isStruct()) {
+                    throw Invalid{"Bytecode has a constructor type for something that isn't a struct."};
+                }
+
+                return std::make_shared<ConstructorType>(std::static_pointer_cast<const StructType>(structType),
+                                                         readTypeMap());
+            }
+        }
+
+        throw Invalid{"Bytecode has an unknown kind of type."};
+    }
+
+    FunctionObject *BytecodeReader::readFunction() {
+        std::string name = readString();
+        Type type = readTypeIndex();
+        uint32_t upvalueCount = readU32();
+
+        Chunk chunk{};
+        readCode(chunk);
+
+        uint32_t functionCount = readU32();
+        std::vector<FunctionObject *> functions{};
+        for (uint32_t i = 0; i < functionCount; ++i) {
+            functions.push_back(readFunctionIndex());
+        }
+
+        uint32_t constantsSize = readU32();
+        expect(constantsSize);
+        size_t constantsEnd = m_offset + constantsSize;
+
+        if (m_image->file) {
+            chunk.m_pendingImage = m_image;
+            chunk.m_pendingOffset = m_offset;
+            chunk.m_pendingFunctions = std::move(functions);
+            m_offset = constantsEnd;
+        } else {
+            chunk.m_constants = readConstants();
+            if (m_offset != constantsEnd) {
+                throw Invalid{"Bytecode has constants of the wrong size."};
+            }
+        }
+
+        auto function = keep(m_gc.allocateObject<FunctionObject>(type, std::move(chunk), std::move(name)));
+        function->getUpvalueCount() = upvalueCount;
+
+        return function;
+    }
+
+    void BytecodeReader::readCode(Chunk &chunk) {
+        uint32_t codeSize = readU32();
+        expect(codeSize);
+        if (m_image->file) {
+            chunk.m_code = CodeBuffer{m_image->file, m_image->file->getData() + m_offset, codeSize};
+        } else {
+            chunk.m_code.assign(m_data + m_offset, m_data + m_offset + codeSize);
+        }
+        m_offset += codeSize;
+
+        uint32_t startCount = readU32();
+        expect(static_cast<size_t>(startCount) * sizeof(uint32_t));
+        chunk.m_instructionStarts.reserve(startCount);
+        for (uint32_t i = 0; i < startCount; ++i) {
+            chunk.m_instructionStarts.push_back(readU32());
+        }
+
+        uint32_t lineCount = readU32();
+        for (uint32_t i = 0; i < lineCount; ++i) {
+            size_t start = readU32();
+            line_t line = readU32();
+            col_t col = readU16();
+            chunk.m_lines.add(start, line, col);
+        }
+
+        // Each cache belongs to one instruction, so there can't be more of them than bytes of code.
+        uint32_t cacheCount = readU32();
+        if (cacheCount > codeSize) {
+            throw Invalid{"Bytecode has more property caches than instructions."};
+        }
+        chunk.m_propertyCaches.resize(cacheCount);
+    }
+
+    std::vector<Value> BytecodeReader::readConstants() {
+        // The constants are kept rooted until the function that holds them has them.
+        uint32_t count = readU32();
+
+        // Each constant takes at least its tag, so a count that doesn't fit is caught before
+        // reserving room for it.
+        expect(count);
+
+        std::vector<Value> constants{};
+        constants.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            constants.push_back(readConstant());
+        }
+
+        return constants;
+    }
+
+    Value BytecodeReader::readConstant() {
+        switch (static_cast<ConstantTag>(readU8())) {
+            case ConstantTag::NIL: return Value{};
+            case ConstantTag::BOOL: return Value{readU8() != 0};
+            case ConstantTag::INT: return Value{static_cast<int>(readU32())};
+
+            case ConstantTag::DOUBLE: {
+                uint64_t bits = readU64();
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return Value{value};
+            }
+
+            case ConstantTag::STRING: {
+                return Value{keep(m_gc.allocateObject<StringObject>(readString()))};
+            }
+
+            case ConstantTag::FUNCTION: {
+                return Value{readFunctionIndex()};
+            }
+
+            case ConstantTag::TYPE: {
+                return Value{keep(m_gc.allocateObject<TypeObject>(readTypeIndex()))};
+            }
+
+            case ConstantTag::NATIVE: {
+                NativeFn function;
+                switch (static_cast<NativeTag>(readU8())) {
+                    case NativeTag::PRINT: function = Natives::print; break;
+                    case NativeTag::PUT: function = Natives::put; break;
+                    case NativeTag::DIS: function = Natives::dis; break;
+                    default: throw Invalid{"Bytecode has an unknown native."};
+                }
+
+                return Value{keep(m_gc.allocateObject<NativeObject>(readTypeIndex(), function))};
+            }
+        }
+
+        throw Invalid{"Bytecode has an unknown kind of constant."};
+    }
+
+    Type BytecodeReader::readTypeIndex() {
+        uint32_t index = readU32();
+        if (index == BYTECODE_NO_TYPE) return nullptr;
+
+        if (index >= m_image->types.size()) {
+            throw Invalid{"Bytecode refers to a type before it is defined."};
+        }
+        return m_image->types[index];
+    }
+
+    FunctionObject *BytecodeReader::readFunctionIndex() {
+        uint32_t index = readU32();
+        if (index >= m_image->functions.size()) {
+            throw Invalid{"Bytecode refers to a function before it is defined."};
+        }
+
+        // The rest of the image's functions could have been freed since it was mapped.
+        FunctionObject *function = m_image->functions[index];
+        if (m_pendingFunctions &&
+                std::find(m_pendingFunctions->begin(), m_pendingFunctions->end(), function) == m_pendingFunctions->end()) {
+            throw Invalid{"Bytecode refers to a function that isn't listed before its constants."};
+        }
+
+        return function;
+    }
+
+    InsertionOrderMap<std::string, Type> BytecodeReader::readTypeMap() {
+        InsertionOrderMap<std::string, Type> map{};
+
+        uint32_t count = readU32();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string key = readString();
+            map.insert(std::make_pair(key, readTypeIndex()));
+        }
+
+        return map;
+    }
+
+    template<typename T>
+    T *BytecodeReader::keep(T *object) {
+        m_gc.pushRoot(object);
+        ++m_rootCount;
+        return object;
+    }
+
+    uint8_t BytecodeReader::readU8() {
+        expect(1);
+        return m_data[m_offset++];
+    }
+
+    uint16_t BytecodeReader::readU16() {
+        uint16_t low = readU8();
+        return low | static_cast<uint16_t>(readU8() << 8);
+    }
+
+    uint32_t BytecodeReader::readU32() {
+        uint32_t low = readU16();
+        return low | (static_cast<uint32_t>(readU16()) << 16);
+    }
+
+    uint64_t BytecodeReader::readU64() {
+        uint64_t low = readU32();
+        return low | (static_cast<uint64_t>(readU32()) << 32);
+    }
+
+    std::string BytecodeReader::readString() {
+        uint32_t size = readU32();
+        expect(size);
+
+        std::string string{reinterpret_cast<const char *>(m_data) + m_offset, size};
+        m_offset += size;
+        return string;
+    }
+
+    void BytecodeReader::expect(size_t count) {
+        if (m_size - m_offset < count) {
+            throw Invalid{"Bytecode ends unexpectedly."};
+        }
+    }
+}
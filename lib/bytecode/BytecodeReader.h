@@ -0,0 +1,94 @@
+#ifndef ENACT_BYTECODEREADER_H
+#define ENACT_BYTECODEREADER_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../value/Object.h"
+#include "BytecodeFormat.h"
+#include "BytecodeImage.h"
+
+namespace enact {
+    class GC;
+
+    // Rebuilds a script and everything that it refers to from what BytecodeWriter wrote, without
+    // going through the front end.
+    class BytecodeReader {
+        friend class SnapshotReader;
+
+    public:
+        class Invalid : public std::runtime_error {
+        public:
+            explicit Invalid(const std::string &what) : std::runtime_error{what} {}
+        };
+
+        // Whether data has the right magic and version, and was written from source with the
+        // given hash. Anything that doesn't should be thrown away rather than read.
+        static bool matches(const uint8_t *data, size_t size, uint64_t sourceHash);
+
+        // Throws Invalid if data is truncated or refers to something that it doesn't contain.
+        // Nothing but the caller holds onto the script, so it has to be rooted before anything
+        // else is allocated.
+        static FunctionObject *read(const std::string &data, GC &gc);
+
+        // Reads a mapped cache file without copying its code, which the chunks borrow from the
+        // mapping instead. Their constants are left pending until loadConstants() is called.
+        static FunctionObject *map(std::shared_ptr<const MappedFile> file, GC &gc);
+
+        // Reads the constants of a function that map() left pending, if it hasn't already.
+        static void loadConstants(FunctionObject *function, GC &gc);
+
+        // Reads the constants of a function and of every function that it refers to, for code
+        // that needs the whole program at once.
+        static void loadAllConstants(FunctionObject *function, GC &gc);
+
+    private:
+        std::shared_ptr<BytecodeImage> m_image;
+
+        const uint8_t *m_data;
+        size_t m_size;
+        size_t m_offset = 0;
+
+        GC &m_gc;
+        size_t m_rootCount = 0;
+
+        // When loading pending constants, the only functions that they can refer to.
+        const std::vector<FunctionObject *> *m_pendingFunctions = nullptr;
+
+        BytecodeReader(std::shared_ptr<BytecodeImage> image, const uint8_t *data, size_t size, GC &gc);
+
+        FunctionObject *readScript();
+
+        Type readType();
+        FunctionObject *readFunction();
+
+        // Reads everything about a chunk but its constants.
+        void readCode(Chunk &chunk);
+
+        std::vector<Value> readConstants();
+        Value readConstant();
+
+        // Reads the index of a type or function that has already been read.
+        Type readTypeIndex();
+        FunctionObject *readFunctionIndex();
+
+        InsertionOrderMap<std::string, Type> readTypeMap();
+
+        // Roots an object for as long as the reader is running.
+        template<typename T>
+        T *keep(T *object);
+
+        uint8_t readU8();
+        uint16_t readU16();
+        uint32_t readU32();
+        uint64_t readU64();
+        std::string readString();
+
+        // Throws Invalid unless there are another count bytes to read.
+        void expect(size_t count);
+    };
+}
+
+#endif //ENACT_BYTECODEREADER_H
@@ -0,0 +1,245 @@
+#include <cstring>
+
+#include "../Natives.h"
+#include "BytecodeWriter.h"
+
+namespace enact {
+    std::string BytecodeWriter::write(FunctionObject *script, uint64_t sourceHash) {
+        BytecodeWriter writer{};
+        writer.writeFunction(script);
+
+        std::string out{};
+        out.append(BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+        writeU32(out, BYTECODE_VERSION);
+        writeU64(out, sourceHash);
+
+        writeU32(out, writer.m_typeCount);
+        out += writer.m_types;
+
+        writeU32(out, writer.m_functionCount);
+        out += writer.m_functions;
+
+        return out;
+    }
+
+    uint32_t BytecodeWriter::writeType(const Type &type) {
+        if (!type) return BYTECODE_NO_TYPE;
+
+        auto found = m_typeIndices.find(type.get());
+        if (found != m_typeIndices.end()) {
+            if (found->second == BYTECODE_NO_TYPE) {
+                throw Unsupported{"Type '" + type->toString() + "' refers to itself."};
+            }
+            return found->second;
+        }
+
+        // Marks the type as being written, so that a type which refers back to itself is caught
+        // instead of recursing forever.
+        m_typeIndices[type.get()] = BYTECODE_NO_TYPE;
+
+        std::string entry{};
+        writeU8(entry, static_cast<uint8_t>(type->getKind()));
+
+        switch (type->getKind()) {
+            case TypeKind::PRIMITIVE: {
+                writeU8(entry, static_cast<uint8_t>(type->as<PrimitiveType>()->getPrimitiveKind()));
+                break;
+            }
+
+            case TypeKind::ARRAY: {
+                writeU32(entry, writeType(type->as<ArrayType>()->getElementType()));
+                break;
+            }
+
+            case TypeKind::FUNCTION: {
+                auto functionType = type->as<FunctionType>();
+                writeU32(entry, writeType(functionType->getReturnType()));
+
+                writeU32(entry, functionType->getArgumentTypes().size());
+                for (const Type &argumentType : functionType->getArgumentTypes()) {
+                    writeU32(entry, writeType(argumentType));
+                }
+
+                writeU8(entry, functionType->isMethod());
+                writeU8(entry, functionType->isNative());
+                break;
+            }
+
+            case TypeKind::TRAIT: {
+                auto traitType = type->as<TraitType>();
+                writeString(entry, traitType->getName());
+                writeTypeMap(entry, traitType->getMethods());
+                break;
+            }
+
+            case TypeKind::STRUCT: {
+                auto structType = type->as<StructType>();
+                writeString(entry, structType->getName());
+
+                writeU32(entry, structType->getTraits().size());
+                for (const auto &trait : structType->getTraits()) {
+                    writeU32(entry, writeType(trait));
+                }
+
+                writeTypeMap(entry, structType->getFields());
+                writeTypeMap(entry, structType->getMethods());
+                break;
+            }
+
+            case TypeKind::CONSTRUCTOR: {
+                auto constructorType = type->as<ConstructorType>();
+                writeU32(entry, writeType(constructorType->getStructType()));
+                writeTypeMap(entry, constructorType->getAssocProperties());
+                break;
+            }
+        }
+
+        m_types += entry;
+        m_typeIndices[type.get()] = m_typeCount;
+        return m_typeCount++;
+    }
+
+    uint32_t BytecodeWriter::writeFunction(FunctionObject *function) {
+        auto found = m_functionIndices.find(function);
+        if (found != m_functionIndices.end()) return found->second;
+
+        const Chunk &chunk = function->getChunk();
+        if (chunk.hasPendingConstants()) {
+            throw Unsupported{"Function '" + function->getName() + "' hasn't had its constants loaded."};
+        }
+
+        std::string entry{};
+        writeString(entry, function->getName());
+        writeU32(entry, writeType(function->getType()));
+        writeU32(entry, function->getUpvalueCount());
+
+        writeCode(entry, chunk);
+
+        std::string constants{};
+        writeU32(constants, chunk.getConstants().size());
+        for (Value constant : chunk.getConstants()) {
+            writeConstant(constants, constant);
+        }
+
+        std::vector<uint32_t> functions{};
+        for (Value constant : chunk.getConstants()) {
+            if (constant.isObject() && constant.asObject()->is<FunctionObject>()) {
+                functions.push_back(m_functionIndices[constant.asObject()->as<FunctionObject>()]);
+            }
+        }
+
+        writeU32(entry, functions.size());
+        for (uint32_t index : functions) {
+            writeU32(entry, index);
+        }
+
+        writeU32(entry, constants.size());
+        entry += constants;
+
+        m_functions += entry;
+        m_functionIndices[function] = m_functionCount;
+        return m_functionCount++;
+    }
+
+    void BytecodeWriter::writeCode(std::string &out, const Chunk &chunk) {
+        writeU32(out, chunk.getCode().size());
+        out.append(reinterpret_cast<const char *>(chunk.getCode().data()), chunk.getCode().size());
+
+        writeU32(out, chunk.getInstructionStarts().size());
+        for (size_t start : chunk.getInstructionStarts()) {
+            writeU32(out, start);
+        }
+
+        writeU32(out, chunk.getLines().getEntries().size());
+        for (const LineTableEntry &line : chunk.getLines().getEntries()) {
+            writeU32(out, line.start);
+            writeU32(out, line.line);
+            writeU16(out, line.col);
+        }
+
+        // The caches are filled in as the VM runs, so only how many there are is kept.
+        writeU32(out, chunk.getPropertyCaches().size());
+    }
+
+    void BytecodeWriter::writeConstant(std::string &out, Value constant) {
+        if (constant.isNil()) {
+            writeU8(out, static_cast<uint8_t>(ConstantTag::NIL));
+        } else if (constant.isBool()) {
+            writeU8(out, static_cast<uint8_t>(ConstantTag::BOOL));
+            writeU8(out, constant.asBool());
+        } else if (constant.isInt()) {
+            writeU8(out, static_cast<uint8_t>(ConstantTag::INT));
+            writeU32(out, static_cast<uint32_t>(constant.asInt()));
+        } else if (constant.isDouble()) {
+            double value = constant.asDouble();
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+
+            writeU8(out, static_cast<uint8_t>(ConstantTag::DOUBLE));
+            writeU64(out, bits);
+        } else if (constant.asObject()->is<StringObject>()) {
+            writeU8(out, static_cast<uint8_t>(ConstantTag::STRING));
+            writeString(out, constant.asObject()->as<StringObject>()->asStdString());
+        } else if (constant.asObject()->is<FunctionObject>()) {
+            uint32_t index = writeFunction(constant.asObject()->as<FunctionObject>());
+            writeU8(out, static_cast<uint8_t>(ConstantTag::FUNCTION));
+            writeU32(out, index);
+        } else if (constant.asObject()->is<TypeObject>()) {
+            uint32_t index = writeType(constant.asObject()->as<TypeObject>()->getContainedType());
+            writeU8(out, static_cast<uint8_t>(ConstantTag::TYPE));
+            writeU32(out, index);
+        } else if (constant.asObject()->is<NativeObject>()) {
+            auto native = constant.asObject()->as<NativeObject>();
+
+            NativeTag tag;
+            if (native->getFunction() == Natives::print) {
+                tag = NativeTag::PRINT;
+            } else if (native->getFunction() == Natives::put) {
+                tag = NativeTag::PUT;
+            } else if (native->getFunction() == Natives::dis) {
+                tag = NativeTag::DIS;
+            } else {
+                throw Unsupported{"Native '" + native->toString() + "' isn't one of the built-in natives."};
+            }
+
+            uint32_t index = writeType(native->getType());
+            writeU8(out, static_cast<uint8_t>(ConstantTag::NATIVE));
+            writeU8(out, static_cast<uint8_t>(tag));
+            writeU32(out, index);
+        } else {
+            throw Unsupported{"Constant '" + constant.asObject()->toString() + "' can't be written."};
+        }
+    }
+
+    void BytecodeWriter::writeTypeMap(std::string &out, const InsertionOrderMap<std::string, Type> &map) {
+        writeU32(out, map.length());
+        for (const auto &pair : map) {
+            writeString(out, pair.first);
+            writeU32(out, writeType(pair.second));
+        }
+    }
+
+    void BytecodeWriter::writeU8(std::string &out, uint8_t value) {
+        out.push_back(static_cast<char>(value));
+    }
+
+    void BytecodeWriter::writeU16(std::string &out, uint16_t value) {
+        writeU8(out, value & 0xff);
+        writeU8(out, value >> 8);
+    }
+
+    void BytecodeWriter::writeU32(std::string &out, uint32_t value) {
+        writeU16(out, value & 0xffff);
+        writeU16(out, value >> 16);
+    }
+
+    void BytecodeWriter::writeU64(std::string &out, uint64_t value) {
+        writeU32(out, value & 0xffffffff);
+        writeU32(out, value >> 32);
+    }
+
+    void BytecodeWriter::writeString(std::string &out, const std::string &string) {
+        writeU32(out, string.size());
+        out += string;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef ENACT_BYTECODEWRITER_H
+#define ENACT_BYTECODEWRITER_H
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "../value/Object.h"
+#include "BytecodeFormat.h"
+
+namespace enact {
+    // Serialises a compiled script, along with every function and type that its constants refer
+    // to, into the format described in BytecodeFormat.h.
+    class BytecodeWriter {
+        friend class SnapshotWriter;
+
+    public:
+        class Unsupported : public std::runtime_error {
+        public:
+            explicit Unsupported(const std::string &what) : std::runtime_error{what} {}
+        };
+
+        // Must be given the script straight from the compiler, since the VM rewrites code in
+        // place as it runs. Throws Unsupported if a constant can't be written.
+        static std::string write(FunctionObject *script, uint64_t sourceHash);
+
+    private:
+        std::string m_types{};
+        uint32_t m_typeCount = 0;
+        std::unordered_map<const TypeBase *, uint32_t> m_typeIndices{};
+
+        std::string m_functions{};
+        uint32_t m_functionCount = 0;
+        std::unordered_map<const FunctionObject *, uint32_t> m_functionIndices{};
+
+        BytecodeWriter() = default;
+
+        // Each of these writes whatever the value refers to into its own table first, and
+        // returns its index.
+        uint32_t writeType(const Type &type);
+        uint32_t writeFunction(FunctionObject *function);
+
+        // Writes everything about a chunk but its constants.
+        static void writeCode(std::string &out, const Chunk &chunk);
+
+        void writeConstant(std::string &out, Value constant);
+        void writeTypeMap(std::string &out, const InsertionOrderMap<std::string, Type> &map);
+
+        static void writeU8(std::string &out, uint8_t value);
+        static void writeU16(std::string &out, uint16_t value);
+        static void writeU32(std::string &out, uint32_t value);
+        static void writeU64(std::string &out, uint64_t value);
+        static void writeString(std::string &out, const std::string &string);
+    };
+}
+
+#endif //ENACT_BYTECODEWRITER_H
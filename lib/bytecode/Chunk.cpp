@@ -6,24 +6,25 @@
 #include "Chunk.h"
 
 namespace enact {
-    void Chunk::write(uint8_t byte, line_t line) {
+    void Chunk::write(uint8_t byte, line_t line, col_t col) {
+        m_lines.add(m_code.size(), line, col);
         m_code.push_back(byte);
-        m_lines.insert(std::pair(m_code.size() - 1, line));
     }
 
-    void Chunk::write(OpCode byte, line_t line) {
-        write(static_cast<uint8_t>(byte), line);
+    void Chunk::write(OpCode byte, line_t line, col_t col) {
+        m_instructionStarts.push_back(m_code.size());
+        write(static_cast<uint8_t>(byte), line, col);
     }
 
-    void Chunk::writeShort(uint32_t value, line_t line) {
-        write(static_cast<uint8_t>(value & 0xff), line);
-        write(static_cast<uint8_t>((value >> 8) & 0xff), line);
+    void Chunk::writeShort(uint32_t value, line_t line, col_t col) {
+        write(static_cast<uint8_t>(value & 0xff), line, col);
+        write(static_cast<uint8_t>((value >> 8) & 0xff), line, col);
     }
 
-    void Chunk::writeLong(uint32_t value, line_t line) {
-        write(static_cast<uint8_t>(value & 0xff), line);
-        write(static_cast<uint8_t>((value >> 8) & 0xff), line);
-        write(static_cast<uint8_t>((value >> 16) & 0xff), line);
+    void Chunk::writeLong(uint32_t value, line_t line, col_t col) {
+        write(static_cast<uint8_t>(value & 0xff), line, col);
+        write(static_cast<uint8_t>((value >> 8) & 0xff), line, col);
+        write(static_cast<uint8_t>((value >> 16) & 0xff), line, col);
     }
 
     void Chunk::rewrite(size_t index, uint8_t byte) {
@@ -34,20 +35,71 @@ namespace enact {
         m_code[index] = static_cast<uint8_t>(byte);
     }
 
+    // A sequence of instructions, which all take byte-sized operands, that can be replaced by one opcode.
+    struct Superinstruction {
+        OpCode fused;
+        std::vector<OpCode> sequence;
+        size_t length;
+    };
+
+    // Ordered longest-first, since the first sequence that matches is the one that gets fused.
+    static const std::vector<Superinstruction> SUPERINSTRUCTIONS{
+            {OpCode::ADD_INT_LOCAL_CONST_SET,
+                    {OpCode::GET_LOCAL, OpCode::CONSTANT, OpCode::ADD_INT, OpCode::SET_LOCAL, OpCode::POP}, 8},
+            {OpCode::LESS_INT_LOCAL_CONST_JUMP,
+                    {OpCode::GET_LOCAL, OpCode::CONSTANT, OpCode::LESS_INT, OpCode::JUMP_IF_FALSE}, 8},
+            {OpCode::GET_LOCAL_GET_LOCAL,
+                    {OpCode::GET_LOCAL, OpCode::GET_LOCAL}, 4},
+    };
+
+    void Chunk::fuseSuperinstructions() {
+        for (size_t i = 0; i < m_instructionStarts.size(); ++i) {
+            for (const Superinstruction &superinstruction : SUPERINSTRUCTIONS) {
+                const std::vector<OpCode> &sequence = superinstruction.sequence;
+                if (i + sequence.size() > m_instructionStarts.size()) continue;
+
+                bool matches = true;
+                for (size_t j = 0; j < sequence.size(); ++j) {
+                    if (static_cast<OpCode>(m_code[m_instructionStarts[i + j]]) != sequence[j]) {
+                        matches = false;
+                        break;
+                    }
+                }
+
+                if (matches) {
+                    rewrite(m_instructionStarts[i], superinstruction.fused);
+
+                    // The table is longest-first, so the first match is the best one. Skip over
+                    // the instructions it covers.
+                    i += sequence.size() - 1;
+                    break;
+                }
+            }
+        }
+
+        // Anything written after this point (like the next part of a REPL session) is fused separately.
+        m_instructionStarts.clear();
+    }
+
     size_t Chunk::addConstant(Value constant) {
         m_constants.push_back(constant);
         return m_constants.size() - 1;
     }
 
-    void Chunk::writeConstant(Value constant, line_t line) {
+    size_t Chunk::addPropertyCache() {
+        m_propertyCaches.emplace_back();
+        return m_propertyCaches.size() - 1;
+    }
+
+    void Chunk::writeConstant(Value constant, line_t line, col_t col) {
         size_t index = addConstant(constant);
 
         if (index < UINT8_MAX) {
-            write(OpCode::CONSTANT, line);
-            write(static_cast<uint8_t>(index), line);
+            write(OpCode::CONSTANT, line, col);
+            write(static_cast<uint8_t>(index), line, col);
         } else {
-            write(OpCode::CONSTANT_LONG, line);
-            writeLong(static_cast<uint32_t>(index), line);
+            write(OpCode::CONSTANT_LONG, line, col);
+            writeLong(static_cast<uint32_t>(index), line, col);
         }
     }
 
@@ -57,6 +109,12 @@ namespace enact {
 
         s << "-- disassembly --\n";
 
+        // CLOSURE instructions can't even be measured without the function in their constant.
+        if (hasPendingConstants()) {
+            s << "(not loaded until the function is first called)\n";
+            return s.str();
+        }
+
         for (size_t i = 0; i < m_code.size();) {
             std::string str;
             std::tie(str, i) = disassembleInstruction(i);
@@ -82,6 +140,10 @@ namespace enact {
 
         s << " ";
 
+        // Everything but STRUCT is measured here, and the disassembly only has to print it.
+        size_t start = index;
+        size_t length = getInstructionLength(index);
+
         auto op = static_cast<OpCode>(m_code[index]);
         switch (op) {
             // Simple instructions
@@ -101,9 +163,21 @@ namespace enact {
             case OpCode::SUBTRACT:
             case OpCode::MULTIPLY:
             case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
             case OpCode::LESS:
             case OpCode::GREATER:
             case OpCode::EQUAL:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
             case OpCode::GET_ARRAY_INDEX:
             case OpCode::SET_ARRAY_INDEX:
             case OpCode::POP:
@@ -117,7 +191,6 @@ namespace enact {
             }
 
                 // Byte instructions
-            case OpCode::ARRAY:
             case OpCode::GET_LOCAL:
             case OpCode::SET_LOCAL:
             case OpCode::GET_UPVALUE:
@@ -149,7 +222,6 @@ namespace enact {
             }
 
                 // Long instructions
-            case OpCode::ARRAY_LONG:
             case OpCode::GET_LOCAL_LONG:
             case OpCode::SET_LOCAL_LONG:
             case OpCode::GET_UPVALUE_LONG:
@@ -167,8 +239,9 @@ namespace enact {
                 // Constant instructions
             case OpCode::CONSTANT:
             case OpCode::CHECK_TYPE:
-            case OpCode::GET_PROPERTY_DYNAMIC:
-            case OpCode::SET_PROPERTY_DYNAMIC: {
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_BOOL: {
                 std::string str;
                 std::tie(str, index) = disassembleConstant(index);
                 s << str;
@@ -178,10 +251,77 @@ namespace enact {
                 // Long constant instructions
             case OpCode::CONSTANT_LONG:
             case OpCode::CHECK_TYPE_LONG:
+            case OpCode::CHECK_TYPE_INT_LONG:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+            case OpCode::CHECK_TYPE_BOOL_LONG: {
+                std::string str;
+                std::tie(str, index) = disassembleLongConstant(index);
+                s << str;
+                break;
+            }
+
+                // Array instructions
+            case OpCode::ARRAY: {
+                std::string str;
+                std::tie(str, index) = disassembleArray(index, false);
+                s << str;
+                break;
+            }
+            case OpCode::ARRAY_LONG: {
+                std::string str;
+                std::tie(str, index) = disassembleArray(index, true);
+                s << str;
+                break;
+            }
+
+                // Dynamic property instructions
+            case OpCode::GET_PROPERTY_DYNAMIC:
+            case OpCode::SET_PROPERTY_DYNAMIC: {
+                std::string str;
+                std::tie(str, index) = disassembleProperty(index, false);
+                s << str;
+                break;
+            }
             case OpCode::GET_PROPERTY_DYNAMIC_LONG:
             case OpCode::SET_PROPERTY_DYNAMIC_LONG: {
                 std::string str;
-                std::tie(str, index) = disassembleLongConstant(index);
+                std::tie(str, index) = disassembleProperty(index, true);
+                s << str;
+                break;
+            }
+
+                // Invoke instructions
+            case OpCode::INVOKE: {
+                std::string str;
+                std::tie(str, index) = disassembleInvoke(index, false, false);
+                s << str;
+                break;
+            }
+            case OpCode::INVOKE_LONG: {
+                std::string str;
+                std::tie(str, index) = disassembleInvoke(index, true, false);
+                s << str;
+                break;
+            }
+            case OpCode::INVOKE_DYNAMIC: {
+                std::string str;
+                std::tie(str, index) = disassembleInvoke(index, false, true);
+                s << str;
+                break;
+            }
+            case OpCode::INVOKE_DYNAMIC_LONG: {
+                std::string str;
+                std::tie(str, index) = disassembleInvoke(index, true, true);
+                s << str;
+                break;
+            }
+
+                // Superinstructions
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET: {
+                std::string str;
+                std::tie(str, index) = disassembleSuperinstruction(index);
                 s << str;
                 break;
             }
@@ -217,7 +357,7 @@ namespace enact {
             }
         }
 
-        return {s.str(), index};
+        return {s.str(), length == 0 ? index : start + length};
     }
 
     std::pair<std::string, size_t> Chunk::disassembleSimple(size_t index) const {
@@ -246,11 +386,11 @@ namespace enact {
         s << std::left << std::setw(MAX_INSTRUCTION_NAME_LENGTH) << opCodeToString(static_cast<OpCode>(m_code[index]));
         s.flags(f);
 
-        // Output the long argument
-        uint16_t arg = (m_code[++index] | (m_code[++index] << 8));
+        // Output the short argument
+        uint16_t arg = static_cast<uint16_t>(m_code[index + 1] | (m_code[index + 2] << 8));
         s << " " << static_cast<size_t>(arg) << "\n";
 
-        return {s.str(), ++index};
+        return {s.str(), index + 3};
     }
 
     std::pair<std::string, size_t> Chunk::disassembleLong(size_t index) const {
@@ -261,10 +401,35 @@ namespace enact {
         s.flags(f);
 
         // Output the long argument
-        uint32_t arg = (m_code[++index] | (m_code[++index] << 8) | (m_code[++index] << 16));
+        uint32_t arg = m_code[index + 1] | (m_code[index + 2] << 8) | (m_code[index + 3] << 16);
         s << " " << static_cast<size_t>(arg) << "\n";
 
-        return {s.str(), ++index};
+        return {s.str(), index + 4};
+    }
+
+    std::pair<std::string, size_t> Chunk::disassembleArray(size_t index, bool isLong) const {
+        std::stringstream s;
+        std::ios_base::fmtflags f(s.flags());
+
+        s << std::left << std::setw(MAX_INSTRUCTION_NAME_LENGTH) << opCodeToString(static_cast<OpCode>(m_code[index]));
+        s.flags(f);
+
+        // Output the length, and then the constant holding the array's type
+        size_t length;
+        size_t constant;
+        if (isLong) {
+            length = m_code[index + 1] | (m_code[index + 2] << 8) | (m_code[index + 3] << 16);
+            constant = m_code[index + 4] | (m_code[index + 5] << 8) | (m_code[index + 6] << 16);
+            index += 7;
+        } else {
+            length = m_code[index + 1];
+            constant = m_code[index + 2];
+            index += 3;
+        }
+
+        s << " " << length << " " << constant << " (" << m_constants[constant] << ")\n";
+
+        return {s.str(), index};
     }
 
     std::pair<std::string, size_t> Chunk::disassembleConstant(size_t index, size_t argCount) const {
@@ -305,6 +470,95 @@ namespace enact {
         return {s.str(), ++index};
     }
 
+    std::pair<std::string, size_t> Chunk::disassembleProperty(size_t index, bool isLong) const {
+        std::stringstream s;
+        std::ios_base::fmtflags f(s.flags());
+
+        s << std::left << std::setw(MAX_INSTRUCTION_NAME_LENGTH) << opCodeToString(static_cast<OpCode>(m_code[index]));
+        s.flags(f);
+
+        // Output the name constant, followed by the index of the instruction's inline cache
+        size_t constant;
+        size_t cache;
+        if (isLong) {
+            constant = m_code[index + 1] | (m_code[index + 2] << 8) | (m_code[index + 3] << 16);
+            cache = m_code[index + 4] | (m_code[index + 5] << 8) | (m_code[index + 6] << 16);
+            index += 6;
+        } else {
+            constant = m_code[index + 1];
+            cache = m_code[index + 2];
+            index += 2;
+        }
+
+        s << " " << constant << " (" << m_constants[constant] << ") cache " << cache << "\n";
+
+        return {s.str(), ++index};
+    }
+
+    std::pair<std::string, size_t> Chunk::disassembleInvoke(size_t index, bool isLong, bool isDynamic) const {
+        std::stringstream s;
+        std::ios_base::fmtflags f(s.flags());
+
+        s << std::left << std::setw(MAX_INSTRUCTION_NAME_LENGTH) << opCodeToString(static_cast<OpCode>(m_code[index]));
+        s.flags(f);
+
+        size_t argCount = m_code[++index];
+
+        // Read the method index, or the name constant and cache index for dynamic invokes
+        auto readOperand = [&]() -> size_t {
+            if (isLong) {
+                size_t operand = m_code[index + 1] | (m_code[index + 2] << 8) | (m_code[index + 3] << 16);
+                index += 3;
+                return operand;
+            }
+            return m_code[++index];
+        };
+
+        s << " " << argCount << " args ";
+        if (isDynamic) {
+            size_t constant = readOperand();
+            size_t cache = readOperand();
+            s << constant << " (" << m_constants[constant] << ") cache " << cache << "\n";
+        } else {
+            s << "method " << readOperand() << "\n";
+        }
+
+        return {s.str(), ++index};
+    }
+
+    std::pair<std::string, size_t> Chunk::disassembleSuperinstruction(size_t index) const {
+        std::stringstream s;
+        std::ios_base::fmtflags f(s.flags());
+
+        auto op = static_cast<OpCode>(m_code[index]);
+        s << std::left << std::setw(MAX_INSTRUCTION_NAME_LENGTH) << opCodeToString(op);
+        s.flags(f);
+
+        // Output the operands of each fused instruction, in order
+        const uint8_t *operands = &m_code[index + 1];
+        size_t length = 0;
+        switch (op) {
+            case OpCode::GET_LOCAL_GET_LOCAL:
+                s << " " << static_cast<size_t>(operands[0]) << " " << static_cast<size_t>(operands[2]) << "\n";
+                length = 4;
+                break;
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+                s << " " << static_cast<size_t>(operands[0]) << " " << static_cast<size_t>(operands[2]) <<
+                  " (" << m_constants[operands[2]] << ") " << (operands[5] | (operands[6] << 8)) << "\n";
+                length = 8;
+                break;
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                s << " " << static_cast<size_t>(operands[0]) << " " << static_cast<size_t>(operands[2]) <<
+                  " (" << m_constants[operands[2]] << ") " << static_cast<size_t>(operands[5]) << "\n";
+                length = 8;
+                break;
+            default:
+                break;
+        }
+
+        return {s.str(), index + length};
+    }
+
     std::pair<std::string, size_t> Chunk::disassembleClosure(size_t index, bool isLong) const {
         std::stringstream s;
         std::ios_base::fmtflags f(s.flags());
@@ -411,30 +665,51 @@ namespace enact {
         return {s.str(), index};
     }
 
-    line_t Chunk::getLine(size_t index) const {
-        line_t line = 0;
-
-        while (index >= 0 && m_lines.count(index) <= 0) {
-            --index;
+    size_t Chunk::getInstructionLength(size_t index) const {
+        auto op = static_cast<OpCode>(m_code[index]);
+        if (op != OpCode::CLOSURE && op != OpCode::CLOSURE_LONG) {
+            return instructionLength(op);
         }
 
-        if (m_lines.count(index) > 0) {
-            line = m_lines.find(index)->second;
+        bool isLong = op == OpCode::CLOSURE_LONG;
+        size_t length = isLong ? 4 : 2;
+        if (index + length > m_code.size()) return 0;
+
+        size_t constant = isLong
+                          ? m_code[index + 1] | (m_code[index + 2] << 8) | (m_code[index + 3] << 16)
+                          : m_code[index + 1];
+        if (constant >= m_constants.size()) return 0;
+
+        Value function = m_constants[constant];
+        if (!function.isObject() || !function.asObject()->is<FunctionObject>()) return 0;
+
+        // Each upvalue is an isLocal byte and an index, which is long from the 256th on.
+        uint32_t upvalueCount = function.asObject()->as<FunctionObject>()->getUpvalueCount();
+        for (uint32_t i = 0; i < upvalueCount; ++i) {
+            length += i < UINT8_MAX ? 2 : 4;
         }
 
-        return line;
+        if (index + length > m_code.size()) return 0;
+        return length;
+    }
+
+    line_t Chunk::getLine(size_t index) const {
+        return m_lines.getLine(index);
+    }
+
+    col_t Chunk::getColumn(size_t index) const {
+        return m_lines.getColumn(index);
     }
 
     line_t Chunk::getCurrentLine() const {
-        line_t line = 1;
-        if (m_code.size() > 1) {
-            line = getLine(m_code.size() - 2);
-        }
+        return m_lines.getLastLine();
+    }
 
-        return line;
+    col_t Chunk::getCurrentColumn() const {
+        return m_lines.getLastColumn();
     }
 
-    const std::vector<uint8_t> &Chunk::getCode() const {
+    const CodeBuffer &Chunk::getCode() const {
         return m_code;
     }
 
@@ -442,10 +717,31 @@ namespace enact {
         return m_constants;
     }
 
+    const std::vector<PropertyCache> &Chunk::getPropertyCaches() const {
+        return m_propertyCaches;
+    }
+
+    const LineTable &Chunk::getLines() const {
+        return m_lines;
+    }
+
+    const std::vector<size_t> &Chunk::getInstructionStarts() const {
+        return m_instructionStarts;
+    }
+
+    const std::vector<FunctionObject *> &Chunk::getPendingFunctions() const {
+        return m_pendingFunctions;
+    }
+
     size_t Chunk::getCount() const {
         return m_code.size();
     }
 
+    size_t Chunk::getHeapSize() const {
+        return m_code.getHeapSize() + heapSizeOf(m_constants) + heapSizeOf(m_propertyCaches) +
+               m_lines.getHeapSize() + heapSizeOf(m_instructionStarts) + heapSizeOf(m_pendingFunctions);
+    }
+
     std::string opCodeToString(OpCode code) {
         switch (code) {
             case OpCode::CONSTANT:
@@ -474,6 +770,18 @@ namespace enact {
                 return "CHECK_TYPE";
             case OpCode::CHECK_TYPE_LONG:
                 return "CHECK_TYPE_LONG";
+            case OpCode::CHECK_TYPE_INT:
+                return "CHECK_TYPE_INT";
+            case OpCode::CHECK_TYPE_INT_LONG:
+                return "CHECK_TYPE_INT_LONG";
+            case OpCode::CHECK_TYPE_FLOAT:
+                return "CHECK_TYPE_FLOAT";
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+                return "CHECK_TYPE_FLOAT_LONG";
+            case OpCode::CHECK_TYPE_BOOL:
+                return "CHECK_TYPE_BOOL";
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+                return "CHECK_TYPE_BOOL_LONG";
             case OpCode::NEGATE:
                 return "NEGATE";
             case OpCode::NOT:
@@ -488,12 +796,36 @@ namespace enact {
                 return "MULTIPLY";
             case OpCode::DIVIDE:
                 return "DIVIDE";
+            case OpCode::ADD_INT:
+                return "ADD_INT";
+            case OpCode::SUBTRACT_INT:
+                return "SUBTRACT_INT";
+            case OpCode::MULTIPLY_INT:
+                return "MULTIPLY_INT";
+            case OpCode::DIVIDE_INT:
+                return "DIVIDE_INT";
+            case OpCode::ADD_FLOAT:
+                return "ADD_FLOAT";
+            case OpCode::SUBTRACT_FLOAT:
+                return "SUBTRACT_FLOAT";
+            case OpCode::MULTIPLY_FLOAT:
+                return "MULTIPLY_FLOAT";
+            case OpCode::DIVIDE_FLOAT:
+                return "DIVIDE_FLOAT";
             case OpCode::LESS:
                 return "LESS";
             case OpCode::GREATER:
                 return "GREATER";
             case OpCode::EQUAL:
                 return "EQUAL";
+            case OpCode::LESS_INT:
+                return "LESS_INT";
+            case OpCode::GREATER_INT:
+                return "GREATER_INT";
+            case OpCode::LESS_FLOAT:
+                return "LESS_FLOAT";
+            case OpCode::GREATER_FLOAT:
+                return "GREATER_FLOAT";
             case OpCode::ARRAY:
                 return "ARRAY";
             case OpCode::ARRAY_LONG:
@@ -562,6 +894,14 @@ namespace enact {
                 return "CALL_NATIVE";
             case OpCode::CALL_DYNAMIC:
                 return "CALL_DYNAMIC";
+            case OpCode::INVOKE:
+                return "INVOKE";
+            case OpCode::INVOKE_LONG:
+                return "INVOKE_LONG";
+            case OpCode::INVOKE_DYNAMIC:
+                return "INVOKE_DYNAMIC";
+            case OpCode::INVOKE_DYNAMIC_LONG:
+                return "INVOKE_DYNAMIC_LONG";
             case OpCode::CLOSURE:
                 return "CLOSURE";
             case OpCode::CLOSURE_LONG:
@@ -574,6 +914,12 @@ namespace enact {
                 return "STRUCT";
             case OpCode::STRUCT_LONG:
                 return "STRUCT_LONG";
+            case OpCode::GET_LOCAL_GET_LOCAL:
+                return "GET_LOCAL_GET_LOCAL";
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+                return "LESS_INT_LOCAL_CONST_JUMP";
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                return "ADD_INT_LOCAL_CONST_SET";
             case OpCode::PAUSE:
                 return "PAUSE";
                 // Unreachable.
@@ -581,4 +927,111 @@ namespace enact {
                 return "";
         }
     }
+
+    size_t instructionLength(OpCode op) {
+        switch (op) {
+            case OpCode::TRUE:
+            case OpCode::FALSE:
+            case OpCode::NIL:
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_NUMERIC:
+            case OpCode::CHECK_BOOL:
+            case OpCode::CHECK_REFERENCE:
+            case OpCode::CHECK_INDEXABLE:
+            case OpCode::CHECK_ALLOTABLE:
+            case OpCode::NEGATE:
+            case OpCode::NOT:
+            case OpCode::COPY:
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::EQUAL:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+            case OpCode::GET_ARRAY_INDEX:
+            case OpCode::SET_ARRAY_INDEX:
+            case OpCode::POP:
+            case OpCode::CLOSE_UPVALUE:
+            case OpCode::RETURN:
+            case OpCode::PAUSE:
+                return 1;
+
+            case OpCode::CONSTANT:
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_BOOL:
+            case OpCode::GET_LOCAL:
+            case OpCode::SET_LOCAL:
+            case OpCode::GET_UPVALUE:
+            case OpCode::SET_UPVALUE:
+            case OpCode::GET_FIELD:
+            case OpCode::SET_FIELD:
+            case OpCode::GET_METHOD:
+            case OpCode::GET_ASSOC:
+            case OpCode::CALL_FUNCTION:
+            case OpCode::CALL_BOUND_METHOD:
+            case OpCode::CALL_CONSTRUCTOR:
+            case OpCode::CALL_NATIVE:
+            case OpCode::CALL_DYNAMIC:
+                return 2;
+
+            // The length of the array, and the constant holding its type.
+            case OpCode::ARRAY:
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::LOOP:
+            case OpCode::GET_PROPERTY_DYNAMIC:
+            case OpCode::SET_PROPERTY_DYNAMIC:
+            case OpCode::INVOKE:
+                return 3;
+
+            case OpCode::CONSTANT_LONG:
+            case OpCode::CHECK_TYPE_LONG:
+            case OpCode::CHECK_TYPE_INT_LONG:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+            case OpCode::GET_LOCAL_LONG:
+            case OpCode::SET_LOCAL_LONG:
+            case OpCode::GET_UPVALUE_LONG:
+            case OpCode::SET_UPVALUE_LONG:
+            case OpCode::GET_FIELD_LONG:
+            case OpCode::SET_FIELD_LONG:
+            case OpCode::GET_METHOD_LONG:
+            case OpCode::GET_ASSOC_LONG:
+            case OpCode::INVOKE_DYNAMIC:
+            case OpCode::GET_LOCAL_GET_LOCAL:
+                return 4;
+
+            case OpCode::INVOKE_LONG:
+                return 5;
+
+            case OpCode::ARRAY_LONG:
+            case OpCode::GET_PROPERTY_DYNAMIC_LONG:
+            case OpCode::SET_PROPERTY_DYNAMIC_LONG:
+                return 7;
+
+            case OpCode::INVOKE_DYNAMIC_LONG:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                return 8;
+
+            default:
+                return 0;
+        }
+    }
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 
 #include "../common.h"
 #include "../value/Value.h"
+#include "CodeBuffer.h"
+#include "LineTable.h"
+#include "PropertyCache.h"
 
 namespace enact {
     enum class OpCode : uint8_t {
@@ -24,6 +27,14 @@ namespace enact {
         CHECK_TYPE,
         CHECK_TYPE_LONG,
 
+        // Quickened forms of CHECK_TYPE(_LONG), which are only ever written by the VM.
+        CHECK_TYPE_INT,
+        CHECK_TYPE_INT_LONG,
+        CHECK_TYPE_FLOAT,
+        CHECK_TYPE_FLOAT_LONG,
+        CHECK_TYPE_BOOL,
+        CHECK_TYPE_BOOL_LONG,
+
         NEGATE,
         NOT,
         COPY,
@@ -33,10 +44,27 @@ namespace enact {
         MULTIPLY,
         DIVIDE,
 
+        // Arithmetic on operands that are statically known to both be ints, or both be floats.
+        ADD_INT,
+        SUBTRACT_INT,
+        MULTIPLY_INT,
+        DIVIDE_INT,
+
+        ADD_FLOAT,
+        SUBTRACT_FLOAT,
+        MULTIPLY_FLOAT,
+        DIVIDE_FLOAT,
+
         LESS,
         GREATER,
         EQUAL,
 
+        LESS_INT,
+        GREATER_INT,
+
+        LESS_FLOAT,
+        GREATER_FLOAT,
+
         ARRAY,
         ARRAY_LONG,
 
@@ -87,6 +115,12 @@ namespace enact {
         CALL_NATIVE,
         CALL_DYNAMIC,
 
+        INVOKE,
+        INVOKE_LONG,
+
+        INVOKE_DYNAMIC,
+        INVOKE_DYNAMIC_LONG,
+
         CLOSURE,
         CLOSURE_LONG,
 
@@ -97,18 +131,47 @@ namespace enact {
         STRUCT,
         STRUCT_LONG,
 
+        // Superinstructions, fused by Chunk::fuseSuperinstructions() from the sequences named
+        // in their comments. Only the first opcode of the sequence is overwritten, so the
+        // rest of it is left intact and can still be jumped into.
+        GET_LOCAL_GET_LOCAL,        // GET_LOCAL a, GET_LOCAL b
+        LESS_INT_LOCAL_CONST_JUMP,  // GET_LOCAL a, CONSTANT k, LESS_INT, JUMP_IF_FALSE offset
+        ADD_INT_LOCAL_CONST_SET,    // GET_LOCAL a, CONSTANT k, ADD_INT, SET_LOCAL b, POP
+
         PAUSE,
     };
 
     std::string opCodeToString(OpCode code);
 
+    // How many bytes an instruction with the given opcode takes up, operands included. A
+    // superinstruction covers the whole sequence that it was fused from. Returns 0 for CLOSURE
+    // and STRUCT instructions, whose length depends on the constant they refer to, so they have
+    // to be measured with Chunk::getInstructionLength().
+    size_t instructionLength(OpCode op);
+
+    struct BytecodeImage;
+
+    class FunctionObject;
+
     class Chunk {
+        friend class BytecodeReader;
+
         static constexpr size_t MAX_INSTRUCTION_NAME_LENGTH = 26;
 
-        std::vector<uint8_t> m_code;
+        CodeBuffer m_code;
         std::vector<Value> m_constants;
+        std::vector<PropertyCache> m_propertyCaches;
 
-        std::unordered_map<size_t, line_t> m_lines;
+        LineTable m_lines;
+
+        // The index of every opcode written, so that passes over the code can find instruction boundaries.
+        std::vector<size_t> m_instructionStarts;
+
+        // Set on a chunk mapped from a bytecode cache file until its constants have been read,
+        // with where in the file they start, and the functions that they refer to.
+        std::shared_ptr<BytecodeImage> m_pendingImage{};
+        size_t m_pendingOffset = 0;
+        std::vector<FunctionObject *> m_pendingFunctions{};
 
         std::pair<std::string, size_t> disassembleSimple(size_t index) const;
         std::pair<std::string, size_t> disassembleByte(size_t index) const;
@@ -116,6 +179,10 @@ namespace enact {
         std::pair<std::string, size_t> disassembleLong(size_t index) const;
         std::pair<std::string, size_t> disassembleConstant(size_t index, size_t argCount = 1) const;
         std::pair<std::string, size_t> disassembleLongConstant(size_t index, size_t argCount = 1) const;
+        std::pair<std::string, size_t> disassembleArray(size_t index, bool isLong) const;
+        std::pair<std::string, size_t> disassembleProperty(size_t index, bool isLong) const;
+        std::pair<std::string, size_t> disassembleInvoke(size_t index, bool isLong, bool isDynamic) const;
+        std::pair<std::string, size_t> disassembleSuperinstruction(size_t index) const;
         std::pair<std::string, size_t> disassembleClosure(size_t index, bool isLong) const;
         std::pair<std::string, size_t> disassembleStruct(size_t index, bool isLong) const;
         std::pair<std::string, size_t> disassembleClosureArgs(size_t index, bool isLong) const;
@@ -123,28 +190,65 @@ namespace enact {
     public:
         Chunk() = default;
 
-        void write(uint8_t byte, line_t line);
-        void write(OpCode byte, line_t line);
-        void writeShort(uint32_t value, line_t line);
-        void writeLong(uint32_t value, line_t line);
-        void writeConstant(Value constant, line_t line);
+        void write(uint8_t byte, line_t line, col_t col = 0);
+        void write(OpCode byte, line_t line, col_t col = 0);
+        void writeShort(uint32_t value, line_t line, col_t col = 0);
+        void writeLong(uint32_t value, line_t line, col_t col = 0);
+        void writeConstant(Value constant, line_t line, col_t col = 0);
 
         size_t addConstant(Value constant);
+        size_t addPropertyCache();
 
         void rewrite(size_t index, uint8_t byte);
         void rewrite(size_t index, OpCode byte);
 
+        // Replaces common instruction sequences with superinstructions. Run once the chunk's
+        // jumps have all been patched.
+        void fuseSuperinstructions();
+
         std::string disassemble() const;
         std::pair<std::string, size_t> disassembleInstruction(size_t index) const;
 
+        // The length of the instruction at index, with CLOSURE instructions measured by the
+        // function in their constant. Returns 0 if it can't be told: for STRUCT instructions, and
+        // for CLOSUREs whose constant hasn't been loaded, isn't a function, or would run past
+        // the end of the code.
+        size_t getInstructionLength(size_t index) const;
+
         line_t getLine(size_t index) const;
+        col_t getColumn(size_t index) const;
         line_t getCurrentLine() const;
+        col_t getCurrentColumn() const;
+
+        const CodeBuffer &getCode() const;
 
-        const std::vector<uint8_t> &getCode() const;
+        // Empty until any pending constants have been read by BytecodeReader::loadConstants().
         const std::vector<Value> &getConstants() const;
 
+        inline PropertyCache &getPropertyCache(size_t index);
+        const std::vector<PropertyCache> &getPropertyCaches() const;
+        const LineTable &getLines() const;
+        const std::vector<size_t> &getInstructionStarts() const;
+
+        // Inline, since the VM checks it on every call.
+        inline bool hasPendingConstants() const;
+
+        // Kept alive by the GC in place of the pending constants.
+        const std::vector<FunctionObject *> &getPendingFunctions() const;
+
         size_t getCount() const;
+
+        // How many bytes the chunk holds outside of itself.
+        size_t getHeapSize() const;
     };
+
+    inline PropertyCache &Chunk::getPropertyCache(size_t index) {
+        return m_propertyCaches[index];
+    }
+
+    inline bool Chunk::hasPendingConstants() const {
+        return m_pendingImage != nullptr;
+    }
 }
 
 #endif //ENACT_CHUNK_H
@@ -0,0 +1,114 @@
+#ifndef ENACT_CODEBUFFER_H
+#define ENACT_CODEBUFFER_H
+
+#include <memory>
+#include <vector>
+
+#include "../common.h"
+#include "MappedFile.h"
+
+namespace enact {
+    // The code of a chunk, which is either owned, or borrowed from a mapped bytecode cache file.
+    // Borrowed code is mapped copy-on-write, so it can still be rewritten in place, and only the
+    // pages that are rewritten stop being shared with other processes running the same file.
+    class CodeBuffer {
+        std::vector<uint8_t> m_owned{};
+
+        // Keeps borrowed code mapped for as long as the buffer needs it.
+        std::shared_ptr<const MappedFile> m_file{};
+
+        // Point into either m_owned or m_file, and are updated whenever m_owned changes.
+        uint8_t *m_data = nullptr;
+        size_t m_size = 0;
+
+        // Copies borrowed code into m_owned before it is grown.
+        inline void own() {
+            if (m_file) {
+                m_owned.assign(m_data, m_data + m_size);
+                m_file.reset();
+            }
+        }
+
+        inline void update() {
+            m_data = m_owned.data();
+            m_size = m_owned.size();
+        }
+
+    public:
+        CodeBuffer() = default;
+
+        inline CodeBuffer(std::shared_ptr<const MappedFile> file, uint8_t *data, size_t size) :
+                m_file{std::move(file)},
+                m_data{data},
+                m_size{size} {
+        }
+
+        // A copy always owns its code, so that rewriting one never changes the other.
+        inline CodeBuffer(const CodeBuffer &other) : m_owned{other.m_data, other.m_data + other.m_size} {
+            update();
+        }
+
+        inline CodeBuffer(CodeBuffer &&other) noexcept :
+                m_owned{std::move(other.m_owned)},
+                m_file{std::move(other.m_file)},
+                m_data{other.m_data},
+                m_size{other.m_size} {
+            other.update();
+        }
+
+        inline CodeBuffer &operator=(CodeBuffer other) noexcept {
+            std::swap(m_owned, other.m_owned);
+            std::swap(m_file, other.m_file);
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            return *this;
+        }
+
+        inline void assign(const uint8_t *first, const uint8_t *last) {
+            m_file.reset();
+            m_owned.assign(first, last);
+            update();
+        }
+
+        inline void push_back(uint8_t byte) {
+            own();
+            m_owned.push_back(byte);
+            update();
+        }
+
+        inline uint8_t &operator[](size_t index) {
+            return m_data[index];
+        }
+
+        inline const uint8_t &operator[](size_t index) const {
+            return m_data[index];
+        }
+
+        inline uint8_t *data() {
+            return m_data;
+        }
+
+        inline const uint8_t *data() const {
+            return m_data;
+        }
+
+        inline size_t size() const {
+            return m_size;
+        }
+
+        inline bool empty() const {
+            return m_size == 0;
+        }
+
+        inline bool isBorrowed() const {
+            return m_file != nullptr;
+        }
+
+        // Borrowed code lives in the page cache, so it isn't counted.
+        inline size_t getHeapSize() const {
+            return heapSizeOf(m_owned);
+        }
+    };
+}
+
+#endif //ENACT_CODEBUFFER_H
@@ -0,0 +1,68 @@
+#ifndef ENACT_LINETABLE_H
+#define ENACT_LINETABLE_H
+
+#include <algorithm>
+#include <vector>
+
+#include "../common.h"
+
+namespace enact {
+    // Where in the source the code from `start` onwards came from, up to the next entry.
+    struct LineTableEntry {
+        size_t start;
+        line_t line;
+        col_t col;
+    };
+
+    // Maps offsets in a chunk's code back to the source, run-length encoded so that an entry is
+    // only added when the position changes. Offsets must be added in increasing order, and
+    // lookups binary search for the run that they fall in.
+    class LineTable {
+        std::vector<LineTableEntry> m_entries{};
+
+        inline const LineTableEntry *find(size_t offset) const {
+            auto entry = std::upper_bound(m_entries.begin(), m_entries.end(), offset,
+                                          [](size_t offset, const LineTableEntry &entry) {
+                                              return offset < entry.start;
+                                          });
+
+            // Code from before the first entry has no position.
+            return entry == m_entries.begin() ? nullptr : &*(entry - 1);
+        }
+
+    public:
+        inline void add(size_t offset, line_t line, col_t col = 0) {
+            if (!m_entries.empty() && m_entries.back().line == line && m_entries.back().col == col) return;
+            m_entries.push_back(LineTableEntry{offset, line, col});
+        }
+
+        inline line_t getLine(size_t offset) const {
+            const LineTableEntry *entry = find(offset);
+            return entry ? entry->line : 0;
+        }
+
+        inline col_t getColumn(size_t offset) const {
+            const LineTableEntry *entry = find(offset);
+            return entry ? entry->col : 0;
+        }
+
+        // The position of the last code added, or line 1 if there isn't any.
+        inline line_t getLastLine() const {
+            return m_entries.empty() ? 1 : m_entries.back().line;
+        }
+
+        inline col_t getLastColumn() const {
+            return m_entries.empty() ? 0 : m_entries.back().col;
+        }
+
+        inline const std::vector<LineTableEntry> &getEntries() const {
+            return m_entries;
+        }
+
+        inline size_t getHeapSize() const {
+            return heapSizeOf(m_entries);
+        }
+    };
+}
+
+#endif //ENACT_LINETABLE_H
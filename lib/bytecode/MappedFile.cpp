@@ -0,0 +1,54 @@
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ENACT_HAS_MMAP
+#endif
+
+#include "MappedFile.h"
+
+namespace enact {
+    MappedFile::MappedFile(const std::string &path) {
+#ifdef ENACT_HAS_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) return;
+
+        struct stat status{};
+        if (fstat(fd, &status) != 0 || status.st_size == 0) {
+            close(fd);
+            return;
+        }
+
+        auto size = static_cast<size_t>(status.st_size);
+        void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+        // The mapping keeps the file open on its own.
+        close(fd);
+        if (memory == MAP_FAILED) return;
+
+        m_data = static_cast<uint8_t *>(memory);
+        m_size = size;
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+#ifdef ENACT_HAS_MMAP
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+#endif
+    }
+
+    bool MappedFile::isValid() const {
+        return m_data != nullptr;
+    }
+
+    uint8_t *MappedFile::getData() const {
+        return m_data;
+    }
+
+    size_t MappedFile::getSize() const {
+        return m_size;
+    }
+}
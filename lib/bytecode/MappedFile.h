@@ -0,0 +1,35 @@
+#ifndef ENACT_MAPPEDFILE_H
+#define ENACT_MAPPEDFILE_H
+
+#include <string>
+
+#include "../common.h"
+
+namespace enact {
+    // A whole file mapped into memory copy-on-write. Its pages are shared through the page cache
+    // with every other process that maps the same file, until one of them is written to.
+    //
+    // Whoever replaces the file has to rename a new one over it, rather than writing to it in
+    // place, since the mapping would see the changes.
+    class MappedFile {
+        uint8_t *m_data = nullptr;
+        size_t m_size = 0;
+
+    public:
+        // Mapping can fail, so check isValid() before reading anything.
+        explicit MappedFile(const std::string &path);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool isValid() const;
+
+        uint8_t *getData() const;
+
+        size_t getSize() const;
+    };
+}
+
+#endif //ENACT_MAPPEDFILE_H
@@ -0,0 +1,64 @@
+#ifndef ENACT_PROPERTYCACHE_H
+#define ENACT_PROPERTYCACHE_H
+
+#include <array>
+
+#include "../common.h"
+
+namespace enact {
+    class StructObject;
+
+    // How many different receivers one property access will remember. Once a cache is full
+    // it is megamorphic, and any receiver it hasn't seen always takes the slow path.
+    constexpr size_t PROPERTY_CACHE_SIZE = 4;
+
+    enum class PropertyKind : uint8_t {
+        FIELD,
+        METHOD,
+        ASSOC,
+    };
+
+    // What a property name resolved to for one receiver. For FIELD and METHOD the receiver
+    // was an instance of `struct_`, while for ASSOC it was `struct_` itself.
+    struct PropertyCacheEntry {
+        StructObject *struct_;
+        PropertyKind kind;
+        uint32_t index;
+    };
+
+    // An inline cache belonging to a single GET_PROPERTY_DYNAMIC(_LONG) or
+    // SET_PROPERTY_DYNAMIC(_LONG) instruction, which saves the VM from looking
+    // the property's name up again for receivers it has already seen.
+    class PropertyCache {
+        std::array<PropertyCacheEntry, PROPERTY_CACHE_SIZE> m_entries{};
+        uint8_t m_count = 0;
+
+    public:
+        inline const PropertyCacheEntry *find(const StructObject *struct_, bool isInstance) const {
+            for (uint8_t i = 0; i < m_count; ++i) {
+                const PropertyCacheEntry &entry = m_entries[i];
+                if (entry.struct_ == struct_ && (entry.kind != PropertyKind::ASSOC) == isInstance) {
+                    return &entry;
+                }
+            }
+
+            return nullptr;
+        }
+
+        inline void insert(PropertyCacheEntry entry) {
+            if (m_count < PROPERTY_CACHE_SIZE) {
+                m_entries[m_count++] = entry;
+            }
+        }
+
+        inline const PropertyCacheEntry *begin() const {
+            return m_entries.data();
+        }
+
+        inline const PropertyCacheEntry *end() const {
+            return m_entries.data() + m_count;
+        }
+    };
+}
+
+#endif //ENACT_PROPERTYCACHE_H
@@ -0,0 +1,312 @@
+#include <iomanip>
+#include <sstream>
+
+#include "../value/Object.h"
+
+#include "RegisterChunk.h"
+
+namespace enact {
+    // The operands of each instruction, one character per operand: 'r' is a register, 'k' a
+    // constant, 'K' a 3 byte constant, 'u' an upvalue, 'n' a count, 'j' a forward jump and 'l' a
+    // backward one. CLOSURE is followed by its upvalues, which aren't covered here.
+    static const char *operandLayout(RegisterOp op) {
+        switch (op) {
+            case RegisterOp::MOVE:
+            case RegisterOp::NEGATE:
+            case RegisterOp::NOT:
+                return "rr";
+            case RegisterOp::LOAD_CONSTANT:
+            case RegisterOp::CHECK_TYPE:
+            case RegisterOp::CLOSURE:
+                return "rk";
+            case RegisterOp::LOAD_CONSTANT_LONG:
+            case RegisterOp::CHECK_TYPE_LONG:
+                return "rK";
+            case RegisterOp::LOAD_TRUE:
+            case RegisterOp::LOAD_FALSE:
+            case RegisterOp::LOAD_NIL:
+            case RegisterOp::CHECK_INT:
+            case RegisterOp::CHECK_NUMERIC:
+            case RegisterOp::CHECK_BOOL:
+            case RegisterOp::CLOSE_UPVALUES:
+            case RegisterOp::RETURN:
+                return "r";
+            case RegisterOp::ADD_INT_CONSTANT:
+            case RegisterOp::SUBTRACT_INT_CONSTANT:
+            case RegisterOp::MULTIPLY_INT_CONSTANT:
+            case RegisterOp::DIVIDE_INT_CONSTANT:
+            case RegisterOp::LESS_INT_CONSTANT:
+            case RegisterOp::GREATER_INT_CONSTANT:
+                return "rrk";
+            case RegisterOp::GET_UPVALUE:
+                return "ru";
+            case RegisterOp::SET_UPVALUE:
+                return "ur";
+            case RegisterOp::JUMP:
+                return "j";
+            case RegisterOp::LOOP:
+                return "l";
+            case RegisterOp::JUMP_IF_TRUE:
+            case RegisterOp::JUMP_IF_FALSE:
+                return "rj";
+            case RegisterOp::JUMP_IF_NOT_LESS_INT:
+            case RegisterOp::JUMP_IF_NOT_GREATER_INT:
+                return "rrj";
+            case RegisterOp::JUMP_IF_NOT_LESS_INT_CONSTANT:
+            case RegisterOp::JUMP_IF_NOT_GREATER_INT_CONSTANT:
+                return "rkj";
+            case RegisterOp::CALL_FUNCTION:
+            case RegisterOp::CALL_NATIVE:
+                return "rn";
+            default:
+                return "rrr";
+        }
+    }
+
+    void RegisterChunk::write(uint8_t byte) {
+        m_code.push_back(byte);
+    }
+
+    void RegisterChunk::write(RegisterOp op, line_t line) {
+        m_lines.add(m_code.size(), line);
+        write(static_cast<uint8_t>(op));
+    }
+
+    void RegisterChunk::writeShort(uint32_t value) {
+        write(static_cast<uint8_t>(value & 0xff));
+        write(static_cast<uint8_t>((value >> 8) & 0xff));
+    }
+
+    void RegisterChunk::writeLong(uint32_t value) {
+        write(static_cast<uint8_t>(value & 0xff));
+        write(static_cast<uint8_t>((value >> 8) & 0xff));
+        write(static_cast<uint8_t>((value >> 16) & 0xff));
+    }
+
+    void RegisterChunk::rewrite(size_t index, uint8_t byte) {
+        m_code[index] = byte;
+    }
+
+    std::string RegisterChunk::disassemble(const std::vector<Value> &constants) const {
+        std::stringstream s;
+
+        s << "-- register disassembly (" << m_frameSize << " registers) --\n";
+
+        for (size_t i = 0; i < m_code.size();) {
+            std::string str;
+            std::tie(str, i) = disassembleInstruction(i, constants);
+            s << str;
+        }
+
+        return s.str();
+    }
+
+    std::pair<std::string, size_t> RegisterChunk::disassembleInstruction(
+            size_t index,
+            const std::vector<Value> &constants) const {
+        std::stringstream s;
+        std::ios_base::fmtflags f(s.flags());
+
+        s << std::setfill('0') << std::setw(4) << index << "    ";
+        s.flags(f);
+
+        line_t line = getLine(index);
+        if (index > 0 && line == getLine(index - 1)) {
+            s << "|";
+        } else {
+            s << line;
+        }
+
+        auto op = static_cast<RegisterOp>(m_code[index++]);
+        s << " " << std::left << std::setw(MAX_INSTRUCTION_NAME_LENGTH) << std::setfill(' ') << registerOpToString(op);
+        s.flags(f);
+
+        size_t constant = 0;
+        for (const char *operand = operandLayout(op); *operand != '\0'; ++operand) {
+            switch (*operand) {
+                case 'r':
+                    s << " r" << static_cast<size_t>(m_code[index++]);
+                    break;
+                case 'k':
+                case 'K':
+                    if (*operand == 'k') {
+                        constant = m_code[index++];
+                    } else {
+                        constant = m_code[index] | (m_code[index + 1] << 8) | (m_code[index + 2] << 16);
+                        index += 3;
+                    }
+                    s << " " << constant << " (" << constants[constant] << ")";
+                    break;
+                case 'u':
+                    s << " u" << static_cast<size_t>(m_code[index++]);
+                    break;
+                case 'n':
+                    s << " " << static_cast<size_t>(m_code[index++]);
+                    break;
+                case 'j':
+                case 'l': {
+                    size_t offset = m_code[index] | (m_code[index + 1] << 8);
+                    index += 2;
+                    s << " -> " << (*operand == 'j' ? index + offset : index - offset);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        s << "\n";
+
+        if (op == RegisterOp::CLOSURE) {
+            uint32_t upvalueCount = constants[constant].asObject()->as<FunctionObject>()->getUpvalueCount();
+            for (uint32_t i = 0; i < upvalueCount; ++i) {
+                bool isLocal = m_code[index++] == 1;
+                size_t upvalue = m_code[index++];
+
+                s << std::setfill('0') << std::setw(4) << index - 2 << "    ";
+                s.flags(f);
+                s << "|  " << (isLocal ? "local" : "upvalue") << " " << upvalue << "\n";
+            }
+        }
+
+        return {s.str(), index};
+    }
+
+    line_t RegisterChunk::getLine(size_t index) const {
+        return m_lines.getLine(index);
+    }
+
+    const std::vector<uint8_t> &RegisterChunk::getCode() const {
+        return m_code;
+    }
+
+    size_t RegisterChunk::getCount() const {
+        return m_code.size();
+    }
+
+    size_t RegisterChunk::getHeapSize() const {
+        return heapSizeOf(m_code) + m_lines.getHeapSize();
+    }
+
+    size_t RegisterChunk::getFrameSize() const {
+        return m_frameSize;
+    }
+
+    void RegisterChunk::setFrameSize(size_t frameSize) {
+        m_frameSize = frameSize;
+    }
+
+    std::string registerOpToString(RegisterOp op) {
+        switch (op) {
+            case RegisterOp::MOVE:
+                return "MOVE";
+            case RegisterOp::LOAD_CONSTANT:
+                return "LOAD_CONSTANT";
+            case RegisterOp::LOAD_CONSTANT_LONG:
+                return "LOAD_CONSTANT_LONG";
+            case RegisterOp::LOAD_TRUE:
+                return "LOAD_TRUE";
+            case RegisterOp::LOAD_FALSE:
+                return "LOAD_FALSE";
+            case RegisterOp::LOAD_NIL:
+                return "LOAD_NIL";
+            case RegisterOp::CHECK_INT:
+                return "CHECK_INT";
+            case RegisterOp::CHECK_NUMERIC:
+                return "CHECK_NUMERIC";
+            case RegisterOp::CHECK_BOOL:
+                return "CHECK_BOOL";
+            case RegisterOp::CHECK_TYPE:
+                return "CHECK_TYPE";
+            case RegisterOp::CHECK_TYPE_LONG:
+                return "CHECK_TYPE_LONG";
+            case RegisterOp::NEGATE:
+                return "NEGATE";
+            case RegisterOp::NOT:
+                return "NOT";
+            case RegisterOp::ADD:
+                return "ADD";
+            case RegisterOp::SUBTRACT:
+                return "SUBTRACT";
+            case RegisterOp::MULTIPLY:
+                return "MULTIPLY";
+            case RegisterOp::DIVIDE:
+                return "DIVIDE";
+            case RegisterOp::ADD_INT:
+                return "ADD_INT";
+            case RegisterOp::SUBTRACT_INT:
+                return "SUBTRACT_INT";
+            case RegisterOp::MULTIPLY_INT:
+                return "MULTIPLY_INT";
+            case RegisterOp::DIVIDE_INT:
+                return "DIVIDE_INT";
+            case RegisterOp::ADD_FLOAT:
+                return "ADD_FLOAT";
+            case RegisterOp::SUBTRACT_FLOAT:
+                return "SUBTRACT_FLOAT";
+            case RegisterOp::MULTIPLY_FLOAT:
+                return "MULTIPLY_FLOAT";
+            case RegisterOp::DIVIDE_FLOAT:
+                return "DIVIDE_FLOAT";
+            case RegisterOp::LESS:
+                return "LESS";
+            case RegisterOp::GREATER:
+                return "GREATER";
+            case RegisterOp::EQUAL:
+                return "EQUAL";
+            case RegisterOp::LESS_INT:
+                return "LESS_INT";
+            case RegisterOp::GREATER_INT:
+                return "GREATER_INT";
+            case RegisterOp::LESS_FLOAT:
+                return "LESS_FLOAT";
+            case RegisterOp::GREATER_FLOAT:
+                return "GREATER_FLOAT";
+            case RegisterOp::ADD_INT_CONSTANT:
+                return "ADD_INT_CONSTANT";
+            case RegisterOp::SUBTRACT_INT_CONSTANT:
+                return "SUBTRACT_INT_CONSTANT";
+            case RegisterOp::MULTIPLY_INT_CONSTANT:
+                return "MULTIPLY_INT_CONSTANT";
+            case RegisterOp::DIVIDE_INT_CONSTANT:
+                return "DIVIDE_INT_CONSTANT";
+            case RegisterOp::LESS_INT_CONSTANT:
+                return "LESS_INT_CONSTANT";
+            case RegisterOp::GREATER_INT_CONSTANT:
+                return "GREATER_INT_CONSTANT";
+            case RegisterOp::GET_UPVALUE:
+                return "GET_UPVALUE";
+            case RegisterOp::SET_UPVALUE:
+                return "SET_UPVALUE";
+            case RegisterOp::JUMP:
+                return "JUMP";
+            case RegisterOp::LOOP:
+                return "LOOP";
+            case RegisterOp::JUMP_IF_TRUE:
+                return "JUMP_IF_TRUE";
+            case RegisterOp::JUMP_IF_FALSE:
+                return "JUMP_IF_FALSE";
+            case RegisterOp::JUMP_IF_NOT_LESS_INT:
+                return "JUMP_IF_NOT_LESS_INT";
+            case RegisterOp::JUMP_IF_NOT_GREATER_INT:
+                return "JUMP_IF_NOT_GREATER_INT";
+            case RegisterOp::JUMP_IF_NOT_LESS_INT_CONSTANT:
+                return "JUMP_IF_NOT_LESS_INT_CONSTANT";
+            case RegisterOp::JUMP_IF_NOT_GREATER_INT_CONSTANT:
+                return "JUMP_IF_NOT_GREATER_INT_CONSTANT";
+            case RegisterOp::CALL_FUNCTION:
+                return "CALL_FUNCTION";
+            case RegisterOp::CALL_NATIVE:
+                return "CALL_NATIVE";
+            case RegisterOp::CLOSURE:
+                return "CLOSURE";
+            case RegisterOp::CLOSE_UPVALUES:
+                return "CLOSE_UPVALUES";
+            case RegisterOp::RETURN:
+                return "RETURN";
+                // Unreachable.
+            default:
+                return "";
+        }
+    }
+}
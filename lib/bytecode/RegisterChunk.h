@@ -0,0 +1,125 @@
+#ifndef ENACT_REGISTERCHUNK_H
+#define ENACT_REGISTERCHUNK_H
+
+#include <vector>
+
+#include "../common.h"
+#include "../value/Value.h"
+#include "LineTable.h"
+
+namespace enact {
+    // The instruction set of the register backend. Instead of pushing and popping, operands name
+    // slots in the current frame (its "registers") directly, with the destination first. Registers,
+    // constants and counts are one byte each, and jump offsets are two bytes counted from the end
+    // of the instruction, just like in Chunk.
+    enum class RegisterOp : uint8_t {
+        MOVE,                   // dest src
+        LOAD_CONSTANT,          // dest constant
+        LOAD_CONSTANT_LONG,     // dest constant (3 bytes)
+        LOAD_TRUE,              // dest
+        LOAD_FALSE,             // dest
+        LOAD_NIL,               // dest
+
+        CHECK_INT,              // src
+        CHECK_NUMERIC,          // src
+        CHECK_BOOL,             // src
+        CHECK_TYPE,             // src type
+        CHECK_TYPE_LONG,        // src type (3 bytes)
+
+        NEGATE,                 // dest src
+        NOT,                    // dest src
+
+        // dest left right
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        ADD_INT,
+        SUBTRACT_INT,
+        MULTIPLY_INT,
+        DIVIDE_INT,
+        ADD_FLOAT,
+        SUBTRACT_FLOAT,
+        MULTIPLY_FLOAT,
+        DIVIDE_FLOAT,
+        LESS,
+        GREATER,
+        EQUAL,
+        LESS_INT,
+        GREATER_INT,
+        LESS_FLOAT,
+        GREATER_FLOAT,
+
+        // dest left constant
+        ADD_INT_CONSTANT,
+        SUBTRACT_INT_CONSTANT,
+        MULTIPLY_INT_CONSTANT,
+        DIVIDE_INT_CONSTANT,
+        LESS_INT_CONSTANT,
+        GREATER_INT_CONSTANT,
+
+        GET_UPVALUE,            // dest upvalue
+        SET_UPVALUE,            // upvalue src
+
+        JUMP,                   // offset
+        LOOP,                   // offset
+        JUMP_IF_TRUE,           // condition offset
+        JUMP_IF_FALSE,          // condition offset
+
+        // A comparison and the branch that consumes it: left right offset, or left constant offset.
+        JUMP_IF_NOT_LESS_INT,
+        JUMP_IF_NOT_GREATER_INT,
+        JUMP_IF_NOT_LESS_INT_CONSTANT,
+        JUMP_IF_NOT_GREATER_INT_CONSTANT,
+
+        // callee argCount, with the arguments in the registers after the callee. The result
+        // replaces the callee.
+        CALL_FUNCTION,
+        CALL_NATIVE,
+
+        CLOSURE,                // dest function, then an (isLocal, index) pair per upvalue
+        CLOSE_UPVALUES,         // first register to close
+        RETURN,                 // src
+    };
+
+    std::string registerOpToString(RegisterOp op);
+
+    class RegisterChunk {
+        static constexpr size_t MAX_INSTRUCTION_NAME_LENGTH = 32;
+
+        std::vector<uint8_t> m_code;
+
+        // The line of each instruction, starting from the index of its opcode.
+        LineTable m_lines;
+
+        size_t m_frameSize = 0;
+
+    public:
+        RegisterChunk() = default;
+
+        void write(uint8_t byte);
+        void write(RegisterOp op, line_t line);
+        void writeShort(uint32_t value);
+        void writeLong(uint32_t value);
+
+        void rewrite(size_t index, uint8_t byte);
+
+        // Constants are shared with the Chunk that this code was lowered from.
+        std::string disassemble(const std::vector<Value> &constants) const;
+        std::pair<std::string, size_t> disassembleInstruction(size_t index, const std::vector<Value> &constants) const;
+
+        line_t getLine(size_t index) const;
+
+        const std::vector<uint8_t> &getCode() const;
+        size_t getCount() const;
+
+        // How many bytes the chunk holds outside of itself.
+        size_t getHeapSize() const;
+
+        // The number of registers a call to this code needs, including the callee and its arguments.
+        size_t getFrameSize() const;
+        void setFrameSize(size_t frameSize);
+    };
+}
+
+#endif //ENACT_REGISTERCHUNK_H
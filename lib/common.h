@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -12,8 +13,14 @@
 #endif
 
 #ifdef DEBUG_ASSERTIONS_ENABLED
+// Only build the failure message if the assertion actually fails, so that asserting in hot
+// code (like VM::pop()) doesn't construct strings every time.
 #define ENACT_ASSERT(expr, msg) \
-        _assert(expr, #expr, msg, __FILE__, __LINE__)
+        do { \
+            if (!(expr)) { \
+                _assert(false, #expr, msg, __FILE__, __LINE__); \
+            } \
+        } while (false)
 #else
 #define ENACT_ASSERT(expr, msg)
 #endif
@@ -62,6 +69,25 @@ namespace enact {
         }
         return cloned;
     }
+
+    // How many bytes a container holds outside of itself, for the GC's accounting.
+    inline size_t heapSizeOf(const std::string& string) {
+        // Short strings are kept inside the std::string itself.
+        return string.capacity() > std::string{}.capacity() ? string.capacity() + 1 : 0;
+    }
+
+    template <typename T>
+    inline size_t heapSizeOf(const std::vector<T>& vector) {
+        return vector.capacity() * sizeof(T);
+    }
+
+    // Only an estimate, since the layout of the nodes is up to the standard library: each one holds
+    // an element, the next pointer and a cached hash.
+    template <typename K, typename V>
+    inline size_t heapSizeOf(const std::unordered_map<K, V>& map) {
+        constexpr size_t nodeSize = sizeof(typename std::unordered_map<K, V>::value_type) + 2 * sizeof(void *);
+        return map.size() * nodeSize + map.bucket_count() * sizeof(void *);
+    }
 }
 
 #endif //ENACT_COMMON_H
@@ -0,0 +1,831 @@
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "../Natives.h"
+#include "CCompiler.h"
+
+namespace enact {
+    // The instruction to lower in place of an opcode. A superinstruction still has the bytes of
+    // the sequence it fused, which starts with a GET_LOCAL, and a quickened check is lowered
+    // like the check it replaced.
+    static OpCode unfused(OpCode op) {
+        switch (op) {
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                return OpCode::GET_LOCAL;
+
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_BOOL:
+                return OpCode::CHECK_TYPE;
+            case OpCode::CHECK_TYPE_INT_LONG:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+                return OpCode::CHECK_TYPE_LONG;
+
+            default:
+                return op;
+        }
+    }
+
+    bool CCompiler::Rep::operator==(const Rep &rep) const {
+        return kind == rep.kind && (kind != Kind::CALLEE || callee == rep.callee);
+    }
+
+    bool CCompiler::Rep::operator!=(const Rep &rep) const {
+        return !(*this == rep);
+    }
+
+    std::string CCompiler::compile(FunctionObject *script) {
+        CCompiler compiler{};
+        compiler.addCallee(script);
+        compiler.m_callees[0].upvalues = std::vector<Rep>{};
+
+        // Functions are added as the CLOSUREs for them are found, so this picks them up too.
+        for (uint32_t callee = 0; callee < compiler.m_callees.size(); ++callee) {
+            if (compiler.m_callees[callee].function) {
+                compiler.compileFunction(callee);
+            }
+        }
+
+        std::ostringstream c;
+        c << "// Generated by enact --emit-c. Build it together with the runtime library, from\n"
+             "// lib/runtime, lib/value, lib/type and Natives.cpp.\n"
+             "#include \"EnactRuntime.h\"\n\n";
+
+        if (!compiler.m_strings.empty()) {
+            c << "static EnactValue enact_strings[" << compiler.m_strings.size() << "];\n\n";
+        }
+
+        c << compiler.m_prototypes << "\n" << compiler.m_definitions;
+
+        c << "int main(void) {\n";
+        for (size_t i = 0; i < compiler.m_strings.size(); ++i) {
+            const std::string &string = compiler.m_strings[i];
+            c << "    enact_strings[" << i << "] = enact_string(" << stringLiteral(string) << ", "
+              << string.size() << ");\n";
+        }
+        c << "    " << compiler.m_callees[0].name << "();\n";
+        c << "    return 0;\n";
+        c << "}\n";
+
+        return c.str();
+    }
+
+    uint32_t CCompiler::addCallee(Object *object) {
+        if (object->is<ClosureObject>()) {
+            object = object->as<ClosureObject>()->getFunction();
+        }
+
+        auto found = m_calleeIndices.find(object);
+        if (found != m_calleeIndices.end()) return found->second;
+
+        auto index = static_cast<uint32_t>(m_callees.size());
+        m_calleeIndices[object] = index;
+
+        if (object->is<NativeObject>()) {
+            auto *native = object->as<NativeObject>();
+
+            std::string name{};
+            if (native->getFunction() == &Natives::print) name = "enact_print";
+            if (native->getFunction() == &Natives::put) name = "enact_put";
+
+            m_callees.push_back(Callee{nullptr, native->getType(), name});
+            return index;
+        }
+
+        auto *function = object->as<FunctionObject>();
+
+        std::string name = index == 0 ? "enact_script" : "enact_fn" + std::to_string(index);
+        if (index > 0 && !function->getName().empty()) {
+            name += "_";
+            for (char c : function->getName()) {
+                name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+            }
+        }
+
+        m_callees.push_back(Callee{function, function->getType(), name});
+        return index;
+    }
+
+    std::string CCompiler::stringConstant(const std::string &string) {
+        auto found = m_stringIndices.find(string);
+        if (found == m_stringIndices.end()) {
+            found = m_stringIndices.emplace(string, m_strings.size()).first;
+            m_strings.push_back(string);
+        }
+
+        return "enact_strings[" + std::to_string(found->second) + "]";
+    }
+
+    void CCompiler::compileFunction(uint32_t callee) {
+        FunctionObject *function = m_callees[callee].function;
+        const auto *type = function->getType()->as<FunctionType>();
+
+        m_current = callee;
+        m_chunk = &function->getChunk();
+        m_line = 0;
+
+        // Methods find `self` above their arguments, which only the VM knows how to call.
+        if (type->isMethod()) throw unsupported("methods");
+        if (!m_callees[callee].upvalues) throw unsupported("functions that are never closed over");
+
+        m_returnRep = callee == 0 ? Rep{Kind::VALUE} : repOf(type->getReturnType());
+
+        // The callee and its arguments start out in their own slots.
+        std::vector<Rep> entry{Rep{Kind::CALLEE, callee}};
+        for (const Type &argument : type->getArgumentTypes()) {
+            entry.push_back(repOf(argument));
+        }
+
+        m_states.clear();
+        m_labels.clear();
+        m_states[0] = entry;
+        analyse();
+
+        m_variables.clear();
+        m_body.clear();
+        emit();
+
+        std::string signature = "static " + cType(m_returnRep.kind) + " " + m_callees[callee].name + "(";
+        for (size_t slot = 1; slot < entry.size(); ++slot) {
+            if (slot > 1) signature += ", ";
+            signature += cType(entry[slot].kind) + " " + variable(entry[slot].kind, slot);
+        }
+        signature += entry.size() == 1 ? "void)" : ")";
+
+        std::string declarations{};
+        for (const auto &[kind, depth] : m_variables) {
+            bool isParameter = depth > 0 && depth < entry.size() && entry[depth].kind == kind;
+            if (!isParameter) {
+                declarations += "    " + cType(kind) + " " + variable(kind, depth) + ";\n";
+            }
+        }
+
+        m_prototypes += signature + ";\n";
+        m_definitions += signature + " {\n" + declarations + (declarations.empty() ? "" : "\n") + m_body + "}\n\n";
+    }
+
+    void CCompiler::analyse() {
+        m_isEmitting = false;
+        m_worklist = {0};
+
+        while (!m_worklist.empty()) {
+            size_t index = m_worklist.back();
+            m_worklist.pop_back();
+
+            m_stack = m_states[index];
+            m_line = m_chunk->getLine(index);
+            if (std::optional<size_t> next = lowerInstruction(index)) {
+                flowTo(*next, false);
+            }
+        }
+    }
+
+    void CCompiler::emit() {
+        m_isEmitting = true;
+
+        const CodeBuffer &code = m_chunk->getCode();
+        for (size_t index = 0; index < code.size(); index += instructionLength(index)) {
+            auto state = m_states.find(index);
+            if (state == m_states.end()) continue;
+
+            if (m_labels.count(index) > 0) {
+                m_body += "L" + std::to_string(index) + ":;\n";
+            }
+
+            m_stack = state->second;
+            m_line = m_chunk->getLine(index);
+            if (std::optional<size_t> next = lowerInstruction(index)) {
+                emitLine(flowTo(*next, false));
+            }
+        }
+    }
+
+    std::optional<size_t> CCompiler::lowerInstruction(size_t index) {
+        const CodeBuffer &code = m_chunk->getCode();
+        const std::vector<Value> &constants = m_chunk->getConstants();
+
+        OpCode op = unfused(static_cast<OpCode>(code[index]));
+        size_t next = index + instructionLength(index);
+        size_t top = m_stack.size() - 1;
+
+        switch (op) {
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG: {
+                Value constant = constants[op == OpCode::CONSTANT ? code[index + 1] : readLong(index + 1)];
+                if (constant.isInt()) {
+                    assign(Kind::INT, intLiteral(constant.asInt()));
+                } else if (constant.isDouble()) {
+                    assign(Kind::DOUBLE, doubleLiteral(constant.asDouble()));
+                } else if (constant.isBool()) {
+                    assign(Kind::BOOL, constant.asBool() ? "true" : "false");
+                } else if (constant.isNil()) {
+                    assign(Kind::VALUE, "enact_nil()");
+                } else if (constant.asObject()->is<StringObject>()) {
+                    assign(Kind::VALUE, stringConstant(constant.asObject()->as<StringObject>()->asStdString()));
+                } else if (constant.asObject()->is<NativeObject>() || constant.asObject()->is<FunctionObject>() ||
+                           constant.asObject()->is<ClosureObject>()) {
+                    push(Rep{Kind::CALLEE, addCallee(constant.asObject())});
+                } else {
+                    throw unsupported("constants of type '" + constant.getType()->toString() + "'");
+                }
+                break;
+            }
+            case OpCode::TRUE:
+                assign(Kind::BOOL, "true");
+                break;
+            case OpCode::FALSE:
+                assign(Kind::BOOL, "false");
+                break;
+            case OpCode::NIL:
+                assign(Kind::VALUE, "enact_nil()");
+                break;
+
+            case OpCode::CHECK_INT:
+                lowerCheck(op, INT_TYPE);
+                break;
+            case OpCode::CHECK_NUMERIC:
+                lowerCheck(op, FLOAT_TYPE);
+                break;
+            case OpCode::CHECK_BOOL:
+                lowerCheck(op, BOOL_TYPE);
+                break;
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_LONG: {
+                Value type = constants[op == OpCode::CHECK_TYPE ? code[index + 1] : readLong(index + 1)];
+                lowerCheck(op, type.asObject()->as<TypeObject>()->getContainedType());
+                break;
+            }
+
+            case OpCode::NEGATE: {
+                Kind kind = m_stack[top].kind;
+                if (kind == Kind::INT || kind == Kind::DOUBLE) {
+                    std::string operand = read(top, kind);
+                    pop();
+                    assign(kind, "-" + operand);
+                } else {
+                    std::string operand = read(top, Kind::VALUE);
+                    pop();
+                    assign(Kind::VALUE, "enact_negate(" + operand + ")");
+                }
+                break;
+            }
+            case OpCode::NOT: {
+                std::string operand = read(top, Kind::BOOL);
+                pop();
+                assign(Kind::BOOL, "!" + operand);
+                break;
+            }
+
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::EQUAL:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                lowerArithmetic(op);
+                break;
+
+            // Nothing is captured by reference, so closing an upvalue is just a pop.
+            case OpCode::POP:
+            case OpCode::CLOSE_UPVALUE:
+                pop();
+                break;
+
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_LOCAL_LONG: {
+                uint32_t slot = op == OpCode::GET_LOCAL ? code[index + 1] : readLong(index + 1);
+                Rep rep = m_stack[slot];
+                if (rep.kind == Kind::CALLEE) {
+                    push(rep);
+                } else {
+                    assign(rep.kind, variable(rep.kind, slot));
+                }
+                break;
+            }
+            case OpCode::SET_LOCAL:
+            case OpCode::SET_LOCAL_LONG: {
+                uint32_t slot = op == OpCode::SET_LOCAL ? code[index + 1] : readLong(index + 1);
+                Rep rep = m_stack[top];
+                if (rep.kind == Kind::CALLEE) {
+                    m_stack[slot] = rep;
+                } else {
+                    emitLine(write(slot, rep.kind) + " = " + variable(rep.kind, top) + ";");
+                }
+                break;
+            }
+
+            case OpCode::GET_UPVALUE:
+                push((*m_callees[m_current].upvalues)[code[index + 1]]);
+                break;
+
+            case OpCode::JUMP:
+                emitLine(flowTo(next + readShort(index + 1), true));
+                return {};
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE: {
+                std::string condition = read(top, Kind::BOOL);
+                std::string jump = flowTo(next + readShort(index + 1), true);
+                emitLine("if (" + std::string{op == OpCode::JUMP_IF_FALSE ? "!" : ""} + "(" + condition + ")) { " +
+                         jump + " }");
+                break;
+            }
+            case OpCode::LOOP:
+                emitLine(flowTo(next - readShort(index + 1), true));
+                return {};
+
+            case OpCode::CALL_FUNCTION:
+                lowerCall(code[index + 1]);
+                break;
+            case OpCode::CALL_NATIVE:
+                lowerNativeCall(code[index + 1]);
+                break;
+
+            case OpCode::CLOSURE:
+                lowerClosure(index, code[index + 1]);
+                break;
+            case OpCode::CLOSURE_LONG:
+                lowerClosure(index, readLong(index + 1));
+                break;
+
+            case OpCode::RETURN:
+                emitLine("return " + read(top, m_returnRep.kind) + ";");
+                return {};
+
+            default:
+                throw unsupported("the " + opCodeToString(op) + " instruction");
+        }
+
+        return next;
+    }
+
+    void CCompiler::lowerCheck(OpCode op, const Type &shouldBe) {
+        size_t top = m_stack.size() - 1;
+        Rep rep = m_stack[top];
+        Type type = typeOf(rep);
+
+        bool passes;
+        switch (op) {
+            case OpCode::CHECK_INT: passes = type->isInt(); break;
+            case OpCode::CHECK_NUMERIC: passes = type->isNumeric(); break;
+            case OpCode::CHECK_BOOL: passes = type->isBool(); break;
+            default: passes = shouldBe->looselyEquals(*type); break;
+        }
+
+        // Dynamic values can only be checked at runtime, and everything else is already known.
+        if (passes && (rep.kind != Kind::VALUE || shouldBe->isDynamic())) return;
+        if (rep.kind == Kind::CALLEE) throw unsupported("functions that fail a type check");
+
+        std::string value = read(top, Kind::VALUE);
+        std::string line = std::to_string(m_line);
+
+        switch (op) {
+            case OpCode::CHECK_INT:
+                emitLine(write(top, Kind::INT) + " = enact_check_int(" + value + ", " + line + ");");
+                break;
+            case OpCode::CHECK_NUMERIC:
+                emitLine("enact_check_numeric(" + value + ", " + line + ");");
+                break;
+            case OpCode::CHECK_BOOL:
+                emitLine(write(top, Kind::BOOL) + " = enact_check_bool(" + value + ", " + line + ");");
+                break;
+            default: {
+                std::string checked;
+                if (shouldBe->isInt()) {
+                    checked = "ENACT_TYPE_INT";
+                } else if (shouldBe->isFloat()) {
+                    checked = "ENACT_TYPE_FLOAT";
+                } else if (shouldBe->isBool()) {
+                    checked = "ENACT_TYPE_BOOL";
+                } else if (shouldBe->isString()) {
+                    checked = "ENACT_TYPE_STRING";
+                } else {
+                    throw unsupported("checking for values of type '" + shouldBe->toString() + "'");
+                }
+
+                emitLine("enact_check_type(" + value + ", " + checked + ", " + line + ");");
+                break;
+            }
+        }
+    }
+
+    void CCompiler::lowerArithmetic(OpCode op) {
+        size_t right = m_stack.size() - 1;
+        size_t left = right - 1;
+        Kind leftKind = m_stack[left].kind;
+        Kind rightKind = m_stack[right].kind;
+
+        std::string symbol;
+        std::string runtime;
+        switch (op) {
+            case OpCode::ADD:
+            case OpCode::ADD_INT:
+            case OpCode::ADD_FLOAT:
+                symbol = "+";
+                runtime = "enact_add";
+                break;
+            case OpCode::SUBTRACT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::SUBTRACT_FLOAT:
+                symbol = "-";
+                runtime = "enact_subtract";
+                break;
+            case OpCode::MULTIPLY:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::MULTIPLY_FLOAT:
+                symbol = "*";
+                runtime = "enact_multiply";
+                break;
+            case OpCode::DIVIDE:
+            case OpCode::DIVIDE_INT:
+            case OpCode::DIVIDE_FLOAT:
+                symbol = "/";
+                runtime = "enact_divide";
+                break;
+            case OpCode::LESS:
+            case OpCode::LESS_INT:
+            case OpCode::LESS_FLOAT:
+                symbol = "<";
+                runtime = "enact_less";
+                break;
+            case OpCode::GREATER:
+            case OpCode::GREATER_INT:
+            case OpCode::GREATER_FLOAT:
+                symbol = ">";
+                runtime = "enact_greater";
+                break;
+            default:
+                symbol = "==";
+                runtime = "enact_equal";
+                break;
+        }
+
+        bool isComparison = symbol == "<" || symbol == ">" || symbol == "==";
+
+        // Which kind the operands are computed in, if it can be done in C.
+        std::optional<Kind> operandKind{};
+        switch (op) {
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+                operandKind = Kind::INT;
+                break;
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                operandKind = Kind::DOUBLE;
+                break;
+            case OpCode::EQUAL:
+                // Values of different types are never equal, even an int and a float.
+                if (leftKind == rightKind && leftKind != Kind::VALUE && leftKind != Kind::CALLEE) {
+                    operandKind = leftKind;
+                }
+                break;
+            default: {
+                bool isNumeric = (leftKind == Kind::INT || leftKind == Kind::DOUBLE) &&
+                                 (rightKind == Kind::INT || rightKind == Kind::DOUBLE);
+                if (isNumeric) {
+                    operandKind = leftKind == Kind::INT && rightKind == Kind::INT ? Kind::INT : Kind::DOUBLE;
+                }
+                break;
+            }
+        }
+
+        std::string expression;
+        Kind resultKind;
+        if (operandKind) {
+            expression = read(left, *operandKind) + " " + symbol + " " + read(right, *operandKind);
+            resultKind = isComparison ? Kind::BOOL : *operandKind;
+        } else {
+            expression = runtime + "(" + read(left, Kind::VALUE) + ", " + read(right, Kind::VALUE) + ")";
+            resultKind = isComparison ? Kind::BOOL : Kind::VALUE;
+        }
+
+        pop();
+        pop();
+        assign(resultKind, expression);
+    }
+
+    void CCompiler::lowerClosure(size_t index, uint32_t constant) {
+        const CodeBuffer &code = m_chunk->getCode();
+
+        auto *function = m_chunk->getConstants()[constant].asObject()->as<FunctionObject>();
+        uint32_t callee = addCallee(function);
+
+        // The closure is about to be pushed, so this is where a recursive function finds itself.
+        size_t self = m_stack.size();
+
+        std::vector<Rep> upvalues{};
+        size_t operand = index + (static_cast<OpCode>(code[index]) == OpCode::CLOSURE ? 2 : 4);
+        for (uint32_t i = 0; i < function->getUpvalueCount(); ++i) {
+            bool isLocal = code[operand] != 0;
+            uint32_t upvalue = i < UINT8_MAX ? code[operand + 1] : readLong(operand + 1);
+            operand += i < UINT8_MAX ? 2 : 4;
+
+            if (!isLocal) {
+                upvalues.push_back((*m_callees[m_current].upvalues)[upvalue]);
+            } else if (upvalue == self) {
+                upvalues.push_back(Rep{Kind::CALLEE, callee});
+            } else if (m_stack[upvalue].kind != Kind::CALLEE) {
+                throw unsupported("closing over variables that aren't functions");
+            } else if (isReassigned(upvalue)) {
+                throw unsupported("closing over variables that are assigned to");
+            } else {
+                upvalues.push_back(m_stack[upvalue]);
+            }
+        }
+
+        std::optional<std::vector<Rep>> &bound = m_callees[callee].upvalues;
+        if (bound && *bound != upvalues) throw unsupported("closing over different functions in the same function");
+        bound = std::move(upvalues);
+
+        push(Rep{Kind::CALLEE, callee});
+    }
+
+    void CCompiler::lowerCall(uint8_t argCount) {
+        size_t calleeDepth = m_stack.size() - 1 - argCount;
+        Rep rep = m_stack[calleeDepth];
+        if (rep.kind != Kind::CALLEE || !m_callees[rep.callee].function) {
+            throw unsupported("calling functions that aren't known until runtime");
+        }
+
+        const Callee &callee = m_callees[rep.callee];
+        const auto *type = callee.type->as<FunctionType>();
+        if (type->isMethod() || type->getArgumentTypes().size() != argCount) throw unsupported("calling methods");
+
+        std::string arguments{};
+        for (size_t i = 0; i < argCount; ++i) {
+            if (i > 0) arguments += ", ";
+            arguments += read(calleeDepth + 1 + i, repOf(type->getArgumentTypes()[i]).kind);
+        }
+
+        std::string call = callee.name + "(" + arguments + ")";
+        Kind result = repOf(type->getReturnType()).kind;
+
+        m_stack.resize(calleeDepth);
+        assign(result, call);
+    }
+
+    void CCompiler::lowerNativeCall(uint8_t argCount) {
+        size_t calleeDepth = m_stack.size() - 1 - argCount;
+        Rep rep = m_stack[calleeDepth];
+        if (rep.kind != Kind::CALLEE || m_callees[rep.callee].name.empty() || argCount != 1) {
+            throw unsupported("calling natives other than print and put");
+        }
+
+        std::string call = m_callees[rep.callee].name + "(" + read(calleeDepth + 1, Kind::VALUE) + ")";
+
+        m_stack.resize(calleeDepth);
+        assign(Kind::VALUE, call);
+    }
+
+    bool CCompiler::isReassigned(uint32_t slot) const {
+        const CodeBuffer &code = m_chunk->getCode();
+
+        for (size_t index = 0; index < code.size(); index += instructionLength(index)) {
+            auto op = static_cast<OpCode>(code[index]);
+            if ((op == OpCode::SET_LOCAL && code[index + 1] == slot) ||
+                (op == OpCode::SET_LOCAL_LONG && readLong(index + 1) == slot)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::string CCompiler::flowTo(size_t target, bool isJump) {
+        if (isJump) m_labels.insert(target);
+
+        auto found = m_states.find(target);
+        if (!m_isEmitting) {
+            if (found == m_states.end()) {
+                m_states[target] = m_stack;
+                m_worklist.push_back(target);
+                return "";
+            }
+
+            // Wherever control flow merges, values that could be held differently have to be boxed.
+            std::vector<Rep> &state = found->second;
+            if (state.size() != m_stack.size()) throw unsupported("jumps that change the stack's depth");
+
+            bool hasChanged = false;
+            for (size_t depth = 0; depth < state.size(); ++depth) {
+                if (state[depth] == m_stack[depth]) continue;
+
+                if (state[depth].kind == Kind::CALLEE || m_stack[depth].kind == Kind::CALLEE) {
+                    throw unsupported("variables that could hold different functions");
+                }
+                if (state[depth].kind != Kind::VALUE) {
+                    state[depth] = Rep{Kind::VALUE};
+                    hasChanged = true;
+                }
+            }
+
+            if (hasChanged) m_worklist.push_back(target);
+            return "";
+        }
+
+        std::vector<std::string> statements{};
+        const std::vector<Rep> &state = found->second;
+        for (size_t depth = 0; depth < state.size(); ++depth) {
+            if (state[depth] != m_stack[depth]) {
+                statements.push_back(variable(Kind::VALUE, depth) + " = " + read(depth, Kind::VALUE) + ";");
+            }
+        }
+
+        if (isJump) statements.push_back("goto L" + std::to_string(target) + ";");
+
+        std::string code{};
+        for (const std::string &statement : statements) {
+            code += (code.empty() ? "" : " ") + statement;
+        }
+        return code;
+    }
+
+    size_t CCompiler::instructionLength(size_t index) const {
+        // Superinstructions are lowered as the GET_LOCAL they start with, and then the rest of
+        // their sequence.
+        OpCode op = unfused(static_cast<OpCode>(m_chunk->getCode()[index]));
+        size_t length = op == OpCode::GET_LOCAL ? enact::instructionLength(op) : m_chunk->getInstructionLength(index);
+        if (length == 0) throw unsupported("the " + opCodeToString(op) + " instruction");
+
+        return length;
+    }
+
+    uint16_t CCompiler::readShort(size_t index) const {
+        const CodeBuffer &code = m_chunk->getCode();
+        return static_cast<uint16_t>(code[index] | (code[index + 1] << 8));
+    }
+
+    uint32_t CCompiler::readLong(size_t index) const {
+        const CodeBuffer &code = m_chunk->getCode();
+        return static_cast<uint32_t>(code[index] | (code[index + 1] << 8) | (code[index + 2] << 16));
+    }
+
+    CCompiler::Rep CCompiler::repOf(const Type &type) const {
+        if (type->isInt()) return Rep{Kind::INT};
+        if (type->isFloat()) return Rep{Kind::DOUBLE};
+        if (type->isBool()) return Rep{Kind::BOOL};
+
+        if (type->isFunction()) throw unsupported("passing functions as values");
+        return Rep{Kind::VALUE};
+    }
+
+    Type CCompiler::typeOf(Rep rep) const {
+        switch (rep.kind) {
+            case Kind::INT: return INT_TYPE;
+            case Kind::DOUBLE: return FLOAT_TYPE;
+            case Kind::BOOL: return BOOL_TYPE;
+            case Kind::VALUE: return DYNAMIC_TYPE;
+            case Kind::CALLEE: return m_callees[rep.callee].type;
+        }
+
+        ENACT_UNREACHABLE();
+    }
+
+    std::string CCompiler::variable(Kind kind, size_t depth) {
+        if (m_isEmitting) m_variables.emplace(kind, depth);
+
+        switch (kind) {
+            case Kind::INT: return "i" + std::to_string(depth);
+            case Kind::DOUBLE: return "d" + std::to_string(depth);
+            case Kind::BOOL: return "b" + std::to_string(depth);
+            case Kind::VALUE: return "v" + std::to_string(depth);
+            case Kind::CALLEE: break;
+        }
+
+        ENACT_UNREACHABLE();
+    }
+
+    std::string CCompiler::read(size_t depth, Kind kind) {
+        Kind from = m_stack[depth].kind;
+        if (from == kind) return variable(kind, depth);
+        if (from == Kind::CALLEE || kind == Kind::CALLEE) throw unsupported("using functions as values");
+
+        if (kind == Kind::VALUE) {
+            switch (from) {
+                case Kind::INT: return "enact_box_int(" + variable(from, depth) + ")";
+                case Kind::DOUBLE: return "enact_box_double(" + variable(from, depth) + ")";
+                default: return "enact_box_bool(" + variable(from, depth) + ")";
+            }
+        }
+
+        if (from == Kind::VALUE) {
+            switch (kind) {
+                case Kind::INT: return "enact_as_int(" + variable(from, depth) + ")";
+                case Kind::DOUBLE: return "enact_as_double(" + variable(from, depth) + ")";
+                default: return "enact_as_bool(" + variable(from, depth) + ")";
+            }
+        }
+
+        if (from == Kind::INT && kind == Kind::DOUBLE) return "(double)" + variable(from, depth);
+        throw unsupported("using a value of type '" + typeOf(m_stack[depth])->toString() + "' as a '" +
+                          typeOf(Rep{kind})->toString() + "'");
+    }
+
+    std::string CCompiler::write(size_t depth, Kind kind) {
+        m_stack[depth] = Rep{kind};
+        return variable(kind, depth);
+    }
+
+    void CCompiler::push(Rep rep) {
+        m_stack.push_back(rep);
+    }
+
+    CCompiler::Rep CCompiler::pop() {
+        Rep rep = m_stack.back();
+        m_stack.pop_back();
+        return rep;
+    }
+
+    void CCompiler::assign(Kind kind, const std::string &expression) {
+        m_stack.push_back(Rep{kind});
+        emitLine(variable(kind, m_stack.size() - 1) + " = " + expression + ";");
+    }
+
+    void CCompiler::emitLine(const std::string &line) {
+        if (m_isEmitting && !line.empty()) {
+            m_body += "    " + line + "\n";
+        }
+    }
+
+    CCompiler::Unsupported CCompiler::unsupported(const std::string &what) const {
+        const std::string &name = m_callees[m_current].function->getName();
+        return Unsupported{"[line " + std::to_string(m_line) + "] --emit-c doesn't support " + what + " yet, in " +
+                           (m_current == 0 ? "the script" : "function '" + name + "'") + "."};
+    }
+
+    std::string CCompiler::cType(Kind kind) {
+        switch (kind) {
+            case Kind::INT: return "int32_t";
+            case Kind::DOUBLE: return "double";
+            case Kind::BOOL: return "bool";
+            default: return "EnactValue";
+        }
+    }
+
+    std::string CCompiler::intLiteral(int value) {
+        // -2147483648 would be the negation of a literal that doesn't fit in an int.
+        if (value == INT32_MIN) return "(-2147483647 - 1)";
+        return std::to_string(value);
+    }
+
+    std::string CCompiler::doubleLiteral(double value) const {
+        if (!std::isfinite(value)) throw unsupported("infinite or NaN constants");
+
+        std::ostringstream literal;
+        literal << std::setprecision(17) << value;
+
+        std::string string = literal.str();
+        if (string.find_first_of(".e") == std::string::npos) string += ".0";
+        return string;
+    }
+
+    std::string CCompiler::stringLiteral(const std::string &string) {
+        std::ostringstream literal;
+        literal << '"';
+
+        for (char c : string) {
+            switch (c) {
+                case '"': literal << "\\\""; break;
+                case '\\': literal << "\\\\"; break;
+                case '\n': literal << "\\n"; break;
+                case '\t': literal << "\\t"; break;
+                default:
+                    if (std::isprint(static_cast<unsigned char>(c))) {
+                        literal << c;
+                    } else {
+                        // Always three digits, so that a digit after it can't be read as part of it.
+                        literal << '\\' << std::oct << std::setw(3) << std::setfill('0')
+                                << static_cast<unsigned>(static_cast<unsigned char>(c)) << std::dec;
+                    }
+                    break;
+            }
+        }
+
+        literal << '"';
+        return literal.str();
+    }
+}
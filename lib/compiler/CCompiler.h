@@ -0,0 +1,150 @@
+#ifndef ENACT_CCOMPILER_H
+#define ENACT_CCOMPILER_H
+
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../value/Object.h"
+
+namespace enact {
+    // Translates a compiled program into a C translation unit for --emit-c, which links against
+    // the runtime in lib/runtime. Every stack slot becomes a set of C variables, one per
+    // representation it can have, so a slot that only ever holds ints is a plain int32_t and the
+    // arithmetic on it is plain C. Values are only boxed where the program needs them as Values,
+    // such as passing them to a native or merging differently typed values.
+    //
+    // Functions are called directly, so the callee of every call has to be known statically: a
+    // function, or a native, that was loaded from a constant or a CLOSURE, possibly by way of
+    // a local or an upvalue that is never reassigned. Anything outside of that (objects other
+    // than strings, closures over mutable variables and so on) isn't supported yet.
+    class CCompiler {
+    public:
+        class Unsupported : public std::runtime_error {
+        public:
+            explicit Unsupported(const std::string &what) : std::runtime_error{what} {}
+        };
+
+        // Throws Unsupported, with a message for the user, if the program can't be translated.
+        static std::string compile(FunctionObject *script);
+
+    private:
+        enum class Kind {
+            INT,
+            DOUBLE,
+            BOOL,
+            VALUE,
+            // A function or native known at compile time, which doesn't exist at runtime at all.
+            CALLEE,
+        };
+
+        // How a value on the stack is held in the generated code.
+        struct Rep {
+            Kind kind;
+            uint32_t callee = 0;
+
+            bool operator==(const Rep &rep) const;
+            bool operator!=(const Rep &rep) const;
+        };
+
+        struct Callee {
+            // Null for a native.
+            FunctionObject *function;
+            Type type;
+
+            // The C function that calls go to, if there is one.
+            std::string name;
+
+            // What each of a function's upvalues refers to, which is always another callee. Set
+            // by the first CLOSURE for the function.
+            std::optional<std::vector<Rep>> upvalues{};
+        };
+
+        std::vector<Callee> m_callees{};
+        std::unordered_map<Object *, uint32_t> m_calleeIndices{};
+
+        // String constants, which are allocated once before the script runs.
+        std::vector<std::string> m_strings{};
+        std::unordered_map<std::string, size_t> m_stringIndices{};
+
+        std::string m_prototypes{};
+        std::string m_definitions{};
+
+        // The function being translated.
+        uint32_t m_current = 0;
+        const Chunk *m_chunk = nullptr;
+        Rep m_returnRep{Kind::VALUE};
+
+        // The stack on entry to each reachable instruction, worked out before anything is emitted.
+        std::unordered_map<size_t, std::vector<Rep>> m_states{};
+        std::vector<size_t> m_worklist{};
+        std::set<size_t> m_labels{};
+        bool m_isEmitting = false;
+
+        std::vector<Rep> m_stack{};
+        std::set<std::pair<Kind, size_t>> m_variables{};
+        std::string m_body{};
+        line_t m_line = 0;
+
+        CCompiler() = default;
+
+        uint32_t addCallee(Object *object);
+        std::string stringConstant(const std::string &string);
+
+        void compileFunction(uint32_t callee);
+
+        // Runs through the function until the stack at every instruction has settled.
+        void analyse();
+        void emit();
+
+        // Lowers the instruction at index, and returns the index of the next one if control
+        // can fall through to it.
+        std::optional<size_t> lowerInstruction(size_t index);
+
+        void lowerCheck(OpCode op, const Type &shouldBe);
+        void lowerArithmetic(OpCode op);
+        void lowerClosure(size_t index, uint32_t constant);
+        void lowerCall(uint8_t argCount);
+        void lowerNativeCall(uint8_t argCount);
+
+        // Whether any SET_LOCAL in the current function assigns to the slot.
+        bool isReassigned(uint32_t slot) const;
+
+        // Control reaching target with the current stack. Returns the code for the jump when
+        // emitting, which boxes whatever is boxed at the target but not here.
+        std::string flowTo(size_t target, bool isJump);
+
+        size_t instructionLength(size_t index) const;
+        uint16_t readShort(size_t index) const;
+        uint32_t readLong(size_t index) const;
+
+        Rep repOf(const Type &type) const;
+        Type typeOf(Rep rep) const;
+
+        std::string variable(Kind kind, size_t depth);
+
+        // The value at depth as an expression of the given kind.
+        std::string read(size_t depth, Kind kind);
+
+        // Makes the value at depth be held as kind, and returns the variable to assign to.
+        std::string write(size_t depth, Kind kind);
+
+        void push(Rep rep);
+        Rep pop();
+
+        // Pushes a new value of the given kind, computed by expression.
+        void assign(Kind kind, const std::string &expression);
+
+        void emitLine(const std::string &line);
+
+        Unsupported unsupported(const std::string &what) const;
+
+        static std::string cType(Kind kind);
+        static std::string intLiteral(int value);
+        std::string doubleLiteral(double value) const;
+        static std::string stringLiteral(const std::string &string);
+    };
+}
+
+#endif //ENACT_CCOMPILER_H
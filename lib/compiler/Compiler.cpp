@@ -1,3 +1,5 @@
+#include <iostream>
+
 #include "../context/CompileContext.h"
 #include "../Natives.h"
 
@@ -104,10 +106,20 @@ namespace enact {
     void Compiler::endProgram() {
         emitByte(OpCode::NIL);
         emitByte(OpCode::RETURN);
+        optimise();
+        currentChunk().fuseSuperinstructions();
+        m_context.gc.resized(m_currentFunction);
+
+        if (m_enclosing == nullptr && m_context.options.flagEnabled(Flag::DEBUG_TIME_PASSES)) {
+            std::cout << passManager().report();
+        }
     }
 
     void Compiler::endPart() {
+        // The VM resumes the script from where the last part paused, so parts are never optimised.
         emitByte(OpCode::PAUSE);
+        currentChunk().fuseSuperinstructions();
+        m_context.gc.resized(m_currentFunction);
     }
 
     void Compiler::endFunction() {
@@ -115,6 +127,26 @@ namespace enact {
             emitByte(OpCode::NIL);
             emitByte(OpCode::RETURN);
         }
+
+        optimise();
+        currentChunk().fuseSuperinstructions();
+        m_context.gc.resized(m_currentFunction);
+    }
+
+    PassManager &Compiler::passManager() {
+        if (m_enclosing != nullptr) return m_enclosing->passManager();
+
+        if (!m_passManager) {
+            m_passManager = std::make_unique<PassManager>(m_context.options.getOptimisationLevel());
+        }
+        return *m_passManager;
+    }
+
+    void Compiler::optimise() {
+        // A chunk with errors in it isn't going to be run.
+        if (m_hadError) return;
+
+        passManager().run(currentChunk());
     }
 
     void Compiler::visitBlockStmt(BlockStmt &stmt) {
@@ -500,33 +532,40 @@ namespace enact {
             emitByte(OpCode::CHECK_NUMERIC);
         }
 
+        // If both operands are known to be ints, or known to be floats, the VM doesn't need to check
+        bool isInt = expr.left->getType()->isInt() && expr.right->getType()->isInt();
+        bool isFloat = expr.left->getType()->isFloat() && expr.right->getType()->isFloat();
+
+        OpCode less = isInt ? OpCode::LESS_INT : isFloat ? OpCode::LESS_FLOAT : OpCode::LESS;
+        OpCode greater = isInt ? OpCode::GREATER_INT : isFloat ? OpCode::GREATER_FLOAT : OpCode::GREATER;
+
         switch (expr.oper.type) {
             case TokenType::PLUS:
-                emitByte(OpCode::ADD);
+                emitByte(isInt ? OpCode::ADD_INT : isFloat ? OpCode::ADD_FLOAT : OpCode::ADD);
                 break;
             case TokenType::MINUS:
-                emitByte(OpCode::SUBTRACT);
+                emitByte(isInt ? OpCode::SUBTRACT_INT : isFloat ? OpCode::SUBTRACT_FLOAT : OpCode::SUBTRACT);
                 break;
             case TokenType::STAR:
-                emitByte(OpCode::MULTIPLY);
+                emitByte(isInt ? OpCode::MULTIPLY_INT : isFloat ? OpCode::MULTIPLY_FLOAT : OpCode::MULTIPLY);
                 break;
             case TokenType::SLASH:
-                emitByte(OpCode::DIVIDE);
+                emitByte(isInt ? OpCode::DIVIDE_INT : isFloat ? OpCode::DIVIDE_FLOAT : OpCode::DIVIDE);
                 break;
 
             case TokenType::LESS:
-                emitByte(OpCode::LESS);
+                emitByte(less);
                 break;
             case TokenType::LESS_EQUAL:
-                emitByte(OpCode::GREATER);
+                emitByte(greater);
                 emitByte(OpCode::NOT);
                 break;
 
             case TokenType::GREATER:
-                emitByte(OpCode::GREATER);
+                emitByte(greater);
                 break;
             case TokenType::GREATER_EQUAL:
-                emitByte(OpCode::LESS);
+                emitByte(less);
                 emitByte(OpCode::NOT);
                 break;
 
@@ -545,6 +584,11 @@ namespace enact {
     }
 
     void Compiler::visitCallExpr(CallExpr &expr) {
+        // Method calls skip creating a bound method by invoking it directly
+        if (auto *getExpr = dynamic_cast<GetExpr *>(expr.callee.get())) {
+            if (emitInvoke(*getExpr, expr.arguments)) return;
+        }
+
         compile(*expr.callee);
 
         OpCode callOp;
@@ -577,6 +621,57 @@ namespace enact {
         emitByte(static_cast<uint8_t>(expr.arguments.size()));
     }
 
+    bool Compiler::emitInvoke(GetExpr &callee, std::vector<std::unique_ptr<Expr>> &arguments) {
+        Type objectType = callee.object->getType();
+
+        OpCode byteOp;
+        OpCode longOp;
+        uint32_t index;
+        std::optional<uint32_t> cacheIndex;
+
+        if (objectType->isStruct()) {
+            std::optional<size_t> maybeIndex = objectType->as<StructType>()->findMethod(callee.name.lexeme);
+            if (!maybeIndex) return false;
+
+            // Dynamic arguments still need to be checked by CALL_DYNAMIC
+            for (const auto &argument : arguments) {
+                if (argument->getType()->isDynamic()) return false;
+            }
+
+            byteOp = OpCode::INVOKE;
+            longOp = OpCode::INVOKE_LONG;
+            index = *maybeIndex;
+        } else if (objectType->isDynamic()) {
+            byteOp = OpCode::INVOKE_DYNAMIC;
+            longOp = OpCode::INVOKE_DYNAMIC_LONG;
+
+            auto *name = m_context.gc.allocateObject<StringObject>(callee.name.lexeme);
+            index = currentChunk().addConstant(Value{name});
+            cacheIndex = currentChunk().addPropertyCache();
+        } else {
+            return false;
+        }
+
+        compile(*callee.object);
+        for (const auto &argument : arguments) {
+            compile(*argument);
+        }
+
+        if (index <= UINT8_MAX && cacheIndex.value_or(0) <= UINT8_MAX) {
+            emitByte(byteOp);
+            emitByte(static_cast<uint8_t>(arguments.size()));
+            emitByte(static_cast<uint8_t>(index));
+            if (cacheIndex) emitByte(static_cast<uint8_t>(*cacheIndex));
+        } else {
+            emitByte(longOp);
+            emitByte(static_cast<uint8_t>(arguments.size()));
+            emitLong(index);
+            if (cacheIndex) emitLong(*cacheIndex);
+        }
+
+        return true;
+    }
+
     void Compiler::visitFloatExpr(FloatExpr &expr) {
         emitConstant(Value{expr.value});
     }
@@ -588,6 +683,7 @@ namespace enact {
         OpCode byteOp;
         OpCode longOp;
         uint32_t index;
+        std::optional<uint32_t> cacheIndex;
 
         if (objectType->isStruct()) {
             const auto *structType = objectType->as<StructType>();
@@ -618,16 +714,20 @@ namespace enact {
 
             auto *name = m_context.gc.allocateObject<StringObject>(expr.name.lexeme);
             index = currentChunk().addConstant(Value{name});
+            cacheIndex = currentChunk().addPropertyCache();
         } else {
             throw errorAt(expr.oper, "Only structs and traits have properties.");
         }
 
-        if (index <= UINT8_MAX) {
+        // Dynamic property accesses are followed by the index of their inline cache
+        if (index <= UINT8_MAX && cacheIndex.value_or(0) <= UINT8_MAX) {
             emitByte(byteOp);
             emitByte(static_cast<uint8_t>(index));
+            if (cacheIndex) emitByte(static_cast<uint8_t>(*cacheIndex));
         } else {
             emitByte(longOp);
             emitLong(index);
+            if (cacheIndex) emitLong(*cacheIndex);
         }
     }
 
@@ -667,6 +767,7 @@ namespace enact {
         OpCode byteOp;
         OpCode longOp;
         uint32_t index;
+        std::optional<uint32_t> cacheIndex;
 
         if (objectType->isStruct()) {
             const auto *structType = objectType->as<StructType>();
@@ -682,17 +783,21 @@ namespace enact {
 
             auto *name = m_context.gc.allocateObject<StringObject>(expr.target->name.lexeme);
             index = currentChunk().addConstant(Value{name});
+            cacheIndex = currentChunk().addPropertyCache();
         } else {
             // This should be unreachable.
             throw errorAt(expr.oper, "Only structs and traits have properties.");
         }
 
-        if (index <= UINT8_MAX) {
+        // Dynamic property accesses are followed by the index of their inline cache
+        if (index <= UINT8_MAX && cacheIndex.value_or(0) <= UINT8_MAX) {
             emitByte(byteOp);
             emitByte(static_cast<uint8_t>(index));
+            if (cacheIndex) emitByte(static_cast<uint8_t>(*cacheIndex));
         } else {
             emitByte(longOp);
             emitLong(index);
+            if (cacheIndex) emitLong(*cacheIndex);
         }
     }
 
@@ -865,23 +970,23 @@ namespace enact {
     }
 
     void Compiler::emitByte(uint8_t byte) {
-        currentChunk().write(byte, currentChunk().getCurrentLine());
+        currentChunk().write(byte, currentChunk().getCurrentLine(), currentChunk().getCurrentColumn());
     }
 
     void Compiler::emitByte(OpCode byte) {
-        currentChunk().write(byte, currentChunk().getCurrentLine());
+        currentChunk().write(byte, currentChunk().getCurrentLine(), currentChunk().getCurrentColumn());
     }
 
     void Compiler::emitShort(uint16_t value) {
-        currentChunk().writeShort(value, currentChunk().getCurrentLine());
+        currentChunk().writeShort(value, currentChunk().getCurrentLine(), currentChunk().getCurrentColumn());
     }
 
     void Compiler::emitLong(uint32_t value) {
-        currentChunk().writeLong(value, currentChunk().getCurrentLine());
+        currentChunk().writeLong(value, currentChunk().getCurrentLine(), currentChunk().getCurrentColumn());
     }
 
     void Compiler::emitConstant(Value constant) {
-        currentChunk().writeConstant(constant, currentChunk().getCurrentLine());
+        currentChunk().writeConstant(constant, currentChunk().getCurrentLine(), currentChunk().getCurrentColumn());
     }
 
     size_t Compiler::emitJump(OpCode jump) {
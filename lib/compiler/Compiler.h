@@ -3,6 +3,7 @@
 
 #include "../ast/Stmt.h"
 #include "../bytecode/Chunk.h"
+#include "../optimiser/PassManager.h"
 #include "../value/Object.h"
 
 namespace enact {
@@ -42,6 +43,15 @@ namespace enact {
 
         bool m_hadError = false;
 
+        // Only the outermost compiler has one, which is shared with the compilers nested in it
+        // so that the pass timings cover the whole program.
+        std::unique_ptr<PassManager> m_passManager{};
+
+        PassManager &passManager();
+
+        // Runs the optimiser over the function's code once it is complete.
+        void optimise();
+
         void start(FunctionKind functionKind, Type functionType, const std::string &name);
 
         void startProgram();
@@ -100,6 +110,10 @@ namespace enact {
         // Exactly the same as emitAssoc, except it emits the `self` variable
         void emitMethod(FunctionStmt &stmt);
 
+        // Emits an INVOKE(_DYNAMIC)(_LONG) instruction for a method call, or returns false
+        // if the call has to go through the usual get-then-call sequence.
+        bool emitInvoke(GetExpr &callee, std::vector<std::unique_ptr<Expr>> &arguments);
+
         Chunk &currentChunk();
 
         class CompileError : public std::runtime_error {
@@ -0,0 +1,601 @@
+#include "../memory/GC.h"
+#include "RegisterCompiler.h"
+
+namespace enact {
+    // The instruction to lower in place of an opcode. A superinstruction still has the bytes of
+    // the sequence it fused, which starts with a GET_LOCAL, and a quickened check is lowered
+    // like the check it replaced.
+    static OpCode unfused(OpCode op) {
+        switch (op) {
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                return OpCode::GET_LOCAL;
+
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_BOOL:
+                return OpCode::CHECK_TYPE;
+            case OpCode::CHECK_TYPE_INT_LONG:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+                return OpCode::CHECK_TYPE_LONG;
+
+            default:
+                return op;
+        }
+    }
+
+    static RegisterOp binaryOp(OpCode op) {
+        switch (op) {
+            case OpCode::ADD: return RegisterOp::ADD;
+            case OpCode::SUBTRACT: return RegisterOp::SUBTRACT;
+            case OpCode::MULTIPLY: return RegisterOp::MULTIPLY;
+            case OpCode::DIVIDE: return RegisterOp::DIVIDE;
+            case OpCode::ADD_INT: return RegisterOp::ADD_INT;
+            case OpCode::SUBTRACT_INT: return RegisterOp::SUBTRACT_INT;
+            case OpCode::MULTIPLY_INT: return RegisterOp::MULTIPLY_INT;
+            case OpCode::DIVIDE_INT: return RegisterOp::DIVIDE_INT;
+            case OpCode::ADD_FLOAT: return RegisterOp::ADD_FLOAT;
+            case OpCode::SUBTRACT_FLOAT: return RegisterOp::SUBTRACT_FLOAT;
+            case OpCode::MULTIPLY_FLOAT: return RegisterOp::MULTIPLY_FLOAT;
+            case OpCode::DIVIDE_FLOAT: return RegisterOp::DIVIDE_FLOAT;
+            case OpCode::LESS: return RegisterOp::LESS;
+            case OpCode::GREATER: return RegisterOp::GREATER;
+            case OpCode::EQUAL: return RegisterOp::EQUAL;
+            case OpCode::LESS_INT: return RegisterOp::LESS_INT;
+            case OpCode::GREATER_INT: return RegisterOp::GREATER_INT;
+            case OpCode::LESS_FLOAT: return RegisterOp::LESS_FLOAT;
+            default: return RegisterOp::GREATER_FLOAT;
+        }
+    }
+
+    // The form of an int operation that takes its right operand straight from the constants.
+    static std::optional<RegisterOp> constantBinaryOp(OpCode op) {
+        switch (op) {
+            case OpCode::ADD_INT: return RegisterOp::ADD_INT_CONSTANT;
+            case OpCode::SUBTRACT_INT: return RegisterOp::SUBTRACT_INT_CONSTANT;
+            case OpCode::MULTIPLY_INT: return RegisterOp::MULTIPLY_INT_CONSTANT;
+            case OpCode::DIVIDE_INT: return RegisterOp::DIVIDE_INT_CONSTANT;
+            case OpCode::LESS_INT: return RegisterOp::LESS_INT_CONSTANT;
+            case OpCode::GREATER_INT: return RegisterOp::GREATER_INT_CONSTANT;
+            default: return {};
+        }
+    }
+
+    RegisterCompiler::RegisterCompiler(FunctionObject *function) :
+            m_function{function},
+            m_chunk{function->getChunk()} {
+    }
+
+    bool RegisterCompiler::compile(FunctionObject *function, GC &gc) {
+        if (function->getRegisterChunk()) return true;
+
+        try {
+            RegisterCompiler compiler{function};
+            compiler.lower();
+
+            // Every function this one could call has to be lowered too.
+            for (const Value &constant : function->getChunk().getConstants()) {
+                if (!constant.isObject()) continue;
+
+                Object *object = constant.asObject();
+                if (object->is<ClosureObject>()) {
+                    object = object->as<ClosureObject>()->getFunction();
+                }
+
+                if (object->is<FunctionObject>() && !compile(object->as<FunctionObject>(), gc)) {
+                    return false;
+                }
+            }
+
+            function->getRegisterChunk() = std::move(compiler.m_registers);
+            gc.resized(function);
+        } catch (const Unsupported &) {
+            return false;
+        }
+
+        return true;
+    }
+
+    void RegisterCompiler::lower() {
+        const CodeBuffer &code = m_chunk.getCode();
+
+        for (size_t index = 0; index < code.size(); index += instructionLength(index)) {
+            switch (unfused(static_cast<OpCode>(code[index]))) {
+                case OpCode::JUMP:
+                case OpCode::JUMP_IF_TRUE:
+                case OpCode::JUMP_IF_FALSE:
+                    m_jumpTargets.insert(index + 3 + readShort(index + 1));
+                    break;
+                case OpCode::LOOP:
+                    m_jumpTargets.insert(index + 3 - readShort(index + 1));
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Methods find `self` above their arguments, which only the stack backend knows how to call.
+        const auto *type = m_function->getType()->as<FunctionType>();
+        if (type->isMethod()) throw Unsupported{};
+
+        // The callee and its arguments start out in their own slots.
+        for (size_t slot = 0; slot <= type->getArgumentTypes().size(); ++slot) {
+            push(Operand{false, registerIndex(slot)});
+        }
+
+        for (size_t index = 0; index < code.size();) {
+            if (m_jumpTargets.count(index) > 0) {
+                bindLabel(index);
+            }
+
+            if (m_isReachable) {
+                m_line = m_chunk.getLine(index);
+                index = lowerInstruction(index);
+            } else {
+                index += instructionLength(index);
+            }
+        }
+
+        patchJumps();
+    }
+
+    size_t RegisterCompiler::lowerInstruction(size_t index) {
+        const CodeBuffer &code = m_chunk.getCode();
+        OpCode op = unfused(static_cast<OpCode>(code[index]));
+        size_t next = index + instructionLength(index);
+
+        std::optional<size_t> lastResult = m_lastResult;
+        m_lastResult.reset();
+
+        switch (op) {
+            case OpCode::CONSTANT:
+                push(Operand{true, code[index + 1]});
+                break;
+            case OpCode::CONSTANT_LONG:
+                push(Operand{true, static_cast<uint32_t>(
+                        code[index + 1] | (code[index + 2] << 8) | (code[index + 3] << 16))});
+                break;
+
+            case OpCode::TRUE:
+                emitResult(RegisterOp::LOAD_TRUE);
+                break;
+            case OpCode::FALSE:
+                emitResult(RegisterOp::LOAD_FALSE);
+                break;
+            case OpCode::NIL:
+                emitResult(RegisterOp::LOAD_NIL);
+                break;
+
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_NUMERIC:
+            case OpCode::CHECK_BOOL: {
+                uint8_t value = toRegister(m_stack.back(), m_stack.size() - 1);
+                m_stack.back() = Operand{false, value};
+
+                emitOp(op == OpCode::CHECK_INT ? RegisterOp::CHECK_INT :
+                       op == OpCode::CHECK_NUMERIC ? RegisterOp::CHECK_NUMERIC :
+                       RegisterOp::CHECK_BOOL);
+                emitByte(value);
+                break;
+            }
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_LONG: {
+                uint8_t value = toRegister(m_stack.back(), m_stack.size() - 1);
+                m_stack.back() = Operand{false, value};
+
+                uint32_t type = op == OpCode::CHECK_TYPE
+                                ? code[index + 1]
+                                : code[index + 1] | (code[index + 2] << 8) | (code[index + 3] << 16);
+                emitConstant(RegisterOp::CHECK_TYPE, RegisterOp::CHECK_TYPE_LONG, value, type);
+                break;
+            }
+
+            case OpCode::NEGATE:
+            case OpCode::NOT: {
+                uint8_t value = toRegister(pop(), m_stack.size());
+                emitResult(op == OpCode::NEGATE ? RegisterOp::NEGATE : RegisterOp::NOT);
+                emitByte(value);
+                break;
+            }
+
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+                if (std::optional<size_t> after = lowerComparisonJump(op, next)) {
+                    return *after;
+                }
+                lowerBinary(op);
+                break;
+
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::EQUAL:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                lowerBinary(op);
+                break;
+
+            case OpCode::POP:
+                pop();
+                break;
+
+            case OpCode::GET_LOCAL: {
+                uint8_t local = code[index + 1];
+                materialise(local);
+                push(Operand{false, local});
+                break;
+            }
+            case OpCode::SET_LOCAL:
+                lowerSetLocal(code[index + 1], lastResult);
+                break;
+
+            case OpCode::GET_UPVALUE:
+                emitResult(RegisterOp::GET_UPVALUE);
+                emitByte(code[index + 1]);
+                break;
+            case OpCode::SET_UPVALUE: {
+                uint8_t value = toRegister(m_stack.back(), m_stack.size() - 1);
+                m_stack.back() = Operand{false, value};
+
+                emitOp(RegisterOp::SET_UPVALUE);
+                emitByte(code[index + 1]);
+                emitByte(value);
+                break;
+            }
+
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE:
+                lowerJump(op, index);
+                break;
+            case OpCode::LOOP:
+                lowerLoop(index);
+                break;
+
+            case OpCode::CALL_FUNCTION:
+            case OpCode::CALL_NATIVE: {
+                uint8_t argCount = code[index + 1];
+
+                // The callee's frame starts at the callee, so everything has to be in its slot.
+                flush();
+                size_t callee = m_stack.size() - argCount - 1;
+                emitOp(op == OpCode::CALL_FUNCTION ? RegisterOp::CALL_FUNCTION : RegisterOp::CALL_NATIVE);
+                emitByte(registerIndex(callee));
+                emitByte(argCount);
+
+                m_stack.resize(callee + 1);
+                break;
+            }
+
+            case OpCode::CLOSURE: {
+                // Past this, the upvalue indices would no longer be a single byte.
+                if (next - index > 2 + 2 * UINT8_MAX) throw Unsupported{};
+
+                // Captured locals are read straight from their slots.
+                flush();
+                emitResult(RegisterOp::CLOSURE);
+                for (size_t operand = index + 1; operand < next; ++operand) {
+                    emitByte(code[operand]);
+                }
+                m_lastResult.reset();
+                break;
+            }
+
+            case OpCode::CLOSE_UPVALUE:
+                materialise(m_stack.size() - 1);
+                emitOp(RegisterOp::CLOSE_UPVALUES);
+                emitByte(registerIndex(m_stack.size() - 1));
+                pop();
+                break;
+
+            case OpCode::RETURN: {
+                uint8_t value = toRegister(pop(), m_stack.size());
+                emitOp(RegisterOp::RETURN);
+                emitByte(value);
+                m_isReachable = false;
+                break;
+            }
+
+            default:
+                throw Unsupported{};
+        }
+
+        return next;
+    }
+
+    std::optional<size_t> RegisterCompiler::lowerComparisonJump(OpCode op, size_t index) {
+        const CodeBuffer &code = m_chunk.getCode();
+        if (index >= code.size() ||
+            static_cast<OpCode>(code[index]) != OpCode::JUMP_IF_FALSE ||
+            m_jumpTargets.count(index) > 0 ||
+            !conditionIsDiscarded(index)) {
+            return {};
+        }
+
+        Operand right = pop();
+        Operand left = pop();
+        flush();
+
+        size_t condition = m_stack.size();
+        uint8_t leftRegister = toRegister(left, condition);
+
+        if (right.isConstant && right.index <= UINT8_MAX) {
+            emitOp(op == OpCode::LESS_INT
+                   ? RegisterOp::JUMP_IF_NOT_LESS_INT_CONSTANT
+                   : RegisterOp::JUMP_IF_NOT_GREATER_INT_CONSTANT);
+            emitByte(leftRegister);
+            emitByte(static_cast<uint8_t>(right.index));
+        } else {
+            uint8_t rightRegister = toRegister(right, condition + 1);
+            emitOp(op == OpCode::LESS_INT ? RegisterOp::JUMP_IF_NOT_LESS_INT : RegisterOp::JUMP_IF_NOT_GREATER_INT);
+            emitByte(leftRegister);
+            emitByte(rightRegister);
+        }
+
+        size_t target = index + 3 + readShort(index + 1);
+        emitJumpOffset(target);
+
+        // The condition is never written, since the POP on either side throws it away unread.
+        push(Operand{false, registerIndex(condition)});
+        m_targetDepths[target] = m_stack.size();
+
+        return index + 3;
+    }
+
+    void RegisterCompiler::lowerBinary(OpCode op) {
+        Operand right = pop();
+        Operand left = pop();
+
+        size_t dest = m_stack.size();
+        uint8_t leftRegister = toRegister(left, dest);
+
+        std::optional<RegisterOp> constantOp = constantBinaryOp(op);
+        if (constantOp && right.isConstant && right.index <= UINT8_MAX) {
+            emitResult(*constantOp);
+            emitByte(leftRegister);
+            emitByte(static_cast<uint8_t>(right.index));
+        } else {
+            uint8_t rightRegister = toRegister(right, dest + 1);
+            emitResult(binaryOp(op));
+            emitByte(leftRegister);
+            emitByte(rightRegister);
+        }
+    }
+
+    void RegisterCompiler::lowerSetLocal(uint32_t local, std::optional<size_t> lastResult) {
+        Operand value = m_stack.back();
+        if (!value.isConstant && value.index == local) return;
+
+        // Anything still waiting to read the local has to take a copy of the old value first.
+        bool hasReaders = false;
+        for (size_t depth = 0; depth + 1 < m_stack.size(); ++depth) {
+            const Operand &operand = m_stack[depth];
+            if (depth != local && !operand.isConstant && operand.index == local) {
+                materialise(depth);
+                hasReaders = true;
+            }
+        }
+
+        uint8_t localRegister = registerIndex(local);
+        if (!hasReaders && lastResult && !value.isConstant && value.index == m_stack.size() - 1) {
+            // Have the instruction that just made the value write it to the local instead.
+            m_registers.rewrite(*lastResult, localRegister);
+        } else if (value.isConstant) {
+            emitConstant(RegisterOp::LOAD_CONSTANT, RegisterOp::LOAD_CONSTANT_LONG, localRegister, value.index);
+        } else {
+            emitOp(RegisterOp::MOVE);
+            emitByte(localRegister);
+            emitByte(registerIndex(value.index));
+        }
+
+        m_stack[local] = Operand{false, local};
+        m_stack.back() = Operand{false, local};
+    }
+
+    void RegisterCompiler::lowerJump(OpCode op, size_t index) {
+        size_t target = index + 3 + readShort(index + 1);
+
+        if (op == OpCode::JUMP) {
+            flush();
+            emitOp(RegisterOp::JUMP);
+            emitJumpOffset(target);
+
+            m_targetDepths[target] = m_stack.size();
+            m_isReachable = false;
+            return;
+        }
+
+        RegisterOp registerOp = op == OpCode::JUMP_IF_TRUE ? RegisterOp::JUMP_IF_TRUE : RegisterOp::JUMP_IF_FALSE;
+
+        if (conditionIsDiscarded(index)) {
+            // Test the condition wherever it is, without copying it into its slot.
+            Operand condition = pop();
+            flush();
+
+            uint8_t conditionRegister = toRegister(condition, m_stack.size());
+            emitOp(registerOp);
+            emitByte(conditionRegister);
+            emitJumpOffset(target);
+
+            push(condition);
+        } else {
+            flush();
+            emitOp(registerOp);
+            emitByte(registerIndex(m_stack.size() - 1));
+            emitJumpOffset(target);
+        }
+
+        m_targetDepths[target] = m_stack.size();
+    }
+
+    void RegisterCompiler::lowerLoop(size_t index) {
+        auto label = m_labels.find(index + 3 - readShort(index + 1));
+        if (label == m_labels.end()) throw Unsupported{};
+
+        flush();
+        emitOp(RegisterOp::LOOP);
+
+        size_t offset = m_registers.getCount() + 2 - label->second;
+        if (offset > UINT16_MAX) throw Unsupported{};
+        m_registers.writeShort(static_cast<uint32_t>(offset));
+
+        m_isReachable = false;
+    }
+
+    void RegisterCompiler::bindLabel(size_t index) {
+        auto depth = m_targetDepths.find(index);
+
+        if (m_isReachable) {
+            if (depth != m_targetDepths.end() && depth->second != m_stack.size()) throw Unsupported{};
+            flush();
+        } else {
+            // Only a backward jump from code that is unreachable too could land here.
+            if (depth == m_targetDepths.end()) return;
+
+            m_stack.clear();
+            for (size_t slot = 0; slot < depth->second; ++slot) {
+                push(Operand{false, registerIndex(slot)});
+            }
+            m_isReachable = true;
+        }
+
+        m_labels[index] = m_registers.getCount();
+        m_lastResult.reset();
+    }
+
+    void RegisterCompiler::patchJumps() {
+        for (const auto &[index, target] : m_forwardJumps) {
+            auto label = m_labels.find(target);
+            if (label == m_labels.end()) throw Unsupported{};
+
+            size_t offset = label->second - (index + 2);
+            if (offset > UINT16_MAX) throw Unsupported{};
+
+            m_registers.rewrite(index, static_cast<uint8_t>(offset & 0xff));
+            m_registers.rewrite(index + 1, static_cast<uint8_t>((offset >> 8) & 0xff));
+        }
+    }
+
+    size_t RegisterCompiler::instructionLength(size_t index) const {
+        // Superinstructions are lowered as the GET_LOCAL they start with, and then the rest of
+        // their sequence.
+        OpCode op = unfused(static_cast<OpCode>(m_chunk.getCode()[index]));
+        size_t length = op == OpCode::GET_LOCAL ? enact::instructionLength(op) : m_chunk.getInstructionLength(index);
+        if (length == 0) throw Unsupported{};
+
+        return length;
+    }
+
+    uint16_t RegisterCompiler::readShort(size_t index) const {
+        const CodeBuffer &code = m_chunk.getCode();
+        return static_cast<uint16_t>(code[index] | (code[index + 1] << 8));
+    }
+
+    bool RegisterCompiler::conditionIsDiscarded(size_t index) const {
+        const CodeBuffer &code = m_chunk.getCode();
+        size_t next = index + 3;
+        size_t target = next + readShort(index + 1);
+
+        return next < code.size() && target < code.size() &&
+               static_cast<OpCode>(code[next]) == OpCode::POP &&
+               static_cast<OpCode>(code[target]) == OpCode::POP;
+    }
+
+    RegisterCompiler::Operand RegisterCompiler::pop() {
+        Operand operand = m_stack.back();
+        m_stack.pop_back();
+        return operand;
+    }
+
+    void RegisterCompiler::push(Operand operand) {
+        m_stack.push_back(operand);
+    }
+
+    void RegisterCompiler::materialise(size_t depth) {
+        Operand &operand = m_stack[depth];
+        if (!operand.isConstant && operand.index == depth) return;
+
+        uint8_t dest = registerIndex(depth);
+        if (operand.isConstant) {
+            emitConstant(RegisterOp::LOAD_CONSTANT, RegisterOp::LOAD_CONSTANT_LONG, dest, operand.index);
+        } else {
+            emitOp(RegisterOp::MOVE);
+            emitByte(dest);
+            emitByte(registerIndex(operand.index));
+        }
+
+        operand = Operand{false, dest};
+    }
+
+    void RegisterCompiler::flush() {
+        for (size_t depth = 0; depth < m_stack.size(); ++depth) {
+            materialise(depth);
+        }
+    }
+
+    uint8_t RegisterCompiler::toRegister(Operand operand, size_t scratch) {
+        if (!operand.isConstant) return registerIndex(operand.index);
+
+        uint8_t dest = registerIndex(scratch);
+        emitConstant(RegisterOp::LOAD_CONSTANT, RegisterOp::LOAD_CONSTANT_LONG, dest, operand.index);
+        return dest;
+    }
+
+    uint8_t RegisterCompiler::registerIndex(size_t index) {
+        if (index > UINT8_MAX) throw Unsupported{};
+
+        if (index >= m_registers.getFrameSize()) {
+            m_registers.setFrameSize(index + 1);
+        }
+
+        return static_cast<uint8_t>(index);
+    }
+
+    void RegisterCompiler::emitOp(RegisterOp op) {
+        m_registers.write(op, m_line);
+    }
+
+    void RegisterCompiler::emitByte(uint8_t byte) {
+        m_registers.write(byte);
+    }
+
+    void RegisterCompiler::emitConstant(RegisterOp op, RegisterOp longOp, uint8_t dest, uint32_t constant) {
+        if (constant <= UINT8_MAX) {
+            emitOp(op);
+            emitByte(dest);
+            emitByte(static_cast<uint8_t>(constant));
+        } else {
+            emitOp(longOp);
+            emitByte(dest);
+            m_registers.writeLong(constant);
+        }
+    }
+
+    void RegisterCompiler::emitResult(RegisterOp op) {
+        size_t dest = m_stack.size();
+
+        emitOp(op);
+        m_lastResult = m_registers.getCount();
+        emitByte(registerIndex(dest));
+
+        push(Operand{false, static_cast<uint32_t>(dest)});
+    }
+
+    void RegisterCompiler::emitJumpOffset(size_t target) {
+        m_forwardJumps.emplace_back(m_registers.getCount(), target);
+        m_registers.writeShort(0xffff);
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef ENACT_REGISTERCOMPILER_H
+#define ENACT_REGISTERCOMPILER_H
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../bytecode/RegisterChunk.h"
+#include "../value/Object.h"
+
+namespace enact {
+    class GC;
+
+    // Lowers a function's stack bytecode into three-address code for the register backend. Every
+    // stack slot becomes the register with the same index, but values are only copied into their
+    // slot once something needs them there, so that an instruction can read a local or a constant
+    // straight from where it already is instead of having it pushed first.
+    class RegisterCompiler {
+        // Where a value on the stack currently lives: either a register (its own slot, or the
+        // local it was read from) or the constant it was loaded from.
+        struct Operand {
+            bool isConstant;
+            uint32_t index;
+        };
+
+        FunctionObject *m_function;
+        const Chunk &m_chunk;
+        RegisterChunk m_registers{};
+
+        std::vector<Operand> m_stack{};
+        bool m_isReachable = true;
+        line_t m_line = 0;
+
+        // The index of the destination of the last instruction emitted, if it was a new value on
+        // top of the stack. A SET_LOCAL straight after can then make it write to the local instead.
+        std::optional<size_t> m_lastResult{};
+
+        // Every offset in the stack code that a jump lands on, the stack depth that it expects,
+        // and the offset of the register code it was lowered to.
+        std::unordered_set<size_t> m_jumpTargets{};
+        std::unordered_map<size_t, size_t> m_targetDepths{};
+        std::unordered_map<size_t, size_t> m_labels{};
+
+        // Forward jumps waiting to be patched, as the index of their offset and their target in the stack code.
+        std::vector<std::pair<size_t, size_t>> m_forwardJumps{};
+
+        class Unsupported : public std::runtime_error {
+        public:
+            Unsupported() : std::runtime_error{"Uncaught RegisterCompiler::Unsupported!"} {}
+        };
+
+        explicit RegisterCompiler(FunctionObject *function);
+
+        void lower();
+
+        // Lowers the instruction at index, and returns the index of the next one.
+        size_t lowerInstruction(size_t index);
+
+        // Lowers a comparison and the JUMP_IF_FALSE after it as one instruction, if nothing
+        // else needs the result. Returns the index after the jump if it did.
+        std::optional<size_t> lowerComparisonJump(OpCode op, size_t index);
+
+        void lowerBinary(OpCode op);
+        void lowerSetLocal(uint32_t local, std::optional<size_t> lastResult);
+        void lowerJump(OpCode op, size_t index);
+        void lowerLoop(size_t index);
+
+        void bindLabel(size_t index);
+        void patchJumps();
+
+        size_t instructionLength(size_t index) const;
+        uint16_t readShort(size_t index) const;
+
+        // Whether both the instruction after a conditional jump at index and the one it jumps to
+        // just pop the condition, so the condition is never needed in its slot.
+        bool conditionIsDiscarded(size_t index) const;
+
+        Operand pop();
+        void push(Operand operand);
+
+        // Copies the value at depth into its own slot, if it isn't there already.
+        void materialise(size_t depth);
+
+        // Materialises the whole stack, which is how it has to be wherever control flow merges.
+        void flush();
+
+        // The register holding an operand, first loading it into scratch if it's a constant.
+        uint8_t toRegister(Operand operand, size_t scratch);
+
+        uint8_t registerIndex(size_t index);
+
+        void emitOp(RegisterOp op);
+        void emitByte(uint8_t byte);
+        void emitConstant(RegisterOp op, RegisterOp longOp, uint8_t dest, uint32_t constant);
+
+        // Emits an instruction whose first operand is the slot on top of the stack, and pushes
+        // its result there.
+        void emitResult(RegisterOp op);
+
+        // Emits the offset of a forward jump, to be patched once its target has been lowered.
+        void emitJumpOffset(size_t target);
+
+    public:
+        // Lowers a function and every function nested in it, unless any of them uses an
+        // instruction that the register backend doesn't support. Returns whether it succeeded.
+        // Each function grows by its register chunk, which is reported to gc.
+        static bool compile(FunctionObject *function, GC &gc);
+    };
+}
+
+#endif //ENACT_REGISTERCOMPILER_H
@@ -9,15 +9,20 @@ namespace enact {
     }
 
     CompileResult CompileContext::compile(std::string source) {
-        m_source = std::move(source);
-
-        std::vector<std::unique_ptr<Stmt>> ast = m_parser.parse();
+        std::vector<std::unique_ptr<Stmt>> ast = parse(std::move(source));
         // TODO: serialise and print AST
 
         AstSerialise serialise{};
         for (const std::unique_ptr<Stmt>& stmt : ast) {
             std::cout << serialise(*stmt) << '\n';
         }
+
+        return m_parser.hadError() ? CompileResult::PARSE_ERROR : CompileResult::OK;
+    }
+
+    std::vector<std::unique_ptr<Stmt>> CompileContext::parse(std::string source) {
+        m_source = std::move(source);
+        return m_parser.parse();
     }
 
     std::string CompileContext::getSourceLine(line_t line) {
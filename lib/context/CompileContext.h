@@ -21,6 +21,11 @@ namespace enact {
 
         CompileResult compile(std::string source);
 
+        // Makes source the current source, and parses it. Check getParser().hadError() after.
+        std::vector<std::unique_ptr<Stmt>> parse(std::string source);
+
+        const Parser& getParser() const { return m_parser; }
+
         const std::string& getSource() const { return m_source; }
         const Options& getOptions() const { return m_options; }
 
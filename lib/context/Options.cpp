@@ -17,7 +17,8 @@ namespace enact {
         for (; current < args.size(); ++current) {
             std::string arg = args[current];
 
-            if (arg.size() >= 2 && arg[0] == '-' && arg[1] == '-') {
+            // Single dash flags like "-O2" are whole flags of their own, rather than several letters.
+            if ((arg.size() >= 2 && arg[0] == '-' && arg[1] == '-') || m_parseTable.count(arg) > 0) {
                 parseString(arg);
             } else if (arg.size() >= 1 && arg[0] == '-') {
                 for (char c : arg.substr(1)) {
@@ -41,8 +42,12 @@ namespace enact {
     }
 
     void Options::parseString(const std::string &string) {
+        size_t equals = string.find('=');
+
         if (m_parseTable.count(string) > 0) {
             m_parseTable[string]();
+        } else if (equals != std::string::npos && m_valueParseTable.count(string.substr(0, equals)) > 0) {
+            m_valueParseTable[string.substr(0, equals)](string.substr(equals + 1));
         } else {
             std::cerr << "[enact] Error:\n    Unknown interpreter flag '" << string <<
                       "'.\nUsage: enact [interpreter flags] [filename] [program flags]\n\n";
@@ -77,4 +82,90 @@ namespace enact {
     const std::vector<std::string> &Options::getProgramArgs() {
         return m_programArgs;
     }
+
+    size_t Options::getStackSize() const {
+        return m_stackSize;
+    }
+
+    void Options::setStackSize(const std::string &value) {
+        m_stackSize = parseSize("--stack-size", value);
+    }
+
+    size_t Options::getMaxFrames() const {
+        return m_maxFrames;
+    }
+
+    void Options::setMaxFrames(const std::string &value) {
+        m_maxFrames = parseSize("--max-frames", value);
+    }
+
+    Backend Options::getBackend() const {
+        return m_backend;
+    }
+
+    void Options::setBackend(const std::string &value) {
+        if (value == "stack") {
+            m_backend = Backend::STACK;
+        } else if (value == "register") {
+            m_backend = Backend::REGISTER;
+        } else {
+            std::cerr << "[enact] Error:\n    Interpreter flag '--backend' expects 'stack' or 'register', but got '"
+                      << value << "'.\nUsage: enact [interpreter flags] [filename] [program flags]\n\n";
+            throw FlagsError{};
+        }
+    }
+
+    OptimisationLevel Options::getOptimisationLevel() const {
+        return m_optimisationLevel;
+    }
+
+    void Options::setOptimisationLevel(OptimisationLevel level) {
+        m_optimisationLevel = level;
+    }
+
+    size_t Options::getJitThreshold() const {
+        return m_jitThreshold;
+    }
+
+    void Options::setJitThreshold(const std::string &value) {
+        m_jitThreshold = parseSize("--jit-threshold", value);
+    }
+
+    size_t Options::getGcPauseBudget() const {
+        return m_gcPauseBudget;
+    }
+
+    void Options::setGcPauseBudget(const std::string &value) {
+        m_gcPauseBudget = parseSize("--gc-pause-budget", value, true);
+    }
+
+    size_t Options::getGcThreads() const {
+        return m_gcThreads;
+    }
+
+    void Options::setGcThreads(const std::string &value) {
+        m_gcThreads = parseSize("--gc-threads", value, true);
+    }
+
+    size_t Options::parseSize(const std::string &flag, const std::string &value, bool allowZero) {
+        size_t size = 0;
+        size_t parsed = 0;
+
+        try {
+            if (!value.empty() && value[0] != '-') {
+                size = std::stoul(value, &parsed);
+            }
+        } catch (const std::logic_error &) {
+            parsed = 0;
+        }
+
+        if (parsed == 0 || parsed != value.size() || (size == 0 && !allowZero)) {
+            std::cerr << "[enact] Error:\n    Interpreter flag '" << flag << "' expects a "
+                      << (allowZero ? "non-negative" : "positive") << " integer, but got '"
+                      << value << "'.\nUsage: enact [interpreter flags] [filename] [program flags]\n\n";
+            throw FlagsError{};
+        }
+
+        return size;
+    }
 }
@@ -13,9 +13,53 @@ namespace enact {
         DEBUG_DISASSEMBLE_CHUNK,
         DEBUG_TRACE_EXECUTION,
         DEBUG_STRESS_GC,
-        DEBUG_LOG_GC
+        DEBUG_LOG_GC,
+        PROFILE_OPCODES,
+        DISABLE_JIT,
+        // Compile hot loops with TraceJit instead of whole functions with BaselineJit.
+        TRACING_JIT,
+        // Sweep the old generation on a thread of its own, instead of as the program allocates.
+        GC_SWEEP_THREAD,
+        // Print how long each optimisation pass took once the program has been compiled.
+        DEBUG_TIME_PASSES,
+
+        // Print the program translated to C, instead of running it.
+        EMIT_C
     };
 
+    // Which instruction set the VM runs programs with.
+    enum class Backend {
+        STACK,
+        // Falls back to STACK for any program using instructions that it doesn't support yet.
+        REGISTER,
+    };
+
+    // Which passes PassManager runs over the compiled bytecode.
+    enum class OptimisationLevel {
+        // Run the bytecode exactly as the compiler wrote it.
+        O0,
+        // Tidy up after the compiler: redundant pushes and pops, jumps to jumps and dead stores.
+        O1,
+        // Also fold constants and remove type checks that are known to pass.
+        O2,
+    };
+
+    // The number of Values the VM stack can hold unless --stack-size says otherwise.
+    constexpr size_t DEFAULT_STACK_SIZE = 64 * 1024;
+
+    // The deepest the VM's call stack can get unless --max-frames says otherwise.
+    constexpr size_t DEFAULT_MAX_FRAMES = 16 * 1024;
+
+    // How many calls and loop iterations a function takes before it is compiled to machine code,
+    // unless --jit-threshold says otherwise.
+    constexpr size_t DEFAULT_JIT_THRESHOLD = 1000;
+
+    // Without --gc-pause-budget, the whole heap is marked in a single pause.
+    constexpr size_t DEFAULT_GC_PAUSE_BUDGET = 0;
+
+    // Without --gc-threads, the GC marks with one thread for each core.
+    constexpr size_t DEFAULT_GC_THREADS = 0;
+
     class FlagsError : public std::runtime_error {
     public:
         FlagsError() : std::runtime_error{"Uncaught FlagsError!"} {}
@@ -26,6 +70,14 @@ namespace enact {
         std::vector<std::string> m_programArgs{};
         std::unordered_set<Flag> m_flags{};
 
+        size_t m_stackSize = DEFAULT_STACK_SIZE;
+        size_t m_maxFrames = DEFAULT_MAX_FRAMES;
+        Backend m_backend = Backend::STACK;
+        OptimisationLevel m_optimisationLevel = OptimisationLevel::O1;
+        size_t m_jitThreshold = DEFAULT_JIT_THRESHOLD;
+        size_t m_gcPauseBudget = DEFAULT_GC_PAUSE_BUDGET;
+        size_t m_gcThreads = DEFAULT_GC_THREADS;
+
     public:
         Options(std::string filename, std::vector<std::string> programArgs, std::unordered_set<Flag> flags);
 
@@ -45,13 +97,67 @@ namespace enact {
 
         const std::vector<std::string> &getProgramArgs();
 
+        size_t getStackSize() const;
+
+        void setStackSize(const std::string &value);
+
+        size_t getMaxFrames() const;
+
+        void setMaxFrames(const std::string &value);
+
+        Backend getBackend() const;
+
+        void setBackend(const std::string &value);
+
+        OptimisationLevel getOptimisationLevel() const;
+
+        void setOptimisationLevel(OptimisationLevel level);
+
+        size_t getJitThreshold() const;
+
+        void setJitThreshold(const std::string &value);
+
+        // In microseconds: how long each slice of incremental marking may take. Zero if the
+        // collector isn't incremental.
+        size_t getGcPauseBudget() const;
+
+        void setGcPauseBudget(const std::string &value);
+
+        // How many threads the GC marks with, counting the one running the program. Zero if
+        // that's up to the GC.
+        size_t getGcThreads() const;
+
+        void setGcThreads(const std::string &value);
+
     private:
+        size_t parseSize(const std::string &flag, const std::string &value, bool allowZero = false);
+
+        // Flags which take a value, passed as "--flag=value".
+        std::unordered_map<std::string, std::function<void(const std::string &)>> m_valueParseTable{
+                {"--stack-size",      std::bind(&Options::setStackSize, this, std::placeholders::_1)},
+                {"--max-frames",      std::bind(&Options::setMaxFrames, this, std::placeholders::_1)},
+                {"--backend",         std::bind(&Options::setBackend, this, std::placeholders::_1)},
+                {"--jit-threshold",   std::bind(&Options::setJitThreshold, this, std::placeholders::_1)},
+                {"--gc-pause-budget", std::bind(&Options::setGcPauseBudget, this, std::placeholders::_1)},
+                {"--gc-threads",      std::bind(&Options::setGcThreads, this, std::placeholders::_1)},
+        };
+
         std::unordered_map<std::string, std::function<void()>> m_parseTable{
                 {"--debug-print-ast",         std::bind(&Options::enableFlag, this, Flag::DEBUG_PRINT_AST)},
                 {"--debug-disassemble-chunk", std::bind(&Options::enableFlag, this, Flag::DEBUG_DISASSEMBLE_CHUNK)},
                 {"--debug-trace-execution",   std::bind(&Options::enableFlag, this, Flag::DEBUG_TRACE_EXECUTION)},
                 {"--debug-stress-gc",         std::bind(&Options::enableFlag, this, Flag::DEBUG_STRESS_GC)},
                 {"--debug-log-gc",            std::bind(&Options::enableFlag, this, Flag::DEBUG_LOG_GC)},
+                {"--profile-opcodes",         std::bind(&Options::enableFlag, this, Flag::PROFILE_OPCODES)},
+                {"--no-jit",                  std::bind(&Options::enableFlag, this, Flag::DISABLE_JIT)},
+                {"--tracing-jit",             std::bind(&Options::enableFlag, this, Flag::TRACING_JIT)},
+                {"--emit-c",                  std::bind(&Options::enableFlag, this, Flag::EMIT_C)},
+                {"--gc-sweep-thread",         std::bind(&Options::enableFlag, this, Flag::GC_SWEEP_THREAD)},
+                {"--debug-time-passes",       std::bind(&Options::enableFlag, this, Flag::DEBUG_TIME_PASSES)},
+
+                {"-O0",                       std::bind(&Options::setOptimisationLevel, this, OptimisationLevel::O0)},
+                {"-O1",                       std::bind(&Options::setOptimisationLevel, this, OptimisationLevel::O1)},
+                {"-O2",                       std::bind(&Options::setOptimisationLevel, this, OptimisationLevel::O2)},
 
                 {"--debug",                   std::bind(&Options::enableFlags, this, std::vector<Flag>{
                         Flag::DEBUG_PRINT_AST,
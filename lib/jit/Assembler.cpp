@@ -0,0 +1,325 @@
+#include "Assembler.h"
+
+namespace enact {
+    static uint8_t encoding(Reg reg) {
+        return static_cast<uint8_t>(reg);
+    }
+
+    Label Assembler::newLabel() {
+        m_labels.emplace_back();
+        return Label{m_labels.size() - 1};
+    }
+
+    void Assembler::bind(Label label) {
+        ENACT_ASSERT(!m_labels[label.id], "Assembler::bind(): Label is already bound.");
+        m_labels[label.id] = m_code.size();
+    }
+
+    bool Assembler::isBound(Label label) const {
+        return m_labels[label.id].has_value();
+    }
+
+    void Assembler::push(Reg reg) {
+        emitRex(false, 0, encoding(reg));
+        emitByte(0x50 | (encoding(reg) & 7));
+    }
+
+    void Assembler::pop(Reg reg) {
+        emitRex(false, 0, encoding(reg));
+        emitByte(0x58 | (encoding(reg) & 7));
+    }
+
+    void Assembler::ret() {
+        emitByte(0xc3);
+    }
+
+    void Assembler::mov(Reg dest, Reg src) {
+        emitRex(true, encoding(src), encoding(dest));
+        emitByte(0x89);
+        emitByte(0xc0 | ((encoding(src) & 7) << 3) | (encoding(dest) & 7));
+    }
+
+    void Assembler::mov(Reg dest, uint64_t imm) {
+        emitRex(true, 0, encoding(dest));
+        emitByte(0xb8 | (encoding(dest) & 7));
+        emitLong(imm);
+    }
+
+    void Assembler::mov32(Reg dest, uint32_t imm) {
+        emitRex(false, 0, encoding(dest));
+        emitByte(0xb8 | (encoding(dest) & 7));
+        emitInt(imm);
+    }
+
+    void Assembler::load(Reg dest, Reg base, int32_t disp) {
+        emitRex(true, encoding(dest), encoding(base));
+        emitByte(0x8b);
+        emitMemory(encoding(dest), base, disp);
+    }
+
+    void Assembler::store(Reg base, int32_t disp, Reg src) {
+        emitRex(true, encoding(src), encoding(base));
+        emitByte(0x89);
+        emitMemory(encoding(src), base, disp);
+    }
+
+    void Assembler::load32(Reg dest, Reg base, int32_t disp) {
+        emitRex(false, encoding(dest), encoding(base));
+        emitByte(0x8b);
+        emitMemory(encoding(dest), base, disp);
+    }
+
+    void Assembler::store32(Reg base, int32_t disp, Reg src) {
+        emitRex(false, encoding(src), encoding(base));
+        emitByte(0x89);
+        emitMemory(encoding(src), base, disp);
+    }
+
+    void Assembler::store32(Reg base, int32_t disp, uint32_t imm) {
+        emitRex(false, 0, encoding(base));
+        emitByte(0xc7);
+        emitMemory(0, base, disp);
+        emitInt(imm);
+    }
+
+    void Assembler::add(Reg dest, int32_t imm) {
+        emitRex(true, 0, encoding(dest));
+        emitByte(0x81);
+        emitByte(0xc0 | (encoding(dest) & 7));
+        emitInt(static_cast<uint32_t>(imm));
+    }
+
+    void Assembler::sub(Reg dest, int32_t imm) {
+        emitRex(true, 0, encoding(dest));
+        emitByte(0x81);
+        emitByte(0xc0 | (5 << 3) | (encoding(dest) & 7));
+        emitInt(static_cast<uint32_t>(imm));
+    }
+
+    void Assembler::and_(Reg dest, Reg src) {
+        emitRex(true, encoding(src), encoding(dest));
+        emitByte(0x21);
+        emitByte(0xc0 | ((encoding(src) & 7) << 3) | (encoding(dest) & 7));
+    }
+
+    void Assembler::or_(Reg dest, Reg src) {
+        emitRex(true, encoding(src), encoding(dest));
+        emitByte(0x09);
+        emitByte(0xc0 | ((encoding(src) & 7) << 3) | (encoding(dest) & 7));
+    }
+
+    void Assembler::xor32(Reg dest, Reg src) {
+        emitRex(false, encoding(src), encoding(dest));
+        emitByte(0x31);
+        emitByte(0xc0 | ((encoding(src) & 7) << 3) | (encoding(dest) & 7));
+    }
+
+    void Assembler::cmp(Reg left, Reg right) {
+        emitRex(true, encoding(right), encoding(left));
+        emitByte(0x39);
+        emitByte(0xc0 | ((encoding(right) & 7) << 3) | (encoding(left) & 7));
+    }
+
+    void Assembler::cmp(Reg left, Reg base, int32_t disp) {
+        emitRex(true, encoding(left), encoding(base));
+        emitByte(0x3b);
+        emitMemory(encoding(left), base, disp);
+    }
+
+    void Assembler::cmp8(Reg base, int32_t disp, uint8_t imm) {
+        emitRex(false, 0, encoding(base));
+        emitByte(0x80);
+        emitMemory(7, base, disp);
+        emitByte(imm);
+    }
+
+    void Assembler::cmp32(Reg base, int32_t disp, uint32_t imm) {
+        emitRex(false, 0, encoding(base));
+        emitByte(0x81);
+        emitMemory(7, base, disp);
+        emitInt(imm);
+    }
+
+    void Assembler::test8(Reg left, Reg right) {
+        emitRex(false, encoding(right), encoding(left), true);
+        emitByte(0x84);
+        emitByte(0xc0 | ((encoding(right) & 7) << 3) | (encoding(left) & 7));
+    }
+
+    void Assembler::add32(Reg dest, Reg base, int32_t disp) {
+        emitRex(false, encoding(dest), encoding(base));
+        emitByte(0x03);
+        emitMemory(encoding(dest), base, disp);
+    }
+
+    void Assembler::sub32(Reg dest, Reg base, int32_t disp) {
+        emitRex(false, encoding(dest), encoding(base));
+        emitByte(0x2b);
+        emitMemory(encoding(dest), base, disp);
+    }
+
+    void Assembler::imul32(Reg dest, Reg base, int32_t disp) {
+        emitRex(false, encoding(dest), encoding(base));
+        emitByte(0x0f);
+        emitByte(0xaf);
+        emitMemory(encoding(dest), base, disp);
+    }
+
+    void Assembler::cmp32(Reg left, Reg base, int32_t disp) {
+        emitRex(false, encoding(left), encoding(base));
+        emitByte(0x3b);
+        emitMemory(encoding(left), base, disp);
+    }
+
+    void Assembler::cdq() {
+        emitByte(0x99);
+    }
+
+    void Assembler::idiv32(Reg base, int32_t disp) {
+        emitRex(false, 0, encoding(base));
+        emitByte(0xf7);
+        emitMemory(7, base, disp);
+    }
+
+    void Assembler::movsd(Xmm dest, Reg base, int32_t disp) {
+        emitSse(0xf2, 0x10, dest, base, disp);
+    }
+
+    void Assembler::movsd(Reg base, int32_t disp, Xmm src) {
+        emitSse(0xf2, 0x11, src, base, disp);
+    }
+
+    void Assembler::cvtsi2sd(Xmm dest, Reg base, int32_t disp) {
+        emitSse(0xf2, 0x2a, dest, base, disp);
+    }
+
+    void Assembler::addsd(Xmm dest, Xmm src) {
+        emitSse(0xf2, 0x58, dest, src);
+    }
+
+    void Assembler::subsd(Xmm dest, Xmm src) {
+        emitSse(0xf2, 0x5c, dest, src);
+    }
+
+    void Assembler::mulsd(Xmm dest, Xmm src) {
+        emitSse(0xf2, 0x59, dest, src);
+    }
+
+    void Assembler::divsd(Xmm dest, Xmm src) {
+        emitSse(0xf2, 0x5e, dest, src);
+    }
+
+    void Assembler::ucomisd(Xmm left, Xmm right) {
+        emitSse(0x66, 0x2e, left, right);
+    }
+
+    void Assembler::set(Condition condition, Reg dest) {
+        emitRex(false, 0, encoding(dest), true);
+        emitByte(0x0f);
+        emitByte(0x90 | static_cast<uint8_t>(condition));
+        emitByte(0xc0 | (encoding(dest) & 7));
+    }
+
+    void Assembler::movzx8(Reg dest, Reg src) {
+        emitRex(false, encoding(dest), encoding(src), true);
+        emitByte(0x0f);
+        emitByte(0xb6);
+        emitByte(0xc0 | ((encoding(dest) & 7) << 3) | (encoding(src) & 7));
+    }
+
+    void Assembler::jmp(Label label) {
+        emitByte(0xe9);
+        emitRel32(label);
+    }
+
+    void Assembler::jmp(Reg target) {
+        emitRex(false, 0, encoding(target));
+        emitByte(0xff);
+        emitByte(0xc0 | (4 << 3) | (encoding(target) & 7));
+    }
+
+    void Assembler::jump(Condition condition, Label label) {
+        emitByte(0x0f);
+        emitByte(0x80 | static_cast<uint8_t>(condition));
+        emitRel32(label);
+    }
+
+    void Assembler::call(Reg target) {
+        emitRex(false, 0, encoding(target));
+        emitByte(0xff);
+        emitByte(0xc0 | (2 << 3) | (encoding(target) & 7));
+    }
+
+    std::vector<uint8_t> Assembler::finish() {
+        for (const auto &[index, label] : m_fixups) {
+            ENACT_ASSERT(m_labels[label], "Assembler::finish(): Jump to a label that was never bound.");
+
+            auto rel = static_cast<uint32_t>(static_cast<int64_t>(*m_labels[label]) - static_cast<int64_t>(index + 4));
+            for (size_t i = 0; i < 4; ++i) {
+                m_code[index + i] = static_cast<uint8_t>((rel >> (8 * i)) & 0xff);
+            }
+        }
+
+        m_fixups.clear();
+        return std::move(m_code);
+    }
+
+    size_t Assembler::getCount() const {
+        return m_code.size();
+    }
+
+    void Assembler::emitByte(uint8_t byte) {
+        m_code.push_back(byte);
+    }
+
+    void Assembler::emitInt(uint32_t value) {
+        for (size_t i = 0; i < 4; ++i) {
+            emitByte(static_cast<uint8_t>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void Assembler::emitLong(uint64_t value) {
+        for (size_t i = 0; i < 8; ++i) {
+            emitByte(static_cast<uint8_t>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void Assembler::emitRex(bool wide, uint8_t reg, uint8_t base, bool force) {
+        uint8_t rex = 0x40 | (wide ? 0x8 : 0) | ((reg & 8) ? 0x4 : 0) | ((base & 8) ? 0x1 : 0);
+
+        // A REX prefix with nothing set still changes which byte registers 4-7 mean.
+        if (rex != 0x40 || force) {
+            emitByte(rex);
+        }
+    }
+
+    void Assembler::emitMemory(uint8_t reg, Reg base, int32_t disp) {
+        // Always [base + disp32]. RSP and R12 can only be used as a base through a SIB byte.
+        emitByte(0x80 | ((reg & 7) << 3) | (encoding(base) & 7));
+        if ((encoding(base) & 7) == 4) {
+            emitByte(0x24);
+        }
+        emitInt(static_cast<uint32_t>(disp));
+    }
+
+    void Assembler::emitRel32(Label label) {
+        m_fixups.emplace_back(m_code.size(), label.id);
+        emitInt(0);
+    }
+
+    void Assembler::emitSse(uint8_t prefix, uint8_t opcode, Xmm reg, Xmm src) {
+        // The prefix is part of the opcode, and has to come before any REX prefix.
+        emitByte(prefix);
+        emitByte(0x0f);
+        emitByte(opcode);
+        emitByte(0xc0 | (static_cast<uint8_t>(reg) << 3) | static_cast<uint8_t>(src));
+    }
+
+    void Assembler::emitSse(uint8_t prefix, uint8_t opcode, Xmm reg, Reg base, int32_t disp) {
+        emitByte(prefix);
+        emitRex(false, static_cast<uint8_t>(reg), encoding(base));
+        emitByte(0x0f);
+        emitByte(opcode);
+        emitMemory(static_cast<uint8_t>(reg), base, disp);
+    }
+}
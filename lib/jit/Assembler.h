@@ -0,0 +1,129 @@
+#ifndef ENACT_ASSEMBLER_H
+#define ENACT_ASSEMBLER_H
+
+#include <optional>
+#include <vector>
+
+#include "../common.h"
+
+namespace enact {
+    // x86-64 general purpose registers, numbered as they are encoded.
+    enum class Reg : uint8_t {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15,
+    };
+
+    // The SSE registers that the JITs use for doubles.
+    enum class Xmm : uint8_t {
+        XMM0, XMM1,
+    };
+
+    // Condition codes, numbered as they are encoded in Jcc and SETcc.
+    enum class Condition : uint8_t {
+        EQUAL = 0x4,
+        NOT_EQUAL = 0x5,
+        ABOVE_EQUAL = 0x3,
+        ABOVE = 0x7,
+        LESS = 0xc,
+        GREATER_EQUAL = 0xd,
+        LESS_EQUAL = 0xe,
+        GREATER = 0xf,
+    };
+
+    // A position in the code that jumps can be emitted to before it is bound.
+    struct Label {
+        size_t id;
+    };
+
+    // Emits just the handful of x86-64 instructions that BaselineJit needs. Every memory operand
+    // is a base register plus a 32 bit displacement.
+    class Assembler {
+        std::vector<uint8_t> m_code{};
+
+        std::vector<std::optional<size_t>> m_labels{};
+
+        // The index of each rel32 waiting on a label, and the label.
+        std::vector<std::pair<size_t, size_t>> m_fixups{};
+
+        void emitByte(uint8_t byte);
+        void emitInt(uint32_t value);
+        void emitLong(uint64_t value);
+
+        void emitRex(bool wide, uint8_t reg, uint8_t base, bool force = false);
+        void emitMemory(uint8_t reg, Reg base, int32_t disp);
+
+        void emitRel32(Label label);
+
+        // A scalar double instruction on two registers, or a register and memory.
+        void emitSse(uint8_t prefix, uint8_t opcode, Xmm reg, Xmm src);
+        void emitSse(uint8_t prefix, uint8_t opcode, Xmm reg, Reg base, int32_t disp);
+
+    public:
+        Label newLabel();
+        void bind(Label label);
+        bool isBound(Label label) const;
+
+        void push(Reg reg);
+        void pop(Reg reg);
+        void ret();
+
+        void mov(Reg dest, Reg src);
+        void mov(Reg dest, uint64_t imm);
+        void mov32(Reg dest, uint32_t imm);
+
+        void load(Reg dest, Reg base, int32_t disp);
+        void store(Reg base, int32_t disp, Reg src);
+        void load32(Reg dest, Reg base, int32_t disp);
+        void store32(Reg base, int32_t disp, Reg src);
+        void store32(Reg base, int32_t disp, uint32_t imm);
+
+        void add(Reg dest, int32_t imm);
+        void sub(Reg dest, int32_t imm);
+        void and_(Reg dest, Reg src);
+        void or_(Reg dest, Reg src);
+        void xor32(Reg dest, Reg src);
+        void cmp(Reg left, Reg right);
+        void cmp(Reg left, Reg base, int32_t disp);
+        void cmp8(Reg base, int32_t disp, uint8_t imm);
+        void cmp32(Reg base, int32_t disp, uint32_t imm);
+        void test8(Reg left, Reg right);
+
+        void add32(Reg dest, Reg base, int32_t disp);
+        void sub32(Reg dest, Reg base, int32_t disp);
+        void imul32(Reg dest, Reg base, int32_t disp);
+        void cmp32(Reg left, Reg base, int32_t disp);
+
+        // Sign extends eax into edx, then divides edx:eax by a memory operand.
+        void cdq();
+        void idiv32(Reg base, int32_t disp);
+
+        void movsd(Xmm dest, Reg base, int32_t disp);
+        void movsd(Reg base, int32_t disp, Xmm src);
+
+        // Converts a 32 bit int in memory.
+        void cvtsi2sd(Xmm dest, Reg base, int32_t disp);
+
+        void addsd(Xmm dest, Xmm src);
+        void subsd(Xmm dest, Xmm src);
+        void mulsd(Xmm dest, Xmm src);
+        void divsd(Xmm dest, Xmm src);
+
+        // Sets the flags like an unsigned comparison. Unordered operands set ZF, PF and CF.
+        void ucomisd(Xmm left, Xmm right);
+
+        void set(Condition condition, Reg dest);
+        void movzx8(Reg dest, Reg src);
+
+        void jmp(Label label);
+        void jmp(Reg target);
+        void jump(Condition condition, Label label);
+        void call(Reg target);
+
+        // Patches every jump to its label. Every label that was jumped to must be bound.
+        std::vector<uint8_t> finish();
+
+        size_t getCount() const;
+    };
+}
+
+#endif //ENACT_ASSEMBLER_H
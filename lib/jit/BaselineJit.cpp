@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cstddef>
+
+#include "BaselineJit.h"
+
+namespace enact {
+    BaselineJit::BaselineJit(FunctionObject *function, JitCallout callout) :
+            JitBuilder{function->getChunk(), callout},
+            m_function{function} {
+    }
+
+    std::shared_ptr<const JitCode> BaselineJit::compile(FunctionObject *function, JitCallout callout) {
+#ifdef ENACT_HAS_JIT
+        return BaselineJit{function, callout}.translate();
+#else
+        return nullptr;
+#endif
+    }
+
+    std::shared_ptr<const JitCode> BaselineJit::translate() {
+        const CodeBuffer &code = m_chunk.getCode();
+
+        // Everything up to the first instruction that the JIT can't even step over is translated.
+        std::vector<size_t> starts{};
+        size_t end = 0;
+        while (end < code.size()) {
+            size_t length = instructionLength(end);
+            if (length == 0) break;
+
+            starts.push_back(end);
+            m_instructions.emplace(end, m_assembler.newLabel());
+            end += length;
+        }
+
+        emitPrologue();
+
+        std::vector<uint32_t> entries(code.size(), JitCode::NO_ENTRY);
+        for (size_t i = 0; i < starts.size(); ++i) {
+            size_t offset = starts[i];
+            size_t next = i + 1 < starts.size() ? starts[i + 1] : end;
+
+            m_assembler.bind(m_instructions.at(offset));
+            entries[offset] = static_cast<uint32_t>(m_assembler.getCount());
+            emitInstruction(offset, next);
+        }
+
+        if (end < code.size()) {
+            m_assembler.jmp(exitTo(end));
+        }
+
+        // Entering and leaving the code costs more than interpreting a handful of instructions.
+        std::vector<bool> loopEntries = findLoopEntries(starts, end);
+        if (std::find(loopEntries.begin(), loopEntries.end(), true) == loopEntries.end()) return nullptr;
+
+        // Translated instructions only exit to themselves when one of their guards fails.
+        std::vector<bool> bailouts(code.size(), false);
+        for (size_t i = 0; i < starts.size(); ++i) {
+            if (!loopEntries[i]) entries[starts[i]] = JitCode::NO_ENTRY;
+            bailouts[starts[i]] = m_untranslated.count(starts[i]) == 0;
+        }
+
+        return finish(std::move(entries), std::move(bailouts));
+    }
+
+    std::vector<bool> BaselineJit::findLoopEntries(const std::vector<size_t> &starts, size_t end) const {
+        const CodeBuffer &code = m_chunk.getCode();
+
+        std::unordered_map<size_t, size_t> indices{};
+        for (size_t i = 0; i < starts.size(); ++i) {
+            indices.emplace(starts[i], i);
+        }
+
+        std::vector<bool> reachesLoop(starts.size(), false);
+        auto reaches = [&](size_t offset) {
+            auto index = indices.find(offset);
+            return index != indices.end() && reachesLoop[index->second];
+        };
+
+        // Jumps can go either way, so keep going until nothing changes.
+        bool changed = true;
+        while (changed) {
+            changed = false;
+
+            for (size_t i = starts.size(); i-- > 0;) {
+                if (reachesLoop[i] || m_untranslated.count(starts[i]) > 0) continue;
+
+                size_t offset = starts[i];
+                size_t next = i + 1 < starts.size() ? starts[i + 1] : end;
+
+                bool result;
+                switch (static_cast<OpCode>(code[offset])) {
+                    case OpCode::LOOP:
+                        result = indices.count(next - readShort(code, offset + 1)) > 0;
+                        break;
+                    case OpCode::JUMP:
+                        result = reaches(next + readShort(code, offset + 1));
+                        break;
+                    case OpCode::JUMP_IF_TRUE:
+                    case OpCode::JUMP_IF_FALSE:
+                        result = reaches(next) || reaches(next + readShort(code, offset + 1));
+                        break;
+                    default:
+                        result = reaches(next);
+                        break;
+                }
+
+                if (result) {
+                    reachesLoop[i] = true;
+                    changed = true;
+                }
+            }
+        }
+
+        return reachesLoop;
+    }
+
+    size_t BaselineJit::instructionLength(size_t offset) const {
+        switch (static_cast<OpCode>(m_chunk.getCode()[offset])) {
+            // A superinstruction is translated as the GET_LOCAL it starts with, followed by the
+            // rest of its sequence, which is still there.
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                return enact::instructionLength(OpCode::GET_LOCAL);
+
+            // A CLOSURE whose constant isn't a function can't be measured, so the code stops
+            // before it and leaves the rest of the function to the interpreter.
+            default:
+                return m_chunk.getInstructionLength(offset);
+        }
+    }
+
+    void BaselineJit::emitInstruction(size_t offset, size_t next) {
+        const CodeBuffer &code = m_chunk.getCode();
+        Assembler &a = m_assembler;
+
+        auto op = static_cast<OpCode>(code[offset]);
+        switch (op) {
+            case OpCode::CONSTANT:
+                emitPush(Reg::R14, code[offset + 1] * VALUE_SIZE, offset);
+                break;
+            case OpCode::CONSTANT_LONG:
+                emitPush(Reg::R14, readLong(code, offset + 1) * VALUE_SIZE, offset);
+                break;
+            case OpCode::TRUE:
+                emitPush(Value{true}, offset);
+                break;
+            case OpCode::FALSE:
+                emitPush(Value{false}, offset);
+                break;
+            case OpCode::NIL:
+                emitPush(Value{}, offset);
+                break;
+
+            // Checks only let the common case through, and leave anything else to the interpreter.
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_INT_LONG:
+                emitGuard(Reg::R12, -VALUE_SIZE, ValueType::INT, exitTo(offset));
+                break;
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+                emitGuard(Reg::R12, -VALUE_SIZE, ValueType::DOUBLE, exitTo(offset));
+                break;
+            case OpCode::CHECK_BOOL:
+            case OpCode::CHECK_TYPE_BOOL:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+                emitGuard(Reg::R12, -VALUE_SIZE, ValueType::BOOL, exitTo(offset));
+                break;
+            case OpCode::CHECK_NUMERIC: {
+                Label notInt = a.newLabel();
+                Label isNumeric = a.newLabel();
+                emitGuard(Reg::R12, -VALUE_SIZE, ValueType::INT, notInt);
+                a.jmp(isNumeric);
+                a.bind(notInt);
+                emitGuard(Reg::R12, -VALUE_SIZE, ValueType::DOUBLE, exitTo(offset));
+                a.bind(isNumeric);
+                break;
+            }
+
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+                emitBinary(op, offset);
+                break;
+
+            case OpCode::POP:
+                a.sub(Reg::R12, VALUE_SIZE);
+                break;
+
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                emitPush(Reg::R13, code[offset + 1] * VALUE_SIZE, offset);
+                break;
+            case OpCode::GET_LOCAL_LONG:
+                emitPush(Reg::R13, readLong(code, offset + 1) * VALUE_SIZE, offset);
+                break;
+            case OpCode::SET_LOCAL:
+                emitCopy(Reg::R13, code[offset + 1] * VALUE_SIZE, Reg::R12, -VALUE_SIZE);
+                break;
+            case OpCode::SET_LOCAL_LONG:
+                emitCopy(Reg::R13, readLong(code, offset + 1) * VALUE_SIZE, Reg::R12, -VALUE_SIZE);
+                break;
+
+            case OpCode::JUMP:
+                a.jmp(target(next + readShort(code, offset + 1)));
+                break;
+            case OpCode::LOOP:
+                a.jmp(target(next - readShort(code, offset + 1)));
+                break;
+            case OpCode::JUMP_IF_TRUE:
+                a.jump(emitTestTrue(-VALUE_SIZE), target(next + readShort(code, offset + 1)));
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                a.jump(invert(emitTestTrue(-VALUE_SIZE)), target(next + readShort(code, offset + 1)));
+                break;
+
+            // The slow paths that the VM already has code for, like allocating and looking up properties.
+            case OpCode::GET_UPVALUE:
+            case OpCode::SET_UPVALUE:
+            case OpCode::GET_PROPERTY_DYNAMIC:
+            case OpCode::SET_PROPERTY_DYNAMIC:
+            case OpCode::CALL_NATIVE:
+            case OpCode::CLOSURE:
+            case OpCode::CLOSE_UPVALUE:
+                emitCallout(offset);
+                break;
+
+            // Calls, returns and the rest are left to the interpreter.
+            default:
+                a.jmp(exitTo(offset));
+                m_untranslated.insert(offset);
+                break;
+        }
+    }
+
+    void BaselineJit::emitBinary(OpCode op, size_t offset) {
+        constexpr int32_t left = -2 * VALUE_SIZE;
+        constexpr int32_t right = -VALUE_SIZE;
+
+        // The untyped forms only handle two ints here.
+        switch (op) {
+            case OpCode::ADD: op = OpCode::ADD_INT; break;
+            case OpCode::SUBTRACT: op = OpCode::SUBTRACT_INT; break;
+            case OpCode::MULTIPLY: op = OpCode::MULTIPLY_INT; break;
+            case OpCode::DIVIDE: op = OpCode::DIVIDE_INT; break;
+            case OpCode::LESS: op = OpCode::LESS_INT; break;
+            case OpCode::GREATER: op = OpCode::GREATER_INT; break;
+            default:
+                emitIntBinary(op, offset);
+                return;
+        }
+
+        emitGuard(Reg::R12, left, ValueType::INT, exitTo(offset));
+        emitGuard(Reg::R12, right, ValueType::INT, exitTo(offset));
+        emitIntBinary(op, offset);
+    }
+
+    Label BaselineJit::target(size_t offset) {
+        auto instruction = m_instructions.find(offset);
+        return instruction != m_instructions.end() ? instruction->second : exitTo(offset);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef ENACT_BASELINEJIT_H
+#define ENACT_BASELINEJIT_H
+
+#include <unordered_set>
+
+#include "JitBuilder.h"
+
+namespace enact {
+    // How many times in a row a function's machine code can exit at a failed guard before it is
+    // thrown away, and the function left to the interpreter for good. A loop that mixes ints and
+    // doubles fails a guard on every iteration, and would otherwise pay for entering and leaving
+    // the code each time round.
+    constexpr uint8_t MAX_BASELINE_BAILOUTS = 16;
+
+    // Translates a function's bytecode into x86-64 by stitching together a template per
+    // instruction. The operand stack stays in memory, so that the interpreter can take over
+    // at any instruction: calls, returns and anything else without a template exit to it,
+    // as do guards that fail, like an ADD that doesn't get two ints. The interpreter then
+    // runs the instruction itself, and re-enters the code at the next backedge or return.
+    class BaselineJit : JitBuilder {
+        FunctionObject *m_function;
+
+        std::unordered_map<size_t, Label> m_instructions{};
+
+        // Instructions that were translated as nothing but an exit.
+        std::unordered_set<size_t> m_untranslated{};
+
+        BaselineJit(FunctionObject *function, JitCallout callout);
+
+        std::shared_ptr<const JitCode> translate();
+
+        // The length of the instruction at offset, or 0 if the JIT can't tell and has to stop.
+        size_t instructionLength(size_t offset) const;
+
+        // Which of the instructions starting at starts can run into a loop's backedge without
+        // exiting first. Those are the only ones worth entering the code at.
+        std::vector<bool> findLoopEntries(const std::vector<size_t> &starts, size_t end) const;
+
+        void emitInstruction(size_t offset, size_t next);
+        void emitBinary(OpCode op, size_t offset);
+
+        // The instruction at offset if it was translated, and otherwise an exit to it.
+        Label target(size_t offset);
+
+    public:
+        // Returns nullptr if the function has no loops that could be entered, the code couldn't
+        // be made executable, or there is no JIT for this platform.
+        static std::shared_ptr<const JitCode> compile(FunctionObject *function, JitCallout callout);
+    };
+}
+
+#endif //ENACT_BASELINEJIT_H
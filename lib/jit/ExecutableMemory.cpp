@@ -0,0 +1,63 @@
+#include <cstring>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define ENACT_HAS_MMAP
+#endif
+
+#include "ExecutableMemory.h"
+
+namespace enact {
+    ExecutableMemory::ExecutableMemory(const std::vector<uint8_t> &code) {
+#ifdef ENACT_HAS_MMAP
+        auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t size = (code.size() + pageSize - 1) / pageSize * pageSize;
+
+        void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return;
+
+        std::memcpy(memory, code.data(), code.size());
+
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, size);
+            return;
+        }
+
+        m_memory = memory;
+        m_size = size;
+#endif
+    }
+
+    ExecutableMemory::~ExecutableMemory() {
+#ifdef ENACT_HAS_MMAP
+        if (m_memory != nullptr) {
+            munmap(m_memory, m_size);
+        }
+#endif
+    }
+
+    ExecutableMemory::ExecutableMemory(ExecutableMemory &&other) noexcept :
+            m_memory{std::exchange(other.m_memory, nullptr)},
+            m_size{std::exchange(other.m_size, 0)} {
+    }
+
+    ExecutableMemory &ExecutableMemory::operator=(ExecutableMemory &&other) noexcept {
+        std::swap(m_memory, other.m_memory);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    bool ExecutableMemory::isValid() const {
+        return m_memory != nullptr;
+    }
+
+    const uint8_t *ExecutableMemory::getCode() const {
+        return static_cast<const uint8_t *>(m_memory);
+    }
+
+    size_t ExecutableMemory::getSize() const {
+        return m_size;
+    }
+}
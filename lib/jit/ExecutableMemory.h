@@ -0,0 +1,35 @@
+#ifndef ENACT_EXECUTABLEMEMORY_H
+#define ENACT_EXECUTABLEMEMORY_H
+
+#include <vector>
+
+#include "../common.h"
+
+namespace enact {
+    // Machine code in its own mapping, which is made executable (and read-only) once the code
+    // has been copied in, so no page is ever writable and executable at the same time.
+    class ExecutableMemory {
+        void *m_memory = nullptr;
+        size_t m_size = 0;
+
+    public:
+        // Mapping can fail, so check isValid() before running anything.
+        explicit ExecutableMemory(const std::vector<uint8_t> &code);
+
+        ~ExecutableMemory();
+
+        ExecutableMemory(const ExecutableMemory &) = delete;
+        ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+
+        ExecutableMemory(ExecutableMemory &&other) noexcept;
+        ExecutableMemory &operator=(ExecutableMemory &&other) noexcept;
+
+        bool isValid() const;
+
+        const uint8_t *getCode() const;
+
+        size_t getSize() const;
+    };
+}
+
+#endif //ENACT_EXECUTABLEMEMORY_H
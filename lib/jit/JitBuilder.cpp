@@ -0,0 +1,302 @@
+#include <cstddef>
+
+#include "JitBuilder.h"
+
+namespace enact {
+    static_assert(sizeof(Value) % 8 == 0, "JitBuilder copies Values a quadword at a time.");
+
+    static constexpr auto STACK_TOP = static_cast<int32_t>(offsetof(JitState, stackTop));
+    static constexpr auto STACK_END = static_cast<int32_t>(offsetof(JitState, stackEnd));
+    static constexpr auto SLOTS = static_cast<int32_t>(offsetof(JitState, slots));
+    static constexpr auto CONSTANTS = static_cast<int32_t>(offsetof(JitState, constants));
+    static constexpr auto EXIT_OFFSET = static_cast<int32_t>(offsetof(JitState, exitOffset));
+
+    JitCode::JitCode(ExecutableMemory memory, std::vector<uint32_t> entries, std::vector<bool> bailouts) :
+            m_memory{std::move(memory)},
+            m_entries{std::move(entries)},
+            m_bailouts{std::move(bailouts)} {
+    }
+
+    bool JitCode::hasEntry(size_t offset) const {
+        return offset < m_entries.size() && m_entries[offset] != NO_ENTRY;
+    }
+
+    bool JitCode::isBailout(size_t offset) const {
+        return offset < m_bailouts.size() && m_bailouts[offset];
+    }
+
+    bool JitCode::run(JitState &state, size_t offset) const {
+        using Entry = uint32_t (*)(JitState *state, const void *target);
+
+        auto entry = reinterpret_cast<Entry>(reinterpret_cast<uintptr_t>(m_memory.getCode()));
+        return entry(&state, m_memory.getCode() + m_entries[offset]) == 0;
+    }
+
+    size_t JitCode::getSize() const {
+        return m_memory.getSize();
+    }
+
+    ValueType JitBuilder::typeOf(Value value) {
+        return value.getValueType();
+    }
+
+    JitBuilder::JitBuilder(const Chunk &chunk, JitCallout callout) :
+            m_chunk{chunk},
+            m_callout{callout},
+            m_exit{m_assembler.newLabel()},
+            m_error{m_assembler.newLabel()} {
+    }
+
+    uint32_t JitBuilder::readLong(const CodeBuffer &code, size_t index) {
+        return code[index] | (code[index + 1] << 8) | (code[index + 2] << 16);
+    }
+
+    uint16_t JitBuilder::readShort(const CodeBuffer &code, size_t index) {
+        return static_cast<uint16_t>(code[index] | (code[index + 1] << 8));
+    }
+
+    Condition JitBuilder::invert(Condition condition) {
+        return condition == Condition::EQUAL ? Condition::NOT_EQUAL : Condition::EQUAL;
+    }
+
+    std::shared_ptr<const JitCode> JitBuilder::finish(std::vector<uint32_t> entries, std::vector<bool> bailouts) {
+        for (const auto &[offset, label] : m_exits) {
+            m_assembler.bind(label);
+            m_assembler.mov32(Reg::RAX, static_cast<uint32_t>(offset));
+            m_assembler.jmp(m_exit);
+        }
+
+        ExecutableMemory memory{m_assembler.finish()};
+        if (!memory.isValid()) return nullptr;
+
+        return std::make_shared<const JitCode>(std::move(memory), std::move(entries), std::move(bailouts));
+    }
+
+    void JitBuilder::emitPrologue() {
+        Assembler &a = m_assembler;
+
+        // uint32_t entry(JitState *state, const void *target). Five pushes on top of the return
+        // address leave the stack 16 byte aligned, as callouts expect.
+        a.push(Reg::RBX);
+        a.push(Reg::R12);
+        a.push(Reg::R13);
+        a.push(Reg::R14);
+        a.push(Reg::R15);
+
+        a.mov(Reg::RBX, Reg::RDI);
+        a.load(Reg::R12, Reg::RBX, STACK_TOP);
+        a.load(Reg::R13, Reg::RBX, SLOTS);
+        a.load(Reg::R14, Reg::RBX, CONSTANTS);
+        a.jmp(Reg::RSI);
+
+        // Every exit arrives here with the offset to carry on from in eax.
+        Label epilogue = a.newLabel();
+        a.bind(m_exit);
+        a.store32(Reg::RBX, EXIT_OFFSET, Reg::RAX);
+        a.xor32(Reg::RAX, Reg::RAX);
+
+        a.bind(epilogue);
+        a.store(Reg::RBX, STACK_TOP, Reg::R12);
+        a.pop(Reg::R15);
+        a.pop(Reg::R14);
+        a.pop(Reg::R13);
+        a.pop(Reg::R12);
+        a.pop(Reg::RBX);
+        a.ret();
+
+        a.bind(m_error);
+        a.mov32(Reg::RAX, 1);
+        a.jmp(epilogue);
+    }
+
+    void JitBuilder::emitCallout(size_t offset) {
+        Assembler &a = m_assembler;
+
+        a.store(Reg::RBX, STACK_TOP, Reg::R12);
+        a.mov(Reg::RDI, Reg::RBX);
+        a.mov32(Reg::RSI, static_cast<uint32_t>(offset));
+        a.mov(Reg::RAX, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(m_callout)));
+        a.call(Reg::RAX);
+        a.load(Reg::R12, Reg::RBX, STACK_TOP);
+
+        a.test8(Reg::RAX, Reg::RAX);
+        a.jump(Condition::EQUAL, m_error);
+    }
+
+    Label JitBuilder::exitTo(size_t offset) {
+        auto exit = m_exits.find(offset);
+        if (exit != m_exits.end()) return exit->second;
+
+        Label label = m_assembler.newLabel();
+        m_exits.emplace(offset, label);
+        return label;
+    }
+
+    void JitBuilder::emitCopy(Reg destBase, int32_t destDisp, Reg srcBase, int32_t srcDisp) {
+        for (int32_t i = 0; i < VALUE_SIZE; i += 8) {
+            m_assembler.load(Reg::RAX, srcBase, srcDisp + i);
+            m_assembler.store(destBase, destDisp + i, Reg::RAX);
+        }
+    }
+
+    void JitBuilder::emitPush(Reg srcBase, int32_t srcDisp, size_t offset) {
+        emitStackCheck(offset);
+        emitCopy(Reg::R12, 0, srcBase, srcDisp);
+        m_assembler.add(Reg::R12, VALUE_SIZE);
+    }
+
+    void JitBuilder::emitPush(Value value, size_t offset) {
+        emitStackCheck(offset);
+
+        uint64_t words[VALUE_SIZE / 8];
+        std::memcpy(words, &value, sizeof(Value));
+        for (int32_t i = 0; i < VALUE_SIZE / 8; ++i) {
+            m_assembler.mov(Reg::RAX, words[i]);
+            m_assembler.store(Reg::R12, i * 8, Reg::RAX);
+        }
+
+        m_assembler.add(Reg::R12, VALUE_SIZE);
+    }
+
+    void JitBuilder::emitStackCheck(size_t offset) {
+        // Let the interpreter run the push instead, and throw the stack overflow error.
+        m_assembler.cmp(Reg::R12, Reg::RBX, STACK_END);
+        m_assembler.jump(Condition::ABOVE_EQUAL, exitTo(offset));
+    }
+
+    void JitBuilder::emitIntBinary(OpCode op, size_t offset) {
+        Assembler &a = m_assembler;
+
+        constexpr int32_t left = -2 * VALUE_SIZE;
+        constexpr int32_t right = -VALUE_SIZE;
+
+        int32_t payload = payloadOffset();
+
+        // The left operand is already tagged as an int, so arithmetic only has to write its payload.
+        a.load32(Reg::RAX, Reg::R12, left + payload);
+        switch (op) {
+            case OpCode::ADD_INT:
+                a.add32(Reg::RAX, Reg::R12, right + payload);
+                a.store32(Reg::R12, left + payload, Reg::RAX);
+                break;
+            case OpCode::SUBTRACT_INT:
+                a.sub32(Reg::RAX, Reg::R12, right + payload);
+                a.store32(Reg::R12, left + payload, Reg::RAX);
+                break;
+            case OpCode::MULTIPLY_INT:
+                a.imul32(Reg::RAX, Reg::R12, right + payload);
+                a.store32(Reg::R12, left + payload, Reg::RAX);
+                break;
+            case OpCode::DIVIDE_INT:
+                // idiv traps on these, so let the interpreter deal with them.
+                a.cmp32(Reg::R12, right + payload, 0u);
+                a.jump(Condition::EQUAL, exitTo(offset));
+                a.cmp32(Reg::R12, right + payload, static_cast<uint32_t>(-1));
+                a.jump(Condition::EQUAL, exitTo(offset));
+
+                a.cdq();
+                a.idiv32(Reg::R12, right + payload);
+                a.store32(Reg::R12, left + payload, Reg::RAX);
+                break;
+            case OpCode::LESS_INT:
+                a.cmp32(Reg::RAX, Reg::R12, right + payload);
+                a.set(Condition::LESS, Reg::RCX);
+                emitStoreBool(left, Reg::RCX);
+                break;
+            case OpCode::GREATER_INT:
+                a.cmp32(Reg::RAX, Reg::R12, right + payload);
+                a.set(Condition::GREATER, Reg::RCX);
+                emitStoreBool(left, Reg::RCX);
+                break;
+            default:
+                ENACT_UNREACHABLE();
+        }
+
+        a.sub(Reg::R12, VALUE_SIZE);
+    }
+
+#ifdef ENACT_NAN_BOXING
+    int32_t JitBuilder::payloadOffset() {
+        return 0;
+    }
+
+    void JitBuilder::emitGuard(Reg base, int32_t disp, ValueType type, Label fail) {
+        Assembler &a = m_assembler;
+        a.load(Reg::RAX, base, disp);
+
+        switch (type) {
+            case ValueType::INT:
+                a.mov(Reg::RCX, Value::INT_MASK);
+                a.and_(Reg::RAX, Reg::RCX);
+                a.mov(Reg::RCX, Value::QNAN | Value::TAG_INT);
+                a.cmp(Reg::RAX, Reg::RCX);
+                a.jump(Condition::NOT_EQUAL, fail);
+                break;
+            case ValueType::DOUBLE:
+                a.mov(Reg::RCX, Value::QNAN);
+                a.and_(Reg::RAX, Reg::RCX);
+                a.cmp(Reg::RAX, Reg::RCX);
+                a.jump(Condition::EQUAL, fail);
+                break;
+            case ValueType::BOOL:
+                a.mov(Reg::RCX, uint64_t{1});
+                a.or_(Reg::RAX, Reg::RCX);
+                a.mov(Reg::RCX, Value::TRUE_BITS);
+                a.cmp(Reg::RAX, Reg::RCX);
+                a.jump(Condition::NOT_EQUAL, fail);
+                break;
+            default:
+                ENACT_UNREACHABLE();
+        }
+    }
+
+    void JitBuilder::emitStoreBool(int32_t disp, Reg byte) {
+        Assembler &a = m_assembler;
+        a.movzx8(Reg::RCX, byte);
+        a.mov(Reg::RAX, Value::FALSE_BITS);
+        a.or_(Reg::RAX, Reg::RCX);
+        a.store(Reg::R12, disp, Reg::RAX);
+    }
+
+    void JitBuilder::emitStoreDouble(int32_t disp, Xmm src) {
+        m_assembler.movsd(Reg::R12, disp, src);
+    }
+
+    Condition JitBuilder::emitTestTrue(int32_t disp) {
+        Assembler &a = m_assembler;
+        a.load(Reg::RAX, Reg::R12, disp);
+        a.mov(Reg::RCX, Value::TRUE_BITS);
+        a.cmp(Reg::RAX, Reg::RCX);
+        return Condition::EQUAL;
+    }
+#else
+    int32_t JitBuilder::payloadOffset() {
+        return static_cast<int32_t>(offsetof(Value, m_value));
+    }
+
+    void JitBuilder::emitGuard(Reg base, int32_t disp, ValueType type, Label fail) {
+        static_assert(sizeof(ValueType) == 4, "JitBuilder compares Value tags as 32 bit integers.");
+
+        m_assembler.cmp32(base, disp + static_cast<int32_t>(offsetof(Value, m_type)), static_cast<uint32_t>(type));
+        m_assembler.jump(Condition::NOT_EQUAL, fail);
+    }
+
+    void JitBuilder::emitStoreBool(int32_t disp, Reg byte) {
+        m_assembler.store32(Reg::R12, disp + static_cast<int32_t>(offsetof(Value, m_type)),
+                            static_cast<uint32_t>(ValueType::BOOL));
+        m_assembler.movzx8(Reg::RCX, byte);
+        m_assembler.store32(Reg::R12, disp + static_cast<int32_t>(offsetof(Value, m_value)), Reg::RCX);
+    }
+
+    void JitBuilder::emitStoreDouble(int32_t disp, Xmm src) {
+        m_assembler.store32(Reg::R12, disp + static_cast<int32_t>(offsetof(Value, m_type)),
+                            static_cast<uint32_t>(ValueType::DOUBLE));
+        m_assembler.movsd(Reg::R12, disp + static_cast<int32_t>(offsetof(Value, m_value)), src);
+    }
+
+    Condition JitBuilder::emitTestTrue(int32_t disp) {
+        m_assembler.cmp8(Reg::R12, disp + static_cast<int32_t>(offsetof(Value, m_value)), 0);
+        return Condition::NOT_EQUAL;
+    }
+#endif
+}
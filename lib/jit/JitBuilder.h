@@ -0,0 +1,120 @@
+#ifndef ENACT_JITBUILDER_H
+#define ENACT_JITBUILDER_H
+
+#include <memory>
+#include <unordered_map>
+
+#include "../value/Object.h"
+#include "Assembler.h"
+#include "ExecutableMemory.h"
+
+// The generated code follows the System V calling convention, so the JITs only run on x86-64
+// outside of Windows. Everywhere else they never compile anything.
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define ENACT_HAS_JIT
+#endif
+
+namespace enact {
+    class VM;
+
+    // What jitted code shares with the VM while it runs. The generated code reads and writes
+    // these fields directly, so don't reorder them.
+    struct JitState {
+        Value *stackTop;
+        const Value *stackEnd;
+        Value *slots;
+        const Value *constants;
+        VM *vm;
+
+        // Set when the code exits: where in the chunk the interpreter should carry on.
+        uint32_t exitOffset;
+    };
+
+    // Runs the single instruction at offset in the current frame's chunk, for anything too
+    // involved to generate inline. Returns false if it threw a runtime error, which will
+    // already have been reported.
+    using JitCallout = bool (*)(JitState *state, uint32_t offset);
+
+    // Machine code for a function's chunk, which can be entered at some of its instructions.
+    class JitCode {
+        ExecutableMemory m_memory;
+
+        // Where each instruction starts in the machine code, indexed by its offset in the chunk.
+        std::vector<uint32_t> m_entries;
+
+        // The offsets whose exits mean that a guard failed, rather than that the code reached
+        // something it leaves to the interpreter.
+        std::vector<bool> m_bailouts;
+
+    public:
+        static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+        JitCode(ExecutableMemory memory, std::vector<uint32_t> entries, std::vector<bool> bailouts);
+
+        bool hasEntry(size_t offset) const;
+
+        bool isBailout(size_t offset) const;
+
+        // Runs from the instruction at offset until the code exits back to the interpreter.
+        // Returns false if a callout threw a runtime error.
+        bool run(JitState &state, size_t offset) const;
+
+        size_t getSize() const;
+    };
+
+    // What BaselineJit and TraceJit have in common: the entry and exit sequences, and templates
+    // for the operand stack, which stays in memory so that the interpreter can take over at
+    // any instruction.
+    class JitBuilder {
+    public:
+        static ValueType typeOf(Value value);
+
+    protected:
+        static constexpr int32_t VALUE_SIZE = sizeof(Value);
+
+        const Chunk &m_chunk;
+        JitCallout m_callout;
+
+        Assembler m_assembler{};
+
+        std::unordered_map<size_t, Label> m_exits{};
+        Label m_exit;
+        Label m_error;
+
+        JitBuilder(const Chunk &chunk, JitCallout callout);
+
+        static uint32_t readLong(const CodeBuffer &code, size_t index);
+        static uint16_t readShort(const CodeBuffer &code, size_t index);
+
+        static Condition invert(Condition condition);
+
+        // Emits the exit stubs and makes the code executable. Returns nullptr if it couldn't be.
+        std::shared_ptr<const JitCode> finish(std::vector<uint32_t> entries, std::vector<bool> bailouts = {});
+
+        // uint32_t entry(JitState *state, const void *target), which the code is always entered
+        // through. Must be emitted first.
+        void emitPrologue();
+        void emitCallout(size_t offset);
+
+        // A label that exits to the interpreter at offset.
+        Label exitTo(size_t offset);
+
+        void emitCopy(Reg destBase, int32_t destDisp, Reg srcBase, int32_t srcDisp);
+        void emitPush(Reg srcBase, int32_t srcDisp, size_t offset);
+        void emitPush(Value value, size_t offset);
+        void emitStackCheck(size_t offset);
+
+        // The int templates, for the top two values on the stack. Division exits at offset when
+        // idiv would trap.
+        void emitIntBinary(OpCode op, size_t offset);
+
+        // The parts of the templates that depend on how Values are laid out.
+        static int32_t payloadOffset();
+        void emitGuard(Reg base, int32_t disp, ValueType type, Label fail);
+        void emitStoreBool(int32_t disp, Reg byte);
+        void emitStoreDouble(int32_t disp, Xmm src);
+        Condition emitTestTrue(int32_t disp);
+    };
+}
+
+#endif //ENACT_JITBUILDER_H
@@ -0,0 +1,472 @@
+#include <algorithm>
+
+#include "TraceJit.h"
+
+namespace enact {
+    // How many times compile() will re-translate a trace while working out its invariants.
+    static constexpr size_t MAX_INVARIANT_ROUNDS = 4;
+
+    TraceJit::TraceJit(FunctionObject *function, uint32_t header, const std::vector<TraceStep> &steps,
+                       JitCallout callout, std::unordered_map<uint32_t, ValueType> invariants) :
+            JitBuilder{function->getChunk(), callout},
+            m_header{header},
+            m_steps{steps},
+            m_locals{invariants},
+            m_invariants{std::move(invariants)} {
+    }
+
+    bool TraceJit::canTrace(OpCode op) {
+        switch (op) {
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG:
+            case OpCode::TRUE:
+            case OpCode::FALSE:
+            case OpCode::NIL:
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_NUMERIC:
+            case OpCode::CHECK_BOOL:
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_LONG:
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_INT_LONG:
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+            case OpCode::CHECK_TYPE_BOOL:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+            case OpCode::GET_ARRAY_INDEX:
+            case OpCode::SET_ARRAY_INDEX:
+            case OpCode::POP:
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_LOCAL_LONG:
+            case OpCode::SET_LOCAL:
+            case OpCode::SET_LOCAL_LONG:
+            case OpCode::GET_UPVALUE:
+            case OpCode::SET_UPVALUE:
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::LOOP:
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    std::shared_ptr<const JitCode> TraceJit::compile(FunctionObject *function, uint32_t header,
+                                                     const std::vector<TraceStep> &steps, JitCallout callout) {
+#ifdef ENACT_HAS_JIT
+        // Locals that keep their types all the way round the loop only need checking on the way
+        // in. Start by assuming nothing, then assume whatever was known at the end of the last
+        // round, until that settles.
+        std::unordered_map<uint32_t, ValueType> invariants{};
+        for (size_t round = 1;; ++round) {
+            TraceJit jit{function, header, steps, callout, invariants};
+            if (!jit.emitTrace()) return nullptr;
+
+            bool isSound = std::all_of(invariants.begin(), invariants.end(), [&](const auto &invariant) {
+                auto known = jit.m_locals.find(invariant.first);
+                return known != jit.m_locals.end() && known->second == invariant.second;
+            });
+
+            if (isSound && (jit.m_locals == invariants || round >= MAX_INVARIANT_ROUNDS)) {
+                return jit.finish(std::move(jit.m_entries));
+            }
+
+            // Assuming nothing is always sound, so fall back to that rather than going round forever.
+            if (isSound && round < MAX_INVARIANT_ROUNDS) {
+                invariants = jit.m_locals;
+            } else {
+                invariants.clear();
+            }
+        }
+#else
+        return nullptr;
+#endif
+    }
+
+    bool TraceJit::emitTrace() {
+        const CodeBuffer &code = m_chunk.getCode();
+
+        emitPrologue();
+
+        m_entries.assign(code.size(), JitCode::NO_ENTRY);
+        m_entries[m_header] = static_cast<uint32_t>(m_assembler.getCount());
+
+        // If the invariants don't hold, the interpreter runs the iteration instead.
+        for (const auto &[local, type] : m_invariants) {
+            emitGuard(Reg::R13, local * VALUE_SIZE, type, exitTo(m_header));
+        }
+
+        Label loop = m_assembler.newLabel();
+        m_assembler.bind(loop);
+
+        for (size_t i = 0; i < m_steps.size(); ++i) {
+            const TraceStep &step = m_steps[i];
+            size_t next = i + 1 < m_steps.size() ? m_steps[i + 1].offset : m_header;
+
+            if (!emitStep(static_cast<OpCode>(code[step.offset]), step.offset, step, next)) {
+                return false;
+            }
+        }
+
+        m_assembler.jmp(loop);
+        return true;
+    }
+
+    bool TraceJit::emitStep(OpCode op, size_t offset, const TraceStep &step, size_t next) {
+        const CodeBuffer &code = m_chunk.getCode();
+        Assembler &a = m_assembler;
+
+        switch (op) {
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG: {
+                uint32_t index = op == OpCode::CONSTANT ? code[offset + 1] : readLong(code, offset + 1);
+                emitPush(Reg::R14, index * VALUE_SIZE, offset);
+                push(Known{typeOf(m_chunk.getConstants()[index])});
+                break;
+            }
+            case OpCode::TRUE:
+            case OpCode::FALSE:
+                emitPush(Value{op == OpCode::TRUE}, offset);
+                push(Known{ValueType::BOOL});
+                break;
+            case OpCode::NIL:
+                emitPush(Value{}, offset);
+                push(Known{ValueType::NIL});
+                break;
+
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_INT_LONG:
+                ensureType(0, ValueType::INT, offset);
+                break;
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+                ensureType(0, ValueType::DOUBLE, offset);
+                break;
+            case OpCode::CHECK_BOOL:
+            case OpCode::CHECK_TYPE_BOOL:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+                ensureType(0, ValueType::BOOL, offset);
+                break;
+            case OpCode::CHECK_NUMERIC: {
+                Known *top = peek(0);
+                if (top && (top->type == ValueType::INT || top->type == ValueType::DOUBLE)) break;
+
+                if (step.top != ValueType::INT && step.top != ValueType::DOUBLE) return false;
+                ensureType(0, step.top, offset);
+                break;
+            }
+
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                return emitArithmetic(op, offset, step);
+
+            case OpCode::POP:
+                a.sub(Reg::R12, VALUE_SIZE);
+                pop();
+                break;
+
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_LOCAL_LONG: {
+                uint32_t local = op == OpCode::GET_LOCAL ? code[offset + 1] : readLong(code, offset + 1);
+                emitPush(Reg::R13, local * VALUE_SIZE, offset);
+
+                auto type = m_locals.find(local);
+                push(Known{type != m_locals.end() ? std::optional{type->second} : std::nullopt, local});
+                break;
+            }
+            case OpCode::SET_LOCAL:
+            case OpCode::SET_LOCAL_LONG: {
+                uint32_t local = op == OpCode::SET_LOCAL ? code[offset + 1] : readLong(code, offset + 1);
+                emitCopy(Reg::R13, local * VALUE_SIZE, Reg::R12, -VALUE_SIZE);
+
+                forgetLocal(local);
+                Known *top = peek(0);
+                if (top && top->type) m_locals[local] = *top->type;
+                break;
+            }
+
+            // The trace just carries on with whatever ran next.
+            case OpCode::JUMP:
+            case OpCode::LOOP:
+                break;
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE:
+                emitBranch(op, offset, next);
+                break;
+
+            case OpCode::GET_ARRAY_INDEX:
+                emitCallout(offset);
+                pop();
+                pop();
+                push(Known{});
+                break;
+            case OpCode::SET_ARRAY_INDEX:
+                emitCallout(offset);
+                pop();
+                pop();
+                break;
+            case OpCode::GET_UPVALUE:
+                emitCallout(offset);
+                push(Known{});
+                break;
+            case OpCode::SET_UPVALUE:
+                // The upvalue could be any of the locals.
+                emitCallout(offset);
+                forgetLocals();
+                break;
+
+            // Superinstructions are compiled as the sequences they stand for, which are still
+            // there after the first opcode.
+            case OpCode::GET_LOCAL_GET_LOCAL:
+                emitStep(OpCode::GET_LOCAL, offset, step, next);
+                emitStep(OpCode::GET_LOCAL, offset + 2, step, next);
+                break;
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+                emitStep(OpCode::GET_LOCAL, offset, step, next);
+                emitStep(OpCode::CONSTANT, offset + 2, step, next);
+                emitStep(OpCode::LESS_INT, offset + 4, step, next);
+                emitStep(OpCode::JUMP_IF_FALSE, offset + 5, step, next);
+                break;
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+                emitStep(OpCode::GET_LOCAL, offset, step, next);
+                emitStep(OpCode::CONSTANT, offset + 2, step, next);
+                emitStep(OpCode::ADD_INT, offset + 4, step, next);
+                emitStep(OpCode::SET_LOCAL, offset + 5, step, next);
+                emitStep(OpCode::POP, offset + 7, step, next);
+                break;
+
+            // Including a CHECK_TYPE(_LONG) that wasn't quickened, because it checks for more than a tag.
+            default:
+                return false;
+        }
+
+        return true;
+    }
+
+    bool TraceJit::emitArithmetic(OpCode op, size_t offset, const TraceStep &step) {
+        ValueType left;
+        ValueType right;
+
+        switch (op) {
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+                left = right = ValueType::INT;
+                learnType(1, left);
+                learnType(0, right);
+                break;
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                left = right = ValueType::DOUBLE;
+                learnType(1, left);
+                learnType(0, right);
+                break;
+
+            default:
+                // Specialise the untyped forms to the operands they saw.
+                left = step.second;
+                right = step.top;
+
+                for (ValueType type : {left, right}) {
+                    if (type != ValueType::INT && type != ValueType::DOUBLE) return false;
+                }
+
+                ensureType(1, left, offset);
+                ensureType(0, right, offset);
+                break;
+        }
+
+        bool isComparison = op == OpCode::LESS || op == OpCode::GREATER ||
+                            op == OpCode::LESS_INT || op == OpCode::GREATER_INT ||
+                            op == OpCode::LESS_FLOAT || op == OpCode::GREATER_FLOAT;
+        bool isInt = left == ValueType::INT && right == ValueType::INT;
+
+        if (isInt) {
+            switch (op) {
+                case OpCode::ADD: op = OpCode::ADD_INT; break;
+                case OpCode::SUBTRACT: op = OpCode::SUBTRACT_INT; break;
+                case OpCode::MULTIPLY: op = OpCode::MULTIPLY_INT; break;
+                case OpCode::DIVIDE: op = OpCode::DIVIDE_INT; break;
+                case OpCode::LESS: op = OpCode::LESS_INT; break;
+                case OpCode::GREATER: op = OpCode::GREATER_INT; break;
+                default: break;
+            }
+
+            emitIntBinary(op, offset);
+        } else {
+            emitFloatBinary(op, left, right);
+        }
+
+        pop();
+        pop();
+        push(Known{isComparison ? ValueType::BOOL : isInt ? ValueType::INT : ValueType::DOUBLE});
+        return true;
+    }
+
+    void TraceJit::emitFloatBinary(OpCode op, ValueType left, ValueType right) {
+        Assembler &a = m_assembler;
+
+        constexpr int32_t leftDisp = -2 * VALUE_SIZE;
+        constexpr int32_t rightDisp = -VALUE_SIZE;
+        int32_t payload = payloadOffset();
+
+        // An int on either side is converted, as the interpreter does.
+        auto load = [&](Xmm dest, int32_t disp, ValueType type) {
+            if (type == ValueType::INT) {
+                a.cvtsi2sd(dest, Reg::R12, disp + payload);
+            } else {
+                a.movsd(dest, Reg::R12, disp + payload);
+            }
+        };
+        load(Xmm::XMM0, leftDisp, left);
+        load(Xmm::XMM1, rightDisp, right);
+
+        switch (op) {
+            case OpCode::ADD:
+            case OpCode::ADD_FLOAT:
+                a.addsd(Xmm::XMM0, Xmm::XMM1);
+                emitStoreDouble(leftDisp, Xmm::XMM0);
+                break;
+            case OpCode::SUBTRACT:
+            case OpCode::SUBTRACT_FLOAT:
+                a.subsd(Xmm::XMM0, Xmm::XMM1);
+                emitStoreDouble(leftDisp, Xmm::XMM0);
+                break;
+            case OpCode::MULTIPLY:
+            case OpCode::MULTIPLY_FLOAT:
+                a.mulsd(Xmm::XMM0, Xmm::XMM1);
+                emitStoreDouble(leftDisp, Xmm::XMM0);
+                break;
+            case OpCode::DIVIDE:
+            case OpCode::DIVIDE_FLOAT:
+                a.divsd(Xmm::XMM0, Xmm::XMM1);
+                emitStoreDouble(leftDisp, Xmm::XMM0);
+                break;
+
+            // Both compare the larger side against the smaller, so that a NaN comes out false.
+            case OpCode::LESS:
+            case OpCode::LESS_FLOAT:
+                a.ucomisd(Xmm::XMM1, Xmm::XMM0);
+                a.set(Condition::ABOVE, Reg::RCX);
+                emitStoreBool(leftDisp, Reg::RCX);
+                break;
+            case OpCode::GREATER:
+            case OpCode::GREATER_FLOAT:
+                a.ucomisd(Xmm::XMM0, Xmm::XMM1);
+                a.set(Condition::ABOVE, Reg::RCX);
+                emitStoreBool(leftDisp, Reg::RCX);
+                break;
+
+            default:
+                ENACT_UNREACHABLE();
+        }
+
+        a.sub(Reg::R12, VALUE_SIZE);
+    }
+
+    void TraceJit::emitBranch(OpCode op, size_t offset, size_t next) {
+        size_t fallthrough = offset + 3;
+        size_t target = fallthrough + readShort(m_chunk.getCode(), offset + 1);
+
+        bool wasTaken = next != fallthrough;
+        bool jumpsIfTrue = op == OpCode::JUMP_IF_TRUE;
+
+        // Leave the trace whenever the branch would go the other way to how it was recorded.
+        Condition isTrue = emitTestTrue(-VALUE_SIZE);
+        m_assembler.jump(wasTaken != jumpsIfTrue ? isTrue : invert(isTrue),
+                         exitTo(wasTaken ? fallthrough : target));
+    }
+
+    void TraceJit::push(Known known) {
+        m_stack.push_back(known);
+    }
+
+    TraceJit::Known TraceJit::pop() {
+        if (m_stack.empty()) return Known{};
+
+        Known known = m_stack.back();
+        m_stack.pop_back();
+        return known;
+    }
+
+    TraceJit::Known *TraceJit::peek(size_t depth) {
+        return depth < m_stack.size() ? &m_stack[m_stack.size() - 1 - depth] : nullptr;
+    }
+
+    void TraceJit::ensureType(size_t depth, ValueType type, size_t offset) {
+        Known *known = peek(depth);
+        if (known && known->type == type) return;
+
+        emitGuard(Reg::R12, -static_cast<int32_t>(depth + 1) * VALUE_SIZE, type, exitTo(offset));
+        learnType(depth, type);
+    }
+
+    void TraceJit::learnType(size_t depth, ValueType type) {
+        Known *known = peek(depth);
+        if (!known) return;
+
+        known->type = type;
+        if (known->local) m_locals[*known->local] = type;
+    }
+
+    void TraceJit::forgetLocal(uint32_t local) {
+        m_locals.erase(local);
+        for (Known &known : m_stack) {
+            if (known.local == local) known.local.reset();
+        }
+    }
+
+    void TraceJit::forgetLocals() {
+        m_locals.clear();
+        for (Known &known : m_stack) {
+            known.local.reset();
+        }
+    }
+}
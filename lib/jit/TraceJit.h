@@ -0,0 +1,70 @@
+#ifndef ENACT_TRACEJIT_H
+#define ENACT_TRACEJIT_H
+
+#include <optional>
+
+#include "JitBuilder.h"
+#include "TraceRecorder.h"
+
+namespace enact {
+    // Compiles a recorded trace into a straight line of machine code that runs round the loop
+    // until a guard fails. Branches only follow the direction they took while recording, and
+    // leave the trace otherwise. Because the types the trace saw are known, the templates for
+    // generic arithmetic are specialised to them, and type checks are dropped wherever a value's
+    // type is already known, from a guard or the instruction that produced it.
+    class TraceJit : JitBuilder {
+        // What the trace knows about a value on the stack.
+        struct Known {
+            std::optional<ValueType> type{};
+
+            // The local it was loaded from, as long as that hasn't been assigned since.
+            std::optional<uint32_t> local{};
+        };
+
+        uint32_t m_header;
+        const std::vector<TraceStep> &m_steps;
+
+        // Only values pushed since the trace started are tracked.
+        std::vector<Known> m_stack{};
+        std::unordered_map<uint32_t, ValueType> m_locals;
+
+        // The types of the locals that are checked once on entry, and still hold at the backedge.
+        std::unordered_map<uint32_t, ValueType> m_invariants;
+
+        std::vector<uint32_t> m_entries{};
+
+        TraceJit(FunctionObject *function, uint32_t header, const std::vector<TraceStep> &steps,
+                 JitCallout callout, std::unordered_map<uint32_t, ValueType> invariants);
+
+        // Returns false if anything in the trace can't be compiled after all.
+        bool emitTrace();
+
+        // Emits op, which ran at offset and was followed by the instruction at next. For the
+        // instructions in a superinstruction's sequence, op is what offset holds underneath.
+        bool emitStep(OpCode op, size_t offset, const TraceStep &step, size_t next);
+        bool emitArithmetic(OpCode op, size_t offset, const TraceStep &step);
+        void emitFloatBinary(OpCode op, ValueType left, ValueType right);
+        void emitBranch(OpCode op, size_t offset, size_t next);
+
+        void push(Known known);
+        Known pop();
+        Known *peek(size_t depth);
+
+        // Guards that the value at depth has type, unless that is already known.
+        void ensureType(size_t depth, ValueType type, size_t offset);
+        void learnType(size_t depth, ValueType type);
+
+        void forgetLocal(uint32_t local);
+        void forgetLocals();
+
+    public:
+        // Whether the trace compiler has a template for op, or one that it might be quickened to.
+        static bool canTrace(OpCode op);
+
+        // Returns nullptr if the trace couldn't be compiled, or there is no JIT for this platform.
+        static std::shared_ptr<const JitCode> compile(FunctionObject *function, uint32_t header,
+                                                      const std::vector<TraceStep> &steps, JitCallout callout);
+    };
+}
+
+#endif //ENACT_TRACEJIT_H
@@ -0,0 +1,50 @@
+#include "TraceJit.h"
+#include "TraceRecorder.h"
+
+namespace enact {
+    void TraceRecorder::start(FunctionObject *function, size_t frameCount, uint32_t header) {
+        m_function = function;
+        m_frameCount = frameCount;
+        m_header = header;
+        m_steps.clear();
+    }
+
+    void TraceRecorder::stop() {
+        m_function = nullptr;
+    }
+
+    bool TraceRecorder::isRecording() const {
+        return m_function != nullptr;
+    }
+
+    TraceRecorder::Status TraceRecorder::record(size_t frameCount, uint32_t offset, Value top, Value second) {
+        // Calls and returns aren't traced.
+        if (frameCount != m_frameCount) return Status::ABORTED;
+
+        const CodeBuffer &code = m_function->getChunk().getCode();
+        if (offset == m_header && !m_steps.empty()) {
+            // Anything but the loop's own backedge would need the trace to branch back.
+            bool isBackedge = static_cast<OpCode>(code[m_steps.back().offset]) == OpCode::LOOP;
+            return isBackedge ? Status::FINISHED : Status::ABORTED;
+        }
+
+        if (m_steps.size() == MAX_TRACE_LENGTH || !TraceJit::canTrace(static_cast<OpCode>(code[offset]))) {
+            return Status::ABORTED;
+        }
+
+        m_steps.push_back(TraceStep{offset, JitBuilder::typeOf(top), JitBuilder::typeOf(second)});
+        return Status::RECORDING;
+    }
+
+    FunctionObject *TraceRecorder::getFunction() const {
+        return m_function;
+    }
+
+    uint32_t TraceRecorder::getHeader() const {
+        return m_header;
+    }
+
+    const std::vector<TraceStep> &TraceRecorder::getSteps() const {
+        return m_steps;
+    }
+}
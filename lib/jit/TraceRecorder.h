@@ -0,0 +1,61 @@
+#ifndef ENACT_TRACERECORDER_H
+#define ENACT_TRACERECORDER_H
+
+#include <vector>
+
+#include "../value/Object.h"
+
+namespace enact {
+    // The most instructions a trace can hold. Recording gives up on longer loop bodies.
+    constexpr size_t MAX_TRACE_LENGTH = 1024;
+
+    // How many times a loop's trace can fail to record or compile before the loop is left
+    // to the interpreter for good.
+    constexpr uint8_t MAX_TRACE_ATTEMPTS = 3;
+
+    // One instruction that the interpreter ran while a trace was being recorded.
+    struct TraceStep {
+        uint32_t offset;
+
+        // The types of the top two values on the stack just before it ran.
+        ValueType top;
+        ValueType second;
+    };
+
+    // Follows the interpreter through one iteration of a hot loop, from its header back
+    // around to it, noting each instruction and the types it saw.
+    class TraceRecorder {
+        FunctionObject *m_function = nullptr;
+        size_t m_frameCount = 0;
+        uint32_t m_header = 0;
+
+        std::vector<TraceStep> m_steps{};
+
+    public:
+        enum class Status {
+            RECORDING,
+            FINISHED,
+            ABORTED,
+        };
+
+        // Starts recording the loop with its header at offset in the function, which is running
+        // in the frameCount'th frame.
+        void start(FunctionObject *function, size_t frameCount, uint32_t header);
+
+        void stop();
+
+        bool isRecording() const;
+
+        // Called before each instruction while recording. Traces are aborted if they leave the
+        // frame or run anything TraceJit can't compile.
+        Status record(size_t frameCount, uint32_t offset, Value top, Value second);
+
+        FunctionObject *getFunction() const;
+
+        uint32_t getHeader() const;
+
+        const std::vector<TraceStep> &getSteps() const;
+    };
+}
+
+#endif //ENACT_TRACERECORDER_H
@@ -1,7 +1,28 @@
+#include <algorithm>
+#include <thread>
+
 #include "../context/CompileContext.h"
+#include "ParallelMarker.h"
 
 namespace enact {
-    GC::GC(Context &context) : m_context{context} {
+    GC::GC(Context &context) :
+            m_context{context},
+            // The sweeping thread can't log either.
+            m_sweeper{*this, context.options.flagEnabled(Flag::GC_SWEEP_THREAD) &&
+                             !context.options.flagEnabled(Flag::DEBUG_LOG_GC)} {
+        m_isStressing = m_context.options.flagEnabled(Flag::DEBUG_STRESS_GC);
+        m_isLogging = m_context.options.flagEnabled(Flag::DEBUG_LOG_GC);
+        m_pauseBudget = std::chrono::microseconds{m_context.options.getGcPauseBudget()};
+
+        // Zero threads means one for each core. The marking threads can't log, so logging
+        // keeps to one.
+        m_markThreads = m_context.options.getGcThreads();
+        if (m_markThreads == 0) m_markThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        if (m_isLogging) m_markThreads = 1;
+
+        if (m_isStressing) {
+            m_nextRun = 0;
+        }
     }
 
     GC::~GC() {
@@ -10,15 +31,19 @@ namespace enact {
 
 
     Object *GC::cloneObject(Object *object) {
-        m_bytesAllocated += object->size();
-        if (m_bytesAllocated > m_nextRun || m_context.options.flagEnabled(Flag::DEBUG_STRESS_GC)) {
-            collectGarbage();
+        if (m_nurseryBytes + object->size() > GC_NURSERY_SIZE || m_isStressing) {
+            collectNursery();
+        } else if (m_isMarking && m_nurseryBytes >= m_nextSlice) {
+            markSlice();
+        } else if (m_isSweeping && m_nurseryBytes >= m_nextSweep) {
+            sweepSlice();
         }
 
-        Object *cloned = object->clone();
-        m_objects.push_back(cloned);
+        Object *cloned = copyObject(object);
+        account(cloned);
+        m_nursery.push_back(cloned);
 
-        if (m_context.options.flagEnabled(Flag::DEBUG_LOG_GC)) {
+        if (m_isLogging) {
             std::cout << static_cast<void *>(cloned) << ": allocated object of size " << cloned->size() << " and type "
                       <<
                       static_cast<int>(static_cast<Object *>(cloned)->m_type) << ".\n";
@@ -28,40 +53,210 @@ namespace enact {
     }
 
     void GC::collectGarbage() {
-        if (m_context.options.flagEnabled(Flag::DEBUG_LOG_GC)) {
-            std::cout << "-- GC BEGIN\n";
+        beginPause();
+        if (m_isMarking) {
+            finishMarking();
+        } else {
+            collect(false);
+        }
+        endPause();
+    }
+
+    void GC::collectNursery() {
+        beginPause();
+        collect(true);
+
+        // Promotions are what fill up the old generation, so this is when it can need collecting.
+        if (m_isMarking) {
+            markSlice();
+        } else {
+            // Until it has been swept, the old generation still counts the objects that died in
+            // the last collection, so it may not really have outgrown m_nextRun.
+            if (m_isSweeping && m_bytesAllocated > m_nextRun) finishSweeping();
+
+            if (m_bytesAllocated > m_nextRun) {
+                if (m_pauseBudget.count() > 0) {
+                    startMarking();
+                } else {
+                    collect(false);
+                }
+            }
         }
+        endPause();
+    }
+
+    void GC::pushRoot(Object *object) {
+        m_extraRoots.push_back(object);
+    }
+
+    void GC::popRoots(size_t count) {
+        m_extraRoots.resize(m_extraRoots.size() - count);
+    }
+
+    void GC::resized(Object *object) {
+        size_t size = object->size();
+        size_t &bytes = object->m_isOld ? m_bytesAllocated : m_nurseryBytes;
+        bytes = bytes - object->m_accountedSize + size;
+        object->m_accountedSize = size;
+    }
+
+    HeapStats GC::getStats() {
+        if (m_isSweeping) finishSweeping();
 
-        size_t before = m_bytesAllocated;
+        HeapStats stats = m_stats;
+        stats.oldBytes = m_bytesAllocated;
+        stats.nurseryBytes = m_nurseryBytes;
+
+        for (const std::unique_ptr<HeapBlock> &block : m_blocks) {
+            for (size_t i = 0; i < block->count; ++i) {
+                Object *object = block->objects[i];
+                stats.bytesByType[static_cast<size_t>(object->m_type)] += object->m_accountedSize;
+            }
+        }
+
+        for (Object *object : m_nursery) {
+            stats.bytesByType[static_cast<size_t>(object->m_type)] += object->m_accountedSize;
+        }
+
+        return stats;
+    }
+
+    void GC::beginPause() {
+        if (m_pauseDepth++ == 0) {
+            m_pauseStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    void GC::endPause() {
+        if (--m_pauseDepth > 0) return;
+
+        auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_pauseStart);
+        m_stats.totalPause += pause;
+        m_stats.longestPause = std::max(m_stats.longestPause, pause);
+    }
+
+    void GC::collect(bool isMinor) {
+        if (m_isLogging) {
+            std::cout << (isMinor ? "-- MINOR GC BEGIN\n" : "-- GC BEGIN\n");
+        }
+
+        if (!isMinor && m_isSweeping) finishSweeping();
+
+        size_t before = m_bytesAllocated + m_nurseryBytes;
+        m_isMinor = isMinor;
+        ++(isMinor ? m_stats.minorCollections : m_stats.collections);
+
+        // The grey objects of an incremental collection are put aside, so that a minor one only
+        // traces the nursery.
+        std::vector<Object *> incrementalGreyStack{};
+        if (isMinor) std::swap(incrementalGreyStack, m_greyStack);
 
         markRoots();
+        if (isMinor) markRememberedSet();
         traceReferences();
-        sweep();
 
-        m_nextRun = m_bytesAllocated * GC_HEAP_GROW_FACTOR;
+        if (isMinor) std::swap(incrementalGreyStack, m_greyStack);
+
+        // Whatever survives is about to be promoted, so nothing old will point into the nursery.
+        // This has to happen before sweeping, which could free remembered objects.
+        for (Object *object : m_rememberedSet) {
+            object->m_isRemembered = false;
+        }
+        m_rememberedSet.clear();
+
+        if (!isMinor) sweep();
+        sweepNursery();
+        m_isMinor = false;
+
+        // The old generation hasn't been swept yet, so this is only an estimate, until
+        // finishSweeping() works it out again.
+        if (!isMinor) {
+            m_nextRun = m_isStressing ? 0 : m_bytesAllocated * GC_HEAP_GROW_FACTOR;
+        }
+
+        if (m_isLogging) {
+            std::cout << (isMinor ? "-- MINOR GC END" : "-- GC END") << ": collected " << before - m_bytesAllocated <<
+                      " bytes (from " << before << " to " << m_bytesAllocated << "), next GC at " << m_nextRun << ".\n";
+        }
+    }
+
+    void GC::startMarking() {
+        if (m_isLogging) {
+            std::cout << "-- GC MARKING BEGIN\n";
+        }
+
+        // This always follows a minor collection, so the roots are all old. It also follows
+        // finishSweeping(), so the old objects are all unmarked.
+        m_isMarking = true;
+        markRoots();
+
+        m_nextSlice = m_nurseryBytes + GC_SLICE_INTERVAL;
+    }
+
+    void GC::markSlice() {
+        beginPause();
+        auto deadline = std::chrono::steady_clock::now() + m_pauseBudget;
+
+        size_t blackened = 0;
+        while (!m_greyStack.empty()) {
+            Object *object = m_greyStack.back();
+            m_greyStack.pop_back();
+            blackenObject(object);
+
+            if (++blackened % GC_SLICE_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+        }
+
+        if (m_isLogging) {
+            std::cout << "-- GC MARKING SLICE: blackened " << blackened << " objects, " << m_greyStack.size() <<
+                      " left grey.\n";
+        }
 
-        if (m_context.options.flagEnabled(Flag::DEBUG_LOG_GC)) {
-            std::cout << "-- GC END: collected " << before - m_bytesAllocated << " bytes (from " << before << " to " <<
-                      m_bytesAllocated << "), next GC at " << m_nextRun << ".\n";
+        m_nextSlice = m_nurseryBytes + GC_SLICE_INTERVAL;
+        if (m_greyStack.empty()) {
+            finishMarking();
         }
+        endPause();
+    }
+
+    void GC::finishMarking() {
+        // Old objects stay marked from the slices. The full collection then picks up whatever
+        // reached them through the nursery or the stack, which have no barriers.
+        m_isMarking = false;
+        markRememberedSet();
+        collect(false);
     }
 
     void GC::markRoots() {
         markCompilerRoots();
         markVMRoots();
+
+        for (Object *object : m_extraRoots) {
+            markObject(object);
+        }
     }
 
     void GC::markCompilerRoots() {
         Compiler *compiler = &m_context.currentCompiler();
         while (compiler != nullptr) {
-            if (compiler->m_currentFunction) markObject(compiler->m_currentFunction);
+            FunctionObject *function = compiler->m_currentFunction;
+
+            // The compiler adds constants to its functions without a write barrier, so they are
+            // traced by every collection, even once they are old or have already been marked.
+            if (function) {
+                if (!m_isMinor || !function->m_isOld) function->tryMark();
+                m_greyStack.push_back(function);
+            }
+
             compiler = compiler->m_enclosing;
         }
     }
 
     void GC::markVMRoots() {
-        for (Value &value : m_context.vm.m_stack) {
-            markValue(value);
+        for (Value *slot = m_context.vm.m_stack.data(); slot != m_context.vm.m_stackTop; ++slot) {
+            markValue(*slot, m_greyStack);
         }
 
         for (size_t i = 0; i < m_context.vm.m_frameCount; ++i) {
@@ -73,31 +268,51 @@ namespace enact {
         }
     }
 
+    void GC::markRememberedSet() {
+        for (Object *object : m_rememberedSet) {
+            blackenObject(object);
+        }
+    }
+
     void GC::markObject(Object *object) {
-        if (!object || object->isMarked()) return;
-        object->mark();
+        markObject(object, m_greyStack);
+    }
+
+    void GC::markObject(Object *object, std::vector<Object *> &greyStack) {
+        if (!object) return;
 
-        m_greyStack.push_back(object);
+        // Minor collections take old objects to be alive, and incremental marking leaves young
+        // objects to the minor collections and the final pause.
+        if (m_isMinor ? object->m_isOld : m_isMarking && !object->m_isOld) return;
+        if (!object->tryMark()) return;
 
-        if (m_context.options.flagEnabled(Flag::DEBUG_LOG_GC)) {
+        greyStack.push_back(object);
+
+        if (m_isLogging) {
             std::cout << static_cast<void *>(object) << ": marked object [ " << *object << " ].\n";
         }
     }
 
-    void GC::markValue(Value value) {
+    void GC::markValue(Value value, std::vector<Object *> &greyStack) {
         if (value.isObject()) {
-            markObject(value.asObject());
+            markObject(value.asObject(), greyStack);
         }
     }
 
-    void GC::markValues(const std::vector<Value> &values) {
+    void GC::markValues(const std::vector<Value> &values, std::vector<Object *> &greyStack) {
         for (const Value &value : values) {
-            markValue(value);
+            markValue(value, greyStack);
         }
     }
 
     void GC::traceReferences() {
-        while (!m_greyStack.empty()) {
+        for (size_t blackened = 0; !m_greyStack.empty(); ++blackened) {
+            if (blackened == GC_PARALLEL_MARK_THRESHOLD && m_markThreads > 1) {
+                if (!m_marker) m_marker = std::make_unique<ParallelMarker>(*this, m_markThreads);
+                m_marker->trace(m_greyStack);
+                break;
+            }
+
             Object *object = m_greyStack.back();
             m_greyStack.pop_back();
             blackenObject(object);
@@ -105,23 +320,31 @@ namespace enact {
     }
 
     void GC::blackenObject(Object *object) {
-        if (m_context.options.flagEnabled(Flag::DEBUG_LOG_GC)) {
+        blackenObject(object, m_greyStack);
+    }
+
+    void GC::blackenObject(Object *object, std::vector<Object *> &greyStack) {
+        if (m_isLogging) {
             std::cout << static_cast<void *>(object) << ": blackened object [ " << *object << " ].\n";
         }
 
         switch (object->m_type) {
+            case ObjectType::ARRAY:
+                markValues(object->as<ArrayObject>()->asVector(), greyStack);
+                break;
+
             case ObjectType::BOUND_METHOD: {
                 auto *boundMethod = object->as<BoundMethodObject>();
-                markValue(boundMethod->receiver());
-                markObject(boundMethod->method());
+                markValue(boundMethod->receiver(), greyStack);
+                markObject(boundMethod->method(), greyStack);
                 break;
             }
 
             case ObjectType::INSTANCE: {
                 auto *instance = object->as<InstanceObject>();
-                markObject(instance->getStruct());
+                markObject(instance->getStruct(), greyStack);
                 for (Value field : instance->fields()) {
-                    markValue(field);
+                    markValue(field, greyStack);
                 }
                 break;
             }
@@ -129,31 +352,45 @@ namespace enact {
             case ObjectType::STRUCT: {
                 auto *struct_ = object->as<StructObject>();
                 for (ClosureObject *method : struct_->methods()) {
-                    markObject(method);
+                    markObject(method, greyStack);
                 }
                 for (Value assoc : struct_->assocs()) {
-                    markValue(assoc);
+                    markValue(assoc, greyStack);
                 }
                 break;
             }
 
             case ObjectType::CLOSURE: {
                 auto *closure = object->as<ClosureObject>();
-                markObject(closure->getFunction());
+                markObject(closure->getFunction(), greyStack);
                 for (UpvalueObject *upvalue : closure->getUpvalues()) {
-                    markObject(upvalue);
+                    markObject(upvalue, greyStack);
                 }
                 break;
             }
 
             case ObjectType::FUNCTION: {
                 auto function = object->as<FunctionObject>();
-                markValues(function->getChunk().getConstants());
+                markValues(function->getChunk().getConstants(), greyStack);
+
+                // A function can only refer to functions read before it, which are at least as
+                // old, so a minor collection can't free any of them while it is still pending.
+                for (FunctionObject *pending : function->getChunk().getPendingFunctions()) {
+                    markObject(pending, greyStack);
+                }
+
+                // Cached structs are kept alive so that a new struct can never be allocated
+                // at the same address and be mistaken for a cached one.
+                for (const PropertyCache &cache : function->getChunk().getPropertyCaches()) {
+                    for (const PropertyCacheEntry &entry : cache) {
+                        markObject(entry.struct_, greyStack);
+                    }
+                }
                 break;
             }
 
             case ObjectType::UPVALUE:
-                markValue(object->as<UpvalueObject>()->getClosed());
+                markValue(object->as<UpvalueObject>()->getClosed(), greyStack);
                 break;
 
             default:
@@ -162,31 +399,119 @@ namespace enact {
     }
 
     void GC::sweep() {
-        for (auto it = m_objects.begin(); it != m_objects.end();) {
-            Object *object = *it;
+        m_sweeper.start(m_blocks);
+        m_isSweeping = true;
+        m_nextSweep = m_nurseryBytes + GC_SWEEP_INTERVAL;
+    }
+
+    void GC::sweepSlice() {
+        beginPause();
+        m_nextSweep = m_nurseryBytes + GC_SWEEP_INTERVAL;
+        if (!m_sweeper.sweep(1)) {
+            finishSweeping();
+        }
+        endPause();
+    }
+
+    void GC::finishSweeping() {
+        size_t freedBytes = m_sweeper.finish(m_blocks);
+        m_bytesAllocated -= freedBytes;
+        m_isSweeping = false;
+
+        m_nextRun = m_isStressing ? 0 : m_bytesAllocated * GC_HEAP_GROW_FACTOR;
+
+        if (m_isLogging) {
+            std::cout << "-- GC SWEEP END: freed " << freedBytes << " bytes, " << m_blocks.size() <<
+                      " blocks left, next GC at " << m_nextRun << ".\n";
+        }
+    }
+
+    void GC::promote(Object *object) {
+        // Counted afresh, in case the object grew in the nursery without being reported, as the
+        // compiler's functions do.
+        object->m_isOld = true;
+        object->m_accountedSize = object->size();
+        m_bytesAllocated += object->m_accountedSize;
+
+        if (m_blocks.empty() || m_blocks.back()->count == GC_BLOCK_CAPACITY) {
+            m_blocks.push_back(std::make_unique<HeapBlock>());
+        }
+
+        HeapBlock &block = *m_blocks.back();
+        block.objects[block.count++] = object;
+    }
+
+    void GC::sweepNursery() {
+        for (Object *object : m_nursery) {
             if (object->isMarked()) {
-                object->unmark();
-                it++;
+                promote(object);
+
+                // Objects promoted in the middle of incremental marking are shaded grey, since
+                // nothing has traced the old objects that they point to yet.
+                if (m_isMarking) {
+                    m_greyStack.push_back(object);
+                } else {
+                    object->unmark();
+                }
             } else {
                 freeObject(object);
-                it = m_objects.erase(it);
             }
         }
+
+        m_nursery.clear();
+        m_nurseryBytes = 0;
+    }
+
+    void GC::remember(Object *object) {
+        object->m_isRemembered = true;
+        m_rememberedSet.push_back(object);
+    }
+
+    Object *GC::copyObject(const Object *object) {
+        switch (object->m_type) {
+            case ObjectType::STRING: return construct<StringObject>(*object->as<StringObject>());
+            case ObjectType::ARRAY: return construct<ArrayObject>(*object->as<ArrayObject>());
+            case ObjectType::UPVALUE: return construct<UpvalueObject>(*object->as<UpvalueObject>());
+            case ObjectType::CLOSURE: return construct<ClosureObject>(*object->as<ClosureObject>());
+            case ObjectType::STRUCT: return construct<StructObject>(*object->as<StructObject>());
+            case ObjectType::INSTANCE: return construct<InstanceObject>(*object->as<InstanceObject>());
+            case ObjectType::BOUND_METHOD: return construct<BoundMethodObject>(*object->as<BoundMethodObject>());
+            case ObjectType::FUNCTION: return construct<FunctionObject>(*object->as<FunctionObject>());
+            case ObjectType::NATIVE: return construct<NativeObject>(*object->as<NativeObject>());
+            case ObjectType::TYPE: return construct<TypeObject>(*object->as<TypeObject>());
+        }
     }
 
-    void GC::freeObject(Object *object) {
-        if (m_context.options.flagEnabled(Flag::DEBUG_LOG_GC)) {
+    size_t GC::freeObject(Object *object) {
+        if (m_isLogging) {
             std::cout << static_cast<void *>(object) << ": freed object of type " <<
                       static_cast<int>(object->m_type) << ".\n";
         }
 
-        delete object;
+        uint8_t sizeClass = object->m_sizeClass;
+        size_t size = object->m_accountedSize;
+
+        object->~Object();
+        m_allocator.free(object, sizeClass);
+
+        return size;
     }
 
     void GC::freeObjects() {
-        while (m_objects.begin() != m_objects.end()) {
-            freeObject(*m_objects.begin());
-            m_objects.erase(m_objects.begin());
+        for (Object *object : m_nursery) {
+            freeObject(object);
+        }
+        m_nursery.clear();
+
+        // Whatever is still unswept is freed along with everything else.
+        if (m_isSweeping) finishSweeping();
+
+        for (std::unique_ptr<HeapBlock> &block : m_blocks) {
+            for (size_t i = 0; i < block->count; ++i) {
+                freeObject(block->objects[i]);
+            }
         }
+        m_blocks.clear();
+        m_bytesAllocated = 0;
     }
 }
\ No newline at end of file
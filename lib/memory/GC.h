@@ -1,42 +1,197 @@
 #ifndef ENACT_GC_H
 #define ENACT_GC_H
 
+#include <array>
+#include <chrono>
+#include <memory>
 #include <vector>
 
 #include "../value/Object.h"
+#include "ObjectAllocator.h"
+#include "Sweeper.h"
 
 namespace enact {
     class CompileContext;
 
+    class ParallelMarker;
+
     constexpr size_t GC_HEAP_GROW_FACTOR = 2;
 
+    // How many bytes can be allocated in the nursery before it is collected.
+    constexpr size_t GC_NURSERY_SIZE = 256 * 1024;
+
+    // How many bytes are allocated between slices of incremental marking.
+    constexpr size_t GC_SLICE_INTERVAL = 32 * 1024;
+
+    // How many objects a slice blackens between looking at the clock.
+    constexpr size_t GC_SLICE_CHECK_INTERVAL = 64;
+
+    // How many bytes are allocated in the nursery between blocks of the old generation being swept.
+    constexpr size_t GC_SWEEP_INTERVAL = 4 * 1024;
+
+    // How many objects a collection blackens on its own before it starts up the marking threads.
+    // Most minor collections are over well before then.
+    constexpr size_t GC_PARALLEL_MARK_THRESHOLD = 4096;
+
+    constexpr size_t OBJECT_TYPE_COUNT = static_cast<size_t>(ObjectType::TYPE) + 1;
+
+    // What GC::getStats() reports about the heap.
+    struct HeapStats {
+        // Bytes held by the objects of each ObjectType, including garbage in the nursery that
+        // hasn't been collected yet.
+        std::array<size_t, OBJECT_TYPE_COUNT> bytesByType{};
+
+        size_t oldBytes = 0;
+        size_t nurseryBytes = 0;
+
+        size_t collections = 0;
+        size_t minorCollections = 0;
+
+        // Covers every pause, including incremental slices and lazy sweeping.
+        std::chrono::nanoseconds totalPause{0};
+        std::chrono::nanoseconds longestPause{0};
+    };
+
+    // A generational collector. New objects go into the nursery, which is collected on its own
+    // whenever it fills up, and whatever survives is promoted into the old generation. Only when
+    // the old generation outgrows m_nextRun is the whole heap collected.
+    //
+    // Objects are never moved, because the VM and the JIT hold onto raw Object pointers. A
+    // promotion just moves the pointer from m_nursery into one of the HeapBlocks in m_blocks.
+    //
+    // With --gc-pause-budget, the old generation is marked incrementally, in slices that run
+    // as the program allocates. Marking only looks at old objects, and the write barrier shades
+    // any old object stored into another while it is in progress, so a blackened object can
+    // never point to a white one. Stores into the nursery and the stack aren't barriered, so
+    // the final pause traces from the roots, the remembered set and the nursery once more.
+    //
+    // Collections that find a lot to trace finish it on a ParallelMarker, with --gc-threads
+    // threads. Incremental slices are short enough that they always mark on one thread.
+    //
+    // After a full collection, the old generation's blocks are handed to the Sweeper, and swept
+    // a block at a time as the program allocates, or on a thread of its own with
+    // --gc-sweep-thread. Sweeping has to finish before marking can start again, since the
+    // unswept blocks still hold the mark bits of the last collection.
     class GC {
+        friend class ParallelMarker;
+
         CompileContext &m_context;
 
+        // Bytes held by the old generation, and by the nursery, as counted by Object::size().
         size_t m_bytesAllocated = 0;
+        size_t m_nurseryBytes = 0;
         size_t m_nextRun = 1024 * 1024;
 
-        std::vector<Object *> m_objects{};
+        // Resolved from the debug flags in Options once, when the GC is created, so that
+        // allocation doesn't have to look them up every time.
+        bool m_isStressing = false;
+        bool m_isLogging = false;
+        std::chrono::microseconds m_pauseBudget{0};
+        size_t m_markThreads = 1;
+
+        // Declared before m_sweeper, so that it outlives the sweeping thread.
+        ObjectAllocator m_allocator{};
+
+        // Started the first time that a collection has enough to trace.
+        std::unique_ptr<ParallelMarker> m_marker{};
+
+        // The old generation, apart from the blocks that the Sweeper has yet to give back.
+        std::vector<std::unique_ptr<HeapBlock>> m_blocks{};
+        std::vector<Object *> m_nursery{};
         std::vector<Object *> m_greyStack{};
 
+        // Objects kept alive by pushRoot() that nothing else can reach yet.
+        std::vector<Object *> m_extraRoots{};
+
+        // Old objects that might point into the nursery, recorded by the write barrier. A minor
+        // collection treats them as roots, instead of tracing the whole old generation.
+        std::vector<Object *> m_rememberedSet{};
+
+        // Whether the collection in progress is only of the nursery, in which case old objects
+        // are taken to be alive and never marked.
+        bool m_isMinor = false;
+
+        // Whether an incremental collection of the old generation is in progress, and how large
+        // the nursery will be when its next slice runs.
+        bool m_isMarking = false;
+        size_t m_nextSlice = 0;
+
+        // Whether the Sweeper has any of the old generation's blocks, and how large the nursery
+        // will be when the next one is swept.
+        bool m_isSweeping = false;
+        size_t m_nextSweep = 0;
+
+        Sweeper m_sweeper;
+
+        // The byte counts are filled in by getStats().
+        HeapStats m_stats{};
+        size_t m_pauseDepth = 0;
+        std::chrono::steady_clock::time_point m_pauseStart{};
+
+        void collect(bool isMinor);
+
+        void startMarking();
+
+        // Blackens grey objects until the pause budget runs out, and finishes the collection if
+        // there are none left.
+        void markSlice();
+
+        void finishMarking();
+
         void markRoots();
 
         void markCompilerRoots();
 
         void markVMRoots();
 
+        void markRememberedSet();
+
         void markObject(Object *object);
 
-        void markValue(Value value);
+        // Marking threads pass a grey stack of their own to each of these.
+        void markObject(Object *object, std::vector<Object *> &greyStack);
+
+        void markValue(Value value, std::vector<Object *> &greyStack);
 
-        void markValues(const std::vector<Value> &values);
+        void markValues(const std::vector<Value> &values, std::vector<Object *> &greyStack);
 
         void traceReferences();
 
         void blackenObject(Object *object);
 
+        void blackenObject(Object *object, std::vector<Object *> &greyStack);
+
+        // Hands the old generation to the Sweeper.
         void sweep();
 
+        // Sweeps a block of the old generation, and finishes sweeping if there are none left.
+        void sweepSlice();
+
+        void finishSweeping();
+
+        // Moves a survivor of the nursery into the old generation.
+        void promote(Object *object);
+
+        // Frees the dead objects in the nursery, and promotes the rest.
+        void sweepNursery();
+
+        void remember(Object *object);
+
+        // Constructs an object in memory from m_allocator, without checking whether to collect.
+        template<typename T, typename... Args>
+        T *construct(Args &&... args);
+
+        Object *copyObject(const Object *object);
+
+        // Counts a new object towards the nursery.
+        inline void account(Object *object);
+
+        // Pauses can nest, as when a minor collection runs a slice of marking, so only the
+        // outermost one is timed.
+        void beginPause();
+
+        void endPause();
+
     public:
         explicit GC(CompileContext &context);
 
@@ -47,12 +202,92 @@ namespace enact {
 
         Object *cloneObject(Object *object);
 
+        // Collects the whole heap.
         void collectGarbage();
 
-        void freeObject(Object *object);
+        // Collects only the nursery.
+        void collectNursery();
+
+        // Keeps an object alive until it is popped, for code that allocates objects before
+        // anything else can reach them. Roots are popped in the reverse order.
+        void pushRoot(Object *object);
+
+        void popRoots(size_t count);
+
+        // Must be called after an object's size() changes, once it could have been promoted.
+        void resized(Object *object);
+
+        // Finishes any sweeping first, so that the byte counts are exact.
+        HeapStats getStats();
+
+        // Must be called after storing value into object, once object could have been promoted.
+        inline void writeBarrier(Object *object, Value value);
+        inline void writeBarrier(Object *object, Object *value);
+
+        // Returns the number of bytes that the object was counted as.
+        size_t freeObject(Object *object);
 
         void freeObjects();
     };
+
+    template<typename T, typename... Args>
+    T *GC::allocateObject(Args &&... args) {
+        static_assert(std::is_base_of_v<Object, T>,
+                      "GC::allocateObject<T>: T must derive from Object.");
+
+        // When stressing, m_nextRun is pinned at 0, so the whole heap is collected as well.
+        if (m_nurseryBytes + sizeof(T) > GC_NURSERY_SIZE || m_isStressing) {
+            collectNursery();
+        } else if (m_isMarking && m_nurseryBytes >= m_nextSlice) {
+            markSlice();
+        } else if (m_isSweeping && m_nurseryBytes >= m_nextSweep) {
+            sweepSlice();
+        }
+
+        T *object = construct<T>(std::forward<Args>(args)...);
+        account(object);
+        m_nursery.push_back(object);
+
+        if (m_isLogging) {
+            std::cout << static_cast<void *>(object) << ": allocated object of size " << object->size() <<
+                      " and type " << static_cast<int>(static_cast<Object *>(object)->m_type) << ".\n";
+        }
+
+        return object;
+    }
+
+    template<typename T, typename... Args>
+    T *GC::construct(Args &&... args) {
+        static_assert(alignof(T) <= GC_SIZE_CLASS_GRANULARITY,
+                      "GC::construct<T>: T must fit the alignment of the GC's size classes.");
+
+        constexpr uint8_t sizeClass = ObjectAllocator::sizeClassOf(sizeof(T));
+        T *object = new(m_allocator.allocate(sizeClass, sizeof(T))) T(std::forward<Args>(args)...);
+        object->m_sizeClass = sizeClass;
+
+        return object;
+    }
+
+    inline void GC::account(Object *object) {
+        object->m_accountedSize = object->size();
+        m_nurseryBytes += object->m_accountedSize;
+    }
+
+    inline void GC::writeBarrier(Object *object, Value value) {
+        if (value.isObject()) {
+            writeBarrier(object, value.asObject());
+        }
+    }
+
+    inline void GC::writeBarrier(Object *object, Object *value) {
+        if (!value || !object->m_isOld) return;
+
+        if (!value->m_isOld) {
+            if (!object->m_isRemembered) remember(object);
+        } else if (m_isMarking) {
+            markObject(value);
+        }
+    }
 }
 
 #endif //ENACT_GC_H
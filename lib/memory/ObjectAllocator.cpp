@@ -0,0 +1,39 @@
+#include "ObjectAllocator.h"
+
+namespace enact {
+    ObjectAllocator::~ObjectAllocator() {
+        for (void *slab : m_slabs) {
+            ::operator delete(slab);
+        }
+    }
+
+    void *ObjectAllocator::allocateSlow(SizeClass &sizeClass, size_t cellSize) {
+        // Cells freed by the Sweeper's thread are only picked up once the rest have run out.
+        if (FreeCell *cell = sizeClass.returnedCells.exchange(nullptr, std::memory_order_acquire)) {
+            sizeClass.freeCells = cell->next;
+            return cell;
+        }
+
+        // Whatever is left at the end of the old slab is too small for a cell, and is wasted.
+        char *slab = static_cast<char *>(::operator new(GC_SLAB_SIZE));
+        m_slabs.push_back(slab);
+
+        sizeClass.bump = slab + cellSize;
+        sizeClass.end = slab + GC_SLAB_SIZE;
+        return slab;
+    }
+
+    void ObjectAllocator::free(void *memory, uint8_t sizeClass) {
+        if (sizeClass == GC_LARGE_SIZE_CLASS) {
+            ::operator delete(memory);
+            return;
+        }
+
+        auto *cell = static_cast<FreeCell *>(memory);
+        std::atomic<FreeCell *> &returnedCells = m_sizeClasses[sizeClass].returnedCells;
+
+        cell->next = returnedCells.load(std::memory_order_relaxed);
+        while (!returnedCells.compare_exchange_weak(cell->next, cell, std::memory_order_release,
+                                                    std::memory_order_relaxed)) {}
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef ENACT_OBJECTALLOCATOR_H
+#define ENACT_OBJECTALLOCATOR_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace enact {
+    // Object sizes are rounded up to a multiple of this, which is also the alignment of every cell.
+    constexpr size_t GC_SIZE_CLASS_GRANULARITY = 16;
+
+    // How many size classes there are, and so the largest object that is allocated from a slab.
+    constexpr size_t GC_SIZE_CLASS_COUNT = 16;
+    constexpr size_t GC_MAX_SMALL_OBJECT_SIZE = GC_SIZE_CLASS_GRANULARITY * GC_SIZE_CLASS_COUNT;
+
+    // The size class of objects that are too large for a slab, and are allocated with operator new.
+    constexpr uint8_t GC_LARGE_SIZE_CLASS = GC_SIZE_CLASS_COUNT;
+
+    // How many bytes each slab holds.
+    constexpr size_t GC_SLAB_SIZE = 64 * 1024;
+
+    // Allocates the memory for the GC's objects. Each size class carves cells out of its current
+    // slab with a bump pointer, and reuses freed cells before it takes a new one. Slabs are only
+    // given back when the allocator is destroyed.
+    //
+    // Only the thread running the program allocates, but the Sweeper's thread can free at the
+    // same time, so freed cells are pushed onto an atomic list that allocation takes from as a
+    // whole once its own list runs dry.
+    class ObjectAllocator {
+        struct FreeCell {
+            FreeCell *next;
+        };
+
+        struct SizeClass {
+            char *bump = nullptr;
+            char *end = nullptr;
+
+            FreeCell *freeCells = nullptr;
+            std::atomic<FreeCell *> returnedCells{nullptr};
+        };
+
+        std::array<SizeClass, GC_SIZE_CLASS_COUNT> m_sizeClasses{};
+        std::vector<void *> m_slabs{};
+
+        void *allocateSlow(SizeClass &sizeClass, size_t cellSize);
+
+    public:
+        ObjectAllocator() = default;
+
+        ObjectAllocator(const ObjectAllocator &allocator) = delete;
+
+        ~ObjectAllocator();
+
+        static constexpr uint8_t sizeClassOf(size_t size);
+
+        inline void *allocate(uint8_t sizeClass, size_t size);
+
+        void free(void *memory, uint8_t sizeClass);
+    };
+
+    constexpr uint8_t ObjectAllocator::sizeClassOf(size_t size) {
+        if (size > GC_MAX_SMALL_OBJECT_SIZE) return GC_LARGE_SIZE_CLASS;
+        return static_cast<uint8_t>((size + GC_SIZE_CLASS_GRANULARITY - 1) / GC_SIZE_CLASS_GRANULARITY - 1);
+    }
+
+    inline void *ObjectAllocator::allocate(uint8_t sizeClass, size_t size) {
+        if (sizeClass == GC_LARGE_SIZE_CLASS) {
+            return ::operator new(size);
+        }
+
+        SizeClass &cells = m_sizeClasses[sizeClass];
+        if (FreeCell *cell = cells.freeCells) {
+            cells.freeCells = cell->next;
+            return cell;
+        }
+
+        size_t cellSize = (sizeClass + 1) * GC_SIZE_CLASS_GRANULARITY;
+        if (cells.bump + cellSize <= cells.end) {
+            void *cell = cells.bump;
+            cells.bump += cellSize;
+            return cell;
+        }
+
+        return allocateSlow(cells, cellSize);
+    }
+}
+
+#endif //ENACT_OBJECTALLOCATOR_H
@@ -0,0 +1,133 @@
+#include "GC.h"
+#include "ParallelMarker.h"
+
+namespace enact {
+    ParallelMarker::ParallelMarker(GC &gc, size_t threadCount) : m_gc{gc}, m_queues(threadCount) {
+        for (size_t i = 1; i < threadCount; ++i) {
+            m_threads.emplace_back(&ParallelMarker::runThread, this, i);
+        }
+    }
+
+    ParallelMarker::~ParallelMarker() {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_isStopping = true;
+        }
+        m_wakeThreads.notify_all();
+
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void ParallelMarker::trace(std::vector<Object *> &greyStack) {
+        m_idle = 0;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            ++m_epoch;
+            m_running = m_threads.size();
+        }
+        m_wakeThreads.notify_all();
+
+        mark(0, greyStack);
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_threadsDone.wait(lock, [&] { return m_running == 0; });
+    }
+
+    void ParallelMarker::runThread(size_t index) {
+        std::vector<Object *> greyStack{};
+        size_t epoch = 0;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_wakeThreads.wait(lock, [&] { return m_isStopping || m_epoch != epoch; });
+
+                if (m_isStopping) return;
+                epoch = m_epoch;
+            }
+
+            mark(index, greyStack);
+
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                --m_running;
+            }
+            m_threadsDone.notify_one();
+        }
+    }
+
+    void ParallelMarker::mark(size_t index, std::vector<Object *> &greyStack) {
+        const size_t threadCount = m_queues.size();
+
+        while (true) {
+            while (!greyStack.empty()) {
+                Object *object = greyStack.back();
+                greyStack.pop_back();
+                m_gc.blackenObject(object, greyStack);
+
+                if (greyStack.size() > GC_MARK_SHARE_THRESHOLD && m_queues[index].size == 0) {
+                    share(index, greyStack);
+                }
+            }
+
+            if (steal(index, greyStack)) continue;
+
+            // Only a thread with work can queue any more, so once every thread is idle and
+            // the queues are empty, the trace is over.
+            m_idle.fetch_add(1);
+            while (true) {
+                if (hasQueued()) {
+                    m_idle.fetch_sub(1);
+                    break;
+                }
+
+                if (m_idle.load() == threadCount) return;
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void ParallelMarker::share(size_t index, std::vector<Object *> &greyStack) {
+        // The bottom of the stack is closest to the roots, so it is likely to lead to the most work.
+        auto half = greyStack.begin() + greyStack.size() / 2;
+
+        WorkQueue &queue = m_queues[index];
+        {
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            queue.objects.insert(queue.objects.end(), greyStack.begin(), half);
+            queue.size = queue.objects.size();
+        }
+
+        greyStack.erase(greyStack.begin(), half);
+    }
+
+    bool ParallelMarker::steal(size_t index, std::vector<Object *> &greyStack) {
+        // Starting with the thread's own queue.
+        for (size_t i = 0; i < m_queues.size(); ++i) {
+            WorkQueue &queue = m_queues[(index + i) % m_queues.size()];
+            if (queue.size == 0) continue;
+
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            if (queue.objects.empty()) continue;
+
+            auto end = queue.objects.begin() + (queue.objects.size() + 1) / 2;
+            greyStack.insert(greyStack.end(), queue.objects.begin(), end);
+            queue.objects.erase(queue.objects.begin(), end);
+            queue.size = queue.objects.size();
+
+            return true;
+        }
+
+        return false;
+    }
+
+    bool ParallelMarker::hasQueued() const {
+        for (const WorkQueue &queue : m_queues) {
+            if (queue.size > 0) return true;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ENACT_PARALLELMARKER_H
+#define ENACT_PARALLELMARKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace enact {
+    class GC;
+
+    class Object;
+
+    // How many grey objects a marking thread keeps to itself before it shares half of them.
+    constexpr size_t GC_MARK_SHARE_THRESHOLD = 64;
+
+    // Traces the heap on a pool of threads, one of which is the thread that asked for it. Each
+    // thread blackens objects from a stack of its own, and moves half of it into a queue that
+    // the others can steal from whenever it grows large enough. Objects are claimed with
+    // Object::tryMark(), so each one is only blackened once, by whichever thread got there first.
+    class ParallelMarker {
+        // The part of a thread's grey objects that other threads can steal.
+        struct WorkQueue {
+            std::mutex mutex{};
+            std::deque<Object *> objects{};
+            std::atomic<size_t> size{0};
+        };
+
+        GC &m_gc;
+
+        std::vector<std::thread> m_threads{};
+        std::vector<WorkQueue> m_queues;
+
+        // The threads wait for m_epoch to change, which is how each trace starts.
+        std::mutex m_mutex{};
+        std::condition_variable m_wakeThreads{};
+        std::condition_variable m_threadsDone{};
+        size_t m_epoch = 0;
+        size_t m_running = 0;
+        bool m_isStopping = false;
+
+        std::atomic<size_t> m_idle{0};
+
+        void runThread(size_t index);
+
+        // Blackens objects until there are none left anywhere.
+        void mark(size_t index, std::vector<Object *> &greyStack);
+
+        void share(size_t index, std::vector<Object *> &greyStack);
+
+        bool steal(size_t index, std::vector<Object *> &greyStack);
+
+        bool hasQueued() const;
+
+    public:
+        // threadCount includes the thread that calls trace().
+        ParallelMarker(GC &gc, size_t threadCount);
+
+        ~ParallelMarker();
+
+        // Blackens everything reachable from the objects in greyStack, which are already marked,
+        // and leaves it empty.
+        void trace(std::vector<Object *> &greyStack);
+    };
+}
+
+#endif //ENACT_PARALLELMARKER_H
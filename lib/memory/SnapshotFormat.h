@@ -0,0 +1,38 @@
+#ifndef ENACT_SNAPSHOTFORMAT_H
+#define ENACT_SNAPSHOTFORMAT_H
+
+#include <cstdint>
+
+// The layout of a heap snapshot, which SnapshotWriter writes and SnapshotReader reads. Integers,
+// strings, types and chunks are written the same way as in a bytecode cache (see BytecodeFormat.h).
+//
+//   header    magic, SNAPSHOT_VERSION (uint32_t), BYTECODE_VERSION (uint32_t), hash of the source (uint64_t)
+//   types     count (uint32_t), then each type, after any type that it refers to
+//   objects   count (uint32_t), then each object's ObjectType (uint8_t) and what it is constructed from
+//   contents  what is stored into each array, upvalue, closure, struct and instance after it is constructed
+//   vm        the resume point (uint32_t), the stack slots in use, and the first open upvalue
+//
+// Objects refer to each other by their index in the object table. Whatever an object is
+// constructed from (a closure's function, an instance's struct, a bound method's receiver and
+// method, and a function's constants) comes before it in the table. Everything else is in the
+// contents, which can refer to any object, so cycles between objects are kept.
+namespace enact {
+    constexpr char SNAPSHOT_MAGIC[4] = {'E', 'N', 'H', 'S'};
+
+    // Bumped whenever the layout changes. The snapshot's code also has to match BYTECODE_VERSION.
+    constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+    // Stands in for the index of an object that is null, like an upvalue that isn't followed by
+    // another open one.
+    constexpr uint32_t SNAPSHOT_NO_OBJECT = UINT32_MAX;
+
+    enum class SnapshotValueTag : uint8_t {
+        NIL,
+        BOOL,
+        INT,
+        DOUBLE,
+        OBJECT,
+    };
+}
+
+#endif //ENACT_SNAPSHOTFORMAT_H
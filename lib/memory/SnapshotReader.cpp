@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "../vm/VM.h"
+#include "GC.h"
+#include "SnapshotReader.h"
+
+namespace enact {
+    FunctionObject *SnapshotReader::restore(const std::string &data, uint64_t sourceHash, VM &vm, GC &gc) {
+        SnapshotReader reader{data, gc};
+
+        try {
+            FunctionObject *script = reader.readSnapshot(sourceHash, vm);
+            gc.popRoots(reader.m_rootCount + reader.m_reader.m_rootCount);
+            return script;
+        } catch (const BytecodeReader::Invalid &error) {
+            gc.popRoots(reader.m_rootCount + reader.m_reader.m_rootCount);
+            throw Invalid{error.what()};
+        } catch (...) {
+            gc.popRoots(reader.m_rootCount + reader.m_reader.m_rootCount);
+            throw;
+        }
+    }
+
+    FunctionObject *SnapshotReader::load(const std::string &path, uint64_t sourceHash, VM &vm, GC &gc) {
+        std::ifstream file{path, std::ios::binary};
+        if (!file) return nullptr;
+
+        std::stringstream data{};
+        data << file.rdbuf();
+
+        try {
+            return restore(data.str(), sourceHash, vm, gc);
+        } catch (const Invalid &) {
+            return nullptr;
+        }
+    }
+
+    SnapshotReader::SnapshotReader(const std::string &data, GC &gc) :
+            m_reader{std::make_shared<BytecodeImage>(), reinterpret_cast<const uint8_t *>(data.data()), data.size(), gc},
+            m_gc{gc} {
+    }
+
+    FunctionObject *SnapshotReader::readSnapshot(uint64_t sourceHash, VM &vm) {
+        if (vm.m_frameCount != 0 || vm.m_stackTop != vm.m_stack.data()) {
+            throw Invalid{"A snapshot can only be restored into a VM that hasn't run anything."};
+        }
+
+        constexpr size_t headerSize = sizeof(SNAPSHOT_MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+        if (m_reader.m_size < headerSize ||
+                std::memcmp(m_reader.m_data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            return nullptr;
+        }
+        m_reader.m_offset += sizeof(SNAPSHOT_MAGIC);
+
+        if (m_reader.readU32() != SNAPSHOT_VERSION || m_reader.readU32() != BYTECODE_VERSION ||
+                m_reader.readU64() != sourceHash) {
+            return nullptr;
+        }
+
+        uint32_t typeCount = m_reader.readU32();
+        for (uint32_t i = 0; i < typeCount; ++i) {
+            m_reader.m_image->types.push_back(m_reader.readType());
+        }
+
+        // Nothing can reach the objects until the VM's stack is filled in at the end, so they
+        // are all kept rooted until then.
+        uint32_t objectCount = m_reader.readU32();
+        m_reader.expect(objectCount);
+        m_objects.reserve(objectCount);
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            m_objects.push_back(readObject());
+        }
+
+        for (Object *object : m_objects) {
+            readContents(object);
+        }
+
+        size_t pc = m_reader.readU32();
+
+        uint32_t stackCount = m_reader.readU32();
+        if (stackCount == 0 || stackCount > vm.m_stack.size()) {
+            throw Invalid{"Snapshot has the wrong number of stack slots."};
+        }
+
+        std::vector<Value> stack{};
+        stack.reserve(stackCount);
+        for (uint32_t i = 0; i < stackCount; ++i) {
+            stack.push_back(readValue());
+        }
+
+        UpvalueObject *openUpvalues = readObjectIndex<UpvalueObject>();
+
+        // The first slot holds the script, which is resumed from pc.
+        if (!stack[0].isObject() || !stack[0].asObject()->is<ClosureObject>()) {
+            throw Invalid{"Snapshot doesn't start with the script."};
+        }
+
+        FunctionObject *script = stack[0].asObject()->as<ClosureObject>()->getFunction();
+        if (pc >= script->getChunk().getCode().size()) {
+            throw Invalid{"Snapshot resumes the script past its end."};
+        }
+
+        // An open upvalue points into the stack, so it must be one of the slots in use.
+        for (Object *object : m_objects) {
+            if (!object->is<UpvalueObject>()) continue;
+
+            auto upvalue = object->as<UpvalueObject>();
+            if (!upvalue->isClosed() && upvalue->getLocation() >= stackCount) {
+                throw Invalid{"Snapshot has an upvalue outside of the stack."};
+            }
+        }
+
+        size_t openCount = 0;
+        for (UpvalueObject *upvalue = openUpvalues; upvalue != nullptr; upvalue = upvalue->getNext()) {
+            if (upvalue->isClosed() || ++openCount > m_objects.size()) {
+                throw Invalid{"Snapshot has a broken list of open upvalues."};
+            }
+        }
+
+        std::copy(stack.begin(), stack.end(), vm.m_stack.begin());
+        vm.m_stackTop = vm.m_stack.data() + stackCount;
+        vm.m_openUpvalues = openUpvalues;
+        vm.m_pc = pc;
+
+        return script;
+    }
+
+    Object *SnapshotReader::readObject() {
+        switch (static_cast<ObjectType>(m_reader.readU8())) {
+            case ObjectType::STRING: {
+                Value string = m_reader.readConstant();
+                if (!string.isObject() || !string.asObject()->is<StringObject>()) {
+                    throw Invalid{"Snapshot has a string that isn't one."};
+                }
+                return string.asObject();
+            }
+
+            case ObjectType::ARRAY: {
+                Type type = m_reader.readTypeIndex();
+                uint32_t length = m_reader.readU32();
+                m_reader.expect(length);
+
+                return keep(m_gc.allocateObject<ArrayObject>(length, type));
+            }
+
+            case ObjectType::UPVALUE: {
+                return keep(m_gc.allocateObject<UpvalueObject>(m_reader.readU32()));
+            }
+
+            case ObjectType::CLOSURE: {
+                auto function = readObjectIndex<FunctionObject>();
+                if (!function) {
+                    throw Invalid{"Snapshot has a closure without a function."};
+                }
+
+                return keep(m_gc.allocateObject<ClosureObject>(function));
+            }
+
+            case ObjectType::STRUCT: {
+                Type type = m_reader.readTypeIndex();
+                if (!type || type->getKind() != TypeKind::CONSTRUCTOR) {
+                    throw Invalid{"Snapshot has a struct without a constructor type."};
+                }
+
+                uint32_t methodCount = m_reader.readU32();
+                uint32_t assocCount = m_reader.readU32();
+                m_reader.expect(methodCount + static_cast<size_t>(assocCount));
+
+                return keep(m_gc.allocateObject<StructObject>(
+                        std::static_pointer_cast<const ConstructorType>(type),
+                        std::vector<ClosureObject *>(methodCount, nullptr),
+                        std::vector<Value>(assocCount)));
+            }
+
+            case ObjectType::INSTANCE: {
+                auto struct_ = readObjectIndex<StructObject>();
+                if (!struct_) {
+                    throw Invalid{"Snapshot has an instance without a struct."};
+                }
+
+                uint32_t fieldCount = m_reader.readU32();
+                m_reader.expect(fieldCount);
+
+                return keep(m_gc.allocateObject<InstanceObject>(struct_, std::vector<Value>(fieldCount)));
+            }
+
+            case ObjectType::BOUND_METHOD: {
+                Value receiver = readValue();
+                auto method = readObjectIndex<ClosureObject>();
+                if (!method) {
+                    throw Invalid{"Snapshot has a bound method without a method."};
+                }
+
+                return keep(m_gc.allocateObject<BoundMethodObject>(receiver, method));
+            }
+
+            case ObjectType::FUNCTION: {
+                std::string name = m_reader.readString();
+                Type type = m_reader.readTypeIndex();
+                uint32_t upvalueCount = m_reader.readU32();
+
+                Chunk chunk{};
+                m_reader.readCode(chunk);
+
+                uint32_t constantCount = m_reader.readU32();
+                m_reader.expect(constantCount);
+                for (uint32_t i = 0; i < constantCount; ++i) {
+                    chunk.addConstant(readValue());
+                }
+
+                auto function = keep(m_gc.allocateObject<FunctionObject>(type, std::move(chunk), std::move(name)));
+                function->getUpvalueCount() = upvalueCount;
+
+                return function;
+            }
+
+            case ObjectType::NATIVE: {
+                Value native = m_reader.readConstant();
+                if (!native.isObject() || !native.asObject()->is<NativeObject>()) {
+                    throw Invalid{"Snapshot has a native that isn't one."};
+                }
+                return native.asObject();
+            }
+
+            case ObjectType::TYPE: {
+                Value type = m_reader.readConstant();
+                if (!type.isObject() || !type.asObject()->is<TypeObject>()) {
+                    throw Invalid{"Snapshot has a type that isn't one."};
+                }
+                return type.asObject();
+            }
+        }
+
+        throw Invalid{"Snapshot has an unknown kind of object."};
+    }
+
+    void SnapshotReader::readContents(Object *object) {
+        // The object could have been promoted by a collection since it was allocated.
+        if (object->is<ArrayObject>()) {
+            auto array = object->as<ArrayObject>();
+            for (size_t i = 0; i < array->length(); ++i) {
+                array->at(i) = readValue();
+                m_gc.writeBarrier(array, array->at(i));
+            }
+        } else if (object->is<UpvalueObject>()) {
+            auto upvalue = object->as<UpvalueObject>();
+            if (m_reader.readU8() != 0) {
+                upvalue->setClosed(readValue());
+                m_gc.writeBarrier(upvalue, upvalue->getClosed());
+            } else {
+                upvalue->setNext(readObjectIndex<UpvalueObject>());
+            }
+        } else if (object->is<ClosureObject>()) {
+            auto closure = object->as<ClosureObject>();
+            for (UpvalueObject *&upvalue : closure->getUpvalues()) {
+                upvalue = readObjectIndex<UpvalueObject>();
+                if (!upvalue) {
+                    throw Invalid{"Snapshot has a closure that is missing an upvalue."};
+                }
+                m_gc.writeBarrier(closure, upvalue);
+            }
+        } else if (object->is<StructObject>()) {
+            auto struct_ = object->as<StructObject>();
+            for (ClosureObject *&method : struct_->methods()) {
+                method = readObjectIndex<ClosureObject>();
+                if (!method) {
+                    throw Invalid{"Snapshot has a struct that is missing a method."};
+                }
+                m_gc.writeBarrier(struct_, method);
+            }
+            for (Value &assoc : struct_->assocs()) {
+                assoc = readValue();
+                m_gc.writeBarrier(struct_, assoc);
+            }
+        } else if (object->is<InstanceObject>()) {
+            auto instance = object->as<InstanceObject>();
+            for (Value &field : instance->fields()) {
+                field = readValue();
+                m_gc.writeBarrier(instance, field);
+            }
+        }
+    }
+
+    Value SnapshotReader::readValue() {
+        switch (static_cast<SnapshotValueTag>(m_reader.readU8())) {
+            case SnapshotValueTag::NIL: return Value{};
+            case SnapshotValueTag::BOOL: return Value{m_reader.readU8() != 0};
+            case SnapshotValueTag::INT: return Value{static_cast<int>(m_reader.readU32())};
+
+            case SnapshotValueTag::DOUBLE: {
+                uint64_t bits = m_reader.readU64();
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return Value{value};
+            }
+
+            case SnapshotValueTag::OBJECT: {
+                auto object = readObjectIndex<Object>();
+                if (!object) {
+                    throw Invalid{"Snapshot has a null object value."};
+                }
+                return Value{object};
+            }
+        }
+
+        throw Invalid{"Snapshot has an unknown kind of value."};
+    }
+
+    template<typename T>
+    T *SnapshotReader::readObjectIndex() {
+        uint32_t index = m_reader.readU32();
+        if (index == SNAPSHOT_NO_OBJECT) return nullptr;
+
+        if (index >= m_objects.size()) {
+            throw Invalid{"Snapshot refers to an object before it is constructed."};
+        }
+
+        Object *object = m_objects[index];
+        if constexpr (!std::is_same_v<T, Object>) {
+            if (!object->is<T>()) {
+                throw Invalid{"Snapshot refers to an object of the wrong kind."};
+            }
+        }
+
+        return object->as<T>();
+    }
+
+    template<typename T>
+    T *SnapshotReader::keep(T *object) {
+        m_gc.pushRoot(object);
+        ++m_rootCount;
+        return object;
+    }
+}
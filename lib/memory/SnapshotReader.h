@@ -0,0 +1,66 @@
+#ifndef ENACT_SNAPSHOTREADER_H
+#define ENACT_SNAPSHOTREADER_H
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../bytecode/BytecodeReader.h"
+#include "../value/Object.h"
+#include "SnapshotFormat.h"
+
+namespace enact {
+    class GC;
+
+    class VM;
+
+    // Restores what SnapshotWriter wrote into a VM that hasn't run anything yet, which then
+    // resumes the script from where it was paused when it is next run.
+    //
+    // Property caches, JIT code and call counts aren't kept, so they are built up again as the
+    // restored program runs.
+    class SnapshotReader {
+    public:
+        class Invalid : public std::runtime_error {
+        public:
+            explicit Invalid(const std::string &what) : std::runtime_error{what} {}
+        };
+
+        // Returns the script to pass to VM::run(), or nullptr if data wasn't written from source
+        // with the given hash by this version, in which case the VM is left as it was. Throws
+        // Invalid if data is truncated or refers to something that it doesn't contain.
+        static FunctionObject *restore(const std::string &data, uint64_t sourceHash, VM &vm, GC &gc);
+
+        // Returns nullptr if there is no usable snapshot at path, in which case the setup has to
+        // be run as usual. Never throws.
+        static FunctionObject *load(const std::string &path, uint64_t sourceHash, VM &vm, GC &gc);
+
+    private:
+        // Reads the types, and the strings, types and natives, as they are in a bytecode cache.
+        BytecodeReader m_reader;
+
+        GC &m_gc;
+        size_t m_rootCount = 0;
+
+        std::vector<Object *> m_objects{};
+
+        SnapshotReader(const std::string &data, GC &gc);
+
+        FunctionObject *readSnapshot(uint64_t sourceHash, VM &vm);
+
+        Object *readObject();
+        void readContents(Object *object);
+
+        // Values read before the whole table has been may only refer to the objects before them.
+        Value readValue();
+
+        // Returns nullptr for SNAPSHOT_NO_OBJECT, and throws Invalid if the object isn't a T.
+        template<typename T>
+        T *readObjectIndex();
+
+        template<typename T>
+        T *keep(T *object);
+    };
+}
+
+#endif //ENACT_SNAPSHOTREADER_H
@@ -0,0 +1,276 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "../bytecode/BytecodeReader.h"
+#include "../vm/VM.h"
+#include "GC.h"
+#include "SnapshotWriter.h"
+
+namespace enact {
+    std::string SnapshotWriter::write(VM &vm, GC &gc, uint64_t sourceHash) {
+        if (vm.m_frameCount != 0) {
+            throw Unsupported{"The VM can only be snapshotted while it is paused."};
+        }
+
+        SnapshotWriter writer{gc};
+
+        for (Value *slot = vm.m_stack.data(); slot != vm.m_stackTop; ++slot) {
+            writer.noteValue(*slot);
+        }
+
+        for (UpvalueObject *upvalue = vm.m_openUpvalues; upvalue != nullptr; upvalue = upvalue->getNext()) {
+            writer.noteObject(upvalue);
+        }
+
+        while (!writer.m_unwritten.empty()) {
+            Object *object = writer.m_unwritten.back();
+            writer.m_unwritten.pop_back();
+            writer.writeObject(object);
+        }
+
+        std::string out{};
+        out.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        BytecodeWriter::writeU32(out, SNAPSHOT_VERSION);
+        BytecodeWriter::writeU32(out, BYTECODE_VERSION);
+        BytecodeWriter::writeU64(out, sourceHash);
+
+        BytecodeWriter::writeU32(out, writer.m_bytecode.m_typeCount);
+        out += writer.m_bytecode.m_types;
+
+        BytecodeWriter::writeU32(out, writer.m_objectOrder.size());
+        out += writer.m_objects;
+
+        for (Object *object : writer.m_objectOrder) {
+            writer.writeContents(out, object);
+        }
+
+        BytecodeWriter::writeU32(out, vm.m_pc);
+        BytecodeWriter::writeU32(out, vm.m_stackTop - vm.m_stack.data());
+        for (Value *slot = vm.m_stack.data(); slot != vm.m_stackTop; ++slot) {
+            writer.writeValue(out, *slot);
+        }
+        writer.writeObjectIndex(out, vm.m_openUpvalues);
+
+        return out;
+    }
+
+    bool SnapshotWriter::save(const std::string &path, VM &vm, GC &gc, uint64_t sourceHash) {
+        std::string data;
+        try {
+            data = write(vm, gc, sourceHash);
+        } catch (Unsupported &) {
+            return false;
+        }
+
+        // Written to a temporary file and renamed, so that a process starting at the same time
+        // never restores half of one.
+        std::string tempPath = path + ".tmp";
+
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (!file.write(data.data(), data.size())) {
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    SnapshotWriter::SnapshotWriter(GC &gc) : m_gc{gc} {
+    }
+
+    uint32_t SnapshotWriter::writeObject(Object *object) {
+        auto found = m_objectIndices.find(object);
+        if (found != m_objectIndices.end()) {
+            if (found->second == SNAPSHOT_NO_OBJECT) {
+                throw Unsupported{"Object '" + object->toString() + "' is constructed from itself."};
+            }
+            return found->second;
+        }
+
+        m_objectIndices[object] = SNAPSHOT_NO_OBJECT;
+
+        std::string entry{};
+
+        try {
+            if (object->is<StringObject>()) {
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::STRING));
+                m_bytecode.writeConstant(entry, Value{object});
+            } else if (object->is<ArrayObject>()) {
+                auto array = object->as<ArrayObject>();
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::ARRAY));
+                BytecodeWriter::writeU32(entry, m_bytecode.writeType(array->getType()));
+                BytecodeWriter::writeU32(entry, array->length());
+
+                for (Value element : array->asVector()) {
+                    noteValue(element);
+                }
+            } else if (object->is<UpvalueObject>()) {
+                auto upvalue = object->as<UpvalueObject>();
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::UPVALUE));
+                BytecodeWriter::writeU32(entry, upvalue->getLocation());
+
+                // Only an open upvalue's next one is still in the VM's list.
+                if (upvalue->isClosed()) {
+                    noteValue(upvalue->getClosed());
+                } else {
+                    noteObject(upvalue->getNext());
+                }
+            } else if (object->is<ClosureObject>()) {
+                auto closure = object->as<ClosureObject>();
+                uint32_t function = writeObject(closure->getFunction());
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::CLOSURE));
+                BytecodeWriter::writeU32(entry, function);
+
+                for (UpvalueObject *upvalue : closure->getUpvalues()) {
+                    noteObject(upvalue);
+                }
+            } else if (object->is<StructObject>()) {
+                auto struct_ = object->as<StructObject>();
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::STRUCT));
+                BytecodeWriter::writeU32(entry, m_bytecode.writeType(struct_->getType()));
+                BytecodeWriter::writeU32(entry, struct_->methods().size());
+                BytecodeWriter::writeU32(entry, struct_->assocs().size());
+
+                for (ClosureObject *method : struct_->methods()) {
+                    noteObject(method);
+                }
+                for (Value assoc : struct_->assocs()) {
+                    noteValue(assoc);
+                }
+            } else if (object->is<InstanceObject>()) {
+                auto instance = object->as<InstanceObject>();
+                uint32_t struct_ = writeObject(instance->getStruct());
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::INSTANCE));
+                BytecodeWriter::writeU32(entry, struct_);
+                BytecodeWriter::writeU32(entry, instance->fields().size());
+
+                for (Value field : instance->fields()) {
+                    noteValue(field);
+                }
+            } else if (object->is<BoundMethodObject>()) {
+                auto boundMethod = object->as<BoundMethodObject>();
+                if (boundMethod->receiver().isObject()) {
+                    writeObject(boundMethod->receiver().asObject());
+                }
+                uint32_t method = writeObject(boundMethod->method());
+
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::BOUND_METHOD));
+                writeValue(entry, boundMethod->receiver());
+                BytecodeWriter::writeU32(entry, method);
+            } else if (object->is<FunctionObject>()) {
+                auto function = object->as<FunctionObject>();
+
+                // A function mapped from a bytecode cache that hasn't been called yet.
+                BytecodeReader::loadConstants(function, m_gc);
+
+                const Chunk &chunk = function->getChunk();
+                for (Value constant : chunk.getConstants()) {
+                    if (constant.isObject()) writeObject(constant.asObject());
+                }
+
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::FUNCTION));
+                BytecodeWriter::writeString(entry, function->getName());
+                BytecodeWriter::writeU32(entry, m_bytecode.writeType(function->getType()));
+                BytecodeWriter::writeU32(entry, function->getUpvalueCount());
+                BytecodeWriter::writeCode(entry, chunk);
+
+                BytecodeWriter::writeU32(entry, chunk.getConstants().size());
+                for (Value constant : chunk.getConstants()) {
+                    writeValue(entry, constant);
+                }
+            } else if (object->is<NativeObject>()) {
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::NATIVE));
+                m_bytecode.writeConstant(entry, Value{object});
+            } else if (object->is<TypeObject>()) {
+                BytecodeWriter::writeU8(entry, static_cast<uint8_t>(ObjectType::TYPE));
+                m_bytecode.writeConstant(entry, Value{object});
+            }
+        } catch (const BytecodeWriter::Unsupported &error) {
+            throw Unsupported{error.what()};
+        } catch (const BytecodeReader::Invalid &error) {
+            throw Unsupported{error.what()};
+        }
+
+        m_objects += entry;
+        m_objectIndices[object] = m_objectOrder.size();
+        m_objectOrder.push_back(object);
+
+        return m_objectOrder.size() - 1;
+    }
+
+    void SnapshotWriter::writeContents(std::string &out, Object *object) {
+        if (object->is<ArrayObject>()) {
+            for (Value element : object->as<ArrayObject>()->asVector()) {
+                writeValue(out, element);
+            }
+        } else if (object->is<UpvalueObject>()) {
+            auto upvalue = object->as<UpvalueObject>();
+            BytecodeWriter::writeU8(out, upvalue->isClosed());
+            if (upvalue->isClosed()) {
+                writeValue(out, upvalue->getClosed());
+            } else {
+                writeObjectIndex(out, upvalue->getNext());
+            }
+        } else if (object->is<ClosureObject>()) {
+            for (UpvalueObject *upvalue : object->as<ClosureObject>()->getUpvalues()) {
+                writeObjectIndex(out, upvalue);
+            }
+        } else if (object->is<StructObject>()) {
+            auto struct_ = object->as<StructObject>();
+            for (ClosureObject *method : struct_->methods()) {
+                writeObjectIndex(out, method);
+            }
+            for (Value assoc : struct_->assocs()) {
+                writeValue(out, assoc);
+            }
+        } else if (object->is<InstanceObject>()) {
+            for (Value field : object->as<InstanceObject>()->fields()) {
+                writeValue(out, field);
+            }
+        }
+    }
+
+    void SnapshotWriter::noteValue(Value value) {
+        if (value.isObject()) noteObject(value.asObject());
+    }
+
+    void SnapshotWriter::noteObject(Object *object) {
+        if (object && m_objectIndices.find(object) == m_objectIndices.end()) {
+            m_unwritten.push_back(object);
+        }
+    }
+
+    void SnapshotWriter::writeValue(std::string &out, Value value) {
+        if (value.isNil()) {
+            BytecodeWriter::writeU8(out, static_cast<uint8_t>(SnapshotValueTag::NIL));
+        } else if (value.isBool()) {
+            BytecodeWriter::writeU8(out, static_cast<uint8_t>(SnapshotValueTag::BOOL));
+            BytecodeWriter::writeU8(out, value.asBool());
+        } else if (value.isInt()) {
+            BytecodeWriter::writeU8(out, static_cast<uint8_t>(SnapshotValueTag::INT));
+            BytecodeWriter::writeU32(out, static_cast<uint32_t>(value.asInt()));
+        } else if (value.isDouble()) {
+            double number = value.asDouble();
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+
+            BytecodeWriter::writeU8(out, static_cast<uint8_t>(SnapshotValueTag::DOUBLE));
+            BytecodeWriter::writeU64(out, bits);
+        } else {
+            BytecodeWriter::writeU8(out, static_cast<uint8_t>(SnapshotValueTag::OBJECT));
+            writeObjectIndex(out, value.asObject());
+        }
+    }
+
+    void SnapshotWriter::writeObjectIndex(std::string &out, Object *object) {
+        BytecodeWriter::writeU32(out, object ? m_objectIndices.at(object) : SNAPSHOT_NO_OBJECT);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef ENACT_SNAPSHOTWRITER_H
+#define ENACT_SNAPSHOTWRITER_H
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../bytecode/BytecodeWriter.h"
+#include "../value/Object.h"
+#include "SnapshotFormat.h"
+
+namespace enact {
+    class GC;
+
+    class VM;
+
+    // Serialises everything that a paused VM can reach into the format described in
+    // SnapshotFormat.h, so that a later process can start from where it left off instead of
+    // running the same setup again. See SnapshotReader.
+    class SnapshotWriter {
+    public:
+        class Unsupported : public std::runtime_error {
+        public:
+            explicit Unsupported(const std::string &what) : std::runtime_error{what} {}
+        };
+
+        // The VM must be paused between parts of a script, with no frames on its stack. Functions
+        // mapped from a bytecode cache have their constants loaded first, which can allocate.
+        // Throws Unsupported if the VM is running, or an object can't be written.
+        static std::string write(VM &vm, GC &gc, uint64_t sourceHash);
+
+        // Writes the snapshot to a temporary file and renames it over path. Returns false if it
+        // couldn't be written, which the caller is free to ignore.
+        static bool save(const std::string &path, VM &vm, GC &gc, uint64_t sourceHash);
+
+    private:
+        GC &m_gc;
+
+        // Writes the types, and the strings, types and natives, as they are in a bytecode cache.
+        BytecodeWriter m_bytecode{};
+
+        std::string m_objects{};
+        std::vector<Object *> m_objectOrder{};
+        std::unordered_map<const Object *, uint32_t> m_objectIndices{};
+
+        // Objects that are only referred to from the contents of another, and haven't been
+        // written yet.
+        std::vector<Object *> m_unwritten{};
+
+        explicit SnapshotWriter(GC &gc);
+
+        // Writes whatever the object is constructed from first, and returns its index.
+        uint32_t writeObject(Object *object);
+
+        // Written once every object has its index.
+        void writeContents(std::string &out, Object *object);
+
+        // Values in the contents are written later, so only their object is noted here.
+        void noteValue(Value value);
+        void noteObject(Object *object);
+
+        void writeValue(std::string &out, Value value);
+        void writeObjectIndex(std::string &out, Object *object);
+    };
+}
+
+#endif //ENACT_SNAPSHOTWRITER_H
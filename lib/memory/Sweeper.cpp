@@ -0,0 +1,111 @@
+#include "GC.h"
+#include "Sweeper.h"
+
+namespace enact {
+    Sweeper::Sweeper(GC &gc, bool hasThread) : m_gc{gc} {
+        if (hasThread) {
+            m_thread = std::thread{&Sweeper::runThread, this};
+        }
+    }
+
+    Sweeper::~Sweeper() {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_isStopping = true;
+        }
+        m_wakeThread.notify_one();
+
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void Sweeper::start(std::vector<std::unique_ptr<HeapBlock>> &blocks) {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (std::unique_ptr<HeapBlock> &block : blocks) {
+                m_unswept.push_back(std::move(block));
+            }
+        }
+        blocks.clear();
+
+        m_wakeThread.notify_one();
+    }
+
+    bool Sweeper::sweep(size_t count) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        for (size_t i = 0; i < count; ++i) {
+            if (!sweepNext(lock)) return false;
+        }
+
+        return !m_unswept.empty();
+    }
+
+    size_t Sweeper::finish(std::vector<std::unique_ptr<HeapBlock>> &blocks) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        while (sweepNext(lock)) {}
+
+        m_blockSwept.wait(lock, [&] { return m_sweeping == 0; });
+
+        for (std::unique_ptr<HeapBlock> &block : m_swept) {
+            blocks.push_back(std::move(block));
+        }
+        m_swept.clear();
+
+        size_t freedBytes = m_freedBytes;
+        m_freedBytes = 0;
+        return freedBytes;
+    }
+
+    void Sweeper::runThread() {
+        std::unique_lock<std::mutex> lock{m_mutex};
+
+        while (true) {
+            m_wakeThread.wait(lock, [&] { return m_isStopping || !m_unswept.empty(); });
+            if (m_isStopping) return;
+
+            while (sweepNext(lock)) {}
+        }
+    }
+
+    bool Sweeper::sweepNext(std::unique_lock<std::mutex> &lock) {
+        if (m_unswept.empty()) return false;
+
+        std::unique_ptr<HeapBlock> block = std::move(m_unswept.back());
+        m_unswept.pop_back();
+        ++m_sweeping;
+
+        // The block belongs to this thread now, so the other can carry on while it is swept.
+        lock.unlock();
+        size_t freedBytes = sweepBlock(*block);
+        lock.lock();
+
+        if (block->count > 0) {
+            m_swept.push_back(std::move(block));
+        }
+        m_freedBytes += freedBytes;
+
+        --m_sweeping;
+        m_blockSwept.notify_all();
+
+        return true;
+    }
+
+    size_t Sweeper::sweepBlock(HeapBlock &block) {
+        size_t freedBytes = 0;
+        size_t live = 0;
+
+        for (size_t i = 0; i < block.count; ++i) {
+            Object *object = block.objects[i];
+            if (object->isMarked()) {
+                object->unmark();
+                block.objects[live++] = object;
+            } else {
+                freedBytes += m_gc.freeObject(object);
+            }
+        }
+
+        block.count = live;
+        return freedBytes;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef ENACT_SWEEPER_H
+#define ENACT_SWEEPER_H
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace enact {
+    class GC;
+
+    class Object;
+
+    // How many objects a HeapBlock holds.
+    constexpr size_t GC_BLOCK_CAPACITY = 256;
+
+    // The old generation is kept in blocks of objects, each of which is swept all at once.
+    // Sweeping compacts the live objects to the front of the block, and a block with nothing
+    // left alive is freed as a whole.
+    struct HeapBlock {
+        std::array<Object *, GC_BLOCK_CAPACITY> objects{};
+        size_t count = 0;
+    };
+
+    // Sweeps the blocks of the old generation after a full collection has marked them. Blocks
+    // are swept either on demand, by the thread running the program, or by a thread of the
+    // Sweeper's own, whichever takes them first.
+    class Sweeper {
+        GC &m_gc;
+
+        // Guards everything below it, which both threads use.
+        std::mutex m_mutex{};
+        std::condition_variable m_wakeThread{};
+        std::condition_variable m_blockSwept{};
+
+        std::vector<std::unique_ptr<HeapBlock>> m_unswept{};
+        std::vector<std::unique_ptr<HeapBlock>> m_swept{};
+
+        // How many blocks have been taken from m_unswept, but are still being swept.
+        size_t m_sweeping = 0;
+        size_t m_freedBytes = 0;
+
+        bool m_isStopping = false;
+        std::thread m_thread{};
+
+        void runThread();
+
+        // Takes a block from m_unswept and sweeps it. Returns false if there were none left.
+        bool sweepNext(std::unique_lock<std::mutex> &lock);
+
+        // Frees the dead objects in block and unmarks the rest, returning how many bytes it freed.
+        // Only the sizes of dead objects are read, since the program could be resizing live ones.
+        size_t sweepBlock(HeapBlock &block);
+
+    public:
+        Sweeper(GC &gc, bool hasThread);
+
+        ~Sweeper();
+
+        // Takes the blocks of a heap that has just been marked, leaving blocks empty.
+        void start(std::vector<std::unique_ptr<HeapBlock>> &blocks);
+
+        // Sweeps up to count blocks on the calling thread. Returns false once there are none left
+        // to sweep.
+        bool sweep(size_t count);
+
+        // Sweeps whatever is left, and waits for the thread to finish its block. The blocks that
+        // are still alive are moved into blocks, and the number of bytes freed is returned.
+        size_t finish(std::vector<std::unique_ptr<HeapBlock>> &blocks);
+    };
+}
+
+#endif //ENACT_SWEEPER_H
@@ -0,0 +1,31 @@
+#ifndef ENACT_BASICBLOCK_H
+#define ENACT_BASICBLOCK_H
+
+#include <vector>
+
+#include "../bytecode/Chunk.h"
+
+namespace enact {
+    // An instruction decoded from a chunk by ControlFlowGraph.
+    struct Instruction {
+        OpCode op;
+
+        // The bytes after the opcode, as they were written. A jump's are rewritten from its target
+        // when the graph is encoded again, so they are left empty.
+        std::vector<uint8_t> operands{};
+
+        line_t line = 0;
+        col_t col = 0;
+
+        // For JUMP, JUMP_IF_TRUE, JUMP_IF_FALSE and LOOP, the index of the block that it goes to.
+        size_t target = 0;
+    };
+
+    // A run of instructions that is only ever entered at the top. Only the last instruction can
+    // be a jump or a RETURN, and otherwise the block falls through into the next one.
+    struct BasicBlock {
+        std::vector<Instruction> instructions{};
+    };
+}
+
+#endif //ENACT_BASICBLOCK_H
@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "CheckEliminationPass.h"
+
+namespace enact {
+    const char *CheckEliminationPass::getName() const {
+        return "check-elimination";
+    }
+
+    bool CheckEliminationPass::run(ControlFlowGraph &graph) {
+        bool changed = false;
+
+        for (BasicBlock &block : graph.getBlocks()) {
+            std::vector<Instruction> &instructions = block.instructions;
+
+            std::vector<Instruction> result{};
+            result.reserve(instructions.size());
+
+            // Nothing is known about the stack when a block is entered.
+            Kind top = Kind::UNKNOWN;
+
+            // The checks that have passed since the top of the stack last changed.
+            std::vector<Instruction> passed{};
+
+            for (Instruction &instruction : instructions) {
+                if (isCheck(instruction.op)) {
+                    bool isRepeated = std::any_of(passed.begin(), passed.end(), [&](const Instruction &check) {
+                        return check.op == instruction.op && check.operands == instruction.operands;
+                    });
+
+                    if (isRepeated || isSatisfied(instruction.op, top)) {
+                        changed = true;
+                        continue;
+                    }
+
+                    top = kindAfter(graph, instruction, top);
+                    passed.push_back(instruction);
+                } else if (instruction.op == OpCode::SET_LOCAL || instruction.op == OpCode::SET_LOCAL_LONG ||
+                           instruction.op == OpCode::SET_UPVALUE || instruction.op == OpCode::SET_UPVALUE_LONG) {
+                    // These only copy the top of the stack somewhere else, although that could be
+                    // the local just below it, which CHECK_ALLOTABLE looks at too.
+                    passed.erase(std::remove_if(passed.begin(), passed.end(), [](const Instruction &check) {
+                        return check.op == OpCode::CHECK_ALLOTABLE;
+                    }), passed.end());
+                } else {
+                    top = kindAfter(graph, instruction, top);
+                    passed.clear();
+                }
+
+                result.push_back(std::move(instruction));
+            }
+
+            instructions = std::move(result);
+        }
+
+        return changed;
+    }
+
+    CheckEliminationPass::Kind CheckEliminationPass::kindOf(Value value) {
+        if (value.isInt()) return Kind::INT;
+        if (value.isDouble()) return Kind::FLOAT;
+        if (value.isBool()) return Kind::BOOL;
+        if (value.isNil()) return Kind::NIL;
+        return Kind::UNKNOWN;
+    }
+
+    CheckEliminationPass::Kind CheckEliminationPass::kindAfter(const ControlFlowGraph &graph,
+                                                               const Instruction &instruction, Kind top) {
+        if (std::optional<Value> constant = graph.constantPushedBy(instruction)) {
+            return kindOf(*constant);
+        }
+
+        switch (instruction.op) {
+            // A check that passes tells us what the value is.
+            case OpCode::CHECK_INT:
+                return Kind::INT;
+            case OpCode::CHECK_NUMERIC:
+                return top == Kind::INT || top == Kind::FLOAT ? top : Kind::NUMERIC;
+            case OpCode::CHECK_BOOL:
+                return Kind::BOOL;
+
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+                return Kind::INT;
+
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+                return Kind::FLOAT;
+
+            case OpCode::NOT:
+            case OpCode::EQUAL:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                return Kind::BOOL;
+
+            case OpCode::NEGATE:
+                return top == Kind::INT || top == Kind::FLOAT || top == Kind::NUMERIC ? top : Kind::UNKNOWN;
+
+            case OpCode::CHECK_REFERENCE:
+            case OpCode::CHECK_INDEXABLE:
+            case OpCode::CHECK_ALLOTABLE:
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_LONG:
+                return top;
+
+            default:
+                return Kind::UNKNOWN;
+        }
+    }
+
+    bool CheckEliminationPass::isSatisfied(OpCode check, Kind top) {
+        switch (check) {
+            case OpCode::CHECK_INT:
+                return top == Kind::INT;
+            case OpCode::CHECK_NUMERIC:
+                return top == Kind::INT || top == Kind::FLOAT || top == Kind::NUMERIC;
+            case OpCode::CHECK_BOOL:
+                return top == Kind::BOOL;
+
+            default:
+                return false;
+        }
+    }
+
+    bool CheckEliminationPass::isCheck(OpCode op) {
+        switch (op) {
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_NUMERIC:
+            case OpCode::CHECK_BOOL:
+            case OpCode::CHECK_REFERENCE:
+            case OpCode::CHECK_INDEXABLE:
+            case OpCode::CHECK_ALLOTABLE:
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_LONG:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
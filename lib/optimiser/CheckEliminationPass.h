@@ -0,0 +1,38 @@
+#ifndef ENACT_CHECKELIMINATIONPASS_H
+#define ENACT_CHECKELIMINATIONPASS_H
+
+#include "Pass.h"
+
+namespace enact {
+    // Removes the CHECK_* instructions that the compiler emits for dynamic values, where the
+    // value is known to pass them already. Within a block, it follows what kind of value is on
+    // top of the stack from the instructions that pushed it, so CHECK_INT after "CONSTANT 1" or
+    // ADD_INT goes, as does any check repeated before the top of the stack changes.
+    class CheckEliminationPass : public Pass {
+        enum class Kind {
+            UNKNOWN,
+            INT,
+            FLOAT,
+            // An int or a float, but it isn't known which.
+            NUMERIC,
+            BOOL,
+            NIL,
+        };
+
+        static Kind kindOf(Value value);
+
+        // The kind of value that an instruction leaves on top of the stack, given what was there.
+        static Kind kindAfter(const ControlFlowGraph &graph, const Instruction &instruction, Kind top);
+
+        static bool isSatisfied(OpCode check, Kind top);
+
+        static bool isCheck(OpCode op);
+
+    public:
+        const char *getName() const override;
+
+        bool run(ControlFlowGraph &graph) override;
+    };
+}
+
+#endif //ENACT_CHECKELIMINATIONPASS_H
@@ -0,0 +1,279 @@
+#include <limits>
+
+#include "ConstantPropagationPass.h"
+
+namespace enact {
+    const char *ConstantPropagationPass::getName() const {
+        return "constant-propagation";
+    }
+
+    bool ConstantPropagationPass::run(ControlFlowGraph &graph) {
+        bool changed = false;
+
+        for (BasicBlock &block : graph.getBlocks()) {
+            std::vector<Instruction> &instructions = block.instructions;
+
+            std::vector<Instruction> result{};
+            result.reserve(instructions.size());
+
+            // What was pushed within the block and is still there. Anything under it is unknown,
+            // and depth goes below zero once that starts being popped.
+            std::vector<Entry> stack{};
+            int64_t depth = 0;
+
+            std::unordered_map<uint32_t, Known> locals{};
+
+            auto pop = [&](uint32_t count) {
+                for (uint32_t i = 0; i < count; ++i) {
+                    if (!stack.empty()) stack.pop_back();
+                    --depth;
+                }
+
+                for (auto it = locals.begin(); it != locals.end();) {
+                    it = depth < it->second.floor ? locals.erase(it) : std::next(it);
+                }
+            };
+
+            auto push = [&](std::optional<Value> value, bool isProducer) {
+                Entry entry{value};
+                if (isProducer) entry.producer = result.size() - 1;
+
+                stack.push_back(entry);
+                ++depth;
+            };
+
+            // Replaces the instructions that pushed the operands with one that pushes the result.
+            auto fold = [&](uint32_t operands, Value value, const Instruction &instruction) {
+                for (uint32_t i = 0; i < operands; ++i) {
+                    result.pop_back();
+                }
+                pop(operands);
+
+                result.push_back(graph.makeConstantPush(value, instruction.line, instruction.col));
+                push(value, true);
+                changed = true;
+            };
+
+            // Whether the top count entries were pushed by the last count instructions kept.
+            auto isFoldable = [&](uint32_t count) {
+                if (stack.size() < count) return false;
+
+                for (uint32_t i = 0; i < count; ++i) {
+                    const Entry &entry = stack[stack.size() - 1 - i];
+                    if (!entry.value || entry.producer != result.size() - 1 - i) return false;
+                }
+                return true;
+            };
+
+            for (Instruction &instruction : instructions) {
+                OpCode op = instruction.op;
+
+                if (std::optional<Value> constant = graph.constantPushedBy(instruction)) {
+                    result.push_back(std::move(instruction));
+                    push(constant, true);
+                    continue;
+                }
+
+                if (op == OpCode::GET_LOCAL || op == OpCode::GET_LOCAL_LONG) {
+                    auto known = locals.find(ControlFlowGraph::localSlot(instruction));
+                    if (known != locals.end()) {
+                        Value value = known->second.value;
+                        result.push_back(graph.makeConstantPush(value, instruction.line, instruction.col));
+                        push(value, true);
+                        changed = true;
+                    } else {
+                        result.push_back(std::move(instruction));
+                        push({}, false);
+                    }
+                    continue;
+                }
+
+                if (op == OpCode::SET_LOCAL || op == OpCode::SET_LOCAL_LONG) {
+                    uint32_t slot = ControlFlowGraph::localSlot(instruction);
+                    if (!stack.empty() && stack.back().value && !graph.isCaptured(slot)) {
+                        locals.insert_or_assign(slot, Known{*stack.back().value, depth - 1});
+                    } else {
+                        locals.erase(slot);
+                    }
+
+                    result.push_back(std::move(instruction));
+                    continue;
+                }
+
+                if ((op == OpCode::NEGATE || op == OpCode::NOT) && isFoldable(1)) {
+                    if (std::optional<Value> value = foldUnary(op, *stack.back().value)) {
+                        fold(1, *value, instruction);
+                        continue;
+                    }
+                }
+
+                if (isBinary(op) && isFoldable(2)) {
+                    Value a = *stack[stack.size() - 2].value;
+                    Value b = *stack.back().value;
+                    if (std::optional<Value> value = foldBinary(op, a, b)) {
+                        fold(2, *value, instruction);
+                        continue;
+                    }
+                }
+
+                // The condition stays on the stack either way, so a jump that is always taken
+                // becomes a JUMP, and one that never is can go.
+                if ((op == OpCode::JUMP_IF_TRUE || op == OpCode::JUMP_IF_FALSE) &&
+                        !stack.empty() && stack.back().value && stack.back().value->isBool()) {
+                    bool isTaken = stack.back().value->asBool() == (op == OpCode::JUMP_IF_TRUE);
+                    if (isTaken) {
+                        instruction.op = OpCode::JUMP;
+                        result.push_back(std::move(instruction));
+                    }
+                    changed = true;
+                    continue;
+                }
+
+                std::optional<std::pair<uint32_t, uint32_t>> effect = ControlFlowGraph::stackEffect(instruction);
+                result.push_back(std::move(instruction));
+
+                if (!effect) {
+                    // The instruction could have done anything to the stack, so start afresh.
+                    stack.clear();
+                    depth = 0;
+                    locals.clear();
+                    continue;
+                }
+
+                pop(effect->first);
+                for (uint32_t i = 0; i < effect->second; ++i) {
+                    push({}, false);
+                }
+            }
+
+            instructions = std::move(result);
+        }
+
+        return changed;
+    }
+
+    std::optional<Value> ConstantPropagationPass::foldUnary(OpCode op, Value a) {
+        if (op == OpCode::NOT) {
+            if (a.isBool()) return Value{!a.asBool()};
+            return {};
+        }
+
+        if (a.isInt() && a.asInt() != std::numeric_limits<int>::min()) return Value{-a.asInt()};
+        if (a.isDouble()) return Value{-a.asDouble()};
+        return {};
+    }
+
+    std::optional<Value> ConstantPropagationPass::foldBinary(OpCode op, Value a, Value b) {
+        if (op == OpCode::EQUAL) {
+            return Value{a == b};
+        }
+
+        bool isNumeric = (a.isInt() || a.isDouble()) && (b.isInt() || b.isDouble());
+        if (!isNumeric) return {};
+
+        switch (op) {
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+                if (!a.isInt() || !b.isInt()) return {};
+                break;
+
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                if (!a.isDouble() || !b.isDouble()) return {};
+                break;
+
+            default:
+                break;
+        }
+
+        // Like NUMERIC_OP in the VM, two ints give an int, and anything else a float.
+        if (a.isInt() && b.isInt()) {
+            int64_t x = a.asInt();
+            int64_t y = b.asInt();
+
+            int64_t folded;
+            switch (op) {
+                case OpCode::ADD:
+                case OpCode::ADD_INT: folded = x + y; break;
+                case OpCode::SUBTRACT:
+                case OpCode::SUBTRACT_INT: folded = x - y; break;
+                case OpCode::MULTIPLY:
+                case OpCode::MULTIPLY_INT: folded = x * y; break;
+                case OpCode::DIVIDE:
+                case OpCode::DIVIDE_INT:
+                    if (y == 0) return {};
+                    folded = x / y;
+                    break;
+
+                case OpCode::LESS:
+                case OpCode::LESS_INT: return Value{x < y};
+                case OpCode::GREATER:
+                case OpCode::GREATER_INT: return Value{x > y};
+
+                default: return {};
+            }
+
+            if (folded < std::numeric_limits<int>::min() || folded > std::numeric_limits<int>::max()) return {};
+            return Value{static_cast<int>(folded)};
+        }
+
+        double x = a.isInt() ? a.asInt() : a.asDouble();
+        double y = b.isInt() ? b.asInt() : b.asDouble();
+
+        switch (op) {
+            case OpCode::ADD:
+            case OpCode::ADD_FLOAT: return Value{x + y};
+            case OpCode::SUBTRACT:
+            case OpCode::SUBTRACT_FLOAT: return Value{x - y};
+            case OpCode::MULTIPLY:
+            case OpCode::MULTIPLY_FLOAT: return Value{x * y};
+            case OpCode::DIVIDE:
+            case OpCode::DIVIDE_FLOAT:
+                if (y == 0) return {};
+                return Value{x / y};
+
+            case OpCode::LESS:
+            case OpCode::LESS_FLOAT: return Value{x < y};
+            case OpCode::GREATER:
+            case OpCode::GREATER_FLOAT: return Value{x > y};
+
+            default: return {};
+        }
+    }
+
+    bool ConstantPropagationPass::isBinary(OpCode op) {
+        switch (op) {
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::EQUAL:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
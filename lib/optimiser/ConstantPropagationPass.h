@@ -0,0 +1,48 @@
+#ifndef ENACT_CONSTANTPROPAGATIONPASS_H
+#define ENACT_CONSTANTPROPAGATIONPASS_H
+
+#include <unordered_map>
+
+#include "Pass.h"
+
+namespace enact {
+    // Works out values that don't depend on anything at runtime, within a block:
+    //
+    //   - arithmetic, comparisons, NEGATE and NOT on constants are folded into one constant,
+    //     unless an int operation would overflow or divide by zero
+    //   - a GET_LOCAL of a local that was just set to a constant pushes the constant instead
+    //   - a conditional jump on a known bool becomes a JUMP, or goes if it is never taken
+    //
+    // Only ints, floats, bools and nil are folded. Locals captured by a closure could be changed
+    // by it at any time, so nothing is assumed about them.
+    class ConstantPropagationPass : public Pass {
+        // A value on the stack, pushed within the current block.
+        struct Entry {
+            std::optional<Value> value{};
+
+            // Where the instruction that pushed it is in the block, if it only pushed the value.
+            // Folding removes it, as long as nothing has been kept since.
+            std::optional<size_t> producer{};
+        };
+
+        // A local last set to a constant. The value that set it was above the local on the stack,
+        // so the local can only have gone once the stack is shallower than it was under that value.
+        struct Known {
+            Value value;
+            int64_t floor;
+        };
+
+        static std::optional<Value> foldUnary(OpCode op, Value a);
+
+        static std::optional<Value> foldBinary(OpCode op, Value a, Value b);
+
+        static bool isBinary(OpCode op);
+
+    public:
+        const char *getName() const override;
+
+        bool run(ControlFlowGraph &graph) override;
+    };
+}
+
+#endif //ENACT_CONSTANTPROPAGATIONPASS_H
@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include "../value/Object.h"
+#include "ControlFlowGraph.h"
+
+namespace enact {
+    static uint32_t readLong(const CodeBuffer &code, size_t index) {
+        return static_cast<uint32_t>(code[index] | (code[index + 1] << 8) | (code[index + 2] << 16));
+    }
+
+    // Whether ControlFlowGraph can decode the instruction. STRUCT instructions can't be measured
+    // without the struct's type, and the rest have either been written by passes that run after
+    // this one, or could be resumed from by the VM.
+    static bool isDecodable(OpCode op) {
+        switch (op) {
+            case OpCode::CHECK_TYPE_INT:
+            case OpCode::CHECK_TYPE_INT_LONG:
+            case OpCode::CHECK_TYPE_FLOAT:
+            case OpCode::CHECK_TYPE_FLOAT_LONG:
+            case OpCode::CHECK_TYPE_BOOL:
+            case OpCode::CHECK_TYPE_BOOL_LONG:
+            case OpCode::STRUCT:
+            case OpCode::STRUCT_LONG:
+            case OpCode::GET_LOCAL_GET_LOCAL:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::ADD_INT_LOCAL_CONST_SET:
+            case OpCode::PAUSE:
+                return false;
+
+            default:
+                return true;
+        }
+    }
+
+    std::optional<ControlFlowGraph> ControlFlowGraph::decode(const Chunk &chunk) {
+        // CLOSURE instructions can't even be measured without the function in their constant.
+        if (chunk.hasPendingConstants()) return {};
+
+        const CodeBuffer &code = chunk.getCode();
+
+        ControlFlowGraph graph{};
+        graph.m_constants = chunk.getConstants();
+        graph.m_propertyCacheCount = chunk.getPropertyCaches().size();
+
+        std::vector<size_t> offsets{};
+        std::vector<Instruction> instructions{};
+
+        // Where each jump goes, by the index of the jump in instructions.
+        std::map<size_t, size_t> targets{};
+
+        // The offsets that start a block, mapped to its index once they are all known.
+        std::map<size_t, size_t> leaders{{0, 0}};
+
+        for (size_t offset = 0; offset < code.size();) {
+            if (!isDecodable(static_cast<OpCode>(code[offset]))) return {};
+
+            size_t length = chunk.getInstructionLength(offset);
+            if (length == 0 || offset + length > code.size()) return {};
+
+            Instruction instruction{static_cast<OpCode>(code[offset])};
+            instruction.line = chunk.getLine(offset);
+            instruction.col = chunk.getColumn(offset);
+
+            size_t next = offset + length;
+
+            if (isJump(instruction.op)) {
+                size_t distance = code[offset + 1] | (code[offset + 2] << 8);
+                if (instruction.op == OpCode::LOOP) {
+                    if (distance > next) return {};
+                    targets.emplace(instructions.size(), next - distance);
+                } else {
+                    targets.emplace(instructions.size(), next + distance);
+                }
+            } else {
+                instruction.operands.assign(code.data() + offset + 1, code.data() + next);
+            }
+
+            if (instruction.op == OpCode::CLOSURE || instruction.op == OpCode::CLOSURE_LONG) {
+                bool isLong = instruction.op == OpCode::CLOSURE_LONG;
+
+                size_t upvalue = offset + (isLong ? 4 : 2);
+                for (uint32_t i = 0; upvalue < next; ++i) {
+                    bool isLocal = code[upvalue] != 0;
+                    uint32_t slot = i < UINT8_MAX ? code[upvalue + 1] : readLong(code, upvalue + 1);
+                    if (isLocal) graph.m_capturedSlots.insert(slot);
+
+                    upvalue += i < UINT8_MAX ? 2 : 4;
+                }
+            }
+
+            if (isTerminator(instruction.op) && next < code.size()) {
+                leaders.emplace(next, 0);
+            }
+
+            offsets.push_back(offset);
+            instructions.push_back(std::move(instruction));
+            offset = next;
+        }
+
+        // A jump can go to the end of the code, which is given an empty block of its own.
+        for (const auto &[index, target] : targets) {
+            if (target != code.size() && !std::binary_search(offsets.begin(), offsets.end(), target)) return {};
+            leaders.emplace(target, 0);
+        }
+
+        for (auto &[offset, block] : leaders) {
+            block = graph.m_blocks.size();
+            graph.m_blocks.emplace_back();
+        }
+
+        size_t block = 0;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            auto leader = leaders.find(offsets[i]);
+            if (leader != leaders.end()) block = leader->second;
+
+            auto target = targets.find(i);
+            if (target != targets.end()) {
+                instructions[i].target = leaders.at(target->second);
+            }
+
+            graph.m_blocks[block].instructions.push_back(std::move(instructions[i]));
+        }
+
+        return graph;
+    }
+
+    std::optional<Chunk> ControlFlowGraph::encode() const {
+        // Every jump is three bytes long whichever way it goes, so the blocks can be laid out
+        // before any of them are written.
+        std::vector<size_t> blockOffsets{};
+        size_t size = 0;
+        for (const BasicBlock &block : m_blocks) {
+            blockOffsets.push_back(size);
+            for (const Instruction &instruction : block.instructions) {
+                size += isJump(instruction.op) ? 3 : 1 + instruction.operands.size();
+            }
+        }
+
+        Chunk chunk{};
+
+        for (const BasicBlock &block : m_blocks) {
+            for (const Instruction &instruction : block.instructions) {
+                if (!isJump(instruction.op)) {
+                    chunk.write(instruction.op, instruction.line, instruction.col);
+                    for (uint8_t operand : instruction.operands) {
+                        chunk.write(operand, instruction.line, instruction.col);
+                    }
+                    continue;
+                }
+
+                size_t next = chunk.getCount() + 3;
+                size_t target = blockOffsets[instruction.target];
+
+                OpCode op = instruction.op;
+                size_t distance;
+                if (target >= next) {
+                    if (op == OpCode::LOOP) op = OpCode::JUMP;
+                    distance = target - next;
+                } else {
+                    // Only unconditional jumps can go backwards.
+                    if (op != OpCode::JUMP && op != OpCode::LOOP) return {};
+                    op = OpCode::LOOP;
+                    distance = next - target;
+                }
+
+                if (distance > UINT16_MAX) return {};
+
+                chunk.write(op, instruction.line, instruction.col);
+                chunk.writeShort(static_cast<uint32_t>(distance), instruction.line, instruction.col);
+            }
+        }
+
+        for (Value constant : m_constants) {
+            chunk.addConstant(constant);
+        }
+
+        for (size_t i = 0; i < m_propertyCacheCount; ++i) {
+            chunk.addPropertyCache();
+        }
+
+        return chunk;
+    }
+
+    std::vector<BasicBlock> &ControlFlowGraph::getBlocks() {
+        return m_blocks;
+    }
+
+    const std::vector<BasicBlock> &ControlFlowGraph::getBlocks() const {
+        return m_blocks;
+    }
+
+    const std::vector<Value> &ControlFlowGraph::getConstants() const {
+        return m_constants;
+    }
+
+    uint32_t ControlFlowGraph::addConstant(Value constant) {
+        // Compared bit for bit, so that 0.0 isn't mistaken for -0.0.
+        for (size_t i = 0; i < m_constants.size(); ++i) {
+            const Value &existing = m_constants[i];
+
+            bool isSame = false;
+            if (constant.isInt() && existing.isInt()) {
+                isSame = constant.asInt() == existing.asInt();
+            } else if (constant.isDouble() && existing.isDouble()) {
+                double a = constant.asDouble();
+                double b = existing.asDouble();
+                isSame = std::memcmp(&a, &b, sizeof(double)) == 0;
+            }
+
+            if (isSame) return static_cast<uint32_t>(i);
+        }
+
+        m_constants.push_back(constant);
+        return static_cast<uint32_t>(m_constants.size() - 1);
+    }
+
+    bool ControlFlowGraph::isCaptured(uint32_t slot) const {
+        return m_capturedSlots.count(slot) > 0;
+    }
+
+    std::vector<size_t> ControlFlowGraph::getSuccessors(size_t block) const {
+        std::vector<size_t> successors{};
+        bool fallsThrough = true;
+
+        const std::vector<Instruction> &instructions = m_blocks[block].instructions;
+        if (!instructions.empty()) {
+            const Instruction &last = instructions.back();
+
+            if (isJump(last.op)) successors.push_back(last.target);
+            fallsThrough = !isTerminator(last.op) ||
+                           last.op == OpCode::JUMP_IF_TRUE || last.op == OpCode::JUMP_IF_FALSE;
+        }
+
+        if (fallsThrough && block + 1 < m_blocks.size()) {
+            successors.push_back(block + 1);
+        }
+
+        return successors;
+    }
+
+    size_t ControlFlowGraph::skipEmpty(size_t block) const {
+        while (block < m_blocks.size() && m_blocks[block].instructions.empty()) {
+            ++block;
+        }
+        return block;
+    }
+
+    bool ControlFlowGraph::removeUnreachable() {
+        std::vector<bool> isReachable(m_blocks.size(), false);
+        std::vector<size_t> worklist{0};
+        isReachable[0] = true;
+
+        while (!worklist.empty()) {
+            size_t block = worklist.back();
+            worklist.pop_back();
+
+            for (size_t successor : getSuccessors(block)) {
+                if (!isReachable[successor]) {
+                    isReachable[successor] = true;
+                    worklist.push_back(successor);
+                }
+            }
+        }
+
+        if (std::find(isReachable.begin(), isReachable.end(), false) == isReachable.end()) return false;
+
+        // A block that falls through is always followed by its successor, which is reachable
+        // too, so dropping the rest leaves every fallthrough where it was.
+        std::vector<size_t> newIndices(m_blocks.size(), 0);
+        std::vector<BasicBlock> blocks{};
+        for (size_t i = 0; i < m_blocks.size(); ++i) {
+            if (!isReachable[i]) continue;
+
+            newIndices[i] = blocks.size();
+            blocks.push_back(std::move(m_blocks[i]));
+        }
+
+        for (BasicBlock &block : blocks) {
+            for (Instruction &instruction : block.instructions) {
+                if (isJump(instruction.op)) instruction.target = newIndices[instruction.target];
+            }
+        }
+
+        m_blocks = std::move(blocks);
+        return true;
+    }
+
+    std::optional<Value> ControlFlowGraph::constantPushedBy(const Instruction &instruction) const {
+        switch (instruction.op) {
+            case OpCode::TRUE: return Value{true};
+            case OpCode::FALSE: return Value{false};
+            case OpCode::NIL: return Value{};
+
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG: {
+                uint32_t index = instruction.op == OpCode::CONSTANT ?
+                        instruction.operands[0] :
+                        readLongOperand(instruction, 0);
+
+                Value constant = m_constants[index];
+                if (constant.isInt() || constant.isDouble()) return constant;
+                return {};
+            }
+
+            default:
+                return {};
+        }
+    }
+
+    Instruction ControlFlowGraph::makeConstantPush(Value value, line_t line, col_t col) {
+        Instruction instruction{OpCode::NIL};
+        instruction.line = line;
+        instruction.col = col;
+
+        if (value.isBool()) {
+            instruction.op = value.asBool() ? OpCode::TRUE : OpCode::FALSE;
+        } else if (!value.isNil()) {
+            uint32_t index = addConstant(value);
+
+            // The same boundary as Chunk::writeConstant().
+            if (index < UINT8_MAX) {
+                instruction.op = OpCode::CONSTANT;
+                instruction.operands = {static_cast<uint8_t>(index)};
+            } else {
+                instruction.op = OpCode::CONSTANT_LONG;
+                instruction.operands = {
+                        static_cast<uint8_t>(index & 0xff),
+                        static_cast<uint8_t>((index >> 8) & 0xff),
+                        static_cast<uint8_t>((index >> 16) & 0xff),
+                };
+            }
+        }
+
+        return instruction;
+    }
+
+    std::optional<std::pair<uint32_t, uint32_t>> ControlFlowGraph::stackEffect(const Instruction &instruction) {
+        switch (instruction.op) {
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG:
+            case OpCode::TRUE:
+            case OpCode::FALSE:
+            case OpCode::NIL:
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_LOCAL_LONG:
+            case OpCode::GET_UPVALUE:
+            case OpCode::GET_UPVALUE_LONG:
+            case OpCode::CLOSURE:
+            case OpCode::CLOSURE_LONG:
+                return std::pair{0u, 1u};
+
+            // These only look at the stack.
+            case OpCode::CHECK_INT:
+            case OpCode::CHECK_NUMERIC:
+            case OpCode::CHECK_BOOL:
+            case OpCode::CHECK_REFERENCE:
+            case OpCode::CHECK_INDEXABLE:
+            case OpCode::CHECK_ALLOTABLE:
+            case OpCode::CHECK_TYPE:
+            case OpCode::CHECK_TYPE_LONG:
+            case OpCode::SET_LOCAL:
+            case OpCode::SET_LOCAL_LONG:
+            case OpCode::SET_UPVALUE:
+            case OpCode::SET_UPVALUE_LONG:
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::LOOP:
+                return std::pair{0u, 0u};
+
+            case OpCode::NEGATE:
+            case OpCode::NOT:
+            case OpCode::COPY:
+            case OpCode::GET_FIELD:
+            case OpCode::GET_FIELD_LONG:
+                return std::pair{1u, 1u};
+
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::ADD_INT:
+            case OpCode::SUBTRACT_INT:
+            case OpCode::MULTIPLY_INT:
+            case OpCode::DIVIDE_INT:
+            case OpCode::ADD_FLOAT:
+            case OpCode::SUBTRACT_FLOAT:
+            case OpCode::MULTIPLY_FLOAT:
+            case OpCode::DIVIDE_FLOAT:
+            case OpCode::LESS:
+            case OpCode::GREATER:
+            case OpCode::EQUAL:
+            case OpCode::LESS_INT:
+            case OpCode::GREATER_INT:
+            case OpCode::LESS_FLOAT:
+            case OpCode::GREATER_FLOAT:
+            case OpCode::GET_ARRAY_INDEX:
+            case OpCode::SET_FIELD:
+            case OpCode::SET_FIELD_LONG:
+                return std::pair{2u, 1u};
+
+            case OpCode::SET_ARRAY_INDEX:
+                return std::pair{3u, 1u};
+
+            case OpCode::POP:
+            case OpCode::CLOSE_UPVALUE:
+                return std::pair{1u, 0u};
+
+            case OpCode::ARRAY:
+                return std::pair{static_cast<uint32_t>(instruction.operands[0]), 1u};
+            case OpCode::ARRAY_LONG:
+                return std::pair{readLongOperand(instruction, 0), 1u};
+
+            // Calls depend on the callee, and the rest aren't worth the trouble.
+            default:
+                return {};
+        }
+    }
+
+    uint32_t ControlFlowGraph::localSlot(const Instruction &instruction) {
+        if (instruction.op == OpCode::GET_LOCAL || instruction.op == OpCode::SET_LOCAL) {
+            return instruction.operands[0];
+        }
+        return readLongOperand(instruction, 0);
+    }
+
+    uint32_t ControlFlowGraph::readLongOperand(const Instruction &instruction, size_t index) {
+        return static_cast<uint32_t>(instruction.operands[index] |
+                                     (instruction.operands[index + 1] << 8) |
+                                     (instruction.operands[index + 2] << 16));
+    }
+
+    bool ControlFlowGraph::isJump(OpCode op) {
+        return op == OpCode::JUMP || op == OpCode::JUMP_IF_TRUE || op == OpCode::JUMP_IF_FALSE ||
+               op == OpCode::LOOP;
+    }
+
+    bool ControlFlowGraph::isTerminator(OpCode op) {
+        return isJump(op) || op == OpCode::RETURN;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef ENACT_CONTROLFLOWGRAPH_H
+#define ENACT_CONTROLFLOWGRAPH_H
+
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+#include "BasicBlock.h"
+
+namespace enact {
+    // A chunk's code split into basic blocks, for the passes run by PassManager. The blocks stay
+    // in the order that their code was in, so a jump to an earlier block is a LOOP.
+    class ControlFlowGraph {
+        std::vector<BasicBlock> m_blocks{};
+
+        // The chunk's constants, along with any added by the passes.
+        std::vector<Value> m_constants{};
+        size_t m_propertyCacheCount = 0;
+
+        // The locals that a CLOSURE captures, which other functions can read and write through
+        // their upvalues.
+        std::unordered_set<uint32_t> m_capturedSlots{};
+
+        ControlFlowGraph() = default;
+
+    public:
+        // Returns nothing for chunks that can't be decoded without changing what they mean: those
+        // already fused or quickened, those with a PAUSE that the VM could resume from, and those
+        // with STRUCT instructions, whose length can't be told from their operands.
+        static std::optional<ControlFlowGraph> decode(const Chunk &chunk);
+
+        // Returns nothing if a jump has become too long to encode.
+        std::optional<Chunk> encode() const;
+
+        std::vector<BasicBlock> &getBlocks();
+        const std::vector<BasicBlock> &getBlocks() const;
+
+        const std::vector<Value> &getConstants() const;
+
+        // Reuses an equal constant if there is one. Only for values that aren't objects.
+        uint32_t addConstant(Value constant);
+
+        bool isCaptured(uint32_t slot) const;
+
+        // The blocks that control can go to from the end of the given one.
+        std::vector<size_t> getSuccessors(size_t block) const;
+
+        // The first block at or after the given one with any instructions in it, which is where
+        // control really goes when it enters the given block. Returns the number of blocks if
+        // there isn't one.
+        size_t skipEmpty(size_t block) const;
+
+        // Drops the blocks that can't be reached from the first one. Returns whether there were any.
+        bool removeUnreachable();
+
+        // The value that an instruction pushes, if it only pushes a constant that isn't an object.
+        std::optional<Value> constantPushedBy(const Instruction &instruction) const;
+
+        // An instruction that pushes the given value, for the passes that work one out.
+        Instruction makeConstantPush(Value value, line_t line, col_t col);
+
+        // How many values an instruction pops and then pushes, or nothing if that isn't known
+        // from the instruction alone.
+        static std::optional<std::pair<uint32_t, uint32_t>> stackEffect(const Instruction &instruction);
+
+        // The slot of a GET_LOCAL(_LONG) or SET_LOCAL(_LONG).
+        static uint32_t localSlot(const Instruction &instruction);
+
+        // The three byte operand starting at the given index of an instruction's operands.
+        static uint32_t readLongOperand(const Instruction &instruction, size_t index);
+
+        static bool isJump(OpCode op);
+
+        static bool isTerminator(OpCode op);
+    };
+}
+
+#endif //ENACT_CONTROLFLOWGRAPH_H
@@ -0,0 +1,85 @@
+#include "DeadStorePass.h"
+
+namespace enact {
+    const char *DeadStorePass::getName() const {
+        return "dead-store";
+    }
+
+    bool DeadStorePass::run(ControlFlowGraph &graph) {
+        std::vector<BasicBlock> &blocks = graph.getBlocks();
+        std::vector<SlotSet> liveIn = findLiveIn(graph);
+
+        bool changed = false;
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            SlotSet live{};
+            for (size_t successor : graph.getSuccessors(i)) {
+                live.insert(liveIn[successor].begin(), liveIn[successor].end());
+            }
+
+            std::vector<Instruction> &instructions = blocks[i].instructions;
+            for (size_t j = instructions.size(); j-- > 0;) {
+                const Instruction &instruction = instructions[j];
+
+                if (isSet(instruction.op)) {
+                    uint32_t slot = ControlFlowGraph::localSlot(instruction);
+                    if (live.count(slot) == 0 && !graph.isCaptured(slot)) {
+                        instructions.erase(instructions.begin() + j);
+                        changed = true;
+                        continue;
+                    }
+                }
+
+                transfer(instruction, live);
+            }
+        }
+
+        return changed;
+    }
+
+    std::vector<DeadStorePass::SlotSet> DeadStorePass::findLiveIn(const ControlFlowGraph &graph) {
+        const std::vector<BasicBlock> &blocks = graph.getBlocks();
+        std::vector<SlotSet> liveIn(blocks.size());
+
+        // Loops make a block live on entry to the ones before it, so keep going until nothing changes.
+        bool changed = true;
+        while (changed) {
+            changed = false;
+
+            for (size_t i = blocks.size(); i-- > 0;) {
+                SlotSet live{};
+                for (size_t successor : graph.getSuccessors(i)) {
+                    live.insert(liveIn[successor].begin(), liveIn[successor].end());
+                }
+
+                const std::vector<Instruction> &instructions = blocks[i].instructions;
+                for (size_t j = instructions.size(); j-- > 0;) {
+                    transfer(instructions[j], live);
+                }
+
+                if (live != liveIn[i]) {
+                    liveIn[i] = std::move(live);
+                    changed = true;
+                }
+            }
+        }
+
+        return liveIn;
+    }
+
+    void DeadStorePass::transfer(const Instruction &instruction, SlotSet &live) {
+        if (isGet(instruction.op)) {
+            live.insert(ControlFlowGraph::localSlot(instruction));
+        } else if (isSet(instruction.op)) {
+            live.erase(ControlFlowGraph::localSlot(instruction));
+        }
+    }
+
+    bool DeadStorePass::isGet(OpCode op) {
+        return op == OpCode::GET_LOCAL || op == OpCode::GET_LOCAL_LONG;
+    }
+
+    bool DeadStorePass::isSet(OpCode op) {
+        return op == OpCode::SET_LOCAL || op == OpCode::SET_LOCAL_LONG;
+    }
+}
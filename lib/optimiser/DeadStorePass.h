@@ -0,0 +1,35 @@
+#ifndef ENACT_DEADSTOREPASS_H
+#define ENACT_DEADSTOREPASS_H
+
+#include <unordered_set>
+
+#include "Pass.h"
+
+namespace enact {
+    // Removes SET_LOCAL(_LONG) instructions whose value is never read back from the local, like
+    // the store in "SET_LOCAL a; POP" when a is overwritten or goes out of scope before the next
+    // GET_LOCAL a. The value stays on the stack, so the POP is left for PeepholePass to pair up
+    // with whatever pushed it.
+    //
+    // Locals captured by a closure can be read through its upvalue at any point, so stores to
+    // them are always kept.
+    class DeadStorePass : public Pass {
+        using SlotSet = std::unordered_set<uint32_t>;
+
+        // The locals that are read before being written again on some path from the start of
+        // each block.
+        static std::vector<SlotSet> findLiveIn(const ControlFlowGraph &graph);
+
+        static void transfer(const Instruction &instruction, SlotSet &live);
+
+        static bool isGet(OpCode op);
+        static bool isSet(OpCode op);
+
+    public:
+        const char *getName() const override;
+
+        bool run(ControlFlowGraph &graph) override;
+    };
+}
+
+#endif //ENACT_DEADSTOREPASS_H
@@ -0,0 +1,83 @@
+#include "JumpThreadingPass.h"
+
+namespace enact {
+    const char *JumpThreadingPass::getName() const {
+        return "jump-threading";
+    }
+
+    bool JumpThreadingPass::run(ControlFlowGraph &graph) {
+        bool changed = false;
+        std::vector<BasicBlock> &blocks = graph.getBlocks();
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            std::vector<Instruction> &instructions = blocks[i].instructions;
+            if (instructions.empty() || !ControlFlowGraph::isJump(instructions.back().op)) continue;
+
+            Instruction &jump = instructions.back();
+
+            size_t target = resolve(graph, i, jump.op, jump.target);
+            if (target != jump.target) {
+                jump.target = target;
+                changed = true;
+            }
+
+            // Conditional jumps only peek at their condition, so any jump to where the block
+            // would have fallen through to anyway can go.
+            if (graph.skipEmpty(jump.target) == graph.skipEmpty(i + 1)) {
+                instructions.pop_back();
+                changed = true;
+            }
+        }
+
+        return graph.removeUnreachable() || changed;
+    }
+
+    size_t JumpThreadingPass::resolve(const ControlFlowGraph &graph, size_t block, OpCode op, size_t target) {
+        const std::vector<BasicBlock> &blocks = graph.getBlocks();
+        bool isConditional = op == OpCode::JUMP_IF_TRUE || op == OpCode::JUMP_IF_FALSE;
+
+        // Each step goes to a different block, so a chain can be no longer than that.
+        size_t resolved = target;
+        for (size_t steps = 0; steps < blocks.size(); ++steps) {
+            size_t next = graph.skipEmpty(resolved);
+            if (next == blocks.size()) break;
+
+            const std::vector<Instruction> &instructions = blocks[next].instructions;
+            if (instructions.size() != 1) {
+                resolved = next;
+                break;
+            }
+
+            const Instruction &only = instructions[0];
+            bool isUnconditional = only.op == OpCode::JUMP || only.op == OpCode::LOOP;
+
+            size_t candidate;
+            if (!isConditional && isUnconditional) {
+                candidate = only.target;
+            } else if (isConditional && only.op == op) {
+                candidate = only.target;
+            } else if (isConditional && (only.op == OpCode::JUMP_IF_TRUE || only.op == OpCode::JUMP_IF_FALSE)) {
+                candidate = next + 1;
+            } else {
+                resolved = next;
+                break;
+            }
+
+            if (candidate >= blocks.size() || (isConditional && candidate <= block)) {
+                resolved = next;
+                break;
+            }
+
+            // A jump that goes round in a circle is left where it is.
+            if (graph.skipEmpty(candidate) == next) {
+                resolved = next;
+                break;
+            }
+
+            resolved = candidate;
+        }
+
+        if (isConditional && graph.skipEmpty(resolved) <= block) return target;
+        return resolved;
+    }
+}
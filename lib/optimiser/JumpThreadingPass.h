@@ -0,0 +1,27 @@
+#ifndef ENACT_JUMPTHREADINGPASS_H
+#define ENACT_JUMPTHREADINGPASS_H
+
+#include "Pass.h"
+
+namespace enact {
+    // Sends jumps straight to where they would end up:
+    //
+    //   - a jump to an unconditional jump goes to its target instead
+    //   - a conditional jump to another on the same condition goes to its target, and to one on
+    //     the opposite condition goes past it, since the condition is still on the stack
+    //   - a jump to the block that follows it is removed
+    //
+    // and then drops the blocks that can no longer be reached. Conditional jumps can only go
+    // forwards, so they are never threaded to an earlier block.
+    class JumpThreadingPass : public Pass {
+        // Where a jump from the given block to target ends up.
+        static size_t resolve(const ControlFlowGraph &graph, size_t block, OpCode op, size_t target);
+
+    public:
+        const char *getName() const override;
+
+        bool run(ControlFlowGraph &graph) override;
+    };
+}
+
+#endif //ENACT_JUMPTHREADINGPASS_H
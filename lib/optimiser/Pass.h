@@ -0,0 +1,22 @@
+#ifndef ENACT_PASS_H
+#define ENACT_PASS_H
+
+#include "ControlFlowGraph.h"
+
+namespace enact {
+    // A transformation of a function's ControlFlowGraph, run by PassManager. Passes only work
+    // within a single function, and must leave it doing exactly what it did before, short of
+    // the type checks that they can prove will pass.
+    class Pass {
+    public:
+        virtual ~Pass() = default;
+
+        // Shown in the timings printed with --debug-time-passes.
+        virtual const char *getName() const = 0;
+
+        // Returns whether anything was changed.
+        virtual bool run(ControlFlowGraph &graph) = 0;
+    };
+}
+
+#endif //ENACT_PASS_H
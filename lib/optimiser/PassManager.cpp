@@ -0,0 +1,101 @@
+#include <iomanip>
+#include <sstream>
+
+#include "CheckEliminationPass.h"
+#include "ConstantPropagationPass.h"
+#include "DeadStorePass.h"
+#include "JumpThreadingPass.h"
+#include "PassManager.h"
+#include "PeepholePass.h"
+
+namespace enact {
+    PassManager::PassManager(OptimisationLevel level) {
+        switch (level) {
+            case OptimisationLevel::O0:
+                break;
+
+            case OptimisationLevel::O1:
+                addPass(std::make_unique<PeepholePass>());
+                addPass(std::make_unique<JumpThreadingPass>());
+                addPass(std::make_unique<DeadStorePass>());
+                break;
+
+            // Constants are propagated first, so that the stores and jumps it leaves behind are
+            // cleaned up in the same round.
+            case OptimisationLevel::O2:
+                addPass(std::make_unique<CheckEliminationPass>());
+                addPass(std::make_unique<ConstantPropagationPass>());
+                addPass(std::make_unique<DeadStorePass>());
+                addPass(std::make_unique<PeepholePass>());
+                addPass(std::make_unique<JumpThreadingPass>());
+                break;
+        }
+    }
+
+    void PassManager::addPass(std::unique_ptr<Pass> pass) {
+        m_passes.push_back(std::move(pass));
+        m_timings.emplace_back();
+    }
+
+    void PassManager::run(Chunk &chunk) {
+        if (m_passes.empty()) return;
+
+        ++m_chunkCount;
+
+        auto start = std::chrono::steady_clock::now();
+        std::optional<ControlFlowGraph> graph = ControlFlowGraph::decode(chunk);
+        m_graphTiming.time += std::chrono::steady_clock::now() - start;
+        ++m_graphTiming.runs;
+
+        if (!graph) {
+            ++m_skippedCount;
+            return;
+        }
+
+        bool changed = true;
+        for (size_t round = 0; changed && round < OPTIMISER_MAX_ROUNDS; ++round) {
+            changed = false;
+
+            for (size_t i = 0; i < m_passes.size(); ++i) {
+                start = std::chrono::steady_clock::now();
+                bool passChanged = m_passes[i]->run(*graph);
+                m_timings[i].time += std::chrono::steady_clock::now() - start;
+
+                ++m_timings[i].runs;
+                if (passChanged) ++m_timings[i].changes;
+
+                changed = changed || passChanged;
+            }
+        }
+
+        start = std::chrono::steady_clock::now();
+        std::optional<Chunk> optimised = graph->encode();
+        m_graphTiming.time += std::chrono::steady_clock::now() - start;
+
+        if (!optimised) {
+            ++m_skippedCount;
+            return;
+        }
+
+        chunk = std::move(*optimised);
+    }
+
+    std::string PassManager::report() const {
+        std::stringstream s;
+        s << "-- pass timings --\n";
+        s << m_chunkCount << " chunks, " << m_skippedCount << " left unoptimised\n";
+
+        auto line = [&](const std::string &name, const PassTiming &timing) {
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(timing.time).count();
+            s << std::setw(12) << micros << "us  " << std::setw(6) << timing.runs << " runs  " <<
+              std::setw(6) << timing.changes << " changed  " << name << "\n";
+        };
+
+        line("(decode and encode)", m_graphTiming);
+        for (size_t i = 0; i < m_passes.size(); ++i) {
+            line(m_passes[i]->getName(), m_timings[i]);
+        }
+
+        return s.str();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef ENACT_PASSMANAGER_H
+#define ENACT_PASSMANAGER_H
+
+#include <chrono>
+#include <memory>
+
+#include "../context/Options.h"
+#include "Pass.h"
+
+namespace enact {
+    // The most times that the passes are run over a chunk. Each round can open up more for the
+    // next, but they rarely find anything new after a couple.
+    constexpr size_t OPTIMISER_MAX_ROUNDS = 4;
+
+    // Runs the passes for an optimisation level over each chunk that the compiler finishes,
+    // between it and the VM, keeping track of how long each pass takes.
+    class PassManager {
+        struct PassTiming {
+            std::chrono::steady_clock::duration time{};
+            size_t runs = 0;
+            size_t changes = 0;
+        };
+
+        std::vector<std::unique_ptr<Pass>> m_passes{};
+        std::vector<PassTiming> m_timings{};
+
+        // Decoding and encoding the chunks, which isn't part of any pass.
+        PassTiming m_graphTiming{};
+
+        size_t m_chunkCount = 0;
+        size_t m_skippedCount = 0;
+
+        void addPass(std::unique_ptr<Pass> pass);
+
+    public:
+        explicit PassManager(OptimisationLevel level);
+
+        // Leaves the chunk as it was if it can't be decoded into a ControlFlowGraph, or the
+        // optimised code can't be encoded again.
+        void run(Chunk &chunk);
+
+        // Lists the time spent in each pass over every chunk run so far.
+        std::string report() const;
+    };
+}
+
+#endif //ENACT_PASSMANAGER_H
@@ -0,0 +1,66 @@
+#include "PeepholePass.h"
+
+namespace enact {
+    const char *PeepholePass::getName() const {
+        return "peephole";
+    }
+
+    bool PeepholePass::run(ControlFlowGraph &graph) {
+        bool changed = false;
+
+        for (BasicBlock &block : graph.getBlocks()) {
+            std::vector<Instruction> &instructions = block.instructions;
+
+            std::vector<Instruction> result{};
+            result.reserve(instructions.size());
+
+            for (size_t i = 0; i < instructions.size(); ++i) {
+                Instruction &instruction = instructions[i];
+
+                if (instruction.op == OpCode::POP && !result.empty() && isPurePush(result.back().op)) {
+                    result.pop_back();
+                    changed = true;
+                    continue;
+                }
+
+                // SET_LOCAL leaves the value on the stack, so it doesn't have to be read back.
+                bool isSet = instruction.op == OpCode::SET_LOCAL || instruction.op == OpCode::SET_LOCAL_LONG;
+                if (isSet && i + 2 < instructions.size() && instructions[i + 1].op == OpCode::POP) {
+                    const Instruction &get = instructions[i + 2];
+                    bool isGet = get.op == OpCode::GET_LOCAL || get.op == OpCode::GET_LOCAL_LONG;
+
+                    if (isGet && ControlFlowGraph::localSlot(get) == ControlFlowGraph::localSlot(instruction)) {
+                        result.push_back(std::move(instruction));
+                        i += 2;
+                        changed = true;
+                        continue;
+                    }
+                }
+
+                result.push_back(std::move(instruction));
+            }
+
+            instructions = std::move(result);
+        }
+
+        return changed;
+    }
+
+    bool PeepholePass::isPurePush(OpCode op) {
+        switch (op) {
+            case OpCode::CONSTANT:
+            case OpCode::CONSTANT_LONG:
+            case OpCode::TRUE:
+            case OpCode::FALSE:
+            case OpCode::NIL:
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_LOCAL_LONG:
+            case OpCode::GET_UPVALUE:
+            case OpCode::GET_UPVALUE_LONG:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
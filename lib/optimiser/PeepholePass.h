@@ -0,0 +1,24 @@
+#ifndef ENACT_PEEPHOLEPASS_H
+#define ENACT_PEEPHOLEPASS_H
+
+#include "Pass.h"
+
+namespace enact {
+    // Tidies up short sequences within a block:
+    //
+    //   CONSTANT k; POP                  =>  (nothing), and the same for anything else that
+    //                                        only pushes a value
+    //   SET_LOCAL a; POP; GET_LOCAL a    =>  SET_LOCAL a
+    //
+    // Most of what it removes is left behind by the other passes.
+    class PeepholePass : public Pass {
+        static bool isPurePush(OpCode op);
+
+    public:
+        const char *getName() const override;
+
+        bool run(ControlFlowGraph &graph) override;
+    };
+}
+
+#endif //ENACT_PEEPHOLEPASS_H
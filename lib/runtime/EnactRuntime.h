@@ -0,0 +1,68 @@
+#ifndef ENACT_ENACTRUNTIME_H
+#define ENACT_ENACTRUNTIME_H
+
+/*
+ * What the C that --emit-c generates links against. Only boxed values need the runtime: plain
+ * ints, floats and bools are C's own types. This header is C, so that the generated code can
+ * be built with any C99 compiler.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A Value, which is large enough for either layout. Only the runtime looks inside it. */
+typedef struct EnactValue {
+    uint64_t bits[2];
+} EnactValue;
+
+/* The types that a CHECK_TYPE can be translated into a call to enact_check_type() for. */
+typedef enum EnactType {
+    ENACT_TYPE_INT,
+    ENACT_TYPE_FLOAT,
+    ENACT_TYPE_BOOL,
+    ENACT_TYPE_STRING,
+} EnactType;
+
+EnactValue enact_nil(void);
+EnactValue enact_box_int(int32_t value);
+EnactValue enact_box_double(double value);
+EnactValue enact_box_bool(bool value);
+
+/* Strings live for as long as the program does. */
+EnactValue enact_string(const char *chars, size_t length);
+
+/* These don't check the value's type, just like the VM's instructions that they stand in for. */
+int32_t enact_as_int(EnactValue value);
+double enact_as_double(EnactValue value);
+bool enact_as_bool(EnactValue value);
+
+/* Exits with a runtime error unless the value has the type. */
+int32_t enact_check_int(EnactValue value, uint32_t line);
+void enact_check_numeric(EnactValue value, uint32_t line);
+bool enact_check_bool(EnactValue value, uint32_t line);
+void enact_check_type(EnactValue value, EnactType type, uint32_t line);
+
+/* Arithmetic and comparisons on ints and floats, with the same promotions as the VM. */
+EnactValue enact_add(EnactValue left, EnactValue right);
+EnactValue enact_subtract(EnactValue left, EnactValue right);
+EnactValue enact_multiply(EnactValue left, EnactValue right);
+EnactValue enact_divide(EnactValue left, EnactValue right);
+EnactValue enact_negate(EnactValue value);
+bool enact_less(EnactValue left, EnactValue right);
+bool enact_greater(EnactValue left, EnactValue right);
+bool enact_equal(EnactValue left, EnactValue right);
+
+/* The natives. */
+EnactValue enact_print(EnactValue value);
+EnactValue enact_put(EnactValue value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENACT_ENACTRUNTIME_H */
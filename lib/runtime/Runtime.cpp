@@ -0,0 +1,155 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "../value/Object.h"
+#include "../Natives.h"
+#include "EnactRuntime.h"
+
+using namespace enact;
+
+static_assert(sizeof(Value) <= sizeof(EnactValue), "EnactValue must be able to hold a Value.");
+
+static EnactValue wrap(Value value) {
+    EnactValue wrapped{};
+    std::memcpy(&wrapped, &value, sizeof(Value));
+    return wrapped;
+}
+
+static Value unwrap(EnactValue value) {
+    Value unwrapped{};
+    std::memcpy(static_cast<void *>(&unwrapped), &value, sizeof(Value));
+    return unwrapped;
+}
+
+// The generated code has no source to point at, so this is the VM's message without it.
+[[noreturn]] static void runtimeError(uint32_t line, const std::string &msg) {
+    std::cout.flush();
+    std::cerr << "[line " << line << "] Error:\n" << msg << "\n";
+    std::exit(1);
+}
+
+static void expected(const std::string &type, Value value, uint32_t line) {
+    runtimeError(line, "Expected a value of type '" + type + "', but got a value of type '"
+                       + value.getType()->toString() + "' instead.");
+}
+
+template <typename Op>
+static Value numericOp(Value a, Value b, Op op) {
+    if (a.isInt() && b.isInt()) return Value{op(a.asInt(), b.asInt())};
+    if (a.isDouble() && b.isDouble()) return Value{op(a.asDouble(), b.asDouble())};
+    if (a.isInt() && b.isDouble()) return Value{op(a.asInt(), b.asDouble())};
+    return Value{op(a.asDouble(), b.asInt())};
+}
+
+extern "C" {
+    EnactValue enact_nil(void) {
+        return wrap(Value{});
+    }
+
+    EnactValue enact_box_int(int32_t value) {
+        return wrap(Value{static_cast<int>(value)});
+    }
+
+    EnactValue enact_box_double(double value) {
+        return wrap(Value{value});
+    }
+
+    EnactValue enact_box_bool(bool value) {
+        return wrap(Value{value});
+    }
+
+    EnactValue enact_string(const char *chars, size_t length) {
+        return wrap(Value{new StringObject{std::string{chars, length}}});
+    }
+
+    int32_t enact_as_int(EnactValue value) {
+        return unwrap(value).asInt();
+    }
+
+    double enact_as_double(EnactValue value) {
+        return unwrap(value).asDouble();
+    }
+
+    bool enact_as_bool(EnactValue value) {
+        return unwrap(value).asBool();
+    }
+
+    int32_t enact_check_int(EnactValue value, uint32_t line) {
+        Value unwrapped = unwrap(value);
+        if (!unwrapped.isInt()) expected("int", unwrapped, line);
+        return unwrapped.asInt();
+    }
+
+    void enact_check_numeric(EnactValue value, uint32_t line) {
+        Value unwrapped = unwrap(value);
+        if (!unwrapped.isInt() && !unwrapped.isDouble()) expected("int' or 'float", unwrapped, line);
+    }
+
+    bool enact_check_bool(EnactValue value, uint32_t line) {
+        Value unwrapped = unwrap(value);
+        if (!unwrapped.isBool()) expected("bool", unwrapped, line);
+        return unwrapped.asBool();
+    }
+
+    void enact_check_type(EnactValue value, EnactType type, uint32_t line) {
+        Value unwrapped = unwrap(value);
+
+        Type shouldBe;
+        switch (type) {
+            case ENACT_TYPE_INT: shouldBe = INT_TYPE; break;
+            case ENACT_TYPE_FLOAT: shouldBe = FLOAT_TYPE; break;
+            case ENACT_TYPE_BOOL: shouldBe = BOOL_TYPE; break;
+            default: shouldBe = STRING_TYPE; break;
+        }
+
+        if (!shouldBe->looselyEquals(*unwrapped.getType())) {
+            runtimeError(line, "Expected a value of type '" + shouldBe->toString() +
+                               "' but got a value of type '" + unwrapped.getType()->toString() + "' instead.");
+        }
+    }
+
+    EnactValue enact_add(EnactValue left, EnactValue right) {
+        return wrap(numericOp(unwrap(left), unwrap(right), [](auto a, auto b) { return a + b; }));
+    }
+
+    EnactValue enact_subtract(EnactValue left, EnactValue right) {
+        return wrap(numericOp(unwrap(left), unwrap(right), [](auto a, auto b) { return a - b; }));
+    }
+
+    EnactValue enact_multiply(EnactValue left, EnactValue right) {
+        return wrap(numericOp(unwrap(left), unwrap(right), [](auto a, auto b) { return a * b; }));
+    }
+
+    EnactValue enact_divide(EnactValue left, EnactValue right) {
+        return wrap(numericOp(unwrap(left), unwrap(right), [](auto a, auto b) { return a / b; }));
+    }
+
+    EnactValue enact_negate(EnactValue value) {
+        Value unwrapped = unwrap(value);
+        if (unwrapped.isInt()) return wrap(Value{-unwrapped.asInt()});
+        return wrap(Value{-unwrapped.asDouble()});
+    }
+
+    bool enact_less(EnactValue left, EnactValue right) {
+        return numericOp(unwrap(left), unwrap(right), [](auto a, auto b) { return a < b; }).asBool();
+    }
+
+    bool enact_greater(EnactValue left, EnactValue right) {
+        return numericOp(unwrap(left), unwrap(right), [](auto a, auto b) { return a > b; }).asBool();
+    }
+
+    bool enact_equal(EnactValue left, EnactValue right) {
+        return unwrap(left) == unwrap(right);
+    }
+
+    EnactValue enact_print(EnactValue value) {
+        Value argument = unwrap(value);
+        return wrap(Natives::print(1, &argument));
+    }
+
+    EnactValue enact_put(EnactValue value) {
+        Value argument = unwrap(value);
+        return wrap(Natives::put(1, &argument));
+    }
+}
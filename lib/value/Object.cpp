@@ -16,6 +16,9 @@ namespace enact {
     Object::Object(ObjectType type) : m_type{type} {
     }
 
+    Object::Object(const Object &object) : m_type{object.m_type} {
+    }
+
     Object::~Object() {
     }
 
@@ -32,18 +35,6 @@ namespace enact {
         }
     }
 
-    void Object::mark() {
-        m_isMarked = true;
-    }
-
-    void Object::unmark() {
-        m_isMarked = false;
-    }
-
-    bool Object::isMarked() {
-        return m_isMarked;
-    }
-
     std::ostream &operator<<(std::ostream &stream, const Object &object) {
         stream << object.toString();
         return stream;
@@ -70,7 +61,7 @@ namespace enact {
     }
 
     size_t StringObject::size() const {
-        return sizeof(StringObject);
+        return sizeof(StringObject) + heapSizeOf(m_data);
     }
 
     ArrayObject::ArrayObject(Type type) : Object{ObjectType::ARRAY}, m_type{type}, m_vector{} {
@@ -127,7 +118,7 @@ namespace enact {
     }
 
     size_t ArrayObject::size() const {
-        return sizeof(ArrayObject);
+        return sizeof(ArrayObject) + heapSizeOf(m_vector);
     }
 
     UpvalueObject::UpvalueObject(uint32_t location) : Object{ObjectType::UPVALUE}, m_location{location} {
@@ -199,7 +190,7 @@ namespace enact {
     }
 
     size_t ClosureObject::size() const {
-        return sizeof(ClosureObject);
+        return sizeof(ClosureObject) + heapSizeOf(m_upvalues);
     }
 
     StructObject::StructObject(std::shared_ptr<const ConstructorType> constructorType,
@@ -257,7 +248,7 @@ namespace enact {
     }
 
     size_t StructObject::size() const {
-        return sizeof(StructObject);
+        return sizeof(StructObject) + heapSizeOf(m_methods) + heapSizeOf(m_assocs);
     }
 
     InstanceObject::InstanceObject(StructObject *struct_, std::vector<Value> fields) :
@@ -300,7 +291,7 @@ namespace enact {
     }
 
     size_t InstanceObject::size() const {
-        return 0;
+        return sizeof(InstanceObject) + heapSizeOf(m_fields);
     }
 
     FunctionObject::FunctionObject(Type type, Chunk chunk, std::string name) :
@@ -311,6 +302,10 @@ namespace enact {
         return m_chunk;
     }
 
+    std::optional<RegisterChunk> &FunctionObject::getRegisterChunk() {
+        return m_registerChunk;
+    }
+
     const std::string &FunctionObject::getName() const {
         return m_name;
     }
@@ -339,7 +334,10 @@ namespace enact {
     }
 
     size_t FunctionObject::size() const {
-        return sizeof(FunctionObject);
+        // Machine code and the tracing JIT's loop records aren't counted.
+        size_t size = sizeof(FunctionObject) + m_chunk.getHeapSize() + heapSizeOf(m_name);
+        if (m_registerChunk) size += m_registerChunk->getHeapSize();
+        return size;
     }
 
     NativeObject::NativeObject(Type type, NativeFn function) : Object{ObjectType::NATIVE}, m_type{type},
@@ -1,9 +1,14 @@
 #ifndef ENACT_OBJECT_H
 #define ENACT_OBJECT_H
 
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
 
 #include "../bytecode/Chunk.h"
+#include "../bytecode/RegisterChunk.h"
 #include "../type/Type.h"
 
 #include "Value.h"
@@ -44,15 +49,34 @@ namespace enact {
 
     class VM;
 
+    class JitCode;
+
     class Object {
         friend class GC;
 
         ObjectType m_type;
-        bool m_isMarked{false};
+
+        // Atomic so that the GC's marking threads can race to mark the same object.
+        std::atomic<bool> m_isMarked{false};
+
+        // Whether the object has survived a collection and been promoted out of the nursery,
+        // and if so, whether it is in the remembered set for pointing at young objects.
+        bool m_isOld{false};
+        bool m_isRemembered{false};
+
+        // Which of the GC's size classes the object's memory came from.
+        uint8_t m_sizeClass{0};
+
+        // The size() that the GC last counted the object as, which is what it takes back once the
+        // object is freed.
+        size_t m_accountedSize{0};
 
     public:
         explicit Object(ObjectType type);
 
+        // A copy is a new object, so it starts out unmarked and in the nursery.
+        Object(const Object &object);
+
         virtual ~Object();
 
         template<typename T>
@@ -66,11 +90,12 @@ namespace enact {
 
         bool operator==(const Object &object) const;
 
-        virtual void mark();
+        inline bool isMarked() const;
 
-        virtual void unmark();
+        // Returns false if the object was already marked, perhaps by another thread.
+        inline bool tryMark();
 
-        virtual bool isMarked();
+        inline void unmark();
 
         virtual std::string toString() const = 0;
 
@@ -78,11 +103,26 @@ namespace enact {
 
         virtual Object *clone() const = 0;
 
+        // How many bytes the object holds, including the storage of its strings and vectors.
+        // Changes to it are reported with GC::resized().
         virtual size_t size() const = 0;
     };
 
     std::ostream &operator<<(std::ostream &stream, const Object &object);
 
+    inline bool Object::isMarked() const {
+        return m_isMarked.load(std::memory_order_relaxed);
+    }
+
+    inline bool Object::tryMark() {
+        // Checking first saves a contended write for objects that are already marked.
+        return !isMarked() && !m_isMarked.exchange(true, std::memory_order_relaxed);
+    }
+
+    inline void Object::unmark() {
+        m_isMarked.store(false, std::memory_order_relaxed);
+    }
+
     template<typename T>
     inline bool Object::is() const {
         static_assert(std::is_base_of_v<Object, T>,
@@ -167,6 +207,7 @@ namespace enact {
 
         const Value &at(size_t index) const;
 
+        // Grows the array, which must then be reported with GC::resized().
         void append(Value value);
 
         const std::vector<Value> &asVector() const;
@@ -318,12 +359,37 @@ namespace enact {
         size_t size() const override;
     };
 
+    // What the VM keeps for each loop when the tracing JIT is on, keyed by its header's offset.
+    struct LoopTrace {
+        // How many times the loop has gone round since it was last recorded.
+        uint32_t hotness = 0;
+        uint8_t attempts = 0;
+        bool isBlacklisted = false;
+
+        std::shared_ptr<const JitCode> code{};
+    };
+
     class FunctionObject : public Object {
         Type m_type{nullptr};
         Chunk m_chunk{};
         std::string m_name{};
         uint32_t m_upvalueCount = 0;
 
+        // The chunk lowered for the register backend, once RegisterCompiler has managed to.
+        std::optional<RegisterChunk> m_registerChunk{};
+
+        // How many times the function has been called or looped, until it gets compiled by
+        // BaselineJit.
+        uint32_t m_hotness = 0;
+        std::shared_ptr<const JitCode> m_jitCode{};
+
+        // How many times in a row the machine code has bailed out at a guard, and whether it
+        // was thrown away for doing so too often.
+        uint8_t m_jitBailouts = 0;
+        bool m_isJitBlacklisted = false;
+
+        std::unordered_map<size_t, LoopTrace> m_loopTraces{};
+
     public:
         explicit FunctionObject(Type type, Chunk chunk, std::string name);
 
@@ -331,6 +397,19 @@ namespace enact {
 
         Chunk &getChunk();
 
+        std::optional<RegisterChunk> &getRegisterChunk();
+
+        // Inline, since the VM checks these on every call and backedge.
+        inline uint32_t &getHotness();
+
+        inline std::shared_ptr<const JitCode> &getJitCode();
+
+        inline uint8_t &getJitBailouts();
+
+        inline bool &isJitBlacklisted();
+
+        inline std::unordered_map<size_t, LoopTrace> &getLoopTraces();
+
         const std::string &getName() const;
 
         uint32_t &getUpvalueCount();
@@ -344,6 +423,26 @@ namespace enact {
         size_t size() const override;
     };
 
+    inline uint32_t &FunctionObject::getHotness() {
+        return m_hotness;
+    }
+
+    inline std::shared_ptr<const JitCode> &FunctionObject::getJitCode() {
+        return m_jitCode;
+    }
+
+    inline uint8_t &FunctionObject::getJitBailouts() {
+        return m_jitBailouts;
+    }
+
+    inline bool &FunctionObject::isJitBlacklisted() {
+        return m_isJitBlacklisted;
+    }
+
+    inline std::unordered_map<size_t, LoopTrace> &FunctionObject::getLoopTraces() {
+        return m_loopTraces;
+    }
+
     typedef Value (*NativeFn)(uint8_t argCount, Value *args);
 
     class NativeObject : public Object {
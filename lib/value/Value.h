@@ -1,10 +1,14 @@
 #ifndef ENACT_VALUE_H
 #define ENACT_VALUE_H
 
+#include <cmath>
+#include <cstring>
+
 #include "../type/Type.h"
 
 namespace enact {
     class Object;
+    class JitBuilder;
 
     enum class ValueType {
         INT,
@@ -15,6 +19,35 @@ namespace enact {
     };
 
     class Value {
+        // The JITs generate code that works on Values' representation directly.
+        friend class JitBuilder;
+
+#ifdef ENACT_NAN_BOXING
+        // With NaN-boxing, every Value fits in 64 bits. Doubles are stored as themselves, and
+        // everything else is hidden inside the payload of a quiet NaN that no arithmetic
+        // operation will ever produce:
+        //
+        //   double:  any bit pattern that isn't one of the below, with every NaN stored as CANONICAL_NAN
+        //   nil:     0 11111111111 11 00 ... 0001
+        //   false:   0 11111111111 11 00 ... 0010
+        //   true:    0 11111111111 11 00 ... 0011
+        //   int:     0 11111111111 11 01 ... [ 32 bit int ]
+        //   object:  1 11111111111 11 00 ... [ 48 bit pointer ]
+        static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+        static constexpr uint64_t QNAN = 0x7ffc000000000000;
+        static constexpr uint64_t CANONICAL_NAN = 0x7ff8000000000000;
+
+        static constexpr uint64_t TAG_INT = 0x0001000000000000;
+
+        static constexpr uint64_t NIL_BITS = QNAN | 1;
+        static constexpr uint64_t FALSE_BITS = QNAN | 2;
+        static constexpr uint64_t TRUE_BITS = QNAN | 3;
+
+        static constexpr uint64_t INT_MASK = SIGN_BIT | QNAN | TAG_INT;
+        static constexpr uint64_t OBJECT_MASK = SIGN_BIT | QNAN;
+
+        uint64_t m_bits;
+#else
         ValueType m_type;
 
         union {
@@ -23,37 +56,40 @@ namespace enact {
             bool asBool;
             Object *asObject;
         } m_value;
+#endif
+
+        inline ValueType getValueType() const;
 
     public:
-        explicit Value(int value);
+        inline explicit Value(int value);
 
-        explicit Value(double value);
+        inline explicit Value(double value);
 
-        explicit Value(bool value);
+        inline explicit Value(bool value);
 
-        explicit Value(Object *value);
+        inline explicit Value(Object *value);
 
-        explicit Value();
+        inline explicit Value();
 
-        bool is(ValueType type) const;
+        inline bool is(ValueType type) const;
 
-        bool isInt() const;
+        inline bool isInt() const;
 
-        bool isDouble() const;
+        inline bool isDouble() const;
 
-        bool isBool() const;
+        inline bool isBool() const;
 
-        bool isObject() const;
+        inline bool isObject() const;
 
-        bool isNil() const;
+        inline bool isNil() const;
 
-        int asInt() const;
+        inline int asInt() const;
 
-        double asDouble() const;
+        inline double asDouble() const;
 
-        bool asBool() const;
+        inline bool asBool() const;
 
-        Object *asObject() const;
+        inline Object *asObject() const;
 
         bool operator==(const Value &value) const;
 
@@ -63,6 +99,130 @@ namespace enact {
     };
 
     std::ostream &operator<<(std::ostream &stream, const Value &value);
+
+#ifdef ENACT_NAN_BOXING
+    static_assert(sizeof(void *) == 8, "NaN-boxing requires 64 bit pointers.");
+
+    inline Value::Value(int value) : m_bits{QNAN | TAG_INT | static_cast<uint32_t>(value)} {}
+
+    inline Value::Value(double value) : m_bits{CANONICAL_NAN} {
+        // A NaN can carry any payload, including one of the tags above, so they all collapse
+        // into the one quiet NaN that can't be mistaken for anything else.
+        if (!std::isnan(value)) {
+            std::memcpy(&m_bits, &value, sizeof(double));
+        }
+    }
+
+    inline Value::Value(bool value) : m_bits{value ? TRUE_BITS : FALSE_BITS} {}
+
+    inline Value::Value(Object *value) : m_bits{SIGN_BIT | QNAN | reinterpret_cast<uintptr_t>(value)} {}
+
+    inline Value::Value() : m_bits{NIL_BITS} {}
+
+    inline bool Value::isInt() const {
+        return (m_bits & INT_MASK) == (QNAN | TAG_INT);
+    }
+
+    inline bool Value::isDouble() const {
+        return (m_bits & QNAN) != QNAN;
+    }
+
+    inline bool Value::isBool() const {
+        return (m_bits | 1) == TRUE_BITS;
+    }
+
+    inline bool Value::isObject() const {
+        return (m_bits & OBJECT_MASK) == OBJECT_MASK;
+    }
+
+    inline bool Value::isNil() const {
+        return m_bits == NIL_BITS;
+    }
+
+    inline int Value::asInt() const {
+        return static_cast<int>(static_cast<uint32_t>(m_bits));
+    }
+
+    inline double Value::asDouble() const {
+        double value;
+        std::memcpy(&value, &m_bits, sizeof(double));
+        return value;
+    }
+
+    inline bool Value::asBool() const {
+        return m_bits == TRUE_BITS;
+    }
+
+    inline Object *Value::asObject() const {
+        return reinterpret_cast<Object *>(static_cast<uintptr_t>(m_bits & ~OBJECT_MASK));
+    }
+
+    inline ValueType Value::getValueType() const {
+        if (isDouble()) return ValueType::DOUBLE;
+        if (isObject()) return ValueType::OBJECT;
+        if (isInt()) return ValueType::INT;
+        if (isBool()) return ValueType::BOOL;
+        return ValueType::NIL;
+    }
+
+    inline bool Value::is(ValueType type) const {
+        return getValueType() == type;
+    }
+#else
+    inline Value::Value(int value) : m_type{ValueType::INT}, m_value{.asInt = value} {}
+
+    inline Value::Value(double value) : m_type{ValueType::DOUBLE}, m_value{.asDouble = value} {}
+
+    inline Value::Value(bool value) : m_type{ValueType::BOOL}, m_value{.asBool = value} {}
+
+    inline Value::Value(Object *value) : m_type{ValueType::OBJECT}, m_value{.asObject = value} {}
+
+    inline Value::Value() : m_type{ValueType::NIL}, m_value{.asInt = 0} {}
+
+    inline bool Value::is(ValueType type) const {
+        return m_type == type;
+    }
+
+    inline bool Value::isInt() const {
+        return is(ValueType::INT);
+    }
+
+    inline bool Value::isDouble() const {
+        return is(ValueType::DOUBLE);
+    }
+
+    inline bool Value::isBool() const {
+        return is(ValueType::BOOL);
+    }
+
+    inline bool Value::isObject() const {
+        return is(ValueType::OBJECT);
+    }
+
+    inline bool Value::isNil() const {
+        return is(ValueType::NIL);
+    }
+
+    inline int Value::asInt() const {
+        return m_value.asInt;
+    }
+
+    inline double Value::asDouble() const {
+        return m_value.asDouble;
+    }
+
+    inline bool Value::asBool() const {
+        return m_value.asBool;
+    }
+
+    inline Object *Value::asObject() const {
+        return m_value.asObject;
+    }
+
+    inline ValueType Value::getValueType() const {
+        return m_type;
+    }
+#endif
 }
 
 #endif //ENACT_VALUE_H
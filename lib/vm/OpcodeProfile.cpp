@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "OpcodeProfile.h"
+
+namespace enact {
+    void OpcodeProfile::record(OpCode op) {
+        if (m_windowSize == MAX_NGRAM_LENGTH) {
+            std::copy(m_window.begin() + 1, m_window.end(), m_window.begin());
+            --m_windowSize;
+        }
+
+        m_window[m_windowSize++] = op;
+
+        // Count every sequence that ends with this opcode.
+        uint64_t key = static_cast<uint8_t>(op);
+        for (size_t length = 2; length <= m_windowSize; ++length) {
+            uint64_t first = static_cast<uint8_t>(m_window[m_windowSize - length]);
+            key |= first << (8 * (length - 1));
+            ++m_counts[length][key];
+        }
+
+        if (endsSequence(op)) {
+            m_windowSize = 0;
+        }
+    }
+
+    std::string OpcodeProfile::report(size_t limit) const {
+        std::stringstream s;
+        s << "-- opcode profile --\n";
+
+        for (size_t length = 2; length <= MAX_NGRAM_LENGTH; ++length) {
+            std::vector<std::pair<uint64_t, size_t>> sequences{m_counts[length].begin(), m_counts[length].end()};
+            std::sort(sequences.begin(), sequences.end(), [](const auto &a, const auto &b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+
+            s << length << " opcodes:\n";
+
+            for (size_t i = 0; i < std::min(limit, sequences.size()); ++i) {
+                const auto &[key, count] = sequences[i];
+                s << std::setw(14) << count << "  ";
+
+                for (size_t j = length; j-- > 0;) {
+                    s << opCodeToString(static_cast<OpCode>((key >> (8 * j)) & 0xff));
+                    if (j > 0) s << ", ";
+                }
+
+                s << "\n";
+            }
+        }
+
+        return s.str();
+    }
+
+    bool OpcodeProfile::endsSequence(OpCode op) {
+        switch (op) {
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_TRUE:
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::LOOP:
+            case OpCode::LESS_INT_LOCAL_CONST_JUMP:
+            case OpCode::CALL_FUNCTION:
+            case OpCode::CALL_BOUND_METHOD:
+            case OpCode::CALL_CONSTRUCTOR:
+            case OpCode::CALL_NATIVE:
+            case OpCode::CALL_DYNAMIC:
+            case OpCode::INVOKE:
+            case OpCode::INVOKE_LONG:
+            case OpCode::INVOKE_DYNAMIC:
+            case OpCode::INVOKE_DYNAMIC_LONG:
+            case OpCode::RETURN:
+            case OpCode::PAUSE:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
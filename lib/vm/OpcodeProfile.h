@@ -0,0 +1,33 @@
+#ifndef ENACT_OPCODEPROFILE_H
+#define ENACT_OPCODEPROFILE_H
+
+#include <array>
+#include <unordered_map>
+
+#include "../bytecode/Chunk.h"
+
+namespace enact {
+    // The longest opcode sequence that OpcodeProfile counts.
+    constexpr size_t MAX_NGRAM_LENGTH = 5;
+
+    // Counts how often each sequence of opcodes runs back to back, to find candidates for
+    // new superinstructions. Only straight-line code can be fused, so sequences are cut
+    // short after every branch, call and return.
+    class OpcodeProfile {
+        std::array<OpCode, MAX_NGRAM_LENGTH> m_window{};
+        size_t m_windowSize = 0;
+
+        // Indexed by sequence length, and keyed on its opcodes packed one per byte.
+        std::array<std::unordered_map<uint64_t, size_t>, MAX_NGRAM_LENGTH + 1> m_counts{};
+
+        static bool endsSequence(OpCode op);
+
+    public:
+        void record(OpCode op);
+
+        // Lists the most frequent sequences of each length.
+        std::string report(size_t limit = 10) const;
+    };
+}
+
+#endif //ENACT_OPCODEPROFILE_H
@@ -0,0 +1,109 @@
+#include <fstream>
+#include <sstream>
+
+#include "../analyser/Analyser.h"
+#include "../bytecode/BytecodeCache.h"
+#include "../compiler/Compiler.h"
+#include "../memory/SnapshotReader.h"
+#include "../memory/SnapshotWriter.h"
+
+#include "ScriptRunner.h"
+
+namespace enact {
+    ScriptRunner::ScriptRunner(CompileContext &context) :
+            m_context{context},
+            m_gc{context},
+            m_vm{context} {
+    }
+
+    CompileResult ScriptRunner::runFile(const std::string &path, bool useCache) {
+        std::optional<std::string> source = readFile(path);
+        if (!source) return CompileResult::COMPILE_ERROR;
+
+        FunctionObject *script = useCache ? BytecodeCache::load(path, *source, m_gc) : nullptr;
+        if (!script) {
+            CompileResult result = CompileResult::OK;
+            script = compile({*source}, result);
+            if (!script) return result;
+
+            // Before the VM has run it, since it rewrites instructions in place. A cache that
+            // can't be written only means compiling again next time.
+            if (useCache) BytecodeCache::store(path, *source, script);
+        }
+
+        return m_vm.run(script);
+    }
+
+    CompileResult ScriptRunner::runWithSetup(const std::string &setupPath, const std::string &path,
+                                             const std::string &snapshotPath) {
+        std::optional<std::string> setup = readFile(setupPath);
+        std::optional<std::string> source = readFile(path);
+        if (!setup || !source) return CompileResult::COMPILE_ERROR;
+
+        // The snapshot holds the code of both parts, so a change to either makes it stale.
+        uint64_t hash = BytecodeCache::hashSource(*setup + '\0' + *source);
+
+        FunctionObject *script = snapshotPath.empty() ? nullptr : SnapshotReader::load(snapshotPath, hash, m_vm, m_gc);
+        if (!script) {
+            CompileResult result = CompileResult::OK;
+            script = compile({*setup, *source}, result);
+            if (!script) return result;
+
+            // Runs up to the pause at the end of the setup.
+            result = m_vm.run(script);
+            if (result != CompileResult::OK) return result;
+
+            // A snapshot that can't be written only means running the setup again next time.
+            if (!snapshotPath.empty()) SnapshotWriter::save(snapshotPath, m_vm, m_gc, hash);
+        }
+
+        // The script pauses at the end of its own part too, before the script itself returns.
+        CompileResult result = m_vm.run(script);
+        if (result != CompileResult::OK) return result;
+
+        return m_vm.run(script);
+    }
+
+    std::optional<std::string> ScriptRunner::readFile(const std::string &path) {
+        std::ifstream file{path};
+        if (!file) {
+            std::cerr << "[enact] Error:\n    Unable to read file '" << path << "'.\n";
+            return std::nullopt;
+        }
+
+        std::stringstream source{};
+        source << file.rdbuf();
+        return source.str();
+    }
+
+    FunctionObject *ScriptRunner::compile(std::vector<std::string> parts, CompileResult &result) {
+        Analyser analyser{m_context};
+        Compiler compiler{m_context};
+
+        bool isSplit = parts.size() > 1;
+        if (isSplit) compiler.startRepl();
+
+        FunctionObject *script = nullptr;
+        for (std::string &part : parts) {
+            std::vector<std::unique_ptr<Stmt>> ast = m_context.parse(std::move(part));
+            if (m_context.getParser().hadError()) {
+                result = CompileResult::PARSE_ERROR;
+                return nullptr;
+            }
+
+            ast = analyser.analyse(std::move(ast));
+            if (analyser.hadError()) {
+                result = CompileResult::ANALYSIS_ERROR;
+                return nullptr;
+            }
+
+            script = isSplit ? compiler.compilePart(std::move(ast)) : compiler.compileProgram(std::move(ast));
+            if (compiler.hadError()) {
+                result = CompileResult::COMPILE_ERROR;
+                return nullptr;
+            }
+        }
+
+        return isSplit ? compiler.endRepl() : script;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef ENACT_SCRIPTRUNNER_H
+#define ENACT_SCRIPTRUNNER_H
+
+#include <optional>
+
+#include "../context/CompileContext.h"
+#include "../memory/GC.h"
+
+#include "VM.h"
+
+namespace enact {
+    // Takes a script file through the front end and into the VM, as opposed to the REPL, which
+    // compiles a line at a time.
+    class ScriptRunner {
+        CompileContext &m_context;
+
+        GC m_gc;
+        VM m_vm;
+
+        // Returns nothing if the file couldn't be read, which will already have been reported.
+        static std::optional<std::string> readFile(const std::string &path);
+
+        // Parses, analyses and compiles each source as a part of one script, which pauses at the
+        // end of every part when there is more than one. Returns nullptr and sets result if there
+        // were errors, which will already have been reported.
+        FunctionObject *compile(std::vector<std::string> parts, CompileResult &result);
+
+    public:
+        explicit ScriptRunner(CompileContext &context);
+
+        // Runs the script at path. With useCache, a cache compiled from the same source is run
+        // instead of compiling it again, and otherwise the script is cached once it has been
+        // compiled.
+        CompileResult runFile(const std::string &path, bool useCache = false);
+
+        // Runs the setup script and then the one at path, as the two parts of a single script, so
+        // that the script can use whatever the setup declared. Given a snapshotPath, the VM is
+        // saved there once the setup has run, and later runs restore it instead of running the
+        // setup again, for as long as neither source changes.
+        CompileResult runWithSetup(const std::string &setupPath, const std::string &path,
+                                   const std::string &snapshotPath = "");
+    };
+}
+
+#endif //ENACT_SCRIPTRUNNER_H
@@ -1,24 +1,108 @@
+#include <algorithm>
 #include <sstream>
 
+#include "../bytecode/BytecodeReader.h"
+#include "../compiler/CCompiler.h"
+#include "../compiler/RegisterCompiler.h"
 #include "../context/CompileContext.h"
 
 #include "VM.h"
 
+// Threaded dispatch relies on the "labels as values" extension, which only GCC and Clang provide.
+// Everywhere else we fall back to the portable switch.
+#if defined(ENACT_THREADED_DISPATCH) && !defined(__GNUC__)
+#undef ENACT_THREADED_DISPATCH
+#endif
+
 namespace enact {
-    VM::VM(Context &context) : m_context{context} {
+    VM::VM(Context &context) :
+            m_context{context},
+            m_stack(m_context.options.getStackSize()),
+            m_stackTop{m_stack.data()},
+            m_frames(std::min(INITIAL_FRAMES, m_context.options.getMaxFrames()), CallFrame{nullptr, nullptr, nullptr, nullptr}),
+            m_maxFrames{m_context.options.getMaxFrames()} {
     }
 
     InterpretResult VM::run(FunctionObject *function) {
+        // A runtime error can leave a recording behind.
+        m_recorder.stop();
+
+        // A script mapped from a bytecode cache has its constants read as its functions are
+        // called, apart from by the backends that compile the whole program up front.
+        if (function->getChunk().hasPendingConstants()) {
+            m_context.gc.pushRoot(function);
+            try {
+                if (m_context.options.flagEnabled(Flag::EMIT_C) ||
+                        m_context.options.getBackend() == Backend::REGISTER) {
+                    BytecodeReader::loadAllConstants(function, m_context.gc);
+                } else {
+                    BytecodeReader::loadConstants(function, m_context.gc);
+                }
+            } catch (const BytecodeReader::Invalid &error) {
+                m_context.gc.popRoots(1);
+                std::cerr << error.what() << "\n";
+                return InterpretResult::RUNTIME_ERROR;
+            }
+            m_context.gc.popRoots(1);
+        }
+
+        if (m_context.options.flagEnabled(Flag::EMIT_C)) {
+            try {
+                std::cout << CCompiler::compile(function);
+                return InterpretResult::OK;
+            } catch (const CCompiler::Unsupported &error) {
+                std::cerr << error.what() << "\n";
+                return InterpretResult::COMPILE_ERROR;
+            }
+        }
+
         try {
-            executionLoop(function);
+            // Choose the specialisation once, so that the release loop never has to ask
+            // about tracing or profiling again.
+            m_isTracing = m_context.options.flagEnabled(Flag::DEBUG_TRACE_EXECUTION);
+            m_isProfiling = m_context.options.flagEnabled(Flag::PROFILE_OPCODES);
+
+            // Programs that use anything the register backend can't run yet stay on the stack.
+            m_isRegisterMode = m_context.options.getBackend() == Backend::REGISTER &&
+                               m_pc == 0 &&
+                               RegisterCompiler::compile(function, m_context.gc);
+
+#ifdef ENACT_HAS_JIT
+            bool canJit = !m_isTracing && !m_isProfiling && !m_isRegisterMode &&
+                          !m_context.options.flagEnabled(Flag::DISABLE_JIT);
+            m_isTraceJitEnabled = canJit && m_context.options.flagEnabled(Flag::TRACING_JIT);
+            m_isJitEnabled = canJit && !m_isTraceJitEnabled;
+            m_jitThreshold = static_cast<uint32_t>(std::min<size_t>(m_context.options.getJitThreshold(), UINT32_MAX));
+#endif
+
+            if (m_isRegisterMode) {
+                if (m_context.options.flagEnabled(Flag::DEBUG_DISASSEMBLE_CHUNK)) {
+                    std::cout << function->getRegisterChunk()->disassemble(function->getChunk().getConstants());
+                }
+
+                if (m_isTracing) {
+                    registerLoop<true>(function);
+                } else {
+                    registerLoop<false>(function);
+                }
+            } else {
+                enterScript(function);
+
+                bool isTraced = m_isTracing || m_isProfiling;
+                while (!(isTraced ? executionLoop<true>() : executionLoop<false>())) {
+                    isTraced = !isTraced;
+                }
+            }
         } catch (const RuntimeError &error) {
+            if (m_isProfiling) std::cout << m_profile.report();
             return InterpretResult::RUNTIME_ERROR;
         }
 
+        if (m_isProfiling) std::cout << m_profile.report();
         return InterpretResult::OK;
     }
 
-    void VM::executionLoop(FunctionObject *function) {
+    void VM::enterScript(FunctionObject *function) {
         push(Value{function});
 
         m_frame = &m_frames[m_frameCount++];
@@ -30,9 +114,12 @@ namespace enact {
             m_stack[0] = Value{m_frame->closure};
         }
         m_frame->ip = function->getChunk().getCode().data() + m_pc;
-        m_frame->slotsBegin = 0;
+        m_frame->constants = function->getChunk().getConstants().data();
+        m_frame->slots = m_stack.data();
+    }
 
-        for (;;) {
+    template<bool shouldTrace>
+    bool VM::executionLoop() {
 #define NUMERIC_OP(op) \
             do { \
                 Value b = pop(); \
@@ -48,85 +135,223 @@ namespace enact {
                 } \
             } while (false)
 
-            if (m_context.options.flagEnabled(Flag::DEBUG_TRACE_EXECUTION)) {
-                std::cout << "    ";
-                for (Value value : m_stack) {
-                    std::cout << "[ " << value << " ] ";
-                }
-                std::cout << "\n";
+// Operations on two ints or two doubles, which the compiler has already proven.
+#define INT_OP(op) \
+            do { \
+                int b = pop().asInt(); \
+                int a = pop().asInt(); \
+                push(Value{a op b}); \
+            } while (false)
 
-                std::cout << m_frame->closure->getFunction()->getChunk()
-                        .disassembleInstruction(
-                                m_frame->ip - m_frame->closure->getFunction()->getChunk().getCode().data()).first;
-            }
+#define FLOAT_OP(op) \
+            do { \
+                double b = pop().asDouble(); \
+                double a = pop().asDouble(); \
+                push(Value{a op b}); \
+            } while (false)
+
+// A CHECK_TYPE(_LONG) that has been quickened to test a single tag. Any other
+// value sends it back to the full check, which will run next.
+#define QUICK_TYPE_CHECK(isType, generic, operandSize) \
+            do { \
+                if (peek(0).isType()) { \
+                    m_frame->ip += (operandSize); \
+                } else { \
+                    deoptimise(OpCode::generic); \
+                } \
+            } while (false)
+
+// Once a trace has finished recording, the loop without tracing takes over again.
+#define VM_BEGIN_INSTRUCTION() \
+            do { \
+                if constexpr (shouldTrace) { \
+                    traceExecution(); \
+                    if (m_isTraceJitEnabled && !m_recorder.isRecording()) return false; \
+                } \
+            } while (false)
+
+#ifdef ENACT_THREADED_DISPATCH
+        // One label per opcode, in exactly the same order as they are declared in OpCode.
+        static void *dispatchTable[] = {
+                &&op_CONSTANT,
+                &&op_CONSTANT_LONG,
+                &&op_TRUE,
+                &&op_FALSE,
+                &&op_NIL,
+                &&op_CHECK_INT,
+                &&op_CHECK_NUMERIC,
+                &&op_CHECK_BOOL,
+                &&op_CHECK_REFERENCE,
+                &&op_CHECK_INDEXABLE,
+                &&op_CHECK_ALLOTABLE,
+                &&op_CHECK_TYPE,
+                &&op_CHECK_TYPE_LONG,
+                &&op_CHECK_TYPE_INT,
+                &&op_CHECK_TYPE_INT_LONG,
+                &&op_CHECK_TYPE_FLOAT,
+                &&op_CHECK_TYPE_FLOAT_LONG,
+                &&op_CHECK_TYPE_BOOL,
+                &&op_CHECK_TYPE_BOOL_LONG,
+                &&op_NEGATE,
+                &&op_NOT,
+                &&op_COPY,
+                &&op_ADD,
+                &&op_SUBTRACT,
+                &&op_MULTIPLY,
+                &&op_DIVIDE,
+                &&op_ADD_INT,
+                &&op_SUBTRACT_INT,
+                &&op_MULTIPLY_INT,
+                &&op_DIVIDE_INT,
+                &&op_ADD_FLOAT,
+                &&op_SUBTRACT_FLOAT,
+                &&op_MULTIPLY_FLOAT,
+                &&op_DIVIDE_FLOAT,
+                &&op_LESS,
+                &&op_GREATER,
+                &&op_EQUAL,
+                &&op_LESS_INT,
+                &&op_GREATER_INT,
+                &&op_LESS_FLOAT,
+                &&op_GREATER_FLOAT,
+                &&op_ARRAY,
+                &&op_ARRAY_LONG,
+                &&op_GET_ARRAY_INDEX,
+                &&op_SET_ARRAY_INDEX,
+                &&op_POP,
+                &&op_GET_LOCAL,
+                &&op_GET_LOCAL_LONG,
+                &&op_SET_LOCAL,
+                &&op_SET_LOCAL_LONG,
+                &&op_GET_UPVALUE,
+                &&op_GET_UPVALUE_LONG,
+                &&op_SET_UPVALUE,
+                &&op_SET_UPVALUE_LONG,
+                &&op_GET_FIELD,
+                &&op_GET_FIELD_LONG,
+                &&op_SET_FIELD,
+                &&op_SET_FIELD_LONG,
+                &&op_GET_METHOD,
+                &&op_GET_METHOD_LONG,
+                &&op_GET_ASSOC,
+                &&op_GET_ASSOC_LONG,
+                &&op_GET_PROPERTY_DYNAMIC,
+                &&op_GET_PROPERTY_DYNAMIC_LONG,
+                &&op_SET_PROPERTY_DYNAMIC,
+                &&op_SET_PROPERTY_DYNAMIC_LONG,
+                &&op_JUMP,
+                &&op_JUMP_IF_TRUE,
+                &&op_JUMP_IF_FALSE,
+                &&op_LOOP,
+                &&op_CALL_FUNCTION,
+                &&op_CALL_BOUND_METHOD,
+                &&op_CALL_CONSTRUCTOR,
+                &&op_CALL_NATIVE,
+                &&op_CALL_DYNAMIC,
+                &&op_INVOKE,
+                &&op_INVOKE_LONG,
+                &&op_INVOKE_DYNAMIC,
+                &&op_INVOKE_DYNAMIC_LONG,
+                &&op_CLOSURE,
+                &&op_CLOSURE_LONG,
+                &&op_CLOSE_UPVALUE,
+                &&op_RETURN,
+                &&op_STRUCT,
+                &&op_STRUCT_LONG,
+                &&op_GET_LOCAL_GET_LOCAL,
+                &&op_LESS_INT_LOCAL_CONST_JUMP,
+                &&op_ADD_INT_LOCAL_CONST_SET,
+                &&op_PAUSE,
+        };
+        static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == static_cast<size_t>(OpCode::PAUSE) + 1,
+                      "The VM dispatch table must have an entry for every OpCode.");
+
+        // Every handler ends by decoding and jumping straight to the next one, so each
+        // opcode gets its own indirect branch for the CPU to predict.
+#define VM_CASE(name) op_##name
+#define VM_NEXT() \
+            do { \
+                VM_BEGIN_INSTRUCTION(); \
+                goto *dispatchTable[readByte()]; \
+            } while (false)
+
+        VM_NEXT();
+#else
+#define VM_CASE(name) case OpCode::name
+#define VM_NEXT() break
 
-            Value *slots = &m_stack[m_frame->slotsBegin];
+        for (;;) {
+            VM_BEGIN_INSTRUCTION();
 
             switch (static_cast<OpCode>(readByte())) {
-                case OpCode::CONSTANT: {
+#endif
+                VM_CASE(CONSTANT): {
                     Value constant = readConstant();
                     push(constant);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::CONSTANT_LONG: {
+                VM_CASE(CONSTANT_LONG): {
                     Value constant = readConstantLong();
                     push(constant);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::TRUE:
+                VM_CASE(TRUE):
                     push(Value{true});
-                    break;
-                case OpCode::FALSE:
+                    VM_NEXT();
+                VM_CASE(FALSE):
                     push(Value{false});
-                    break;
-                case OpCode::NIL:
+                    VM_NEXT();
+                VM_CASE(NIL):
                     push(Value{});
-                    break;
+                    VM_NEXT();
 
-                case OpCode::CHECK_INT: {
+                VM_CASE(CHECK_INT): {
                     Value value = peek(0);
-                    if (!value.getType()->isInt()) {
+                    if (!value.isInt() && !value.getType()->isInt()) {
                         throw runtimeError("Expected a value of type 'int', but got a value of type '"
                                            + value.getType()->toString() + "' instead.");
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_NUMERIC: {
+                VM_CASE(CHECK_NUMERIC): {
                     Value value = peek(0);
-                    if (!value.getType()->isNumeric()) {
+                    if (!value.isInt() && !value.isDouble() && !value.getType()->isNumeric()) {
                         throw runtimeError("Expected a value of type 'int' or 'float', but got a value of type '"
                                            + value.getType()->toString() + "' instead.");
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_BOOL: {
+                VM_CASE(CHECK_BOOL): {
                     Value value = peek(0);
-                    if (!value.getType()->isBool()) {
+                    if (!value.isBool() && !value.getType()->isBool()) {
                         throw runtimeError("Expected a value of type 'bool', but got a value of type '"
                                            + value.getType()->toString() + "' instead.");
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_REFERENCE: {
+                VM_CASE(CHECK_REFERENCE): {
                     Value value = peek(0);
-                    if (value.getType()->isPrimitive()) {
+                    // Strings are the only objects with a primitive type.
+                    bool isReference = value.isObject() && !value.asObject()->is<StringObject>();
+                    if (!isReference && value.getType()->isPrimitive()) {
                         throw runtimeError("Only reference types can be copied, not a value of type '"
                                            + value.getType()->toString() + "'.");
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_INDEXABLE: {
+                VM_CASE(CHECK_INDEXABLE): {
                     Value array = peek(0);
-                    if (!array.getType()->isArray()) {
+                    bool isArray = array.isObject() && array.asObject()->is<ArrayObject>();
+                    if (!isArray && !array.getType()->isArray()) {
                         throw runtimeError(
                                 "Expected an array, but got a value of type '" + array.getType()->toString() +
                                 "' instead.");
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_ALLOTABLE: {
+                VM_CASE(CHECK_ALLOTABLE): {
                     Type shouldBe = peek(0).getType()->as<ArrayType>()->getElementType();
                     Type valueType = peek(1).getType();
 
@@ -135,72 +360,121 @@ namespace enact {
                                            "' to assign in array, but got a value of type '" + valueType->toString() +
                                            "' instead.");
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_TYPE: {
-                    Type shouldBe = readConstant().asObject()->getType();
-                    Value value = peek(0);
-                    if (!shouldBe->looselyEquals(*value.getType())) {
-                        throw runtimeError("Expected a value of type '" + shouldBe->toString() +
-                                           "' but got a value of type '" + value.getType()->toString() + "' instead.");
-                    }
-                    break;
+                VM_CASE(CHECK_TYPE): {
+                    Type shouldBe = readConstant().asObject()->as<TypeObject>()->getContainedType();
+                    checkType(shouldBe, false);
+                    VM_NEXT();
                 }
-                case OpCode::CHECK_TYPE_LONG: {
-                    Type shouldBe = readConstantLong().asObject()->getType();
-                    Value value = peek(0);
-                    if (!shouldBe->looselyEquals(*value.getType())) {
-                        throw runtimeError("Expected a value of type '" + shouldBe->toString() +
-                                           "' but got a value of type '" + value.getType()->toString() + "' instead.");
-                    }
-                    break;
+                VM_CASE(CHECK_TYPE_LONG): {
+                    Type shouldBe = readConstantLong().asObject()->as<TypeObject>()->getContainedType();
+                    checkType(shouldBe, true);
+                    VM_NEXT();
                 }
 
-                case OpCode::NEGATE: {
+                VM_CASE(CHECK_TYPE_INT):
+                    QUICK_TYPE_CHECK(isInt, CHECK_TYPE, 1);
+                    VM_NEXT();
+                VM_CASE(CHECK_TYPE_INT_LONG):
+                    QUICK_TYPE_CHECK(isInt, CHECK_TYPE_LONG, 3);
+                    VM_NEXT();
+                VM_CASE(CHECK_TYPE_FLOAT):
+                    QUICK_TYPE_CHECK(isDouble, CHECK_TYPE, 1);
+                    VM_NEXT();
+                VM_CASE(CHECK_TYPE_FLOAT_LONG):
+                    QUICK_TYPE_CHECK(isDouble, CHECK_TYPE_LONG, 3);
+                    VM_NEXT();
+                VM_CASE(CHECK_TYPE_BOOL):
+                    QUICK_TYPE_CHECK(isBool, CHECK_TYPE, 1);
+                    VM_NEXT();
+                VM_CASE(CHECK_TYPE_BOOL_LONG):
+                    QUICK_TYPE_CHECK(isBool, CHECK_TYPE_LONG, 3);
+                    VM_NEXT();
+
+                VM_CASE(NEGATE): {
                     Value value = pop();
                     if (value.isInt()) {
                         push(Value{-value.asInt()});
                     } else {
                         push(Value{-value.asDouble()});
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::NOT:
+                VM_CASE(NOT):
                     push(Value{!pop().asBool()});
-                    break;
+                    VM_NEXT();
 
-                case OpCode::COPY:
+                VM_CASE(COPY):
                     push(Value{pop().asObject()->clone()});
-                    break;
+                    VM_NEXT();
 
-                case OpCode::ADD:
+                VM_CASE(ADD):
                     NUMERIC_OP(+);
-                    break;
-                case OpCode::SUBTRACT:
+                    VM_NEXT();
+                VM_CASE(SUBTRACT):
                     NUMERIC_OP(-);
-                    break;
-                case OpCode::MULTIPLY:
+                    VM_NEXT();
+                VM_CASE(MULTIPLY):
                     NUMERIC_OP(*);
-                    break;
-                case OpCode::DIVIDE:
+                    VM_NEXT();
+                VM_CASE(DIVIDE):
                     NUMERIC_OP(/);
-                    break;
-
-                case OpCode::LESS:
+                    VM_NEXT();
+
+                VM_CASE(ADD_INT):
+                    INT_OP(+);
+                    VM_NEXT();
+                VM_CASE(SUBTRACT_INT):
+                    INT_OP(-);
+                    VM_NEXT();
+                VM_CASE(MULTIPLY_INT):
+                    INT_OP(*);
+                    VM_NEXT();
+                VM_CASE(DIVIDE_INT):
+                    INT_OP(/);
+                    VM_NEXT();
+                VM_CASE(ADD_FLOAT):
+                    FLOAT_OP(+);
+                    VM_NEXT();
+                VM_CASE(SUBTRACT_FLOAT):
+                    FLOAT_OP(-);
+                    VM_NEXT();
+                VM_CASE(MULTIPLY_FLOAT):
+                    FLOAT_OP(*);
+                    VM_NEXT();
+                VM_CASE(DIVIDE_FLOAT):
+                    FLOAT_OP(/);
+                    VM_NEXT();
+
+                VM_CASE(LESS):
                     NUMERIC_OP(<);
-                    break;
-                case OpCode::GREATER:
+                    VM_NEXT();
+                VM_CASE(GREATER):
                     NUMERIC_OP(>);
-                    break;
-                case OpCode::EQUAL: {
+                    VM_NEXT();
+                VM_CASE(EQUAL): {
                     Value b = pop();
                     Value a = pop();
                     push(Value{a == b});
-                    break;
+                    VM_NEXT();
                 }
 
-
-                case OpCode::ARRAY: {
+                VM_CASE(LESS_INT):
+                    INT_OP(<);
+                    VM_NEXT();
+                VM_CASE(GREATER_INT):
+                    INT_OP(>);
+                    VM_NEXT();
+                VM_CASE(LESS_FLOAT):
+                    FLOAT_OP(<);
+                    VM_NEXT();
+                VM_CASE(GREATER_FLOAT):
+                    FLOAT_OP(>);
+                    VM_NEXT();
+
+
+                VM_CASE(ARRAY): {
                     uint8_t length = readByte();
                     Type type = readConstant().asObject()->as<TypeObject>()->getContainedType();
                     auto *array = m_context.gc.allocateObject<ArrayObject>(length, type);
@@ -210,9 +484,9 @@ namespace enact {
                         }
                     }
                     push(Value{array});
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::ARRAY_LONG: {
+                VM_CASE(ARRAY_LONG): {
                     uint32_t length = readLong();
                     Type type = readConstantLong().asObject()->as<TypeObject>()->getContainedType();
                     auto *array = m_context.gc.allocateObject<ArrayObject>(length, type);
@@ -222,10 +496,10 @@ namespace enact {
                         }
                     }
                     push(Value{array});
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::GET_ARRAY_INDEX: {
+                VM_CASE(GET_ARRAY_INDEX): {
                     int index = pop().asInt();
                     ArrayObject *array = pop().asObject()->as<ArrayObject>();
 
@@ -235,9 +509,9 @@ namespace enact {
                     }
 
                     push(array->at(index));
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::SET_ARRAY_INDEX: {
+                VM_CASE(SET_ARRAY_INDEX): {
                     int index = pop().asInt();
                     ArrayObject *array = pop().asObject()->as<ArrayObject>();
                     Value newValue = peek(0);
@@ -248,56 +522,57 @@ namespace enact {
                     }
 
                     array->at(index) = newValue;
-                    break;
+                    m_context.gc.writeBarrier(array, newValue);
+                    VM_NEXT();
                 }
 
-                case OpCode::POP:
+                VM_CASE(POP):
                     pop();
-                    break;
-
-                case OpCode::GET_LOCAL:
-                    push(slots[readByte()]);
-                    break;
-                case OpCode::GET_LOCAL_LONG:
-                    push(slots[readLong()]);
-                    break;
-
-                case OpCode::SET_LOCAL:
-                    slots[readByte()] = peek(0);
-                    break;
-                case OpCode::SET_LOCAL_LONG:
-                    slots[readLong()] = peek(0);
-                    break;
-
-                case OpCode::GET_UPVALUE: {
+                    VM_NEXT();
+
+                VM_CASE(GET_LOCAL):
+                    push(m_frame->slots[readByte()]);
+                    VM_NEXT();
+                VM_CASE(GET_LOCAL_LONG):
+                    push(m_frame->slots[readLong()]);
+                    VM_NEXT();
+
+                VM_CASE(SET_LOCAL):
+                    m_frame->slots[readByte()] = peek(0);
+                    VM_NEXT();
+                VM_CASE(SET_LOCAL_LONG):
+                    m_frame->slots[readLong()] = peek(0);
+                    VM_NEXT();
+
+                VM_CASE(GET_UPVALUE): {
                     uint8_t slot = readByte();
                     UpvalueObject *upvalue = m_frame->closure->getUpvalues()[slot];
                     push(upvalue->isClosed() ?
                          upvalue->getClosed() :
                          m_stack[upvalue->getLocation()]);
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::GET_UPVALUE_LONG: {
+                VM_CASE(GET_UPVALUE_LONG): {
                     uint8_t slot = readByte();
                     UpvalueObject *upvalue = m_frame->closure->getUpvalues()[slot];
                     push(upvalue->isClosed() ?
                          upvalue->getClosed() :
                          m_stack[upvalue->getLocation()]);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::SET_UPVALUE: {
+                VM_CASE(SET_UPVALUE): {
                     uint8_t slot = readByte();
-                    m_stack[m_frame->closure->getUpvalues()[slot]->getLocation()] = peek(0);
-                    break;
+                    setUpvalue(m_frame->closure->getUpvalues()[slot], peek(0));
+                    VM_NEXT();
                 }
-                case OpCode::SET_UPVALUE_LONG: {
+                VM_CASE(SET_UPVALUE_LONG): {
                     uint32_t slot = readLong();
-                    m_stack[m_frame->closure->getUpvalues()[slot]->getLocation()] = peek(0);
-                    break;
+                    setUpvalue(m_frame->closure->getUpvalues()[slot], peek(0));
+                    VM_NEXT();
                 }
 
-                case OpCode::GET_FIELD: {
+                VM_CASE(GET_FIELD): {
                     auto *instance = pop()
                             .asObject()
                             ->as<InstanceObject>();
@@ -305,9 +580,9 @@ namespace enact {
                     uint8_t index = readByte();
                     push(instance->field(index));
 
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::GET_FIELD_LONG: {
+                VM_CASE(GET_FIELD_LONG): {
                     auto *instance = pop()
                             .asObject()
                             ->as<InstanceObject>();
@@ -315,30 +590,32 @@ namespace enact {
                     uint32_t index = readLong();
                     push(instance->field(index));
 
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::SET_FIELD: {
+                VM_CASE(SET_FIELD): {
                     auto *instance = pop()
                             .asObject()
                             ->as<InstanceObject>();
 
                     uint8_t index = readByte();
                     instance->field(index) = peek(0);
+                    m_context.gc.writeBarrier(instance, peek(0));
 
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::SET_FIELD_LONG: {
+                VM_CASE(SET_FIELD_LONG): {
                     auto *instance = pop()
                             .asObject()
                             ->as<InstanceObject>();
 
                     uint32_t index = readLong();
                     instance->field(index) = peek(0);
+                    m_context.gc.writeBarrier(instance, peek(0));
 
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::GET_METHOD: {
+                VM_CASE(GET_METHOD): {
                     auto *instance = peek(0)
                             .asObject()
                             ->as<InstanceObject>();
@@ -351,9 +628,9 @@ namespace enact {
                     auto *bound = m_context.gc.allocateObject<BoundMethodObject>(Value{instance}, method);
                     pop(); // Pop the instance
                     push(Value{bound});
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::GET_METHOD_LONG: {
+                VM_CASE(GET_METHOD_LONG): {
                     auto *instance = peek(0)
                             .asObject()
                             ->as<InstanceObject>();
@@ -366,10 +643,10 @@ namespace enact {
                     auto *bound = m_context.gc.allocateObject<BoundMethodObject>(Value{instance}, method);
                     pop(); // Pop the instance;
                     push(Value{bound});
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::GET_ASSOC: {
+                VM_CASE(GET_ASSOC): {
                     auto *struct_ = peek(0)
                             .asObject()
                             ->as<StructObject>();
@@ -379,9 +656,9 @@ namespace enact {
 
                     pop();
                     push(assoc);
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::GET_ASSOC_LONG: {
+                VM_CASE(GET_ASSOC_LONG): {
                     auto *struct_ = peek(0)
                             .asObject()
                             ->as<StructObject>();
@@ -391,173 +668,64 @@ namespace enact {
 
                     pop();
                     push(assoc);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::GET_PROPERTY_DYNAMIC: {
-                    Value maybeObject = peek(0);
-                    if (!maybeObject.isObject()) {
-                        throw runtimeError("Only instances and constructors have properties, not a value of type '" +
-                                           maybeObject.getType()->toString() + "'.");
-                    }
-
-                    Object *object = maybeObject.asObject();
-                    const std::string &name = readConstant()
-                            .asObject()
-                            ->as<StringObject>()
-                            ->asStdString();
-
-                    if (object->is<InstanceObject>()) {
-                        auto *instance = peek(0)
-                                .asObject()
-                                ->as<InstanceObject>();
-
-                        Value property;
-
-                        if (auto field = instance->fieldNamed(name)) {
-                            property = *field;
-                        } else if (auto method = instance->getStruct()->methodNamed(name)) {
-                            auto *bound = m_context.gc.allocateObject<BoundMethodObject>(Value{instance}, *method);
-                            property = Value{bound};
-                        } else {
-                            throw runtimeError("Instance of type '" + instance->getType()->toString() +
-                                               "' does not have a property named '" + name + "'.");
-                        }
-
-                        pop(); // Pop the instance
-                        push(property);
-                    } else if (object->is<StructObject>()) {
-                        auto *struct_ = pop()
-                                .asObject()
-                                ->as<StructObject>();
-
-                        std::optional<std::reference_wrapper<Value>> assoc;
-                        if (!(assoc = struct_->assocNamed(name))) {
-                            throw runtimeError("Struct '" + assoc->get().getType()->toString() +
-                                               "' does not have an associated function named '" + name + "'.");
-                        }
-
-                        push(*assoc);
-                    } else {
-                        throw runtimeError("Only instances and constructors have properties, not a value of type '" +
-                                           object->getType()->toString() + "'.");
-                    }
-
-                    break;
+                VM_CASE(GET_PROPERTY_DYNAMIC): {
+                    uint32_t name = readByte();
+                    uint32_t cache = readByte();
+                    getPropertyDynamic(name, cache);
+                    VM_NEXT();
                 }
-                case OpCode::GET_PROPERTY_DYNAMIC_LONG: {
-                    Value maybeObject = peek(0);
-                    if (!maybeObject.isObject()) {
-                        throw runtimeError("Only instances and constructors have properties, not a value of type '" +
-                                           maybeObject.getType()->toString() + "'.");
-                    }
-
-                    Object *object = maybeObject.asObject();
-                    const std::string &name = readConstantLong()
-                            .asObject()
-                            ->as<StringObject>()
-                            ->asStdString();
-
-                    if (object->is<InstanceObject>()) {
-                        auto *instance = peek(0)
-                                .asObject()
-                                ->as<InstanceObject>();
-
-                        Value property;
-
-                        if (auto field = instance->fieldNamed(name)) {
-                            property = *field;
-                        } else if (auto method = instance->getStruct()->methodNamed(name)) {
-                            auto *bound = m_context.gc.allocateObject<BoundMethodObject>(Value{instance}, *method);
-                            property = Value{bound};
-                        } else {
-                            throw runtimeError("Instance of type '" + instance->getType()->toString() +
-                                               "' does not have a property named '" + name + "'.");
-                        }
-
-                        pop(); // Pop the instance
-                        push(property);
-                    } else if (object->is<StructObject>()) {
-                        auto *struct_ = pop()
-                                .asObject()
-                                ->as<StructObject>();
-
-                        std::optional<std::reference_wrapper<Value>> assoc;
-                        if (!(assoc = struct_->assocNamed(name))) {
-                            throw runtimeError("Struct '" + assoc->get().getType()->toString() +
-                                               "' does not have an associated function named '" + name + "'.");
-                        }
-
-                        push(*assoc);
-                    } else {
-                        throw runtimeError("Only instances and constructors have properties, not a value of type '" +
-                                           object->getType()->toString() + "'.");
-                    }
-
-                    break;
+                VM_CASE(GET_PROPERTY_DYNAMIC_LONG): {
+                    uint32_t name = readLong();
+                    uint32_t cache = readLong();
+                    getPropertyDynamic(name, cache);
+                    VM_NEXT();
                 }
 
-                case OpCode::SET_PROPERTY_DYNAMIC_LONG: {
-                    Value maybeInstance = peek(0);
-                    if (!maybeInstance.isObject() && !maybeInstance.asObject()->is<InstanceObject>()) {
-                        throw runtimeError("Only instances have assignable fields, not a value of type '" +
-                                           maybeInstance.getType()->toString() + "'.");
-                    }
-
-                    auto *instance = pop()
-                            .asObject()
-                            ->as<InstanceObject>();
-
-                    const std::string &name = readConstantLong()
-                            .asObject()
-                            ->as<StringObject>()
-                            ->asStdString();
-
-                    std::optional<std::reference_wrapper<Value>> maybeField;
-                    if (!(maybeField = instance->fieldNamed(name))) {
-                        throw runtimeError("Instance of type '" + instance->getType()->toString() +
-                                           "' does not have a field named '" + name + "'.");
-                    }
-
-                    Value &field = maybeField.value().get();
-                    Value value = peek(0);
-
-                    if (!field.getType()->looselyEquals(*value.getType())) {
-                        throw runtimeError("Cannot assign a value of type '" + value.getType()->toString() +
-                                           "' to field '" + name + "' of type '" + field.getType()->toString() + "'.");
-                    }
-
-                    field = peek(0);
-                    break;
+                VM_CASE(SET_PROPERTY_DYNAMIC): {
+                    uint32_t name = readByte();
+                    uint32_t cache = readByte();
+                    setPropertyDynamic(name, cache);
+                    VM_NEXT();
+                }
+                VM_CASE(SET_PROPERTY_DYNAMIC_LONG): {
+                    uint32_t name = readLong();
+                    uint32_t cache = readLong();
+                    setPropertyDynamic(name, cache);
+                    VM_NEXT();
                 }
 
-                case OpCode::JUMP: {
+                VM_CASE(JUMP): {
                     uint16_t jumpSize = readShort();
                     m_frame->ip += jumpSize;
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::JUMP_IF_TRUE: {
+                VM_CASE(JUMP_IF_TRUE): {
                     uint16_t jumpSize = readShort();
                     if (peek(0).asBool()) {
                         m_frame->ip += jumpSize;
                     }
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::JUMP_IF_FALSE: {
+                VM_CASE(JUMP_IF_FALSE): {
                     uint16_t jumpSize = readShort();
                     if (!peek(0).asBool()) {
                         m_frame->ip += jumpSize;
                     }
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::LOOP: {
+                VM_CASE(LOOP): {
                     uint16_t jumpSize = readShort();
                     m_frame->ip -= jumpSize;
-                    break;
+                    if (!shouldTrace && m_isJitEnabled) enterJit();
+                    if (!shouldTrace && m_isTraceJitEnabled && !enterTrace()) return false;
+                    VM_NEXT();
                 }
 
-                case OpCode::CALL_FUNCTION: {
+                VM_CASE(CALL_FUNCTION): {
                     uint8_t argCount = readByte();
                     auto *closure = peek(argCount)
                             .asObject()
@@ -565,10 +733,11 @@ namespace enact {
 
                     callFunction(closure, argCount);
                     m_frame = &m_frames[m_frameCount - 1];
-                    break;
+                    if (!shouldTrace && m_isJitEnabled) enterJit();
+                    VM_NEXT();
                 }
 
-                case OpCode::CALL_BOUND_METHOD: {
+                VM_CASE(CALL_BOUND_METHOD): {
                     uint8_t argCount = readByte();
                     auto *bound = peek(argCount)
                             .asObject()
@@ -578,103 +747,105 @@ namespace enact {
                     m_frame = &m_frames[m_frameCount - 1];
                     push(bound->receiver());
 
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::CALL_CONSTRUCTOR: {
+                VM_CASE(CALL_CONSTRUCTOR): {
                     uint8_t argCount = readByte();
                     auto *struct_ = peek(argCount)
                             .asObject()
                             ->as<StructObject>();
 
                     callConstructor(struct_, argCount);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::CALL_NATIVE: {
+                VM_CASE(CALL_NATIVE): {
                     uint8_t argCount = readByte();
                     auto *native = peek(argCount)
                             .asObject()
                             ->as<NativeObject>();
 
                     callNative(native, argCount);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::CALL_DYNAMIC: {
+                VM_CASE(CALL_DYNAMIC): {
                     uint8_t argCount = readByte();
-                    Value calleeValue = peek(argCount);
+                    callDynamic(argCount);
+                    VM_NEXT();
+                }
 
-                    if (!calleeValue.isObject()) {
-                        throw runtimeError("Only functions and constructors can be called, not a value of type '"
-                                           + calleeValue.getType()->toString() + ".");
-                    }
+                VM_CASE(INVOKE): {
+                    uint8_t argCount = readByte();
+                    uint32_t index = readByte();
+                    invokeMethod(argCount, index);
+                    VM_NEXT();
+                }
+                VM_CASE(INVOKE_LONG): {
+                    uint8_t argCount = readByte();
+                    uint32_t index = readLong();
+                    invokeMethod(argCount, index);
+                    VM_NEXT();
+                }
 
-                    Object *callee = calleeValue.asObject();
-
-                    if (callee->is<ClosureObject>()) {
-                        checkFunctionCallable(callee->getType()->as<FunctionType>(), argCount);
-                        callFunction(callee->as<ClosureObject>(), argCount);
-
-                        // TODO: incorporate this in callFunction()
-                        m_frame = &m_frames[m_frameCount - 1];
-                    } else if (callee->is<BoundMethodObject>()) {
-                        auto *bound = callee->as<BoundMethodObject>();
-                        checkFunctionCallable(bound->method()->getType()->as<FunctionType>(), argCount);
-
-                        callFunction(bound->method(), argCount);
-                        m_frame = &m_frames[m_frameCount - 1];
-                        push(bound->receiver());
-                    } else if (callee->is<StructObject>()) {
-                        checkConstructorCallable(callee->getType()->as<ConstructorType>(), argCount);
-                        callConstructor(callee->as<StructObject>(), argCount);
-                    } else if (callee->is<NativeObject>()) {
-                        // Native functions are of a regular FunctionType
-                        checkFunctionCallable(callee->getType()->as<FunctionType>(), argCount);
-                        callNative(callee->as<NativeObject>(), argCount);
-                    } else {
-                        throw runtimeError("Only functions and constructors can be called, not a value of type '"
-                                           + callee->getType()->toString() + ".");
-                    }
-                    break;
+                VM_CASE(INVOKE_DYNAMIC): {
+                    uint8_t argCount = readByte();
+                    uint32_t name = readByte();
+                    uint32_t cache = readByte();
+                    invokeDynamic(argCount, name, cache);
+                    VM_NEXT();
+                }
+                VM_CASE(INVOKE_DYNAMIC_LONG): {
+                    uint8_t argCount = readByte();
+                    uint32_t name = readLong();
+                    uint32_t cache = readLong();
+                    invokeDynamic(argCount, name, cache);
+                    VM_NEXT();
                 }
 
-                case OpCode::CLOSURE: {
+                VM_CASE(CLOSURE): {
                     FunctionObject *function = readConstant().asObject()->as<FunctionObject>();
                     encloseFunction(function);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::CLOSURE_LONG: {
+                VM_CASE(CLOSURE_LONG): {
                     FunctionObject *function = readConstantLong().asObject()->as<FunctionObject>();
                     encloseFunction(function);
-                    break;
+                    VM_NEXT();
                 }
 
-                case OpCode::CLOSE_UPVALUE:
-                    closeUpvalues(m_stack.size() - 1);
+                VM_CASE(CLOSE_UPVALUE):
+                    closeUpvalues(stackIndex(m_stackTop - 1));
                     pop();
-                    break;
+                    VM_NEXT();
 
-                case OpCode::RETURN: {
+                VM_CASE(RETURN): {
                     Value result = pop();
 
-                    closeUpvalues(m_frame->slotsBegin);
+                    closeUpvalues(stackIndex(m_frame->slots));
 
                     m_frameCount--;
                     if (m_frameCount == 0) {
                         pop();
-                        return;
+                        return true;
                     }
 
-                    m_stack.erase(m_stack.begin() + m_frame->slotsBegin, m_stack.end());
+                    m_stackTop = m_frame->slots;
                     push(result);
 
                     m_frame = &m_frames[m_frameCount - 1];
-                    break;
+
+                    // Go back into the caller's machine code, if it has any.
+                    if (!shouldTrace && m_isJitEnabled) {
+                        FunctionObject *caller = m_frame->closure->getFunction();
+                        if (caller->getJitCode()) runBaselineJit(caller);
+                    }
+                    VM_NEXT();
                 }
 
-                case OpCode::STRUCT: {
+                VM_CASE(STRUCT): {
                     auto type = std::static_pointer_cast<const ConstructorType>(
                             readConstant()
                                     .asObject()
@@ -682,9 +853,9 @@ namespace enact {
                                     ->getContainedType());
 
                     makeConstructor(type);
-                    break;
+                    VM_NEXT();
                 }
-                case OpCode::STRUCT_LONG: {
+                VM_CASE(STRUCT_LONG): {
                     auto type = std::static_pointer_cast<const ConstructorType>(
                             readConstant()
                                     .asObject()
@@ -692,36 +863,763 @@ namespace enact {
                                     ->getContainedType());
 
                     makeConstructor(type);
-                    break;
+                    VM_NEXT();
+                }
+
+                // Superinstructions keep the operands of the instructions they replace where they
+                // were, so each one reads them relative to its own position and then skips the rest.
+                VM_CASE(GET_LOCAL_GET_LOCAL): {
+                    const uint8_t *operands = m_frame->ip;
+                    push(m_frame->slots[operands[0]]);
+                    push(m_frame->slots[operands[2]]);
+                    m_frame->ip += 3;
+                    VM_NEXT();
+                }
+                VM_CASE(LESS_INT_LOCAL_CONST_JUMP): {
+                    const uint8_t *operands = m_frame->ip;
+                    bool isLess = m_frame->slots[operands[0]].asInt() < getConstant(operands[2]).asInt();
+                    push(Value{isLess});
+                    m_frame->ip += 7;
+                    if (!isLess) {
+                        m_frame->ip += static_cast<uint16_t>(operands[5] | (operands[6] << 8u));
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(ADD_INT_LOCAL_CONST_SET): {
+                    const uint8_t *operands = m_frame->ip;
+                    m_frame->slots[operands[5]] =
+                            Value{m_frame->slots[operands[0]].asInt() + getConstant(operands[2]).asInt()};
+                    m_frame->ip += 7;
+                    VM_NEXT();
                 }
 
-                case OpCode::PAUSE: {
-                    m_pc = m_frame->ip - function->getChunk().getCode().data();
+                VM_CASE(PAUSE): {
+                    m_pc = m_frame->ip - m_frame->closure->getFunction()->getChunk().getCode().data();
                     m_frameCount--;
-                    return;
+                    return true;
                 }
+#ifndef ENACT_THREADED_DISPATCH
             }
         }
+#endif
+
+#undef VM_NEXT
+#undef VM_CASE
+#undef VM_BEGIN_INSTRUCTION
+#undef QUICK_TYPE_CHECK
+#undef FLOAT_OP
+#undef INT_OP
+#undef NUMERIC_OP
     }
 
-    inline void VM::callFunction(ClosureObject *closure, uint8_t argCount) {
-        if (m_frameCount == FRAMES_MAX) {
+    template<bool shouldTrace>
+    void VM::registerLoop(FunctionObject *function) {
+        push(Value{function});
+
+        m_frame = &m_frames[m_frameCount++];
+        m_frame->closure = m_context.gc.allocateObject<ClosureObject>(function);
+        m_stack[0] = Value{m_frame->closure};
+        m_frame->ip = function->getRegisterChunk()->getCode().data();
+        m_frame->constants = function->getChunk().getConstants().data();
+        m_frame->slots = m_stack.data();
+
+        if (function->getRegisterChunk()->getFrameSize() > m_stack.size()) {
             throw runtimeError("Stack overflow.");
         }
 
+#define REGISTER_NUMERIC_OP(op) \
+            do { \
+                uint8_t dest = readByte(); \
+                Value a = m_frame->slots[readByte()]; \
+                Value b = m_frame->slots[readByte()]; \
+                if (a.isInt() && b.isInt()) { \
+                    m_frame->slots[dest] = Value{a.asInt() op b.asInt()}; \
+                } else if (a.isDouble() && b.isDouble()) { \
+                    m_frame->slots[dest] = Value{a.asDouble() op b.asDouble()}; \
+                } else if (a.isInt() && b.isDouble()) { \
+                    m_frame->slots[dest] = Value{a.asInt() op b.asDouble()}; \
+                } else { \
+                    m_frame->slots[dest] = Value{a.asDouble() op b.asInt()}; \
+                } \
+            } while (false)
+
+#define REGISTER_INT_OP(op) \
+            do { \
+                uint8_t dest = readByte(); \
+                int a = m_frame->slots[readByte()].asInt(); \
+                int b = m_frame->slots[readByte()].asInt(); \
+                m_frame->slots[dest] = Value{a op b}; \
+            } while (false)
+
+#define REGISTER_INT_CONSTANT_OP(op) \
+            do { \
+                uint8_t dest = readByte(); \
+                int a = m_frame->slots[readByte()].asInt(); \
+                int b = readConstant().asInt(); \
+                m_frame->slots[dest] = Value{a op b}; \
+            } while (false)
+
+#define REGISTER_FLOAT_OP(op) \
+            do { \
+                uint8_t dest = readByte(); \
+                double a = m_frame->slots[readByte()].asDouble(); \
+                double b = m_frame->slots[readByte()].asDouble(); \
+                m_frame->slots[dest] = Value{a op b}; \
+            } while (false)
+
+// Takes the branch when the comparison is false, just like the JUMP_IF_FALSE it was fused with.
+#define REGISTER_COMPARE_JUMP(op, readRight) \
+            do { \
+                int a = m_frame->slots[readByte()].asInt(); \
+                int b = (readRight); \
+                uint16_t jumpSize = readShort(); \
+                if (!(a op b)) { \
+                    m_frame->ip += jumpSize; \
+                } \
+            } while (false)
+
+#define VM_BEGIN_INSTRUCTION() \
+            do { \
+                if constexpr (shouldTrace) { \
+                    traceExecution(); \
+                } \
+            } while (false)
+
+#ifdef ENACT_THREADED_DISPATCH
+        // One label per opcode, in exactly the same order as they are declared in RegisterOp.
+        static void *dispatchTable[] = {
+                &&op_MOVE,
+                &&op_LOAD_CONSTANT,
+                &&op_LOAD_CONSTANT_LONG,
+                &&op_LOAD_TRUE,
+                &&op_LOAD_FALSE,
+                &&op_LOAD_NIL,
+                &&op_CHECK_INT,
+                &&op_CHECK_NUMERIC,
+                &&op_CHECK_BOOL,
+                &&op_CHECK_TYPE,
+                &&op_CHECK_TYPE_LONG,
+                &&op_NEGATE,
+                &&op_NOT,
+                &&op_ADD,
+                &&op_SUBTRACT,
+                &&op_MULTIPLY,
+                &&op_DIVIDE,
+                &&op_ADD_INT,
+                &&op_SUBTRACT_INT,
+                &&op_MULTIPLY_INT,
+                &&op_DIVIDE_INT,
+                &&op_ADD_FLOAT,
+                &&op_SUBTRACT_FLOAT,
+                &&op_MULTIPLY_FLOAT,
+                &&op_DIVIDE_FLOAT,
+                &&op_LESS,
+                &&op_GREATER,
+                &&op_EQUAL,
+                &&op_LESS_INT,
+                &&op_GREATER_INT,
+                &&op_LESS_FLOAT,
+                &&op_GREATER_FLOAT,
+                &&op_ADD_INT_CONSTANT,
+                &&op_SUBTRACT_INT_CONSTANT,
+                &&op_MULTIPLY_INT_CONSTANT,
+                &&op_DIVIDE_INT_CONSTANT,
+                &&op_LESS_INT_CONSTANT,
+                &&op_GREATER_INT_CONSTANT,
+                &&op_GET_UPVALUE,
+                &&op_SET_UPVALUE,
+                &&op_JUMP,
+                &&op_LOOP,
+                &&op_JUMP_IF_TRUE,
+                &&op_JUMP_IF_FALSE,
+                &&op_JUMP_IF_NOT_LESS_INT,
+                &&op_JUMP_IF_NOT_GREATER_INT,
+                &&op_JUMP_IF_NOT_LESS_INT_CONSTANT,
+                &&op_JUMP_IF_NOT_GREATER_INT_CONSTANT,
+                &&op_CALL_FUNCTION,
+                &&op_CALL_NATIVE,
+                &&op_CLOSURE,
+                &&op_CLOSE_UPVALUES,
+                &&op_RETURN,
+        };
+        static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == static_cast<size_t>(RegisterOp::RETURN) + 1,
+                      "The register dispatch table must have an entry for every RegisterOp.");
+
+#define VM_CASE(name) op_##name
+#define VM_NEXT() \
+            do { \
+                VM_BEGIN_INSTRUCTION(); \
+                goto *dispatchTable[readByte()]; \
+            } while (false)
+
+        VM_NEXT();
+#else
+#define VM_CASE(name) case RegisterOp::name
+#define VM_NEXT() break
+
+        for (;;) {
+            VM_BEGIN_INSTRUCTION();
+
+            switch (static_cast<RegisterOp>(readByte())) {
+#endif
+                VM_CASE(MOVE): {
+                    uint8_t dest = readByte();
+                    m_frame->slots[dest] = m_frame->slots[readByte()];
+                    VM_NEXT();
+                }
+                VM_CASE(LOAD_CONSTANT): {
+                    uint8_t dest = readByte();
+                    m_frame->slots[dest] = readConstant();
+                    VM_NEXT();
+                }
+                VM_CASE(LOAD_CONSTANT_LONG): {
+                    uint8_t dest = readByte();
+                    m_frame->slots[dest] = readConstantLong();
+                    VM_NEXT();
+                }
+                VM_CASE(LOAD_TRUE):
+                    m_frame->slots[readByte()] = Value{true};
+                    VM_NEXT();
+                VM_CASE(LOAD_FALSE):
+                    m_frame->slots[readByte()] = Value{false};
+                    VM_NEXT();
+                VM_CASE(LOAD_NIL):
+                    m_frame->slots[readByte()] = Value{};
+                    VM_NEXT();
+
+                VM_CASE(CHECK_INT): {
+                    Value value = m_frame->slots[readByte()];
+                    if (!value.isInt() && !value.getType()->isInt()) {
+                        throw runtimeError("Expected a value of type 'int', but got a value of type '"
+                                           + value.getType()->toString() + "' instead.");
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(CHECK_NUMERIC): {
+                    Value value = m_frame->slots[readByte()];
+                    if (!value.isInt() && !value.isDouble() && !value.getType()->isNumeric()) {
+                        throw runtimeError("Expected a value of type 'int' or 'float', but got a value of type '"
+                                           + value.getType()->toString() + "' instead.");
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(CHECK_BOOL): {
+                    Value value = m_frame->slots[readByte()];
+                    if (!value.isBool() && !value.getType()->isBool()) {
+                        throw runtimeError("Expected a value of type 'bool', but got a value of type '"
+                                           + value.getType()->toString() + "' instead.");
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(CHECK_TYPE): {
+                    Value value = m_frame->slots[readByte()];
+                    checkRegisterType(value, readConstant().asObject()->as<TypeObject>()->getContainedType());
+                    VM_NEXT();
+                }
+                VM_CASE(CHECK_TYPE_LONG): {
+                    Value value = m_frame->slots[readByte()];
+                    checkRegisterType(value, readConstantLong().asObject()->as<TypeObject>()->getContainedType());
+                    VM_NEXT();
+                }
+
+                VM_CASE(NEGATE): {
+                    uint8_t dest = readByte();
+                    Value value = m_frame->slots[readByte()];
+                    if (value.isInt()) {
+                        m_frame->slots[dest] = Value{-value.asInt()};
+                    } else {
+                        m_frame->slots[dest] = Value{-value.asDouble()};
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(NOT): {
+                    uint8_t dest = readByte();
+                    m_frame->slots[dest] = Value{!m_frame->slots[readByte()].asBool()};
+                    VM_NEXT();
+                }
+
+                VM_CASE(ADD):
+                    REGISTER_NUMERIC_OP(+);
+                    VM_NEXT();
+                VM_CASE(SUBTRACT):
+                    REGISTER_NUMERIC_OP(-);
+                    VM_NEXT();
+                VM_CASE(MULTIPLY):
+                    REGISTER_NUMERIC_OP(*);
+                    VM_NEXT();
+                VM_CASE(DIVIDE):
+                    REGISTER_NUMERIC_OP(/);
+                    VM_NEXT();
+
+                VM_CASE(ADD_INT):
+                    REGISTER_INT_OP(+);
+                    VM_NEXT();
+                VM_CASE(SUBTRACT_INT):
+                    REGISTER_INT_OP(-);
+                    VM_NEXT();
+                VM_CASE(MULTIPLY_INT):
+                    REGISTER_INT_OP(*);
+                    VM_NEXT();
+                VM_CASE(DIVIDE_INT):
+                    REGISTER_INT_OP(/);
+                    VM_NEXT();
+                VM_CASE(ADD_FLOAT):
+                    REGISTER_FLOAT_OP(+);
+                    VM_NEXT();
+                VM_CASE(SUBTRACT_FLOAT):
+                    REGISTER_FLOAT_OP(-);
+                    VM_NEXT();
+                VM_CASE(MULTIPLY_FLOAT):
+                    REGISTER_FLOAT_OP(*);
+                    VM_NEXT();
+                VM_CASE(DIVIDE_FLOAT):
+                    REGISTER_FLOAT_OP(/);
+                    VM_NEXT();
+
+                VM_CASE(LESS):
+                    REGISTER_NUMERIC_OP(<);
+                    VM_NEXT();
+                VM_CASE(GREATER):
+                    REGISTER_NUMERIC_OP(>);
+                    VM_NEXT();
+                VM_CASE(EQUAL): {
+                    uint8_t dest = readByte();
+                    Value a = m_frame->slots[readByte()];
+                    Value b = m_frame->slots[readByte()];
+                    m_frame->slots[dest] = Value{a == b};
+                    VM_NEXT();
+                }
+                VM_CASE(LESS_INT):
+                    REGISTER_INT_OP(<);
+                    VM_NEXT();
+                VM_CASE(GREATER_INT):
+                    REGISTER_INT_OP(>);
+                    VM_NEXT();
+                VM_CASE(LESS_FLOAT):
+                    REGISTER_FLOAT_OP(<);
+                    VM_NEXT();
+                VM_CASE(GREATER_FLOAT):
+                    REGISTER_FLOAT_OP(>);
+                    VM_NEXT();
+
+                VM_CASE(ADD_INT_CONSTANT):
+                    REGISTER_INT_CONSTANT_OP(+);
+                    VM_NEXT();
+                VM_CASE(SUBTRACT_INT_CONSTANT):
+                    REGISTER_INT_CONSTANT_OP(-);
+                    VM_NEXT();
+                VM_CASE(MULTIPLY_INT_CONSTANT):
+                    REGISTER_INT_CONSTANT_OP(*);
+                    VM_NEXT();
+                VM_CASE(DIVIDE_INT_CONSTANT):
+                    REGISTER_INT_CONSTANT_OP(/);
+                    VM_NEXT();
+                VM_CASE(LESS_INT_CONSTANT):
+                    REGISTER_INT_CONSTANT_OP(<);
+                    VM_NEXT();
+                VM_CASE(GREATER_INT_CONSTANT):
+                    REGISTER_INT_CONSTANT_OP(>);
+                    VM_NEXT();
+
+                VM_CASE(GET_UPVALUE): {
+                    uint8_t dest = readByte();
+                    UpvalueObject *upvalue = m_frame->closure->getUpvalues()[readByte()];
+                    m_frame->slots[dest] = upvalue->isClosed() ?
+                                           upvalue->getClosed() :
+                                           m_stack[upvalue->getLocation()];
+                    VM_NEXT();
+                }
+                VM_CASE(SET_UPVALUE): {
+                    UpvalueObject *upvalue = m_frame->closure->getUpvalues()[readByte()];
+                    setUpvalue(upvalue, m_frame->slots[readByte()]);
+                    VM_NEXT();
+                }
+
+                VM_CASE(JUMP): {
+                    uint16_t jumpSize = readShort();
+                    m_frame->ip += jumpSize;
+                    VM_NEXT();
+                }
+                VM_CASE(LOOP): {
+                    uint16_t jumpSize = readShort();
+                    m_frame->ip -= jumpSize;
+                    VM_NEXT();
+                }
+                VM_CASE(JUMP_IF_TRUE): {
+                    bool condition = m_frame->slots[readByte()].asBool();
+                    uint16_t jumpSize = readShort();
+                    if (condition) {
+                        m_frame->ip += jumpSize;
+                    }
+                    VM_NEXT();
+                }
+                VM_CASE(JUMP_IF_FALSE): {
+                    bool condition = m_frame->slots[readByte()].asBool();
+                    uint16_t jumpSize = readShort();
+                    if (!condition) {
+                        m_frame->ip += jumpSize;
+                    }
+                    VM_NEXT();
+                }
+
+                VM_CASE(JUMP_IF_NOT_LESS_INT):
+                    REGISTER_COMPARE_JUMP(<, m_frame->slots[readByte()].asInt());
+                    VM_NEXT();
+                VM_CASE(JUMP_IF_NOT_GREATER_INT):
+                    REGISTER_COMPARE_JUMP(>, m_frame->slots[readByte()].asInt());
+                    VM_NEXT();
+                VM_CASE(JUMP_IF_NOT_LESS_INT_CONSTANT):
+                    REGISTER_COMPARE_JUMP(<, readConstant().asInt());
+                    VM_NEXT();
+                VM_CASE(JUMP_IF_NOT_GREATER_INT_CONSTANT):
+                    REGISTER_COMPARE_JUMP(>, readConstant().asInt());
+                    VM_NEXT();
+
+                VM_CASE(CALL_FUNCTION): {
+                    uint8_t callee = readByte();
+                    readByte(); // The callee's frame size already covers its arguments.
+
+                    auto *closure = m_frame->slots[callee]
+                            .asObject()
+                            ->as<ClosureObject>();
+
+                    callRegisterFunction(closure, callee);
+                    m_frame = &m_frames[m_frameCount - 1];
+                    VM_NEXT();
+                }
+                VM_CASE(CALL_NATIVE): {
+                    uint8_t callee = readByte();
+                    uint8_t argCount = readByte();
+
+                    auto *native = m_frame->slots[callee]
+                            .asObject()
+                            ->as<NativeObject>();
+
+                    m_stackTop = m_frame->slots + callee + argCount + 1;
+                    callNative(native, argCount);
+                    VM_NEXT();
+                }
+
+                VM_CASE(CLOSURE): {
+                    uint8_t dest = readByte();
+                    FunctionObject *enclosed = readConstant().asObject()->as<FunctionObject>();
+
+                    // Everything below dest is live, so that's where the GC has to look up to.
+                    m_stackTop = m_frame->slots + dest;
+                    encloseFunction(enclosed);
+                    VM_NEXT();
+                }
+                VM_CASE(CLOSE_UPVALUES):
+                    closeUpvalues(stackIndex(m_frame->slots + readByte()));
+                    VM_NEXT();
+
+                VM_CASE(RETURN): {
+                    Value result = m_frame->slots[readByte()];
+
+                    closeUpvalues(stackIndex(m_frame->slots));
+
+                    m_frameCount--;
+                    if (m_frameCount == 0) {
+                        m_stackTop = m_stack.data();
+                        return;
+                    }
+
+                    m_frame->slots[0] = result;
+
+                    m_frame = &m_frames[m_frameCount - 1];
+                    VM_NEXT();
+                }
+#ifndef ENACT_THREADED_DISPATCH
+            }
+        }
+#endif
+
+#undef VM_NEXT
+#undef VM_CASE
+#undef VM_BEGIN_INSTRUCTION
+#undef REGISTER_COMPARE_JUMP
+#undef REGISTER_FLOAT_OP
+#undef REGISTER_INT_CONSTANT_OP
+#undef REGISTER_INT_OP
+#undef REGISTER_NUMERIC_OP
+    }
+
+    void VM::checkType(const Type &shouldBe, bool isLong) {
+        Value value = peek(0);
+        if (!shouldBe->looselyEquals(*value.getType())) {
+            throw runtimeError("Expected a value of type '" + shouldBe->toString() +
+                               "' but got a value of type '" + value.getType()->toString() + "' instead.");
+        }
+
+        // Every int, float or bool shares a single type, so once one has passed, any
+        // value with the same tag will too. Quicken the check to test only that tag.
+        const uint8_t *instruction = m_frame->ip - (isLong ? 4 : 2);
+        if (value.isInt()) {
+            rewriteInstruction(instruction, isLong ? OpCode::CHECK_TYPE_INT_LONG : OpCode::CHECK_TYPE_INT);
+        } else if (value.isDouble()) {
+            rewriteInstruction(instruction, isLong ? OpCode::CHECK_TYPE_FLOAT_LONG : OpCode::CHECK_TYPE_FLOAT);
+        } else if (value.isBool()) {
+            rewriteInstruction(instruction, isLong ? OpCode::CHECK_TYPE_BOOL_LONG : OpCode::CHECK_TYPE_BOOL);
+        }
+    }
+
+    inline void VM::deoptimise(OpCode generic) {
+        // Step back onto the quickened opcode, so that the generic one executes next.
+        --m_frame->ip;
+        rewriteInstruction(m_frame->ip, generic);
+    }
+
+    inline void VM::rewriteInstruction(const uint8_t *instruction, OpCode op) {
+        Chunk &chunk = m_frame->closure->getFunction()->getChunk();
+        chunk.rewrite(instruction - chunk.getCode().data(), op);
+    }
+
+    inline void VM::enterJit() {
+        FunctionObject *function = m_frame->closure->getFunction();
+
+        std::shared_ptr<const JitCode> &code = function->getJitCode();
+        if (!code) {
+            if (function->isJitBlacklisted() || ++function->getHotness() != m_jitThreshold) return;
+
+            code = BaselineJit::compile(function, &VM::jitCallout);
+            if (!code) return;
+        }
+
+        runBaselineJit(function);
+    }
+
+    void VM::runBaselineJit(FunctionObject *function) {
+        std::shared_ptr<const JitCode> &code = function->getJitCode();
+
+        std::optional<bool> bailedOut = runJit(*code);
+        if (!bailedOut) return;
+
+        if (!*bailedOut) {
+            function->getJitBailouts() = 0;
+        } else if (++function->getJitBailouts() == MAX_BASELINE_BAILOUTS) {
+            // The interpreter does better on its own than going in and out of the code each time.
+            code.reset();
+            function->isJitBlacklisted() = true;
+        }
+    }
+
+    std::optional<bool> VM::runJit(const JitCode &code) {
+        const uint8_t *start = m_frame->closure->getFunction()->getChunk().getCode().data();
+
+        size_t offset = m_frame->ip - start;
+        if (!code.hasEntry(offset)) return std::nullopt;
+
+        JitState state{
+                m_stackTop,
+                m_stack.data() + m_stack.size(),
+                m_frame->slots,
+                m_frame->constants,
+                this,
+                0
+        };
+
+        bool succeeded = code.run(state, offset);
+        m_stackTop = state.stackTop;
+
+        // The callout has already reported the error.
+        if (!succeeded) throw RuntimeError{};
+
+        m_frame->ip = start + state.exitOffset;
+        return code.isBailout(state.exitOffset);
+    }
+
+    inline bool VM::enterTrace() {
+        FunctionObject *function = m_frame->closure->getFunction();
+        uint32_t header = static_cast<uint32_t>(m_frame->ip - function->getChunk().getCode().data());
+
+        LoopTrace &trace = function->getLoopTraces()[header];
+        if (trace.code) {
+            runJit(*trace.code);
+            return true;
+        }
+
+        if (trace.isBlacklisted || ++trace.hotness < m_jitThreshold) return true;
+
+        m_recorder.start(function, m_frameCount, header);
+        return false;
+    }
+
+    void VM::recordTrace() {
+        FunctionObject *function = m_recorder.getFunction();
+        auto offset = static_cast<uint32_t>(m_frame->ip - m_frame->closure->getFunction()->getChunk().getCode().data());
+
+        size_t depth = m_stackTop - m_stack.data();
+        TraceRecorder::Status status = m_recorder.record(m_frameCount, offset,
+                depth > 0 ? peek(0) : Value{},
+                depth > 1 ? peek(1) : Value{});
+        if (status == TraceRecorder::Status::RECORDING) return;
+
+        LoopTrace &trace = function->getLoopTraces()[m_recorder.getHeader()];
+        if (status == TraceRecorder::Status::FINISHED) {
+            trace.code = TraceJit::compile(function, m_recorder.getHeader(), m_recorder.getSteps(), &VM::jitCallout);
+        }
+
+        // Give the loop a few more goes before leaving it to the interpreter for good.
+        if (!trace.code) {
+            trace.hotness = 0;
+            trace.isBlacklisted = ++trace.attempts == MAX_TRACE_ATTEMPTS;
+        }
+
+        m_recorder.stop();
+    }
+
+    bool VM::jitCallout(JitState *state, uint32_t offset) {
+        VM &vm = *state->vm;
+        vm.m_stackTop = state->stackTop;
+
+        const uint8_t *code = vm.m_frame->closure->getFunction()->getChunk().getCode().data();
+        vm.m_frame->ip = code + offset + 1;
+
+        // Exceptions can't unwind through the machine code, so they have to stop here.
+        try {
+            switch (static_cast<OpCode>(code[offset])) {
+                case OpCode::GET_UPVALUE: {
+                    UpvalueObject *upvalue = vm.m_frame->closure->getUpvalues()[vm.readByte()];
+                    vm.push(upvalue->isClosed() ?
+                            upvalue->getClosed() :
+                            vm.m_stack[upvalue->getLocation()]);
+                    break;
+                }
+                case OpCode::SET_UPVALUE:
+                    vm.setUpvalue(vm.m_frame->closure->getUpvalues()[vm.readByte()], vm.peek(0));
+                    break;
+                case OpCode::GET_PROPERTY_DYNAMIC: {
+                    uint32_t name = vm.readByte();
+                    uint32_t cache = vm.readByte();
+                    vm.getPropertyDynamic(name, cache);
+                    break;
+                }
+                case OpCode::SET_PROPERTY_DYNAMIC: {
+                    uint32_t name = vm.readByte();
+                    uint32_t cache = vm.readByte();
+                    vm.setPropertyDynamic(name, cache);
+                    break;
+                }
+                case OpCode::CALL_NATIVE: {
+                    uint8_t argCount = vm.readByte();
+                    vm.callNative(vm.peek(argCount).asObject()->as<NativeObject>(), argCount);
+                    break;
+                }
+                case OpCode::GET_ARRAY_INDEX: {
+                    int index = vm.pop().asInt();
+                    ArrayObject *array = vm.pop().asObject()->as<ArrayObject>();
+
+                    if (index >= array->length()) {
+                        throw vm.runtimeError("Array index '" + std::to_string(index) + "' is out of bounds for array of "
+                                              + "length '" + std::to_string(array->asVector().size()) + "'.");
+                    }
+
+                    vm.push(array->at(index));
+                    break;
+                }
+                case OpCode::SET_ARRAY_INDEX: {
+                    int index = vm.pop().asInt();
+                    ArrayObject *array = vm.pop().asObject()->as<ArrayObject>();
+
+                    if (index >= array->length()) {
+                        throw vm.runtimeError("Array index '" + std::to_string(index) + "' is out of bounds for array of "
+                                              + "length '" + std::to_string(array->asVector().size()) + "'.");
+                    }
+
+                    array->at(index) = vm.peek(0);
+                    vm.m_context.gc.writeBarrier(array, vm.peek(0));
+                    break;
+                }
+                case OpCode::CLOSURE:
+                    vm.encloseFunction(vm.readConstant().asObject()->as<FunctionObject>());
+                    break;
+                case OpCode::CLOSE_UPVALUE:
+                    vm.closeUpvalues(vm.stackIndex(vm.m_stackTop - 1));
+                    vm.pop();
+                    break;
+                default:
+                    ENACT_UNREACHABLE();
+            }
+        } catch (const RuntimeError &) {
+            return false;
+        }
+
+        state->stackTop = vm.m_stackTop;
+        return true;
+    }
+
+    inline void VM::callFunction(ClosureObject *closure, uint8_t argCount) {
+        if (m_frameCount == m_frames.size()) {
+            growFrames();
+        }
+
+        if (closure->getFunction()->getChunk().hasPendingConstants()) {
+            loadConstants(closure->getFunction());
+        }
+
         CallFrame *frame = &m_frames[m_frameCount++];
         frame->closure = closure;
         frame->ip = closure->getFunction()->getChunk().getCode().data();
+        frame->constants = closure->getFunction()->getChunk().getConstants().data();
+
+        frame->slots = m_stackTop - argCount - 1;
+    }
+
+    void VM::loadConstants(FunctionObject *function) {
+        try {
+            BytecodeReader::loadConstants(function, m_context.gc);
+        } catch (const BytecodeReader::Invalid &error) {
+            throw runtimeError(error.what());
+        }
+    }
+
+    inline void VM::callRegisterFunction(ClosureObject *closure, uint8_t callee) {
+        // Taken before growFrames() can move the current frame.
+        Value *slots = m_frame->slots + callee;
+
+        FunctionObject *function = closure->getFunction();
+        if (slots + function->getRegisterChunk()->getFrameSize() > m_stack.data() + m_stack.size()) {
+            throw runtimeError("Stack overflow.");
+        }
+
+        if (m_frameCount == m_frames.size()) {
+            growFrames();
+        }
+
+        CallFrame *frame = &m_frames[m_frameCount++];
+        frame->closure = closure;
+        frame->ip = function->getRegisterChunk()->getCode().data();
+        frame->constants = function->getChunk().getConstants().data();
+        frame->slots = slots;
+    }
 
-        frame->slotsBegin = m_stack.size() - argCount - 1;
+    void VM::checkRegisterType(Value value, const Type &shouldBe) {
+        if (!shouldBe->looselyEquals(*value.getType())) {
+            throw runtimeError("Expected a value of type '" + shouldBe->toString() +
+                               "' but got a value of type '" + value.getType()->toString() + "' instead.");
+        }
+    }
+
+    void VM::growFrames() {
+        if (m_frames.size() >= m_maxFrames) {
+            throw runtimeError("Stack overflow: exceeded the maximum call depth of " +
+                               std::to_string(m_maxFrames) + ".");
+        }
+
+        m_frames.resize(std::min(m_frames.size() * 2, m_maxFrames), CallFrame{nullptr, nullptr, nullptr, nullptr});
+
+        // Resizing may have moved every frame.
+        if (m_frameCount > 0) {
+            m_frame = &m_frames[m_frameCount - 1];
+        }
     }
 
     inline void VM::callConstructor(StructObject *struct_, uint8_t argCount) {
         auto *instance = m_context.gc.allocateObject<InstanceObject>(
                 struct_,
-                std::move(std::vector<Value>{m_stack.end() - argCount, m_stack.end()}));
+                std::move(std::vector<Value>{m_stackTop - argCount, m_stackTop}));
 
-        m_stack.erase(m_stack.end() - argCount - 1, m_stack.end());
+        m_stackTop -= argCount + 1;
 
         push(Value{instance});
     }
@@ -729,13 +1627,85 @@ namespace enact {
     inline void VM::callNative(NativeObject *native, uint8_t argCount) {
         NativeFn fn = native->getFunction();
 
-        Value result = fn(argCount, &m_stack.back() - argCount + 1);
-        m_stack.erase(m_stack.end() - argCount - 1, m_stack.end());
+        Value result = fn(argCount, m_stackTop - argCount);
+        m_stackTop -= argCount + 1;
 
         push(result);
     }
 
-    inline void VM::checkFunctionCallable(const FunctionType *type, uint8_t argCount) {
+    void VM::callDynamic(uint8_t argCount) {
+        Value calleeValue = peek(argCount);
+
+        if (!calleeValue.isObject()) {
+            throw runtimeError("Only functions and constructors can be called, not a value of type '"
+                               + calleeValue.getType()->toString() + ".");
+        }
+
+        Object *callee = calleeValue.asObject();
+
+        if (callee->is<ClosureObject>()) {
+            checkFunctionCallable(callee->getType()->as<FunctionType>(), argCount);
+            callFunction(callee->as<ClosureObject>(), argCount);
+
+            // TODO: incorporate this in callFunction()
+            m_frame = &m_frames[m_frameCount - 1];
+        } else if (callee->is<BoundMethodObject>()) {
+            auto *bound = callee->as<BoundMethodObject>();
+            checkFunctionCallable(bound->method()->getType()->as<FunctionType>(), argCount);
+
+            callFunction(bound->method(), argCount);
+            m_frame = &m_frames[m_frameCount - 1];
+            push(bound->receiver());
+        } else if (callee->is<StructObject>()) {
+            checkConstructorCallable(callee->getType()->as<ConstructorType>(), argCount);
+            callConstructor(callee->as<StructObject>(), argCount);
+        } else if (callee->is<NativeObject>()) {
+            // Native functions are of a regular FunctionType
+            checkFunctionCallable(callee->getType()->as<FunctionType>(), argCount);
+            callNative(callee->as<NativeObject>(), argCount);
+        } else {
+            throw runtimeError("Only functions and constructors can be called, not a value of type '"
+                               + callee->getType()->toString() + ".");
+        }
+    }
+
+    inline void VM::invokeMethod(uint8_t argCount, uint32_t index) {
+        Value receiver = peek(argCount);
+        ClosureObject *method = receiver
+                .asObject()
+                ->as<InstanceObject>()
+                ->getStruct()
+                ->method(index);
+
+        callMethod(receiver, method, argCount);
+    }
+
+    void VM::invokeDynamic(uint8_t argCount, uint32_t nameIndex, uint32_t cacheIndex) {
+        Value receiver = peek(argCount);
+        PropertyCacheEntry entry = findPropertyDynamic(receiver, nameIndex, cacheIndex);
+
+        if (entry.kind == PropertyKind::METHOD) {
+            ClosureObject *method = entry.struct_->method(entry.index);
+            checkFunctionCallable(method->getType()->as<FunctionType>(), argCount);
+            callMethod(receiver, method, argCount);
+            return;
+        }
+
+        // Anything else is called just like CALL_DYNAMIC would, in place of the receiver.
+        m_stackTop[-1 - argCount] = entry.kind == PropertyKind::FIELD
+                ? receiver.asObject()->as<InstanceObject>()->field(entry.index)
+                : entry.struct_->assoc(entry.index);
+        callDynamic(argCount);
+    }
+
+    inline void VM::callMethod(Value receiver, ClosureObject *method, uint8_t argCount) {
+        // The receiver takes the callee's place in slot 0, and is pushed once more as `self`.
+        callFunction(method, argCount);
+        m_frame = &m_frames[m_frameCount - 1];
+        push(receiver);
+    }
+
+    void VM::checkFunctionCallable(const FunctionType *type, uint8_t argCount) {
         const std::vector<Type> &paramTypes = type->getArgumentTypes();
 
         if (argCount != paramTypes.size()) {
@@ -759,7 +1729,7 @@ namespace enact {
         }
     }
 
-    inline void VM::checkConstructorCallable(const ConstructorType *type, uint8_t argCount) {
+    void VM::checkConstructorCallable(const ConstructorType *type, uint8_t argCount) {
         std::vector<std::reference_wrapper<const Type>> paramTypes = type
                 ->getStructType()
                 ->getFields()
@@ -786,7 +1756,7 @@ namespace enact {
         }
     }
 
-    inline void VM::encloseFunction(FunctionObject *function) {
+    void VM::encloseFunction(FunctionObject *function) {
         push(Value{function});
         auto *closure = m_context.gc.allocateObject<ClosureObject>(function);
         pop();
@@ -802,16 +1772,19 @@ namespace enact {
             }
 
             if (isLocal) {
-                closure->getUpvalues()[i] = captureUpvalue(m_frame->slotsBegin + index);
+                closure->getUpvalues()[i] = captureUpvalue(stackIndex(m_frame->slots) + index);
             } else {
                 closure->getUpvalues()[i] = m_frame->closure->getUpvalues()[i];
             }
+
+            // Capturing an upvalue allocates, which could have promoted the closure.
+            m_context.gc.writeBarrier(closure, closure->getUpvalues()[i]);
         }
     }
 
-    inline void VM::makeConstructor(std::shared_ptr<const ConstructorType> type) {
+    void VM::makeConstructor(std::shared_ptr<const ConstructorType> type) {
         // Collect methods
-        size_t methodsBeginIndex = m_stack.size();
+        Value *methodsBegin = m_stackTop;
         size_t methodCount = type->getStructType()->getMethods().length();
         for (uint32_t i = 0; i < methodCount; ++i) {
             auto *function = readConstant().asObject()->as<FunctionObject>();
@@ -819,7 +1792,7 @@ namespace enact {
         }
 
         // Collect assocs
-        size_t assocsBeginIndex = m_stack.size();
+        Value *assocsBegin = m_stackTop;
         size_t assocCount = type->getAssocProperties().length();
         for (uint32_t i = 0; i < assocCount; ++i) {
             auto *function = readConstant().asObject()->as<FunctionObject>();
@@ -827,69 +1800,208 @@ namespace enact {
         }
 
         // Move methods off the stack
-        auto methodsBegin = m_stack.begin() + methodsBeginIndex;
-        auto methodsEnd = m_stack.begin() + methodsBeginIndex + methodCount;
+        Value *methodsEnd = methodsBegin + methodCount;
         std::vector<ClosureObject *> methods{};
-        for (auto it = methodsBegin; it != methodsEnd; ++it) {
+        for (Value *it = methodsBegin; it != methodsEnd; ++it) {
             methods.push_back(it->asObject()->as<ClosureObject>());
         }
 
         // Move assocs off the stack
-        auto assocsBegin = m_stack.begin() + assocsBeginIndex;
-        auto assocsEnd = m_stack.begin() + assocsBeginIndex + assocCount;
+        Value *assocsEnd = assocsBegin + assocCount;
         std::vector<Value> assocs{assocsBegin, assocsEnd};
 
         auto *struct_ = m_context.gc.allocateObject<StructObject>(type, std::move(methods), std::move(assocs));
 
         // Erase the moved elements
-        m_stack.erase(methodsBegin, assocsEnd);
+        m_stackTop = methodsBegin;
 
         push(Value{struct_});
     }
 
+    inline PropertyCacheEntry VM::findPropertyDynamic(Value receiver, uint32_t nameIndex, uint32_t cacheIndex) {
+        if (!receiver.isObject()) {
+            throw runtimeError("Only instances and constructors have properties, not a value of type '" +
+                               receiver.getType()->toString() + "'.");
+        }
+
+        Object *object = receiver.asObject();
+        bool isInstance = object->is<InstanceObject>();
+
+        StructObject *struct_;
+        if (isInstance) {
+            struct_ = object->as<InstanceObject>()->getStruct();
+        } else if (object->is<StructObject>()) {
+            struct_ = object->as<StructObject>();
+        } else {
+            throw runtimeError("Only instances and constructors have properties, not a value of type '" +
+                               object->getType()->toString() + "'.");
+        }
+
+        PropertyCache &cache = m_frame->closure->getFunction()->getChunk().getPropertyCache(cacheIndex);
+        if (const PropertyCacheEntry *cached = cache.find(struct_, isInstance)) {
+            return *cached;
+        }
+
+        PropertyCacheEntry entry = resolveProperty(struct_, isInstance, nameIndex);
+        cache.insert(entry);
+        m_context.gc.writeBarrier(m_frame->closure->getFunction(), entry.struct_);
+        return entry;
+    }
+
+    void VM::getPropertyDynamic(uint32_t nameIndex, uint32_t cacheIndex) {
+        Value receiver = peek(0);
+        PropertyCacheEntry entry = findPropertyDynamic(receiver, nameIndex, cacheIndex);
+
+        Value property;
+        switch (entry.kind) {
+            case PropertyKind::FIELD:
+                property = receiver.asObject()->as<InstanceObject>()->field(entry.index);
+                break;
+            case PropertyKind::METHOD:
+                property = Value{m_context.gc.allocateObject<BoundMethodObject>(
+                        receiver, entry.struct_->method(entry.index))};
+                break;
+            case PropertyKind::ASSOC:
+                property = entry.struct_->assoc(entry.index);
+                break;
+        }
+
+        pop(); // Pop the instance or struct
+        push(property);
+    }
+
+    PropertyCacheEntry VM::resolveProperty(StructObject *struct_, bool isInstance, uint32_t nameIndex) {
+        const std::string &name = propertyName(nameIndex);
+
+        auto constructorType = struct_->getType()->as<ConstructorType>();
+
+        if (isInstance) {
+            auto structType = constructorType->getStructType();
+            if (auto index = structType->findField(name)) {
+                return {struct_, PropertyKind::FIELD, static_cast<uint32_t>(*index)};
+            }
+            if (auto index = structType->findMethod(name)) {
+                return {struct_, PropertyKind::METHOD, static_cast<uint32_t>(*index)};
+            }
+
+            throw runtimeError("Instance of type '" + structType->toString() +
+                               "' does not have a property named '" + name + "'.");
+        }
+
+        if (auto index = constructorType->findAssocProperty(name)) {
+            return {struct_, PropertyKind::ASSOC, static_cast<uint32_t>(*index)};
+        }
+
+        throw runtimeError("Struct '" + constructorType->toString() +
+                           "' does not have an associated function named '" + name + "'.");
+    }
+
+    void VM::setPropertyDynamic(uint32_t nameIndex, uint32_t cacheIndex) {
+        Value maybeInstance = peek(0);
+        if (!maybeInstance.isObject() || !maybeInstance.asObject()->is<InstanceObject>()) {
+            throw runtimeError("Only instances have assignable fields, not a value of type '" +
+                               maybeInstance.getType()->toString() + "'.");
+        }
+
+        auto *instance = maybeInstance.asObject()->as<InstanceObject>();
+        StructObject *struct_ = instance->getStruct();
+
+        PropertyCache &cache = m_frame->closure->getFunction()->getChunk().getPropertyCache(cacheIndex);
+
+        uint32_t index;
+        if (const PropertyCacheEntry *cached = cache.find(struct_, true)) {
+            index = cached->index;
+        } else {
+            const std::string &name = propertyName(nameIndex);
+
+            auto structType = instance->getType()->as<StructType>();
+            std::optional<size_t> maybeIndex = structType->findField(name);
+            if (!maybeIndex) {
+                throw runtimeError("Instance of type '" + structType->toString() +
+                                   "' does not have a field named '" + name + "'.");
+            }
+
+            index = static_cast<uint32_t>(*maybeIndex);
+            cache.insert({struct_, PropertyKind::FIELD, index});
+            m_context.gc.writeBarrier(m_frame->closure->getFunction(), struct_);
+        }
+
+        pop(); // Pop the instance
+
+        Value &field = instance->field(index);
+        Value value = peek(0);
+
+        // Values of the same primitive kind trivially have the same type, so we can skip building them.
+        bool isSameKind = (field.isInt() && value.isInt()) ||
+                          (field.isDouble() && value.isDouble()) ||
+                          (field.isBool() && value.isBool());
+
+        if (!isSameKind && !field.getType()->looselyEquals(*value.getType())) {
+            throw runtimeError("Cannot assign a value of type '" + value.getType()->toString() +
+                               "' to field '" + propertyName(nameIndex) + "' of type '" +
+                               field.getType()->toString() + "'.");
+        }
+
+        field = value;
+        m_context.gc.writeBarrier(instance, value);
+    }
+
+    inline const std::string &VM::propertyName(uint32_t nameIndex) {
+        return m_frame->constants[nameIndex]
+                .asObject()
+                ->as<StringObject>()
+                ->asStdString();
+    }
+
     inline uint8_t VM::readByte() {
         return *m_frame->ip++;
     }
 
+    // The bytes are read one statement at a time, since the order that the operands of | are
+    // evaluated in isn't specified.
     inline uint16_t VM::readShort() {
-        return static_cast<uint16_t>(readByte() | (readByte() << 8u));
+        uint16_t low = readByte();
+        uint16_t high = readByte();
+        return static_cast<uint16_t>(low | (high << 8u));
     }
 
     inline uint32_t VM::readLong() {
-        return static_cast<uint32_t>(readByte() | (readByte() << 8u) | (readByte() << 16u));
+        uint32_t low = readByte();
+        uint32_t middle = readByte();
+        uint32_t high = readByte();
+        return low | (middle << 8u) | (high << 16u);
     }
 
     inline Value VM::readConstant() {
-        return m_frame
-                ->closure
-                ->getFunction()
-                ->getChunk()
-                .getConstants()
-        [readByte()];
+        return getConstant(readByte());
+    }
+
+    inline Value VM::getConstant(uint32_t index) {
+        return m_frame->constants[index];
     }
 
     inline Value VM::readConstantLong() {
-        return m_frame
-                ->closure
-                ->getFunction()
-                ->getChunk()
-                .getConstants()
-        [readLong()];
+        return getConstant(readLong());
+    }
+
+    inline void VM::push(Value value) {
+        if (m_stackTop == m_stack.data() + m_stack.size()) {
+            throw runtimeError("Stack overflow.");
+        }
+        *m_stackTop++ = value;
     }
 
-    void VM::push(Value value) {
-        m_stack.push_back(value);
+    inline Value VM::pop() {
+        ENACT_ASSERT(m_stackTop != m_stack.data(), "Stack underflow!");
+        return *--m_stackTop;
     }
 
-    Value VM::pop() {
-        ENACT_ASSERT(!m_stack.empty(), "Stack underflow!");
-        Value value = m_stack.back();
-        m_stack.pop_back();
-        return value;
+    inline Value VM::peek(size_t depth) {
+        return m_stackTop[-1 - static_cast<ptrdiff_t>(depth)];
     }
 
-    Value VM::peek(size_t depth) {
-        return m_stack[m_stack.size() - 1 - depth];
+    inline uint32_t VM::stackIndex(const Value *slot) const {
+        return static_cast<uint32_t>(slot - m_stack.data());
     }
 
     UpvalueObject *VM::captureUpvalue(uint32_t location) {
@@ -919,14 +2031,53 @@ namespace enact {
         while (m_openUpvalues != nullptr && m_openUpvalues->getLocation() >= last) {
             UpvalueObject *upvalue = m_openUpvalues;
             upvalue->setClosed(m_stack[upvalue->getLocation()]);
+            m_context.gc.writeBarrier(upvalue, upvalue->getClosed());
             m_openUpvalues = upvalue->getNext();
         }
     }
 
+    inline void VM::setUpvalue(UpvalueObject *upvalue, Value value) {
+        if (upvalue->isClosed()) {
+            upvalue->setClosed(value);
+            m_context.gc.writeBarrier(upvalue, value);
+        } else {
+            m_stack[upvalue->getLocation()] = value;
+        }
+    }
+
+    void VM::traceExecution() {
+        if (m_isRegisterMode) {
+            // Registers past the ones in use can hold anything, so only the instruction is shown.
+            FunctionObject *function = m_frame->closure->getFunction();
+            const RegisterChunk &registers = *function->getRegisterChunk();
+            std::cout << registers.disassembleInstruction(
+                    m_frame->ip - registers.getCode().data(), function->getChunk().getConstants()).first;
+            return;
+        }
+
+        if (m_isProfiling) {
+            m_profile.record(static_cast<OpCode>(*m_frame->ip));
+        }
+
+        if (m_recorder.isRecording()) {
+            recordTrace();
+        }
+
+        if (!m_isTracing) return;
+
+        std::cout << "    ";
+        for (Value *slot = m_stack.data(); slot != m_stackTop; ++slot) {
+            std::cout << "[ " << *slot << " ] ";
+        }
+        std::cout << "\n";
+
+        std::cout << m_frame->closure->getFunction()->getChunk()
+                .disassembleInstruction(
+                        m_frame->ip - m_frame->closure->getFunction()->getChunk().getCode().data()).first;
+    }
+
     VM::RuntimeError VM::runtimeError(const std::string &msg) {
-        CallFrame *frame = &m_frames[m_frameCount - 1];
-        size_t instruction = frame->ip - frame->closure->getFunction()->getChunk().getCode().data();
-        line_t line = frame->closure->getFunction()->getChunk().getLine(instruction);
+        line_t line = frameLine(m_frames[m_frameCount - 1], true);
 
         const std::string source = m_context.getSourceLine(line);
 
@@ -936,12 +2087,18 @@ namespace enact {
         }
         std::cerr << "\n" << msg << "\n";
         for (int i = m_frameCount - 1; i >= 0; --i) {
+            // Deep recursion can leave thousands of frames behind, so only show both ends of the stack.
+            if (m_frameCount > TRACEBACK_FRAMES * 2 && i == m_frameCount - 1 - TRACEBACK_FRAMES) {
+                size_t skipped = m_frameCount - TRACEBACK_FRAMES * 2;
+                std::cerr << "... " << skipped << " more frames ...\n";
+                i = TRACEBACK_FRAMES;
+                continue;
+            }
+
             CallFrame *frame = &m_frames[i];
             FunctionObject *function = frame->closure->getFunction();
 
-            // -1 because the IP is sitting on the next instruction to be executed
-            size_t instruction = frame->ip - function->getChunk().getCode().data() - 1;
-            std::cerr << "[line " << function->getChunk().getLine(instruction) << "] in ";
+            std::cerr << "[line " << frameLine(*frame, false) << "] in ";
             if (function->getName().empty()) {
                 std::cerr << "script\n";
             } else {
@@ -951,4 +2108,19 @@ namespace enact {
 
         return RuntimeError{};
     }
-}
\ No newline at end of file
+
+    line_t VM::frameLine(const CallFrame &frame, bool isCurrent) const {
+        FunctionObject *function = frame.closure->getFunction();
+
+        // Register instructions are read whole before they run, so the ip is always past the
+        // one that is running.
+        if (m_isRegisterMode) {
+            const RegisterChunk &registers = *function->getRegisterChunk();
+            return registers.getLine(frame.ip - registers.getCode().data() - 1);
+        }
+
+        // -1 because the IP is sitting on the next instruction to be executed
+        size_t instruction = frame.ip - function->getChunk().getCode().data() - (isCurrent ? 0 : 1);
+        return function->getChunk().getLine(instruction);
+    }
+}
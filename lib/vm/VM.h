@@ -1,62 +1,171 @@
 #ifndef ENACT_VM_H
 #define ENACT_VM_H
 
-#include <array>
+#include <vector>
 #include <optional>
 
 #include "../bytecode/Chunk.h"
 #include "../common.h"
+#include "../jit/BaselineJit.h"
+#include "../jit/TraceJit.h"
 #include "../value/Object.h"
 #include "../value/Value.h"
+#include "OpcodeProfile.h"
 
 namespace enact {
     class CompileContext;
 
     enum class CompileResult;
 
-    constexpr size_t FRAMES_MAX = 64;
+    // How many call frames the VM starts out with room for. The frame stack grows past this
+    // on demand, up to the limit set in Options.
+    constexpr size_t INITIAL_FRAMES = 64;
+
+    // How many frames from each end of the call stack are printed with a runtime error.
+    constexpr size_t TRACEBACK_FRAMES = 16;
 
     struct CallFrame {
         ClosureObject *closure;
         const uint8_t *ip;
-        size_t slotsBegin;
+        Value *slots;
+
+        // The closure's constant pool, cached so that loading a constant doesn't have to
+        // go through the closure and its function.
+        const Value *constants;
     };
 
     class VM {
         friend class GC;
+        friend class SnapshotReader;
+        friend class SnapshotWriter;
 
         CompileContext &m_context;
 
-        std::vector<Value> m_stack{};
+        // Allocated once, at the size given by Options, and never resized. This keeps every
+        // Value * into the stack (like CallFrame::slots) valid for the lifetime of the VM.
+        std::vector<Value> m_stack;
+        Value *m_stackTop;
 
-        std::array<CallFrame, FRAMES_MAX> m_frames{CallFrame{nullptr, nullptr, 0}};
+        std::vector<CallFrame> m_frames;
         size_t m_frameCount = 0;
+        size_t m_maxFrames;
         CallFrame *m_frame = nullptr;
 
         UpvalueObject *m_openUpvalues = nullptr;
 
         size_t m_pc = 0;
 
-        void executionLoop(FunctionObject *function);
+        bool m_isTracing = false;
+        bool m_isProfiling = false;
+        OpcodeProfile m_profile;
+
+        // Whether the running program was lowered for the register backend, in which case
+        // every frame's ip points into a RegisterChunk instead of a Chunk.
+        bool m_isRegisterMode = false;
+
+        // Functions are handed to BaselineJit once they have been called or looped this many
+        // times. The JIT is never used while tracing or profiling, which need every instruction
+        // to go through the interpreter.
+        bool m_isJitEnabled = false;
+        uint32_t m_jitThreshold = 0;
+
+        // With --tracing-jit, loops are recorded and compiled by TraceJit once their backedges
+        // reach the same threshold, and BaselineJit isn't used.
+        bool m_isTraceJitEnabled = false;
+        TraceRecorder m_recorder{};
+
+        // Sets up the frame for the script, or resumes it from m_pc.
+        void enterScript(FunctionObject *function);
+
+        // Instantiated twice by run(): once with tracing and profiling compiled in, and
+        // once without for normal execution. Returns false when the other one should carry
+        // on from the current frame's ip, which is how recording a trace starts and stops.
+        template<bool shouldTrace>
+        bool executionLoop();
+
+        // The same for the register backend. Values stay in their frame's registers and the
+        // stack top is only moved to just above them when something (like the GC) looks at it.
+        template<bool shouldTrace>
+        void registerLoop(FunctionObject *function);
 
     public:
         explicit VM(CompileContext &context);
 
         CompileResult run(FunctionObject *function);
 
+        // Throws if the value on top of the stack isn't of the given type, and otherwise
+        // quickens the CHECK_TYPE(_LONG) instruction that was just read.
+        void checkType(const Type &shouldBe, bool isLong);
+
+        inline void deoptimise(OpCode generic);
+
+        inline void rewriteInstruction(const uint8_t *instruction, OpCode op);
+
+        // Counts a call or backedge of the current frame's function, compiling it once it is hot,
+        // and then runs its machine code from the frame's ip if there is any.
+        inline void enterJit();
+
+        // Runs the function's BaselineJit code, and throws it away if it keeps bailing out.
+        void runBaselineJit(FunctionObject *function);
+
+        // Runs the code from the current frame's ip. Returns whether it exited at a failed
+        // guard, or nothing if it can't be entered there.
+        std::optional<bool> runJit(const JitCode &code);
+
+        // Counts a backedge to the loop header that the current frame's ip points to, and runs
+        // its trace if it has one. Returns false if it has started recording one instead.
+        inline bool enterTrace();
+
+        // Hands the instruction about to run to m_recorder, and compiles the trace once it
+        // has gone round the loop.
+        void recordTrace();
+
+        // Runs the slow path of an instruction for jitted code. See JitCallout.
+        static bool jitCallout(JitState *state, uint32_t offset);
+
         inline void callFunction(ClosureObject *closure, uint8_t argCount);
 
+        // Reads the constants of a function mapped from a bytecode cache the first time it's called.
+        void loadConstants(FunctionObject *function);
+
+        void growFrames();
+
+        // Calls a closure whose frame starts at the given register of the current one.
+        inline void callRegisterFunction(ClosureObject *closure, uint8_t callee);
+
+        void checkRegisterType(Value value, const Type &shouldBe);
+
         inline void callConstructor(StructObject *struct_, uint8_t argCount);
 
         inline void callNative(NativeObject *native, uint8_t argCount);
 
-        inline void checkFunctionCallable(const FunctionType *type, uint8_t argCount);
+        void callDynamic(uint8_t argCount);
+
+        // Call a method on the receiver below its arguments, without binding it first.
+        inline void invokeMethod(uint8_t argCount, uint32_t index);
+
+        void invokeDynamic(uint8_t argCount, uint32_t nameIndex, uint32_t cacheIndex);
+
+        inline void callMethod(Value receiver, ClosureObject *method, uint8_t argCount);
+
+        void checkFunctionCallable(const FunctionType *type, uint8_t argCount);
+
+        void checkConstructorCallable(const ConstructorType *type, uint8_t argCount);
+
+        void encloseFunction(FunctionObject *function);
 
-        inline void checkConstructorCallable(const ConstructorType *type, uint8_t argCount);
+        void makeConstructor(std::shared_ptr<const ConstructorType> type);
 
-        inline void encloseFunction(FunctionObject *function);
+        inline PropertyCacheEntry findPropertyDynamic(Value receiver, uint32_t nameIndex, uint32_t cacheIndex);
 
-        inline void makeConstructor(std::shared_ptr<const ConstructorType> type);
+        void getPropertyDynamic(uint32_t nameIndex, uint32_t cacheIndex);
+
+        // The slow path of getPropertyDynamic(), which looks the property up by name.
+        PropertyCacheEntry resolveProperty(StructObject *struct_, bool isInstance, uint32_t nameIndex);
+
+        void setPropertyDynamic(uint32_t nameIndex, uint32_t cacheIndex);
+
+        inline const std::string &propertyName(uint32_t nameIndex);
 
         inline uint8_t readByte();
 
@@ -68,16 +177,22 @@ namespace enact {
 
         inline Value readConstantLong();
 
-        void push(Value value);
+        inline Value getConstant(uint32_t index);
+
+        inline void push(Value value);
 
-        Value pop();
+        inline Value pop();
 
-        Value peek(size_t depth);
+        inline Value peek(size_t depth);
+
+        inline uint32_t stackIndex(const Value *slot) const;
 
         UpvalueObject *captureUpvalue(uint32_t location);
 
         void closeUpvalues(uint32_t last);
 
+        inline void setUpvalue(UpvalueObject *upvalue, Value value);
+
     private:
         class RuntimeError : public std::runtime_error {
         public:
@@ -86,6 +201,12 @@ namespace enact {
         };
 
         RuntimeError runtimeError(const std::string &msg);
+
+        // The line of the instruction a frame is running. isCurrent is false for frames
+        // waiting on a call, whose ip has already moved past it.
+        line_t frameLine(const CallFrame &frame, bool isCurrent) const;
+
+        void traceExecution();
     };
 }
 
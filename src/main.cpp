@@ -1,20 +1,31 @@
 //#include "../include/Enact.h"
 #include "../lib/context/CompileContext.h"
 
+static int runPrompt(enact::CompileContext &context) {
+    while (true) {
+        std::cout << "enact > ";
+        std::string input;
+        if (!std::getline(std::cin, input)) break;
+
+        context.compile(input);
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     //enact::Options options{argc, argv};
     //enact::CompileContext context{options};
 
     //return static_cast<int>(context.run());
 
-    enact::Options options{argc, argv};
-    enact::CompileContext context{options};
-
-    while (true) {
-        std::cout << "enact > ";
-        std::string input;
-        std::getline(std::cin, input);
+    try {
+        enact::Options options{argc, argv};
+        enact::CompileContext context{options};
 
-        context.compile(input);
+        return runPrompt(context);
+    } catch (const enact::FlagsError &) {
+        // Options has already said what was wrong with the flags.
+        return 1;
     }
 }
\ No newline at end of file